@@ -0,0 +1,432 @@
+#include "command_processor.h"
+
+// Global command processor instance
+static command_processor_t g_cmd_processor = {0};
+
+// Function to trim whitespace from strings
+static void trim_whitespace(char *str)
+{
+    if (!str)
+        return;
+
+    // Trim leading whitespace
+    char *start = str;
+    while (isspace((unsigned char)*start))
+        start++;
+
+    // Move string to beginning if needed
+    if (start != str)
+    {
+        memmove(str, start, strlen(start) + 1);
+    }
+
+    // Trim trailing whitespace
+    char *end = str + strlen(str) - 1;
+    while (end > str && isspace((unsigned char)*end))
+        end--;
+    end[1] = '\0';
+}
+
+command_type_t classify_command(const char *command_text)
+{
+    if (!command_text)
+    {
+        return CMD_TYPE_UNKNOWN;
+    }
+
+    char temp_cmd[MAX_COMMAND_LENGTH];
+    strncpy(temp_cmd, command_text, sizeof(temp_cmd) - 1);
+    temp_cmd[sizeof(temp_cmd) - 1] = '\0';
+    trim_whitespace(temp_cmd);
+
+    // Check for time synchronization commands
+    if (validate_timestamp_format(temp_cmd))
+    {
+        return CMD_TYPE_TIME_SYNC;
+    }
+
+    // Check for CSI configuration commands (could be extended)
+    if (strncmp(temp_cmd, "CSI_", 4) == 0)
+    {
+        return CMD_TYPE_CSI_CONFIG;
+    }
+
+    // Check for help commands
+    if (strcasecmp(temp_cmd, "help") == 0 || strcasecmp(temp_cmd, "?") == 0)
+    {
+        return CMD_TYPE_HELP;
+    }
+
+    // Check for system info commands
+    if (strcasecmp(temp_cmd, "status") == 0 || strcasecmp(temp_cmd, "info") == 0)
+    {
+        return CMD_TYPE_SYSTEM_INFO;
+    }
+
+    return CMD_TYPE_UNKNOWN;
+}
+
+void display_help_information()
+{
+    printf("\n=== Available Commands ===\n");
+    printf("Time Sync: SYNC_TIME: <seconds>.<microseconds>\n");
+    printf("Simple Time: <seconds>.<microseconds>\n");
+    printf("System Info: status, info\n");
+    printf("Help: help, ?\n");
+    for (int index = 0; index < g_cmd_processor.csi_command_count; index++)
+    {
+        printf("CSI Config: %s %s\n", g_cmd_processor.csi_commands[index].name,
+               g_cmd_processor.csi_commands[index].usage);
+    }
+    printf("===========================\n\n");
+}
+
+bool register_csi_command(const char *name, const char *usage, csi_command_handler_t handler)
+{
+    if (!name || !handler || g_cmd_processor.csi_command_count >= MAX_CSI_COMMANDS)
+    {
+        return false;
+    }
+
+    csi_command_entry_t *entry = &g_cmd_processor.csi_commands[g_cmd_processor.csi_command_count++];
+    entry->name = name;
+    entry->usage = usage ? usage : "";
+    entry->handler = handler;
+    return true;
+}
+
+bool execute_csi_command(const char *command_text)
+{
+    char temp_cmd[MAX_COMMAND_LENGTH];
+    strncpy(temp_cmd, command_text, sizeof(temp_cmd) - 1);
+    temp_cmd[sizeof(temp_cmd) - 1] = '\0';
+    trim_whitespace(temp_cmd);
+
+    // Split the command name from its arguments
+    char *arguments = temp_cmd;
+    while (*arguments && !isspace((unsigned char)*arguments))
+        arguments++;
+    if (*arguments)
+    {
+        *arguments++ = '\0';
+        while (isspace((unsigned char)*arguments))
+            arguments++;
+    }
+
+    for (int index = 0; index < g_cmd_processor.csi_command_count; index++)
+    {
+        if (strcasecmp(temp_cmd, g_cmd_processor.csi_commands[index].name) == 0)
+        {
+            return g_cmd_processor.csi_commands[index].handler(arguments);
+        }
+    }
+
+    printf("Unknown CSI command: %s\n", temp_cmd);
+    return false;
+}
+
+// CSI_ALLOW <ADD|DEL> <mac> | LIST | CLEAR - edit the persisted station allowlist
+static bool handle_allowlist_command(const char *arguments)
+{
+    char action[8] = {0};
+    char mac_text[20] = {0};
+    uint8_t mac[6];
+    sscanf(arguments, "%7s %19s", action, mac_text);
+
+    if (strcasecmp(action, "LIST") == 0)
+    {
+        mac_allowlist_print();
+        return true;
+    }
+
+    esp_err_t result;
+    if (strcasecmp(action, "CLEAR") == 0)
+    {
+        mac_allowlist_clear();
+        result = ESP_OK;
+    }
+    else if ((strcasecmp(action, "ADD") == 0 || strcasecmp(action, "DEL") == 0) && parse_mac_address(mac_text, mac))
+    {
+        result = (strcasecmp(action, "ADD") == 0) ? mac_allowlist_add(mac) : mac_allowlist_remove(mac);
+    }
+    else
+    {
+        printf("Usage: CSI_ALLOW <ADD|DEL> <aa:bb:cc:dd:ee:ff> | LIST | CLEAR\n");
+        return false;
+    }
+
+    if (result != ESP_OK)
+    {
+        printf("Allowlist update failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    result = mac_allowlist_save();
+    printf("Allowlist updated (%u entries)%s\n", mac_allowlist_count(),
+           result == ESP_OK ? "" : ", but saving to NVS failed");
+    return true;
+}
+
+void display_system_status()
+{
+    printf("\n=== System Status ===\n");
+    printf("Time Synchronized: %s\n", is_time_synchronized() ? "Yes" : "No");
+    printf("Commands Processed: %d\n", g_cmd_processor.commands_processed);
+
+    int64_t current_time_us = get_timestamp_microseconds();
+    if (current_time_us >= 0)
+    {
+        char current_time[TIMESTAMP_STRING_LENGTH];
+        format_timestamp_microseconds(current_time_us, current_time, sizeof(current_time));
+        printf("Current Timestamp: %s\n", current_time);
+    }
+    else
+    {
+        printf("Current Timestamp: unavailable\n");
+    }
+
+    csi_config_t csi_config = get_csi_configuration();
+    printf("CSI Mode: %d\n", csi_config.mode);
+    printf("Device Role: %s\n", csi_config.device_role);
+    pipeline_stats_print();
+    csi_sink_print();
+    printf("====================\n\n");
+}
+
+bool execute_classified_command(const char *command_text, command_type_t cmd_type)
+{
+    bool command_handled = false;
+
+    switch (cmd_type)
+    {
+    case CMD_TYPE_TIME_SYNC:
+    {
+        // Compensate for the time since the line arrived, then report
+        int64_t elapsed_us = g_cmd_processor.command_received_us >= 0
+                                 ? esp_timer_get_time() - g_cmd_processor.command_received_us
+                                 : 0;
+        command_handled = synchronize_system_time_compensated(command_text, elapsed_us);
+        printf("Processed time synchronization: %s (+%lld us)\n", command_text, (long long)elapsed_us);
+        break;
+    }
+
+    case CMD_TYPE_HELP:
+        display_help_information();
+        command_handled = true;
+        break;
+
+    case CMD_TYPE_SYSTEM_INFO:
+        display_system_status();
+        command_handled = true;
+        break;
+
+    case CMD_TYPE_CSI_CONFIG:
+        command_handled = execute_csi_command(command_text);
+        break;
+
+    case CMD_TYPE_UNKNOWN:
+    default:
+        printf("Unrecognized command: %s\n", command_text);
+        printf("Type 'help' for available commands\n");
+        break;
+    }
+
+    if (command_handled)
+    {
+        g_cmd_processor.commands_processed++;
+    }
+
+    return command_handled;
+}
+
+bool execute_command_line_at(const char *command_text, int64_t received_us)
+{
+    if (!command_text || command_text[0] == '\0')
+    {
+        return false;
+    }
+
+    if (g_cmd_processor.execution_lock)
+    {
+        xSemaphoreTake(g_cmd_processor.execution_lock, portMAX_DELAY);
+    }
+
+    g_cmd_processor.command_received_us = received_us;
+    command_type_t cmd_type = classify_command(command_text);
+    bool command_handled = execute_classified_command(command_text, cmd_type);
+
+    if (g_cmd_processor.execution_lock)
+    {
+        xSemaphoreGive(g_cmd_processor.execution_lock);
+    }
+    return command_handled;
+}
+
+bool execute_command_line(const char *command_text)
+{
+    return execute_command_line_at(command_text, -1);
+}
+
+void process_received_command()
+{
+    execute_command_line_at(g_cmd_processor.command_buffer, g_cmd_processor.buffer_received_us);
+}
+
+static void reset_command_buffer()
+{
+    memset(g_cmd_processor.command_buffer, 0, sizeof(g_cmd_processor.command_buffer));
+    g_cmd_processor.buffer_position = 0;
+}
+
+// Add received console bytes to the line buffer, running each completed line.
+// received_us is when the bytes arrived.
+static void feed_command_input(const uint8_t *data, size_t length, int64_t received_us)
+{
+    for (size_t index = 0; index < length; index++)
+    {
+        char input_char = (char)data[index];
+
+        if (input_char == '\n' || input_char == '\r')
+        {
+            // End of command - process it
+            if (g_cmd_processor.buffer_position > 0)
+            {
+                g_cmd_processor.command_buffer[g_cmd_processor.buffer_position] = '\0';
+                g_cmd_processor.buffer_received_us = received_us;
+                process_received_command();
+            }
+            reset_command_buffer();
+        }
+        else if (g_cmd_processor.buffer_position < (MAX_COMMAND_LENGTH - 1))
+        {
+            // Add character to buffer if there's space
+            g_cmd_processor.command_buffer[g_cmd_processor.buffer_position] = input_char;
+            g_cmd_processor.buffer_position++;
+        }
+        else
+        {
+            // Buffer overflow protection
+            printf("Warning: Command too long, buffer reset\n");
+            reset_command_buffer();
+        }
+    }
+}
+
+void scan_for_input_data()
+{
+    int input_char = fgetc(stdin);
+
+    // Process all available characters
+    while (input_char != 0xFF && input_char != EOF)
+    {
+        uint8_t input_byte = (uint8_t)input_char;
+        feed_command_input(&input_byte, 1, esp_timer_get_time());
+        input_char = fgetc(stdin);
+    }
+}
+
+#if CONFIG_ESP_CONSOLE_UART
+
+// Take over the console UART with the driver so reads block on its event
+// queue; console output keeps working through the VFS on the same driver
+static bool start_uart_command_input()
+{
+    if (uart_is_driver_installed(CONFIG_ESP_CONSOLE_UART_NUM))
+    {
+        return false; // Someone else owns the events
+    }
+
+    if (uart_driver_install(CONFIG_ESP_CONSOLE_UART_NUM, COMMAND_UART_RX_BUFFER_SIZE, 0,
+                            COMMAND_UART_EVENT_QUEUE_DEPTH, &g_cmd_processor.uart_events, 0) != ESP_OK)
+    {
+        return false;
+    }
+
+    uart_set_rx_timeout(CONFIG_ESP_CONSOLE_UART_NUM, COMMAND_UART_RX_TIMEOUT_SYMBOLS);
+    uart_vfs_dev_use_driver(CONFIG_ESP_CONSOLE_UART_NUM);
+    return true;
+}
+
+static void run_uart_command_loop()
+{
+    uart_event_t event;
+    uint8_t chunk[128];
+
+    while (true)
+    {
+        if (xQueueReceive(g_cmd_processor.uart_events, &event, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        // Taken before reading so dispatch time is not counted as line latency
+        int64_t received_us = esp_timer_get_time();
+
+        switch (event.type)
+        {
+        case UART_DATA:
+        {
+            size_t remaining = event.size;
+            while (remaining > 0)
+            {
+                int read = uart_read_bytes(CONFIG_ESP_CONSOLE_UART_NUM, chunk,
+                                           remaining < sizeof(chunk) ? remaining : sizeof(chunk), 0);
+                if (read <= 0)
+                {
+                    break;
+                }
+                feed_command_input(chunk, (size_t)read, received_us);
+                remaining -= (size_t)read;
+            }
+            break;
+        }
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Input was lost, so the partial line is meaningless
+            uart_flush_input(CONFIG_ESP_CONSOLE_UART_NUM);
+            xQueueReset(g_cmd_processor.uart_events);
+            reset_command_buffer();
+            printf("Warning: Console input overflow, buffer reset\n");
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+#endif
+
+void start_command_monitoring_loop()
+{
+    printf("Command processor started. Type 'help' for commands.\n");
+
+#if CONFIG_ESP_CONSOLE_UART
+    if (start_uart_command_input())
+    {
+        run_uart_command_loop();
+    }
+#endif
+
+    while (true)
+    {
+        scan_for_input_data();
+        vTaskDelay(pdMS_TO_TICKS(25));
+    }
+}
+
+void initialize_command_processor(bool enable_echo)
+{
+    memset(&g_cmd_processor, 0, sizeof(g_cmd_processor));
+    g_cmd_processor.echo_enabled = enable_echo;
+    g_cmd_processor.execution_lock = xSemaphoreCreateMutex();
+    register_csi_command("CSI_ALLOW", "<ADD|DEL> <mac> | LIST | CLEAR", handle_allowlist_command);
+    printf("Command processor initialized\n");
+}
+
+void get_processor_stats(int *commands_processed, int *buffer_usage)
+{
+    *commands_processed = g_cmd_processor.commands_processed;
+    *buffer_usage = g_cmd_processor.buffer_position;
+}
@@ -0,0 +1,4 @@
+#
+# Shared CSI components, compiled once for the applications that list this
+# directory in EXTRA_COMPONENT_DIRS. Every source file here is built.
+COMPONENT_ADD_INCLUDEDIRS := .
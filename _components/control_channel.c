@@ -0,0 +1,171 @@
+#include "control_channel.h"
+
+static const char *CONTROL_TAG = "CONTROL_CHANNEL";
+
+static control_channel_t g_control_channel = {.socket_descriptor = -1};
+
+bool control_channel_request_sender(struct sockaddr_in *sender)
+{
+    if (!g_control_channel.task || xTaskGetCurrentTaskHandle() != g_control_channel.task)
+    {
+        return false;
+    }
+
+    *sender = g_control_channel.current_sender;
+    return true;
+}
+
+// Run one command with its output captured after the ACK line
+static size_t control_channel_execute(const char *id, const char *command, int64_t received_us,
+                                      char *response, size_t capacity)
+{
+    // Reserve room for the ACK line, written once the result is known
+    char ack[32];
+    size_t ack_reserve = sizeof(ack);
+    size_t output_capacity = capacity - ack_reserve;
+    char *output = response + ack_reserve;
+    size_t output_length = 0;
+    bool handled = false;
+
+    FILE *capture = fmemopen(output, output_capacity, "w");
+    if (capture)
+    {
+        FILE *console = stdout;
+        stdout = capture;
+        handled = execute_command_line_at(command, received_us);
+        fflush(capture);
+        long position = ftell(capture);
+        stdout = console;
+        fclose(capture);
+
+        output_length = position > 0 ? (size_t)position : 0;
+        if (output_length >= output_capacity - 1)
+        {
+            output_length = output_capacity - sizeof(CONTROL_CHANNEL_TRUNCATED_MARKER);
+            memcpy(output + output_length, CONTROL_CHANNEL_TRUNCATED_MARKER, sizeof(CONTROL_CHANNEL_TRUNCATED_MARKER) - 1);
+            output_length += sizeof(CONTROL_CHANNEL_TRUNCATED_MARKER) - 1;
+        }
+    }
+    else
+    {
+        handled = execute_command_line_at(command, received_us);
+    }
+
+    if (!handled)
+    {
+        g_control_channel.failures++;
+    }
+
+    int ack_length = snprintf(ack, sizeof(ack), "ACK %s %s\n", id[0] ? id : "-", handled ? "OK" : "ERR");
+    memmove(response + ack_length, output, output_length);
+    memcpy(response, ack, ack_length);
+    return ack_length + output_length;
+}
+
+static void control_channel_task(void *parameters)
+{
+    char request[MAX_COMMAND_LENGTH];
+    ESP_LOGI(CONTROL_TAG, "Control channel task started");
+
+    while (true)
+    {
+        struct sockaddr_in sender;
+        socklen_t sender_length = sizeof(sender);
+        int received = recvfrom(g_control_channel.socket_descriptor, request, sizeof(request) - 1, 0,
+                                (struct sockaddr *)&sender, &sender_length);
+        int64_t received_us = esp_timer_get_time();
+        if (received <= 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        request[received] = '\0';
+
+        // Strip the line terminator and the optional request id
+        while (received > 0 && isspace((unsigned char)request[received - 1]))
+        {
+            request[--received] = '\0';
+        }
+
+        char id[sizeof(g_control_channel.last_id)] = {0};
+        char *command = request;
+        if (command[0] == '#')
+        {
+            size_t id_length = strcspn(command + 1, " \t");
+            if (id_length >= sizeof(id))
+            {
+                id_length = sizeof(id) - 1;
+            }
+            memcpy(id, command + 1, id_length);
+            command += 1 + strcspn(command + 1, " \t");
+            while (isspace((unsigned char)*command))
+            {
+                command++;
+            }
+        }
+
+        bool retransmission = id[0] && strcmp(id, g_control_channel.last_id) == 0 &&
+                              sender.sin_addr.s_addr == g_control_channel.last_sender.sin_addr.s_addr &&
+                              sender.sin_port == g_control_channel.last_sender.sin_port;
+
+        if (retransmission)
+        {
+            g_control_channel.retransmissions++;
+        }
+        else
+        {
+            g_control_channel.requests++;
+            g_control_channel.current_sender = sender;
+            g_control_channel.response_length = control_channel_execute(id, command, received_us,
+                                                                       g_control_channel.response,
+                                                                       sizeof(g_control_channel.response));
+            g_control_channel.last_sender = sender;
+            memcpy(g_control_channel.last_id, id, sizeof(id));
+        }
+
+        if (sendto(g_control_channel.socket_descriptor, g_control_channel.response, g_control_channel.response_length, 0,
+                   (struct sockaddr *)&sender, sizeof(sender)) < 0)
+        {
+            ESP_LOGW(CONTROL_TAG, "Failed to send control response: %s", strerror(errno));
+        }
+    }
+}
+
+esp_err_t control_channel_start(uint16_t port, UBaseType_t priority, uint32_t stack_size)
+{
+    if (g_control_channel.socket_descriptor >= 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        ESP_LOGE(CONTROL_TAG, "Failed to create control socket: %s", strerror(errno));
+        return ESP_FAIL;
+    }
+
+    struct sockaddr_in local_address = {0};
+    local_address.sin_family = AF_INET;
+    local_address.sin_port = htons(port);
+    local_address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(sock, (struct sockaddr *)&local_address, sizeof(local_address)) < 0)
+    {
+        ESP_LOGE(CONTROL_TAG, "Failed to bind control port %u: %s", port, strerror(errno));
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    g_control_channel.socket_descriptor = sock;
+    if (xTaskCreate(control_channel_task, "control", stack_size, NULL, priority, &g_control_channel.task) != pdPASS)
+    {
+        close(sock);
+        g_control_channel.socket_descriptor = -1;
+        return ESP_ERR_NO_MEM;
+    }
+
+    pipeline_stats_register_task("control", g_control_channel.task);
+    ESP_LOGI(CONTROL_TAG, "Control channel listening on UDP port %u", port);
+    return ESP_OK;
+}
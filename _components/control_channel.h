@@ -0,0 +1,62 @@
+#ifndef CONTROL_CHANNEL_H
+#define CONTROL_CHANNEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "command_processor.h"
+#include "pipeline_stats.h"
+
+// UDP control port accepting the same command lines as the serial console.
+//
+//   request:  [#<id> ]<command line>
+//   response: ACK <id|-> <OK|ERR>\n<command output>
+//
+// The command's printf output is captured into the response datagram by
+// pointing this task's stdout (per task in ESP-IDF) at a memory stream.
+// Output beyond CONTROL_CHANNEL_MAX_RESPONSE is cut and marked with "...".
+// A request repeating the previous sender's id is answered from the cached
+// response without running the command again, so hosts can retry safely.
+
+#define CONTROL_CHANNEL_MAX_RESPONSE 1400
+#define CONTROL_CHANNEL_TRUNCATED_MARKER "...\n"
+
+typedef struct
+{
+    int socket_descriptor;
+    TaskHandle_t task;
+
+    struct sockaddr_in current_sender; // Sender of the command being executed
+
+    // Last request, for retransmissions
+    struct sockaddr_in last_sender;
+    char last_id[12];
+    char response[CONTROL_CHANNEL_MAX_RESPONSE];
+    size_t response_length;
+
+    uint32_t requests;
+    uint32_t retransmissions;
+    uint32_t failures;
+} control_channel_t;
+
+// Address a command came from, for handlers such as CSI_HELLO. Only true
+// while a command received on the control port is running.
+bool control_channel_request_sender(struct sockaddr_in *sender);
+
+// Bind the control port and start serving commands
+esp_err_t control_channel_start(uint16_t port, UBaseType_t priority, uint32_t stack_size);
+
+#endif // CONTROL_CHANNEL_H
@@ -0,0 +1,370 @@
+#include "csi_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "csi_handler.h"
+#include "mac_allowlist.h"
+#include "timestamp_manager.h"
+#include "csi_replay.h"
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#else
+#include <time.h>
+#endif
+
+#define CSI_BENCH_FRAME_VARIANTS 8 // Frames cycled through, so deltas and windows see changing values
+
+#ifdef ESP_PLATFORM
+// Wraps after 2^32 cycles, 17 s at 240 MHz; a case takes far less
+typedef uint32_t csi_bench_ticks_t;
+
+static inline csi_bench_ticks_t csi_bench_ticks()
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline uint64_t csi_bench_ticks_to_ns(uint64_t ticks)
+{
+    return ticks * 1000 / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+static volatile uint32_t g_csi_bench_allocations;
+
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *pointer, size_t size, uint32_t caps)
+{
+    g_csi_bench_allocations++;
+}
+
+void IRAM_ATTR esp_heap_trace_free_hook(void *pointer)
+{
+}
+
+static inline uint32_t csi_bench_allocations()
+{
+    return g_csi_bench_allocations;
+}
+#define CSI_BENCH_COUNTS_ALLOCATIONS 1
+#else
+#define CSI_BENCH_COUNTS_ALLOCATIONS 0
+#endif
+
+#define CSI_BENCH_HAS_STATIONS 0
+#else
+typedef uint64_t csi_bench_ticks_t;
+
+static inline csi_bench_ticks_t csi_bench_ticks()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static inline uint64_t csi_bench_ticks_to_ns(uint64_t ticks)
+{
+    return ticks;
+}
+
+#define CSI_BENCH_COUNTS_ALLOCATIONS 1
+#define CSI_BENCH_HAS_STATIONS 1
+#endif
+
+typedef struct
+{
+    const char *name;
+    uint8_t cwb;
+    uint8_t stbc;
+    csi_capture_profile_t profile;
+    uint16_t length;
+} csi_bench_shape_t;
+
+static const csi_bench_shape_t g_csi_bench_shapes[] = {
+    {"HT20", 0, 0, CSI_CAPTURE_PROFILE_HTLTF, CSI_LTF_HT20_PAIRS * 2},
+    {"HT40 STBC full", 1, 1, CSI_CAPTURE_PROFILE_FULL, CSI_FRAME_MAX_LENGTH},
+};
+
+#define CSI_BENCH_SHAPE_COUNT (sizeof(g_csi_bench_shapes) / sizeof(g_csi_bench_shapes[0]))
+
+typedef struct
+{
+    csi_frame_slot_t *frames; // CSI_BENCH_FRAME_VARIANTS of the shape being run
+    uint8_t *output;          // CSI_RECORD_MAX_SIZE
+    int64_t timestamp_us;     // Advances 1 ms per frame
+    uint8_t station_index;
+} csi_bench_t;
+
+static csi_bench_t g_csi_bench;
+
+static const uint8_t g_csi_bench_mac[6] = {0x02, 0xBE, 0x4C, 0x00, 0x00, 0x01};
+static const uint8_t g_csi_bench_unknown_mac[6] = {0x02, 0xBE, 0x4C, 0x00, 0x00, 0x02};
+
+// A case handles one frame and returns the bytes it produced, for the
+// allowlist whether the station was found
+typedef size_t (*csi_bench_case_fn_t)(csi_frame_slot_t *frame);
+
+typedef struct
+{
+    const char *name;
+    csi_bench_case_fn_t run;
+    csi_processing_mode_t mode;
+    bool compression;
+    bool phase_sanitize;
+    bool per_shape;       // Once for each frame shape, otherwise once
+    bool station_state;   // Needs CSI_BENCH_HAS_STATIONS
+} csi_bench_case_t;
+
+static size_t csi_bench_allowlist_hit(csi_frame_slot_t *frame)
+{
+    return mac_allowlist_contains(frame->info.mac);
+}
+
+static size_t csi_bench_allowlist_miss(csi_frame_slot_t *frame)
+{
+    return mac_allowlist_contains(g_csi_bench_unknown_mac);
+}
+
+static size_t csi_bench_timestamp_heap(csi_frame_slot_t *frame)
+{
+    char *timestamp = get_formatted_timestamp();
+    size_t length = timestamp ? strlen(timestamp) : 0;
+    free(timestamp);
+    return length;
+}
+
+static size_t csi_bench_timestamp_buffer(csi_frame_slot_t *frame)
+{
+    char timestamp[TIMESTAMP_STRING_LENGTH];
+    return format_timestamp_microseconds(get_timestamp_microseconds(), timestamp, sizeof(timestamp));
+}
+
+// Through the encoder the case installed for the sinks, as the encoder task calls it
+static size_t csi_bench_text(csi_frame_slot_t *frame)
+{
+    csi_record_encoder_t encoder = csi_sink_encoder(CSI_WIRE_FORMAT_TEXT);
+    return encoder(frame, g_csi_bench.timestamp_us, g_csi_bench.output, CSI_RECORD_MAX_SIZE);
+}
+
+static size_t csi_bench_binary(csi_frame_slot_t *frame)
+{
+    csi_record_encoder_t encoder = csi_sink_encoder(CSI_WIRE_FORMAT_BINARY);
+    return encoder(frame, g_csi_bench.timestamp_us, g_csi_bench.output, CSI_RECORD_MAX_SIZE);
+}
+
+// The encoder task's feature stage, with the binary record of each report
+static size_t csi_bench_features(csi_frame_slot_t *frame)
+{
+    if (!csi_feature_stage(frame, g_csi_bench.timestamp_us))
+    {
+        return 0;
+    }
+    csi_record_encoder_t encoder = csi_sink_encoder(CSI_WIRE_FORMAT_BINARY);
+    return encoder(frame, g_csi_bench.timestamp_us, g_csi_bench.output, CSI_RECORD_MAX_SIZE);
+}
+
+#if CSI_BENCH_HAS_STATIONS
+// WiFi callback through the allowlist, frame pool and station queue, and the
+// encoder task's dequeue and release around it
+static size_t csi_bench_capture(csi_frame_slot_t *frame)
+{
+    if (!csi_pipeline_capture(&frame->info))
+    {
+        return 0;
+    }
+    uint16_t frame_slot = csi_scheduler_dequeue();
+    if (frame_slot == CSI_FRAME_POOL_INVALID_SLOT)
+    {
+        return 0;
+    }
+    size_t length = csi_frame_pool_slot(&g_csi_pipeline.frame_pool, frame_slot)->info.len;
+    csi_frame_pool_release(&g_csi_pipeline.frame_pool, frame_slot);
+    return length;
+}
+
+// The pipeline's frame pool and queues without its encoder task
+static esp_err_t csi_bench_start_pipeline()
+{
+    esp_err_t result = csi_frame_pool_init(&g_csi_pipeline.frame_pool, CONFIG_CSI_DATA_QUEUE_DEPTH + 2);
+    if (result == ESP_OK)
+    {
+        result = csi_scheduler_init(&g_csi_pipeline.frame_pool, CONFIG_CSI_DATA_QUEUE_DEPTH);
+    }
+    if (result == ESP_OK)
+    {
+        result = csi_overload_init(&g_csi_pipeline.frame_pool, CONFIG_CSI_DATA_QUEUE_DEPTH, CSI_OVERLOAD_DROP_NEWEST);
+    }
+    g_csi_pipeline.filter = mac_allowlist_contains;
+    g_csi_pipeline.running = result == ESP_OK;
+    return result;
+}
+#endif
+
+static const csi_bench_case_t g_csi_bench_cases[] = {
+    {"allowlist hit", csi_bench_allowlist_hit, CSI_MODE_AMPLITUDE, false, false, false, false},
+    {"allowlist miss", csi_bench_allowlist_miss, CSI_MODE_AMPLITUDE, false, false, false, false},
+    {"timestamp malloc", csi_bench_timestamp_heap, CSI_MODE_AMPLITUDE, false, false, false, false},
+    {"timestamp buffer", csi_bench_timestamp_buffer, CSI_MODE_AMPLITUDE, false, false, false, false},
+#if CSI_BENCH_HAS_STATIONS
+    {"callback", csi_bench_capture, CSI_MODE_AMPLITUDE, false, false, true, true},
+#endif
+    {"text raw", csi_bench_text, CSI_MODE_RAW_DATA, false, false, true, false},
+    {"text amplitude", csi_bench_text, CSI_MODE_AMPLITUDE, false, false, true, false},
+    {"text phase", csi_bench_text, CSI_MODE_PHASE_INFO, false, false, true, false},
+    {"binary raw", csi_bench_binary, CSI_MODE_RAW_DATA, false, false, true, false},
+    {"binary amplitude", csi_bench_binary, CSI_MODE_AMPLITUDE, false, false, true, false},
+    {"binary phase", csi_bench_binary, CSI_MODE_PHASE_INFO, false, false, true, false},
+    {"binary phase sanitized", csi_bench_binary, CSI_MODE_PHASE_INFO, false, true, true, false},
+    {"binary amplitude delta", csi_bench_binary, CSI_MODE_AMPLITUDE, true, false, true, true},
+    {"binary phase delta", csi_bench_binary, CSI_MODE_PHASE_INFO, true, false, true, true},
+    {"binary sanitized delta", csi_bench_binary, CSI_MODE_PHASE_INFO, true, true, true, true},
+    {"features", csi_bench_features, CSI_MODE_FEATURES, false, false, true, true},
+};
+
+#define CSI_BENCH_CASE_COUNT (sizeof(g_csi_bench_cases) / sizeof(g_csi_bench_cases[0]))
+
+// The replay generator's frames, so every run encodes the same ones
+static void csi_bench_fill_frames(const csi_bench_shape_t *shape)
+{
+    uint32_t random_state = 0x2545F491u;
+    for (int variant = 0; variant < CSI_BENCH_FRAME_VARIANTS; variant++)
+    {
+        csi_frame_slot_t *frame = &g_csi_bench.frames[variant];
+        memset(frame, 0, sizeof(*frame));
+        frame->info.buf = frame->data;
+        frame->info.len = shape->length;
+        memcpy(frame->info.mac, g_csi_bench_mac, sizeof(g_csi_bench_mac));
+        frame->info.rx_ctrl.rssi = -48 - variant % 4;
+        frame->info.rx_ctrl.rate = 11;
+        frame->info.rx_ctrl.sig_mode = 1;
+        frame->info.rx_ctrl.mcs = 7;
+        frame->info.rx_ctrl.cwb = shape->cwb;
+        frame->info.rx_ctrl.stbc = shape->stbc;
+        frame->info.rx_ctrl.noise_floor = -92;
+        frame->info.rx_ctrl.channel = 6;
+        frame->info.rx_ctrl.secondary_channel = shape->cwb ? 1 : 0;
+        frame->info.rx_ctrl.timestamp = 1000u * variant;
+        frame->info.rx_ctrl.sig_len = 1024;
+        frame->station_index = g_csi_bench.station_index;
+        frame->sequence = variant;
+        frame->capture_profile = (uint8_t)shape->profile;
+
+        csi_replay_synthesize_iq(frame->data, shape->length / 2, variant, &random_state);
+    }
+}
+
+static void csi_bench_run_case(const csi_bench_case_t *bench_case, const csi_bench_shape_t *shape, uint32_t frames)
+{
+    csi_compression_set_enabled(bench_case->compression);
+    csi_phase_set_sanitize(bench_case->phase_sanitize);
+    set_csi_processing_mode(bench_case->mode);
+
+    // One pass over the frames untimed, for the caches and the first allocations of a station
+    for (int variant = 0; variant < CSI_BENCH_FRAME_VARIANTS; variant++)
+    {
+        g_csi_bench.timestamp_us += 1000;
+        bench_case->run(&g_csi_bench.frames[variant]);
+    }
+
+#if CSI_BENCH_COUNTS_ALLOCATIONS
+    uint32_t allocations_start = csi_bench_allocations();
+#endif
+    uint64_t bytes = 0;
+    csi_bench_ticks_t start = csi_bench_ticks();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        g_csi_bench.timestamp_us += 1000;
+        bytes += bench_case->run(&g_csi_bench.frames[frame % CSI_BENCH_FRAME_VARIANTS]);
+    }
+    csi_bench_ticks_t elapsed = (csi_bench_ticks_t)(csi_bench_ticks() - start);
+
+    uint64_t elapsed_ns = csi_bench_ticks_to_ns(elapsed);
+    printf("%-24s %-15s %10.1f", bench_case->name, shape ? shape->name : "-", (double)elapsed_ns / frames);
+#ifdef ESP_PLATFORM
+    printf(" %10.1f", (double)elapsed / frames);
+#endif
+#if CSI_BENCH_COUNTS_ALLOCATIONS
+    printf(" %12.2f", (double)(csi_bench_allocations() - allocations_start) / frames);
+#else
+    printf(" %12s", "-");
+#endif
+    printf(" %10.1f\n", (double)bytes / frames);
+}
+
+esp_err_t csi_bench_run(uint32_t frames)
+{
+    if (frames == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_csi_bench.frames = malloc(CSI_BENCH_FRAME_VARIANTS * sizeof(csi_frame_slot_t));
+    g_csi_bench.output = malloc(CSI_RECORD_MAX_SIZE);
+    if (!g_csi_bench.frames || !g_csi_bench.output)
+    {
+        free(g_csi_bench.frames);
+        free(g_csi_bench.output);
+        g_csi_bench.frames = NULL;
+        g_csi_bench.output = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    csi_config_t saved_config = g_csi_config;
+    bool saved_compression = csi_compression_enabled();
+    bool saved_phase_sanitize = csi_phase_sanitize_enabled();
+    if (g_csi_config.device_role[0] == '\0')
+    {
+        strncpy(g_csi_config.device_role, "bench", sizeof(g_csi_config.device_role) - 1);
+    }
+    bool added_mac = !mac_allowlist_contains(g_csi_bench_mac) && mac_allowlist_add(g_csi_bench_mac) == ESP_OK;
+
+#if CSI_BENCH_HAS_STATIONS
+    g_csi_bench.station_index = station_table_lookup(g_csi_bench_mac);
+    bool pipeline = csi_bench_start_pipeline() == ESP_OK;
+#else
+    g_csi_bench.station_index = STATION_TABLE_INVALID_INDEX;
+#endif
+
+    printf("CSI benchmark: %lu frames per case\n", (unsigned long)frames);
+#ifdef ESP_PLATFORM
+    printf("%-24s %-15s %10s %10s %12s %10s\n", "case", "frame", "ns/frame", "cycles", "allocs/frame", "bytes");
+#else
+    printf("%-24s %-15s %10s %12s %10s\n", "case", "frame", "ns/frame", "allocs/frame", "bytes");
+#endif
+
+    for (size_t index = 0; index < CSI_BENCH_CASE_COUNT; index++)
+    {
+        const csi_bench_case_t *bench_case = &g_csi_bench_cases[index];
+        if (bench_case->station_state && !CSI_BENCH_HAS_STATIONS)
+        {
+            continue;
+        }
+#if CSI_BENCH_HAS_STATIONS
+        if (bench_case->run == csi_bench_capture && !pipeline)
+        {
+            continue;
+        }
+#endif
+        for (size_t shape = 0; shape < (bench_case->per_shape ? CSI_BENCH_SHAPE_COUNT : 1); shape++)
+        {
+            csi_bench_fill_frames(&g_csi_bench_shapes[shape]);
+            csi_bench_run_case(bench_case, bench_case->per_shape ? &g_csi_bench_shapes[shape] : NULL, frames);
+        }
+    }
+
+    if (added_mac)
+    {
+        mac_allowlist_remove(g_csi_bench_mac);
+    }
+    csi_compression_set_enabled(saved_compression);
+    csi_phase_set_sanitize(saved_phase_sanitize);
+    g_csi_config = saved_config;
+    select_csi_encoders();
+    free(g_csi_bench.frames);
+    free(g_csi_bench.output);
+    g_csi_bench.frames = NULL;
+    g_csi_bench.output = NULL;
+    return ESP_OK;
+}
@@ -0,0 +1,38 @@
+#ifndef CSI_BENCH_H
+#define CSI_BENCH_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Per-frame cost of the hot path on synthetic frames: the allowlist test of
+// the WiFi callback, both timestamp formatters and the text and binary
+// encoders of every mode, for a 20 MHz HT-LTF capture and a full 40 MHz STBC
+// capture. Every case reports the mean time and heap allocations per frame.
+//
+// The host build (active_ap/host_bench) times with the monotonic clock and
+// counts allocations through malloc wrappers. Only there the cases that keep
+// station state run too: compressed records, feature mode and the callback
+// into the frame pool and station queues.
+//
+// On the device CONFIG_CSI_BENCHMARK_AT_BOOT runs it once before the pipeline
+// and WiFi start, timed with the CPU cycle counter. Frames use no station, so
+// nothing is left behind. Allocations are counted with CONFIG_HEAP_USE_HOOKS.
+
+#ifndef CONFIG_CSI_BENCHMARK_FRAMES
+#define CONFIG_CSI_BENCHMARK_FRAMES 1000
+#endif
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#endif
+
+#ifndef ESP_PLATFORM
+// Calls to malloc, calloc and realloc so far, from the host build's wrappers
+uint32_t csi_bench_allocations();
+#endif
+
+// Run every case for frames frames and print one line per case and shape.
+// Restores the mode, compression and phase settings it changes.
+esp_err_t csi_bench_run(uint32_t frames);
+
+#endif // CSI_BENCH_H
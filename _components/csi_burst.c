@@ -0,0 +1,440 @@
+#include "csi_burst.h"
+
+static const char *BURST_TAG = "CSI_BURST";
+
+static csi_burst_t g_csi_burst;
+
+static const char *csi_burst_state_name(uint8_t state)
+{
+    switch (state)
+    {
+    case CSI_BURST_ARMED:
+        return "armed";
+    case CSI_BURST_RECORDING:
+        return "recording";
+    case CSI_BURST_DRAINING:
+        return "draining";
+    default:
+        return "idle";
+    }
+}
+
+// WiFi callback: wall-clock time of a frame, sampling the clock now and then
+static int64_t csi_burst_wall_time(uint32_t radio_timestamp)
+{
+    bool first = !g_csi_burst.has_radio_time;
+    if (first)
+    {
+        g_csi_burst.has_radio_time = true;
+        g_csi_burst.radio_us = radio_timestamp;
+        g_csi_burst.next_sample_radio_us = radio_timestamp;
+        g_csi_burst.window_end_radio_us = radio_timestamp;
+        g_csi_burst.window_samples = 0;
+    }
+    else
+    {
+        g_csi_burst.radio_us += (int32_t)(radio_timestamp - g_csi_burst.last_radio_low);
+    }
+    g_csi_burst.last_radio_low = radio_timestamp;
+
+    if (g_csi_burst.radio_us >= g_csi_burst.next_sample_radio_us)
+    {
+        int64_t wall_us = get_timestamp_microseconds();
+        if (wall_us >= 0)
+        {
+            int64_t offset = wall_us - g_csi_burst.radio_us;
+            if (g_csi_burst.window_samples == 0 || offset < g_csi_burst.window_min_offset_us)
+            {
+                g_csi_burst.window_min_offset_us = offset;
+            }
+            g_csi_burst.window_samples++;
+            if (first)
+            {
+                g_csi_burst.offset_us = offset;
+                g_csi_burst.has_offset = true;
+            }
+        }
+        if (g_csi_burst.radio_us >= g_csi_burst.window_end_radio_us && g_csi_burst.window_samples > 0)
+        {
+            g_csi_burst.offset_us = g_csi_burst.window_min_offset_us;
+            g_csi_burst.has_offset = true;
+            g_csi_burst.window_samples = 0;
+            g_csi_burst.window_end_radio_us = g_csi_burst.radio_us + TIMESTAMP_MODEL_WINDOW_US;
+        }
+        g_csi_burst.next_sample_radio_us = g_csi_burst.radio_us + TIMESTAMP_MODEL_SAMPLE_INTERVAL_US;
+    }
+    // 0 leaves it to the encoder's timestamp model
+    return g_csi_burst.has_offset ? g_csi_burst.radio_us + g_csi_burst.offset_us : 0;
+}
+
+static bool csi_burst_append(const wifi_csi_info_t *csi_info, uint8_t station_index, uint32_t sequence)
+{
+    uint32_t length = sizeof(csi_burst_record_t) + csi_info->len;
+    uint8_t *record = spsc_ring_reserve(&g_csi_burst.ring, length);
+    if (!record)
+    {
+        return false;
+    }
+
+    csi_burst_record_t *header = (csi_burst_record_t *)record;
+    header->timestamp_us = csi_burst_wall_time(csi_info->rx_ctrl.timestamp);
+    header->rx_ctrl = csi_info->rx_ctrl;
+    memcpy(header->mac, csi_info->mac, sizeof(header->mac));
+    header->station_index = station_index;
+    header->capture_profile = (uint8_t)csi_capture_profile_current();
+    header->sequence = sequence;
+    header->len = csi_info->len;
+    header->reserved = 0;
+    memcpy(record + sizeof(csi_burst_record_t), csi_info->buf, csi_info->len);
+    spsc_ring_commit(&g_csi_burst.ring, length);
+
+    g_csi_burst.newest_radio_low = csi_info->rx_ctrl.timestamp;
+    g_csi_burst.recorded++;
+    uint32_t used = spsc_ring_used(&g_csi_burst.ring);
+    if (used > g_csi_burst.high_water)
+    {
+        g_csi_burst.high_water = used;
+    }
+    return true;
+}
+
+// Capture hook, WiFi callback: every frame belongs to the burst until it is drained
+static bool csi_burst_capture(const wifi_csi_info_t *csi_info, uint8_t station_index, uint32_t sequence)
+{
+    atomic_fetch_add(&g_csi_burst.capturing, 1);
+    uint8_t state = g_csi_burst.state;
+    if (state == CSI_BURST_IDLE)
+    {
+        atomic_fetch_sub(&g_csi_burst.capturing, 1);
+        return false;
+    }
+
+    bool kept = (state == CSI_BURST_ARMED || state == CSI_BURST_RECORDING) && csi_info->len <= CSI_FRAME_MAX_LENGTH &&
+                csi_burst_append(csi_info, station_index, sequence);
+    atomic_fetch_sub(&g_csi_burst.capturing, 1);
+
+    if (!kept)
+    {
+        g_csi_burst.dropped++;
+        g_pipeline_stats.allocation_failures++;
+        csi_stream_t *stream = csi_stream(station_index);
+        if (stream)
+        {
+            stream->alloc_drops++;
+        }
+        if (state == CSI_BURST_RECORDING && !g_csi_burst.full)
+        {
+            g_csi_burst.full = true;
+            xTaskNotifyGive(g_csi_burst.task);
+        }
+    }
+    return true;
+}
+
+// Burst task: drop the oldest record, counted against its station
+static void csi_burst_discard_oldest(const uint8_t *record)
+{
+    const csi_burst_record_t *header = (const csi_burst_record_t *)record;
+    csi_stream_t *stream = csi_stream(header->station_index);
+    if (stream)
+    {
+        stream->decimated++;
+    }
+    spsc_ring_consume(&g_csi_burst.ring);
+    g_csi_burst.discarded++;
+}
+
+// Armed: keep pre_trigger_ms of history, and at least half the ring free for what follows the trigger
+static void csi_burst_trim()
+{
+    uint32_t max_age_us = g_csi_burst.pre_trigger_ms * 1000;
+    uint32_t record_length;
+    const uint8_t *record;
+    while (g_csi_burst.state == CSI_BURST_ARMED && (record = spsc_ring_peek(&g_csi_burst.ring, &record_length)))
+    {
+        const csi_burst_record_t *header = (const csi_burst_record_t *)record;
+        uint32_t age_us = g_csi_burst.newest_radio_low - header->rx_ctrl.timestamp;
+        if (age_us <= max_age_us && spsc_ring_used(&g_csi_burst.ring) <= g_csi_burst.ring.capacity / 2)
+        {
+            break;
+        }
+        csi_burst_discard_oldest(record);
+    }
+}
+
+static void csi_burst_end_recording()
+{
+    g_csi_burst.state = CSI_BURST_DRAINING;
+    g_csi_burst.recording_end_us = esp_timer_get_time();
+
+    // A callback may be committing a record it started before the state changed
+    while (atomic_load(&g_csi_burst.capturing) > 0)
+    {
+        vTaskDelay(1);
+    }
+    ESP_LOGI(BURST_TAG, "Burst of %lu frames (%lu KB) recorded in %lld ms, draining",
+             (unsigned long)g_csi_burst.recorded, (unsigned long)(spsc_ring_used(&g_csi_burst.ring) / 1024),
+             (long long)((g_csi_burst.recording_end_us - g_csi_burst.recording_start_us) / 1000));
+}
+
+// Feed the backlog to the encoder no faster than the station queues and sinks take it
+static void csi_burst_drain()
+{
+    uint32_t record_length;
+    const uint8_t *record;
+    while (g_csi_burst.state == CSI_BURST_DRAINING && (record = spsc_ring_peek(&g_csi_burst.ring, &record_length)))
+    {
+        if (g_csi_burst.abort_requested)
+        {
+            csi_burst_discard_oldest(record);
+            continue;
+        }
+
+        const csi_burst_record_t *header = (const csi_burst_record_t *)record;
+        wifi_csi_info_t csi_info = {0};
+        csi_info.rx_ctrl = header->rx_ctrl;
+        memcpy(csi_info.mac, header->mac, sizeof(csi_info.mac));
+        csi_info.buf = (int8_t *)(record + sizeof(csi_burst_record_t));
+        csi_info.len = header->len;
+
+        while (!csi_sink_has_room(csi_scheduler_depth() + 1) ||
+               !csi_pipeline_inject(&csi_info, header->station_index, header->sequence, header->capture_profile,
+                                    header->timestamp_us))
+        {
+            if (g_csi_burst.abort_requested)
+            {
+                break;
+            }
+            vTaskDelay(1);
+        }
+        if (!g_csi_burst.abort_requested)
+        {
+            spsc_ring_consume(&g_csi_burst.ring);
+            g_csi_burst.drained++;
+        }
+    }
+
+    // Back to live frames
+    csi_pipeline_set_capture_hook(NULL);
+    g_csi_burst.state = CSI_BURST_IDLE;
+    ESP_LOGI(BURST_TAG, "Burst %s: %lu frames sent, %lu discarded, %lu dropped",
+             g_csi_burst.abort_requested ? "aborted" : "drained", (unsigned long)g_csi_burst.drained,
+             (unsigned long)g_csi_burst.discarded, (unsigned long)g_csi_burst.dropped);
+}
+
+static void csi_burst_task(void *parameters)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CSI_BURST_POLL_MS));
+        switch (g_csi_burst.state)
+        {
+        case CSI_BURST_ARMED:
+            csi_burst_trim();
+            break;
+        case CSI_BURST_RECORDING:
+            if (g_csi_burst.full || g_csi_burst.abort_requested ||
+                (g_csi_burst.stop_us && esp_timer_get_time() >= g_csi_burst.stop_us))
+            {
+                csi_burst_end_recording();
+                csi_burst_drain();
+            }
+            break;
+        case CSI_BURST_DRAINING:
+            csi_burst_drain();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+esp_err_t csi_burst_start_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core)
+{
+    if (g_csi_burst.task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTaskCreatePinnedToCore(csi_burst_task, "csi_burst", stack_size, NULL, priority, &g_csi_burst.task, core) !=
+        pdPASS)
+    {
+        ESP_LOGE(BURST_TAG, "Failed to create burst task");
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline_stats_register_task("burst", g_csi_burst.task);
+    return ESP_OK;
+}
+
+// The ring is allocated on first use and kept, large PSRAM blocks fragment
+static esp_err_t csi_burst_allocate()
+{
+    if (g_csi_burst.memory)
+    {
+        return ESP_OK;
+    }
+
+    uint32_t capacity = 64;
+    while (capacity * 2 <= CONFIG_CSI_BURST_BUFFER_KB * 1024u)
+    {
+        capacity *= 2;
+    }
+#if CONFIG_SPIRAM
+    uint8_t *buffer = heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    const char *memory = "PSRAM";
+#else
+    uint8_t *buffer = heap_caps_malloc(capacity, MALLOC_CAP_8BIT);
+    const char *memory = "internal RAM";
+#endif
+    if (!buffer)
+    {
+        ESP_LOGE(BURST_TAG, "No %lu KB block of %s for the burst ring", (unsigned long)(capacity / 1024), memory);
+        return ESP_ERR_NO_MEM;
+    }
+    spsc_ring_init_buffer(&g_csi_burst.ring, buffer, capacity);
+    g_csi_burst.memory = memory;
+    return ESP_OK;
+}
+
+// Start recording into the empty ring, armed (history only) or for duration_ms (0 = until stopped)
+static esp_err_t csi_burst_begin(bool armed, uint32_t duration_ms)
+{
+    if (!g_csi_burst.task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (g_csi_burst.state != CSI_BURST_IDLE)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t result = csi_burst_allocate();
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    // Only the burst task consumes and nothing is recording, so the ring is ours to reset
+    spsc_ring_init_buffer(&g_csi_burst.ring, g_csi_burst.ring.buffer, g_csi_burst.ring.capacity);
+    g_csi_burst.has_radio_time = false;
+    g_csi_burst.has_offset = false;
+    g_csi_burst.recorded = 0;
+    g_csi_burst.dropped = 0;
+    g_csi_burst.high_water = 0;
+    g_csi_burst.drained = 0;
+    g_csi_burst.discarded = 0;
+    g_csi_burst.full = false;
+    g_csi_burst.abort_requested = false;
+    g_csi_burst.recording_start_us = esp_timer_get_time();
+    g_csi_burst.recording_end_us = 0;
+    g_csi_burst.stop_us = duration_ms ? g_csi_burst.recording_start_us + duration_ms * 1000LL : 0;
+    g_csi_burst.state = armed ? CSI_BURST_ARMED : CSI_BURST_RECORDING;
+    csi_pipeline_set_capture_hook(csi_burst_capture);
+    return ESP_OK;
+}
+
+esp_err_t csi_burst_start(uint32_t duration_ms)
+{
+    return csi_burst_begin(false, duration_ms);
+}
+
+esp_err_t csi_burst_arm(uint32_t pre_trigger_ms)
+{
+    g_csi_burst.pre_trigger_ms = pre_trigger_ms;
+    return csi_burst_begin(true, 0);
+}
+
+esp_err_t csi_burst_trigger(uint32_t duration_ms)
+{
+    if (g_csi_burst.state != CSI_BURST_ARMED)
+    {
+        return csi_burst_start(duration_ms);
+    }
+    g_csi_burst.stop_us = duration_ms ? esp_timer_get_time() + duration_ms * 1000LL : 0;
+    g_csi_burst.state = CSI_BURST_RECORDING;
+    return ESP_OK;
+}
+
+esp_err_t csi_burst_stop(bool abort)
+{
+    uint8_t state = g_csi_burst.state;
+    if (state == CSI_BURST_IDLE)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (abort)
+    {
+        g_csi_burst.abort_requested = true;
+    }
+    if (state == CSI_BURST_ARMED)
+    {
+        g_csi_burst.state = CSI_BURST_RECORDING;
+    }
+    g_csi_burst.stop_us = esp_timer_get_time();
+    xTaskNotifyGive(g_csi_burst.task);
+    return ESP_OK;
+}
+
+void csi_burst_print()
+{
+    uint32_t capacity = g_csi_burst.memory ? g_csi_burst.ring.capacity : 0;
+    printf("Burst: %s, ring %lu KB of %s\n", csi_burst_state_name(g_csi_burst.state),
+           (unsigned long)(capacity ? capacity / 1024 : CONFIG_CSI_BURST_BUFFER_KB),
+           g_csi_burst.memory ? g_csi_burst.memory : "(not allocated)");
+    if (!g_csi_burst.memory)
+    {
+        return;
+    }
+    printf("  %lu frames recorded, %lu dropped, %lu sent, %lu discarded\n", (unsigned long)g_csi_burst.recorded,
+           (unsigned long)g_csi_burst.dropped, (unsigned long)g_csi_burst.drained,
+           (unsigned long)g_csi_burst.discarded);
+    printf("  %lu KB waiting, high-water %lu KB\n", (unsigned long)(spsc_ring_used(&g_csi_burst.ring) / 1024),
+           (unsigned long)(g_csi_burst.high_water / 1024));
+}
+
+bool csi_burst_command(const char *arguments)
+{
+    char action[12] = {0};
+    int value = -1;
+    sscanf(arguments, "%11s %d", action, &value);
+
+    if (action[0] == '\0')
+    {
+        csi_burst_print();
+        return true;
+    }
+
+    esp_err_t result;
+    if (strcasecmp(action, "STOP") == 0 || strcasecmp(action, "ABORT") == 0)
+    {
+        result = csi_burst_stop(strcasecmp(action, "ABORT") == 0);
+    }
+    else if (value < -1 || value > CSI_BURST_MAX_DURATION_MS)
+    {
+        printf("Durations are 0-%d ms\n", CSI_BURST_MAX_DURATION_MS);
+        return false;
+    }
+    else if (strcasecmp(action, "START") == 0)
+    {
+        result = csi_burst_start(value < 0 ? 0 : (uint32_t)value);
+    }
+    else if (strcasecmp(action, "ARM") == 0)
+    {
+        result = csi_burst_arm(value < 0 ? CSI_BURST_DEFAULT_PRE_TRIGGER_MS : (uint32_t)value);
+    }
+    else if (strcasecmp(action, "TRIGGER") == 0)
+    {
+        result = csi_burst_trigger(value < 0 ? 0 : (uint32_t)value);
+    }
+    else
+    {
+        printf("Usage: CSI_BURST [START [ms] | ARM [pre_ms] | TRIGGER [ms] | STOP | ABORT]\n");
+        return false;
+    }
+
+    if (result != ESP_OK)
+    {
+        printf("CSI_BURST %s failed: %s\n", action, esp_err_to_name(result));
+        return false;
+    }
+    csi_burst_print();
+    return true;
+}
@@ -0,0 +1,137 @@
+#ifndef CSI_BURST_H
+#define CSI_BURST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "spsc_ring.h"
+#include "timestamp_manager.h"
+#include "csi_streams.h"
+#include "csi_sink.h"
+#include "csi_pipeline.h"
+#include "pipeline_stats.h"
+
+// Burst capture: for a short recording the WiFi callback copies every kept
+// frame into one large ring (PSRAM on boards that have it) instead of the
+// frame pool, with no encoding and no queue limit, so the capture rate is
+// set by the radio and not by the uplink. Once the burst ends a task feeds
+// the backlog to the encoder at the pace the sinks take it, then the
+// pipeline goes back to live frames. Frames that arrive while the backlog
+// drains are dropped and counted as alloc drops.
+//
+//   CSI_BURST START [ms]    record now, until STOP, the time is up or the ring is full
+//   CSI_BURST ARM [pre_ms]  record, only keeping the last pre_ms (pre-trigger history)
+//   CSI_BURST TRIGGER [ms]  keep the history and record ms more
+//   CSI_BURST STOP          end the recording and drain it
+//   CSI_BURST ABORT         end the recording and discard it
+//
+// Records keep the frame's rx_ctrl, MAC, station, sequence number and capture
+// profile, so the backlog is encoded exactly like live frames would have
+// been. Their wall-clock time is taken at capture: like the timestamp model,
+// the callback samples the wall clock every TIMESTAMP_MODEL_SAMPLE_INTERVAL_US
+// of radio time and maps radio time with the smallest offset of the last
+// TIMESTAMP_MODEL_WINDOW_US. Frames dropped from the history or by ABORT
+// count as decimated.
+
+#ifndef CONFIG_CSI_BURST_BUFFER_KB
+#if CONFIG_SPIRAM
+#define CONFIG_CSI_BURST_BUFFER_KB 4096
+#else
+#define CONFIG_CSI_BURST_BUFFER_KB 64
+#endif
+#endif
+#ifndef CONFIG_CSI_BURST_TASK_PRIORITY
+#define CONFIG_CSI_BURST_TASK_PRIORITY 3
+#endif
+
+#define CSI_BURST_POLL_MS 10
+#define CSI_BURST_DEFAULT_PRE_TRIGGER_MS 1000
+#define CSI_BURST_MAX_DURATION_MS 600000
+
+typedef enum
+{
+    CSI_BURST_IDLE = 0,
+    CSI_BURST_ARMED,
+    CSI_BURST_RECORDING,
+    CSI_BURST_DRAINING,
+} csi_burst_state_t;
+
+typedef struct
+{
+    int64_t timestamp_us; // Wall clock
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t mac[6];
+    uint8_t station_index;
+    uint8_t capture_profile;
+    uint32_t sequence;
+    uint16_t len;
+    uint16_t reserved;
+} csi_burst_record_t; // Followed by len bytes of CSI
+
+typedef struct
+{
+    spsc_ring_t ring;
+    const char *memory; // "PSRAM" or "internal RAM", NULL until allocated
+    TaskHandle_t task;
+
+    // Set by the commands, acted on by the task
+    volatile uint8_t state; // csi_burst_state_t
+    volatile uint32_t pre_trigger_ms;
+    volatile int64_t stop_us; // End of RECORDING, 0 = until STOP or full
+    volatile bool full;
+    volatile bool abort_requested;
+    atomic_int capturing; // Callbacks between the state check and the commit
+
+    // WiFi callback
+    bool has_radio_time;
+    uint32_t last_radio_low;
+    int64_t radio_us; // Unwrapped
+    int64_t next_sample_radio_us;
+    int64_t window_end_radio_us;
+    int64_t window_min_offset_us;
+    uint32_t window_samples;
+    int64_t offset_us; // Wall - radio, applied to records
+    bool has_offset;
+    volatile uint32_t newest_radio_low;
+    volatile uint32_t recorded;
+    volatile uint32_t dropped;
+    volatile uint32_t high_water; // Bytes
+
+    // Burst task
+    int64_t recording_start_us;
+    int64_t recording_end_us;
+    uint32_t drained;
+    uint32_t discarded;
+} csi_burst_t;
+
+esp_err_t csi_burst_start_task(UBaseType_t priority, uint32_t stack_size, BaseType_t core);
+
+esp_err_t csi_burst_start(uint32_t duration_ms);
+
+esp_err_t csi_burst_arm(uint32_t pre_trigger_ms);
+
+// Keep the armed history and record duration_ms more; starts a burst if not armed
+esp_err_t csi_burst_trigger(uint32_t duration_ms);
+
+// End the recording; the task drains the backlog, or discards it when aborted
+esp_err_t csi_burst_stop(bool abort);
+
+// Snapshot from another task; counters may be slightly stale
+void csi_burst_print();
+
+// CSI_BURST [START [ms] | ARM [pre_ms] | TRIGGER [ms] | STOP | ABORT]
+bool csi_burst_command(const char *arguments);
+
+#endif // CSI_BURST_H
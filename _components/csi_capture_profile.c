@@ -0,0 +1,138 @@
+#include "csi_capture_profile.h"
+
+volatile uint8_t g_csi_capture_profile = CONFIG_CSI_CAPTURE_PROFILE_DEFAULT;
+
+static const char *const g_csi_capture_profile_names[CSI_CAPTURE_PROFILE_COUNT] = {"LLTF", "HTLTF", "HTLTF_STBC",
+                                                                                   "FULL"};
+
+const char *csi_capture_profile_name(csi_capture_profile_t profile)
+{
+    return profile < CSI_CAPTURE_PROFILE_COUNT ? g_csi_capture_profile_names[profile] : "UNKNOWN";
+}
+
+bool csi_capture_profile_parse(const char *name, csi_capture_profile_t *profile)
+{
+    for (int index = 0; index < CSI_CAPTURE_PROFILE_COUNT; index++)
+    {
+        if (strcasecmp(name, g_csi_capture_profile_names[index]) == 0)
+        {
+            *profile = (csi_capture_profile_t)index;
+            return true;
+        }
+    }
+    return false;
+}
+
+void csi_capture_profile_config(csi_capture_profile_t profile, wifi_csi_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->lltf_en = csi_capture_profile_lltf(profile);
+    config->htltf_en = csi_capture_profile_htltf(profile);
+    config->stbc_htltf2_en = csi_capture_profile_stbc(profile);
+    config->ltf_merge_en = false;
+    config->channel_filter_en = false;
+    config->manu_scale = false;
+}
+
+esp_err_t csi_capture_profile_apply(csi_capture_profile_t profile)
+{
+    if (profile >= CSI_CAPTURE_PROFILE_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    wifi_csi_config_t config;
+    csi_capture_profile_config(profile, &config);
+    esp_err_t result = esp_wifi_set_csi_config(&config);
+    if (result == ESP_OK)
+    {
+        g_csi_capture_profile = (uint8_t)profile;
+    }
+    return result;
+}
+
+uint16_t csi_capture_expected_pairs(csi_capture_profile_t profile, const wifi_pkt_rx_ctrl_t *rx_ctrl,
+                                    uint16_t expected[CSI_LTF_COUNT])
+{
+    bool ht = rx_ctrl->sig_mode != 0;
+    memset(expected, 0, CSI_LTF_COUNT * sizeof(expected[0]));
+    if (csi_capture_profile_lltf(profile) || !ht)
+    {
+        expected[CSI_LTF_LLTF] = CSI_LTF_LLTF_PAIRS;
+    }
+    if (ht && csi_capture_profile_htltf(profile))
+    {
+        bool stbc = rx_ctrl->stbc && csi_capture_profile_stbc(profile);
+        expected[CSI_LTF_HTLTF] = !rx_ctrl->cwb ? CSI_LTF_HT20_PAIRS
+                                  : stbc        ? CSI_LTF_HT40_STBC_PAIRS
+                                                : CSI_LTF_HT40_PAIRS;
+        expected[CSI_LTF_STBC_HTLTF] = stbc ? expected[CSI_LTF_HTLTF] : 0;
+    }
+    return expected[CSI_LTF_LLTF] + expected[CSI_LTF_HTLTF] + expected[CSI_LTF_STBC_HTLTF];
+}
+
+void csi_capture_layout(csi_capture_profile_t profile, const wifi_csi_info_t *csi_data, csi_capture_layout_t *layout)
+{
+    memset(layout, 0, sizeof(*layout));
+    uint16_t remaining = csi_data->len / 2;
+    uint16_t offset = 0;
+    bool ht = csi_data->rx_ctrl.sig_mode != 0;
+    int last = -1;
+
+    uint16_t expected[CSI_LTF_COUNT];
+    csi_capture_expected_pairs(profile, &csi_data->rx_ctrl, expected);
+
+    for (int field = 0; field < CSI_LTF_COUNT && remaining > 0; field++)
+    {
+        if (expected[field] == 0)
+        {
+            continue;
+        }
+        layout->offset[field] = offset;
+        layout->pairs[field] = expected[field] < remaining ? expected[field] : remaining;
+        offset += layout->pairs[field];
+        remaining -= layout->pairs[field];
+        last = field;
+    }
+
+    if (remaining > 0)
+    {
+        if (last < 0)
+        {
+            last = ht ? CSI_LTF_HTLTF : CSI_LTF_LLTF;
+        }
+        layout->pairs[last] += remaining;
+    }
+}
+
+int csi_capture_gather(const wifi_csi_info_t *csi_data, csi_capture_profile_t profile, int max_pairs,
+                       int8_t *selected_iq, uint16_t kept[CSI_LTF_COUNT])
+{
+    csi_capture_layout_t layout;
+    csi_capture_layout(profile, csi_data, &layout);
+
+    int total = 0;
+    for (int field = 0; field < CSI_LTF_COUNT; field++)
+    {
+        int pairs = layout.pairs[field] ? csi_subcarrier_mask_gather(csi_data->buf + layout.offset[field] * 2,
+                                                                     layout.pairs[field], max_pairs - total,
+                                                                     selected_iq + total * 2)
+                                        : 0;
+        kept[field] = (uint16_t)pairs;
+        total += pairs;
+    }
+    return total;
+}
+
+csi_ltf_t csi_capture_primary_field(const csi_capture_layout_t *layout)
+{
+    return layout->pairs[CSI_LTF_HTLTF] ? CSI_LTF_HTLTF : CSI_LTF_LLTF;
+}
+
+void csi_capture_profile_print()
+{
+    csi_capture_profile_t profile = csi_capture_profile_current();
+    printf("Capture profile: %s (LLTF %s, HT-LTF %s, STBC HT-LTF %s)\n", csi_capture_profile_name(profile),
+           csi_capture_profile_lltf(profile) ? "on" : "off", csi_capture_profile_htltf(profile) ? "on" : "off",
+           csi_capture_profile_stbc(profile) ? "on" : "off");
+}
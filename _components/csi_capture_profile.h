@@ -0,0 +1,113 @@
+#ifndef CSI_CAPTURE_PROFILE_H
+#define CSI_CAPTURE_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "csi_subcarrier_mask.h"
+
+// Named wifi_csi_config_t sets and the buffer layout they produce. The ESP32
+// reports the enabled training fields back to back, each as I/Q pairs:
+//
+//   LLTF         legacy LTF, 64 subcarriers, present in every frame
+//   HT-LTF       64 subcarriers (HT20), 128 (HT40) or 121 (HT40 with STBC)
+//   STBC HT-LTF  second HT-LTF of an STBC frame, as long as the first one
+//
+// which adds up to at most 612 bytes (LLTF + HT40 STBC HT-LTF pair). Fields
+// that the profile disables or the frame does not carry are left out, so the
+// layout is worked out per frame from its rx_ctrl and the profile it was
+// captured under. The encoders emit every field of a frame in this order and
+// apply the subcarrier mask to each field on its own.
+
+#ifndef CONFIG_CSI_CAPTURE_PROFILE_DEFAULT
+#define CONFIG_CSI_CAPTURE_PROFILE_DEFAULT 1 // HTLTF, the capture of earlier firmware
+#endif
+
+typedef enum
+{
+    CSI_CAPTURE_PROFILE_LLTF = 0,       // Legacy LTF only: smallest records, 20 MHz resolution
+    CSI_CAPTURE_PROFILE_HTLTF = 1,      // HT-LTF only
+    CSI_CAPTURE_PROFILE_HTLTF_STBC = 2, // HT-LTF plus the second STBC HT-LTF
+    CSI_CAPTURE_PROFILE_FULL = 3,       // Every training field the hardware reports
+    CSI_CAPTURE_PROFILE_COUNT
+} csi_capture_profile_t;
+
+typedef enum
+{
+    CSI_LTF_LLTF = 0,
+    CSI_LTF_HTLTF = 1,
+    CSI_LTF_STBC_HTLTF = 2,
+    CSI_LTF_COUNT
+} csi_ltf_t;
+
+#define CSI_LTF_LLTF_PAIRS 64
+#define CSI_LTF_HT20_PAIRS 64
+#define CSI_LTF_HT40_PAIRS 128
+#define CSI_LTF_HT40_STBC_PAIRS 121
+
+// Training fields of one frame, in I/Q pairs from the start of the buffer
+typedef struct
+{
+    uint16_t offset[CSI_LTF_COUNT];
+    uint16_t pairs[CSI_LTF_COUNT]; // 0 for fields the frame does not carry
+} csi_capture_layout_t;
+
+extern volatile uint8_t g_csi_capture_profile;
+
+const char *csi_capture_profile_name(csi_capture_profile_t profile);
+
+bool csi_capture_profile_parse(const char *name, csi_capture_profile_t *profile);
+
+static inline bool csi_capture_profile_lltf(csi_capture_profile_t profile)
+{
+    return profile == CSI_CAPTURE_PROFILE_LLTF || profile == CSI_CAPTURE_PROFILE_FULL;
+}
+
+static inline bool csi_capture_profile_htltf(csi_capture_profile_t profile)
+{
+    return profile != CSI_CAPTURE_PROFILE_LLTF;
+}
+
+static inline bool csi_capture_profile_stbc(csi_capture_profile_t profile)
+{
+    return profile == CSI_CAPTURE_PROFILE_HTLTF_STBC || profile == CSI_CAPTURE_PROFILE_FULL;
+}
+
+void csi_capture_profile_config(csi_capture_profile_t profile, wifi_csi_config_t *config);
+
+static inline csi_capture_profile_t csi_capture_profile_current()
+{
+    return (csi_capture_profile_t)g_csi_capture_profile;
+}
+
+// Reconfigure the CSI capture. Frames already queued keep the layout of the
+// profile they were captured under.
+esp_err_t csi_capture_profile_apply(csi_capture_profile_t profile);
+
+// The I/Q pairs of each training field the driver reports for a frame of
+// this kind under the profile. Returns the total.
+uint16_t csi_capture_expected_pairs(csi_capture_profile_t profile, const wifi_pkt_rx_ctrl_t *rx_ctrl,
+                                    uint16_t expected[CSI_LTF_COUNT]);
+
+// Split a frame's buffer into its training fields. A buffer longer than the
+// fields the layout expects gives the rest to the last field, so nothing the
+// driver reports is dropped; a shorter one cuts the fields short.
+void csi_capture_layout(csi_capture_profile_t profile, const wifi_csi_info_t *csi_data, csi_capture_layout_t *layout);
+
+// Copy the masked I/Q pairs of every training field of a frame next to each
+// other, at most max_pairs in total. kept receives the pairs taken from each
+// field. Returns the total number of pairs copied.
+int csi_capture_gather(const wifi_csi_info_t *csi_data, csi_capture_profile_t profile, int max_pairs,
+                       int8_t *selected_iq, uint16_t kept[CSI_LTF_COUNT]);
+
+// The field statistics are taken over: HT-LTF when the frame carries one
+csi_ltf_t csi_capture_primary_field(const csi_capture_layout_t *layout);
+
+void csi_capture_profile_print();
+
+#endif // CSI_CAPTURE_PROFILE_H
@@ -0,0 +1,343 @@
+#include "csi_commands.h"
+
+static const char *csi_mode_name(csi_processing_mode_t mode)
+{
+    switch (mode)
+    {
+    case CSI_MODE_RAW_DATA:
+        return "RAW";
+    case CSI_MODE_PHASE_INFO:
+        return "PHASE";
+    case CSI_MODE_FEATURES:
+        return "FEATURES";
+    case CSI_MODE_AMPLITUDE:
+    default:
+        return "AMPLITUDE";
+    }
+}
+
+bool csi_commands_save(const char *what)
+{
+    esp_err_t result = runtime_settings_save();
+    if (result != ESP_OK)
+    {
+        printf("%s applied, but saving to NVS failed: %s\n", what, esp_err_to_name(result));
+        return false;
+    }
+    return true;
+}
+
+// CSI_MODE <RAW|AMPLITUDE|PHASE|FEATURES>
+static bool handle_mode_command(const char *arguments)
+{
+    static const csi_processing_mode_t modes[] = {CSI_MODE_RAW_DATA, CSI_MODE_AMPLITUDE, CSI_MODE_PHASE_INFO,
+                                                  CSI_MODE_FEATURES};
+    char mode_name[12] = {0};
+    sscanf(arguments, "%11s", mode_name);
+
+    if (mode_name[0] == '\0')
+    {
+        printf("CSI mode: %s\n", csi_mode_name(get_csi_configuration().mode));
+        return true;
+    }
+
+    for (size_t index = 0; index < sizeof(modes) / sizeof(modes[0]); index++)
+    {
+        if (strcasecmp(mode_name, csi_mode_name(modes[index])) == 0)
+        {
+            set_csi_processing_mode(modes[index]);
+            g_runtime_settings.csi_mode = (uint8_t)modes[index];
+            printf("CSI mode: %s\n", csi_mode_name(modes[index]));
+            return csi_commands_save("CSI mode");
+        }
+    }
+
+    printf("Usage: CSI_MODE <RAW|AMPLITUDE|PHASE|FEATURES>\n");
+    return false;
+}
+
+// CSI_OVERLOAD <DROP_NEWEST|DROP_OLDEST|DECIMATE>
+static bool handle_overload_command(const char *arguments)
+{
+    static const char *const policy_names[] = {"DROP_NEWEST", "DROP_OLDEST", "DECIMATE"};
+    char policy_name[16] = {0};
+    sscanf(arguments, "%15s", policy_name);
+
+    if (policy_name[0] == '\0')
+    {
+        printf("Overload policy: %s (decimation 1/%lu)\n", csi_overload_policy_name(g_csi_overload.policy),
+               (unsigned long)g_csi_overload.decimation_factor);
+        return true;
+    }
+
+    for (int policy = 0; policy < (int)(sizeof(policy_names) / sizeof(policy_names[0])); policy++)
+    {
+        if (strcasecmp(policy_name, policy_names[policy]) == 0)
+        {
+            csi_overload_set_policy((csi_overload_policy_t)policy);
+            g_runtime_settings.overload_policy = (uint8_t)policy;
+            printf("Overload policy: %s\n", csi_overload_policy_name((csi_overload_policy_t)policy));
+            return csi_commands_save("Overload policy");
+        }
+    }
+
+    printf("Usage: CSI_OVERLOAD <DROP_NEWEST|DROP_OLDEST|DECIMATE>\n");
+    return false;
+}
+
+// CSI_QUEUE <depth> - the frame pool is preallocated, so this takes effect at the next boot
+static bool handle_queue_command(const char *arguments)
+{
+    int depth = 0;
+    if (sscanf(arguments, "%d", &depth) != 1)
+    {
+        printf("CSI queue depth: %u\n", g_runtime_settings.queue_depth);
+        return true;
+    }
+    if (depth < 4 || depth > 1024)
+    {
+        printf("Usage: CSI_QUEUE <4-1024>\n");
+        return false;
+    }
+
+    g_runtime_settings.queue_depth = (uint16_t)depth;
+    printf("CSI queue depth %d after the next restart\n", depth);
+    return csi_commands_save("Queue depth");
+}
+
+// CSI_BATCH <max_bytes> [deadline_ms]
+static bool handle_batch_command(const char *arguments)
+{
+    int max_bytes = 0;
+    int deadline_ms = g_runtime_settings.batch_deadline_ms;
+    int parsed = sscanf(arguments, "%d %d", &max_bytes, &deadline_ms);
+
+    if (parsed < 1)
+    {
+        printf("UDP batch: %u bytes, %u ms\n", g_runtime_settings.batch_max_bytes, g_runtime_settings.batch_deadline_ms);
+        return true;
+    }
+    if (max_bytes < 64 || max_bytes > 65000 || deadline_ms < 0 || deadline_ms > 1000)
+    {
+        printf("Usage: CSI_BATCH <64-65000 bytes> [0-1000 ms]\n");
+        return false;
+    }
+
+    esp_err_t result = udp_subscribers_set_batch(max_bytes, deadline_ms);
+    if (result != ESP_OK)
+    {
+        printf("UDP batch update failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    g_runtime_settings.batch_max_bytes = (uint16_t)max_bytes;
+    g_runtime_settings.batch_deadline_ms = (uint16_t)deadline_ms;
+    printf("UDP batch: %d bytes, %d ms\n", max_bytes, deadline_ms);
+    return csi_commands_save("UDP batch");
+}
+
+// CSI_SUBCARRIERS <ALL|HT20|HT40|<first>[-<last>][,...]>
+static bool handle_subcarriers_command(const char *arguments)
+{
+    static const csi_subcarrier_mask_preset_t presets[] = {CSI_SUBCARRIER_MASK_ALL, CSI_SUBCARRIER_MASK_HT20,
+                                                           CSI_SUBCARRIER_MASK_HT40};
+    char mask_text[96] = {0};
+    sscanf(arguments, "%95s", mask_text);
+
+    if (mask_text[0] == '\0')
+    {
+        csi_subcarrier_mask_print();
+        return true;
+    }
+
+    csi_subcarrier_mask_preset_t preset = CSI_SUBCARRIER_MASK_CUSTOM;
+    for (size_t index = 0; index < sizeof(presets) / sizeof(presets[0]); index++)
+    {
+        if (strcasecmp(mask_text, csi_subcarrier_mask_preset_name(presets[index])) == 0)
+        {
+            preset = presets[index];
+        }
+    }
+
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS] = {0};
+    if (preset == CSI_SUBCARRIER_MASK_CUSTOM && !csi_subcarrier_mask_parse_ranges(mask_text, bits))
+    {
+        printf("Usage: CSI_SUBCARRIERS <ALL|HT20|HT40|<first>[-<last>][,...]> (positions 0-%d)\n",
+               CSI_SUBCARRIER_MASK_POSITIONS - 1);
+        return false;
+    }
+
+    csi_subcarrier_mask_set(preset, bits);
+    g_runtime_settings.subcarrier_mask_preset = (uint8_t)preset;
+    memcpy(g_runtime_settings.subcarrier_mask, bits, sizeof(g_runtime_settings.subcarrier_mask));
+    csi_subcarrier_mask_print();
+    return csi_commands_save("Subcarrier mask");
+}
+
+// CSI_PROFILE <LLTF|HTLTF|HTLTF_STBC|FULL> - training fields the driver reports CSI for
+static bool handle_profile_command(const char *arguments)
+{
+    char profile_name[16] = {0};
+    sscanf(arguments, "%15s", profile_name);
+
+    if (profile_name[0] == '\0')
+    {
+        csi_capture_profile_print();
+        return true;
+    }
+
+    csi_capture_profile_t profile;
+    if (!csi_capture_profile_parse(profile_name, &profile))
+    {
+        printf("Usage: CSI_PROFILE <LLTF|HTLTF|HTLTF_STBC|FULL>\n");
+        return false;
+    }
+
+    esp_err_t result = csi_capture_profile_apply(profile);
+    if (result != ESP_OK)
+    {
+        printf("Capture profile change failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    g_runtime_settings.capture_profile = (uint8_t)profile;
+    csi_capture_profile_print();
+    return csi_commands_save("Capture profile");
+}
+
+// CSI_COMPRESS <ON|OFF> - binary records only
+static bool handle_compress_command(const char *arguments)
+{
+    char state[8] = {0};
+    sscanf(arguments, "%7s", state);
+
+    if (state[0] == '\0')
+    {
+        csi_compression_print();
+        return true;
+    }
+
+    bool enable = strcasecmp(state, "ON") == 0;
+    if (!enable && strcasecmp(state, "OFF") != 0)
+    {
+        printf("Usage: CSI_COMPRESS <ON|OFF>\n");
+        return false;
+    }
+
+    esp_err_t result = csi_compression_set_enabled(enable);
+    if (result != ESP_OK)
+    {
+        printf("Compression unavailable: %s\n", esp_err_to_name(result));
+        return false;
+    }
+    select_csi_encoders();
+
+    g_runtime_settings.compression = enable;
+    printf("Compression: %s\n", enable ? "on" : "off");
+    return csi_commands_save("Compression");
+}
+
+// CSI_PHASE <RAW|SANITIZED> - what the PHASE mode emits
+static bool handle_phase_command(const char *arguments)
+{
+    char state[12] = {0};
+    sscanf(arguments, "%11s", state);
+
+    if (state[0] == '\0')
+    {
+        printf("Phase: %s\n", csi_phase_sanitize_enabled() ? "sanitized" : "raw");
+        return true;
+    }
+
+    bool sanitize = strcasecmp(state, "SANITIZED") == 0;
+    if (!sanitize && strcasecmp(state, "RAW") != 0)
+    {
+        printf("Usage: CSI_PHASE <RAW|SANITIZED>\n");
+        return false;
+    }
+
+    csi_phase_set_sanitize(sanitize);
+    select_csi_encoders();
+    g_runtime_settings.phase_sanitize = sanitize;
+    printf("Phase: %s\n", sanitize ? "sanitized" : "raw");
+    return csi_commands_save("Phase sanitization");
+}
+
+// CSI_FEATURES [interval_ms] - report rate of the FEATURES mode
+static bool handle_features_command(const char *arguments)
+{
+    int interval_ms = 0;
+    if (sscanf(arguments, "%d", &interval_ms) != 1)
+    {
+        csi_features_print();
+        return true;
+    }
+    if (interval_ms < 0 || interval_ms > 60000)
+    {
+        printf("Usage: CSI_FEATURES [0-60000 ms]\n");
+        return false;
+    }
+
+    csi_features_set_interval((uint32_t)interval_ms);
+    g_runtime_settings.feature_interval_ms = (uint16_t)interval_ms;
+    printf("Feature report interval: %d ms\n", interval_ms);
+    return csi_commands_save("Feature interval");
+}
+
+// CSI_STIMULUS [rate_hz|OFF] - echo requests per second to every allowlisted station
+static bool handle_stimulus_command(const char *arguments)
+{
+    char rate_text[8] = {0};
+    sscanf(arguments, "%7s", rate_text);
+
+    if (rate_text[0] == '\0')
+    {
+        csi_stimulus_print();
+        return true;
+    }
+
+    char *end = NULL;
+    long rate_hz = strcasecmp(rate_text, "OFF") == 0 ? 0 : strtol(rate_text, &end, 10);
+    if ((end && *end != '\0') || rate_hz < 0 || rate_hz > CSI_STIMULUS_MAX_RATE_HZ)
+    {
+        printf("Usage: CSI_STIMULUS [0-%d Hz|OFF]\n", CSI_STIMULUS_MAX_RATE_HZ);
+        return false;
+    }
+
+    csi_stimulus_set_rate((uint16_t)rate_hz);
+    g_runtime_settings.stimulus_rate_hz = (uint16_t)rate_hz;
+    printf("Stimulus rate: %ld Hz per station\n", rate_hz);
+    return csi_commands_save("Stimulus rate");
+}
+
+// CSI_SETTINGS - the values that are saved across reboots
+static bool handle_settings_command(const char *arguments)
+{
+    printf("Mode %s, overload %s, channel %u, queue depth %u, batch %u bytes / %u ms\n",
+           csi_mode_name((csi_processing_mode_t)g_runtime_settings.csi_mode),
+           csi_overload_policy_name((csi_overload_policy_t)g_runtime_settings.overload_policy),
+           g_runtime_settings.wifi_channel, g_runtime_settings.queue_depth,
+           g_runtime_settings.batch_max_bytes, g_runtime_settings.batch_deadline_ms);
+    printf("Capture %s, subcarriers %s, compression %s, feature interval %u ms\n",
+           csi_capture_profile_name((csi_capture_profile_t)g_runtime_settings.capture_profile),
+           csi_subcarrier_mask_preset_name((csi_subcarrier_mask_preset_t)g_runtime_settings.subcarrier_mask_preset),
+           g_runtime_settings.compression ? "on" : "off", g_runtime_settings.feature_interval_ms);
+    printf("Stimulus %u Hz per station, phase %s\n", g_runtime_settings.stimulus_rate_hz,
+           g_runtime_settings.phase_sanitize ? "sanitized" : "raw");
+    return true;
+}
+
+void register_csi_runtime_commands()
+{
+    register_csi_command("CSI_MODE", "[RAW|AMPLITUDE|PHASE|FEATURES]", handle_mode_command);
+    register_csi_command("CSI_OVERLOAD", "[DROP_NEWEST|DROP_OLDEST|DECIMATE]", handle_overload_command);
+    register_csi_command("CSI_QUEUE", "[depth] (applied at restart)", handle_queue_command);
+    register_csi_command("CSI_BATCH", "[max_bytes [deadline_ms]]", handle_batch_command);
+    register_csi_command("CSI_PROFILE", "[LLTF|HTLTF|HTLTF_STBC|FULL]", handle_profile_command);
+    register_csi_command("CSI_SUBCARRIERS", "[ALL|HT20|HT40|<ranges>]", handle_subcarriers_command);
+    register_csi_command("CSI_COMPRESS", "[ON|OFF]", handle_compress_command);
+    register_csi_command("CSI_PHASE", "[RAW|SANITIZED]", handle_phase_command);
+    register_csi_command("CSI_FEATURES", "[interval_ms]", handle_features_command);
+    register_csi_command("CSI_STIMULUS", "[rate_hz|OFF]", handle_stimulus_command);
+    register_csi_command("CSI_SETTINGS", "", handle_settings_command);
+}
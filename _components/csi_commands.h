@@ -0,0 +1,30 @@
+#ifndef CSI_COMMANDS_H
+#define CSI_COMMANDS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "command_processor.h"
+#include "csi_handler.h"
+#include "csi_overload.h"
+#include "udp_subscribers.h"
+#include "runtime_settings.h"
+#include "csi_subcarrier_mask.h"
+#include "csi_compression.h"
+#include "csi_capture_profile.h"
+#include "csi_stimulus.h"
+#include "csi_phase.h"
+
+// CSI_* commands that retune the running capture pipeline. Each one applies
+// its change immediately where the pipeline allows it and saves the runtime
+// settings, so the device comes back up the same way after a reboot.
+
+bool csi_commands_save(const char *what);
+
+_Static_assert(sizeof(g_runtime_settings.subcarrier_mask) == CSI_SUBCARRIER_MASK_WORDS * sizeof(uint32_t),
+               "runtime settings hold one subcarrier bitmap");
+
+void register_csi_runtime_commands();
+
+#endif // CSI_COMMANDS_H
@@ -0,0 +1,118 @@
+#include "csi_compression.h"
+
+csi_compression_t g_csi_compression;
+
+esp_err_t csi_compression_set_enabled(bool enabled)
+{
+    g_csi_compression.enabled = enabled;
+    return ESP_OK;
+}
+
+void csi_compression_reset_station(uint8_t station_index)
+{
+    if (station_index < STATION_TABLE_MAX_STATIONS && g_csi_compression.references[station_index] &&
+        g_csi_compression.references[station_index]->payload_type != 0)
+    {
+        g_csi_compression.references[station_index]->payload_type = 0;
+        g_csi_compression.resets++;
+    }
+}
+
+size_t csi_compression_encode(uint8_t station_index, uint8_t payload_type, const void *values,
+                              size_t value_size, uint16_t value_count, uint8_t *output, size_t capacity,
+                              uint8_t *flags, uint8_t *sequence)
+{
+    // Worst case is 2 bytes per 8-bit and 3 bytes per 16-bit difference
+    if (value_count > CSI_COMPRESSION_MAX_VALUES || capacity < (size_t)value_count * (value_size + 1))
+    {
+        return 0;
+    }
+
+    unsigned int mask_generation = csi_subcarrier_mask_generation();
+    if (mask_generation != g_csi_compression.mask_generation)
+    {
+        for (int station = 0; station < STATION_TABLE_MAX_STATIONS; station++)
+        {
+            if (g_csi_compression.references[station])
+            {
+                g_csi_compression.references[station]->payload_type = 0;
+            }
+        }
+        g_csi_compression.mask_generation = mask_generation;
+    }
+
+    csi_compression_reference_t *reference = NULL;
+    if (station_index < STATION_TABLE_MAX_STATIONS)
+    {
+        reference = g_csi_compression.references[station_index];
+        if (!reference)
+        {
+            reference = calloc(1, sizeof(csi_compression_reference_t));
+            g_csi_compression.references[station_index] = reference;
+            if (!reference)
+            {
+                g_csi_compression.allocation_failures++;
+            }
+        }
+    }
+
+    bool delta = reference && reference->payload_type == payload_type && reference->value_count == value_count &&
+                 reference->records_since_keyframe + 1 < CONFIG_CSI_COMPRESSION_KEYFRAME_INTERVAL;
+
+    size_t length = 0;
+    int32_t previous = 0;
+    for (uint16_t index = 0; index < value_count; index++)
+    {
+        int32_t value = value_size == 1 ? ((const int8_t *)values)[index] : ((const int16_t *)values)[index];
+        int32_t prediction = delta ? reference->values[index] : previous;
+        length += csi_varint_encode(csi_zigzag_encode(csi_compression_difference(value, prediction, value_size)),
+                                    output + length);
+        previous = value;
+        if (reference)
+        {
+            reference->values[index] = (int16_t)value;
+        }
+    }
+
+    if (reference)
+    {
+        *sequence = (uint8_t)(reference->sequence + 1);
+        reference->sequence = *sequence;
+        reference->payload_type = payload_type;
+        reference->value_count = value_count;
+        reference->records_since_keyframe = delta ? reference->records_since_keyframe + 1 : 0;
+    }
+    else
+    {
+        *sequence = 0;
+    }
+
+    *flags = CSI_WIRE_FLAG_COMPRESSED | (delta ? CSI_WIRE_FLAG_DELTA : 0);
+    if (delta)
+    {
+        g_csi_compression.delta_records++;
+    }
+    else
+    {
+        g_csi_compression.keyframes++;
+    }
+    g_csi_compression.input_bytes += (uint64_t)value_count * value_size;
+    g_csi_compression.output_bytes += length;
+    return length;
+}
+
+void csi_compression_print()
+{
+    uint64_t input = g_csi_compression.input_bytes;
+    uint64_t output = g_csi_compression.output_bytes;
+    printf("Compression: %s, keyframe every %d records\n", g_csi_compression.enabled ? "on" : "off",
+           CONFIG_CSI_COMPRESSION_KEYFRAME_INTERVAL);
+    printf("  %lu keyframes, %lu deltas, %lu resets, payload %llu -> %llu bytes (%lu%%)\n",
+           (unsigned long)g_csi_compression.keyframes, (unsigned long)g_csi_compression.delta_records,
+           (unsigned long)g_csi_compression.resets, (unsigned long long)input, (unsigned long long)output,
+           (unsigned long)(input ? output * 100 / input : 100));
+    if (g_csi_compression.allocation_failures)
+    {
+        printf("  %lu reference allocations failed\n", (unsigned long)g_csi_compression.allocation_failures);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef CSI_COMPRESSION_H
+#define CSI_COMPRESSION_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "csi_wire_format.h"
+#include "csi_frame_pool.h"
+#include "station_table.h"
+#include "csi_subcarrier_mask.h"
+
+// Lossless compression of binary record payloads. Every value is replaced by
+// its difference to a prediction, zigzag mapped and written as a varint:
+//
+//   keyframe  prediction = previous value of the same record (0 for the first)
+//   delta     prediction = same position in the station's previous record
+//
+// Differences wrap at the payload's value width (8 bits raw I/Q, 16 bits
+// amplitude and phase), so decoding is value = prediction + difference
+// truncated to that width. Delta records carry CSI_WIRE_FLAG_DELTA and the
+// per-station sequence number of the record they follow from; a host that
+// missed that record drops deltas until the next keyframe.
+//
+// Reference state lives in the encoder task only. It is reset when a sink
+// drops an encoded record, when the subcarrier mask or payload changes, and
+// every CONFIG_CSI_COMPRESSION_KEYFRAME_INTERVAL records, which bounds how
+// long a host waits after UDP loss or after joining mid-stream. A station's
+// reference (1.2 KiB, room for a full capture) is allocated with its first
+// compressed record; without one its records are all keyframes.
+
+#ifndef CONFIG_CSI_COMPRESSION_KEYFRAME_INTERVAL
+#define CONFIG_CSI_COMPRESSION_KEYFRAME_INTERVAL 16
+#endif
+
+#define CSI_COMPRESSION_MAX_VALUES CSI_FRAME_MAX_LENGTH // Raw I/Q of the longest capture
+
+typedef struct
+{
+    uint8_t payload_type; // 0 while there is no reference
+    uint8_t sequence;     // Sequence number of the reference record
+    uint8_t records_since_keyframe;
+    uint16_t value_count;
+    int16_t values[CSI_COMPRESSION_MAX_VALUES];
+} csi_compression_reference_t;
+
+typedef struct
+{
+    volatile bool enabled;
+    csi_compression_reference_t *references[STATION_TABLE_MAX_STATIONS]; // Allocated per station on first use
+    unsigned int mask_generation;                                         // Subcarrier mask the references were taken with
+
+    // Encoder task
+    uint32_t keyframes;
+    uint32_t delta_records;
+    uint32_t resets;
+    uint32_t allocation_failures;
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+} csi_compression_t;
+
+extern csi_compression_t g_csi_compression;
+
+esp_err_t csi_compression_set_enabled(bool enabled);
+
+static inline bool csi_compression_enabled()
+{
+    return g_csi_compression.enabled;
+}
+
+// Next record of this station is a keyframe. Encoder task only.
+void csi_compression_reset_station(uint8_t station_index);
+
+static inline uint32_t csi_zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline size_t csi_varint_encode(uint32_t value, uint8_t *output)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        output[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    output[length++] = (uint8_t)value;
+    return length;
+}
+
+// Difference truncated to the value width and sign extended
+static inline int32_t csi_compression_difference(int32_t value, int32_t prediction, size_t value_size)
+{
+    return value_size == 1 ? (int8_t)(uint8_t)(value - prediction) : (int16_t)(uint16_t)(value - prediction);
+}
+
+// Compress value_count values of value_size bytes (1: int8, 2: int16/uint16)
+// for one station. Returns the payload length, or 0 if it does not fit. The
+// CSI_WIRE_FLAG_* bits to set and the record's sequence number are returned
+// through flags and sequence.
+size_t csi_compression_encode(uint8_t station_index, uint8_t payload_type, const void *values,
+                              size_t value_size, uint16_t value_count, uint8_t *output, size_t capacity,
+                              uint8_t *flags, uint8_t *sequence);
+
+void csi_compression_print();
+
+#endif // CSI_COMPRESSION_H
@@ -0,0 +1,220 @@
+#include "csi_features.h"
+
+static csi_features_t g_csi_features = {.interval_ms = CONFIG_CSI_FEATURE_INTERVAL_MS};
+
+void csi_features_set_interval(uint32_t interval_ms)
+{
+    g_csi_features.interval_ms = interval_ms;
+}
+
+static csi_feature_station_t *csi_features_station(uint8_t station_index)
+{
+    if (station_index >= STATION_TABLE_MAX_STATIONS)
+    {
+        return NULL;
+    }
+
+    csi_feature_station_t *station = g_csi_features.stations[station_index];
+    if (!station && g_csi_features.allocated_stations < CONFIG_CSI_FEATURE_MAX_STATIONS)
+    {
+        station = calloc(1, sizeof(csi_feature_station_t));
+        if (station)
+        {
+            g_csi_features.stations[station_index] = station;
+            g_csi_features.allocated_stations++;
+        }
+    }
+    return station;
+}
+
+static void csi_features_restart_window(csi_feature_station_t *station, uint16_t subcarrier_count,
+                                        uint16_t source_shape)
+{
+    station->subcarrier_count = subcarrier_count;
+    station->source_shape = source_shape;
+    station->window_fill = 0;
+    station->window_head = 0;
+    station->mask_generation = csi_subcarrier_mask_generation();
+    memset(station->mean, 0, sizeof(station->mean));
+    memset(station->m2, 0, sizeof(station->m2));
+}
+
+// Two-pass statistics over the full ring, replacing the running sums
+static void csi_features_resync(csi_feature_station_t *station)
+{
+    for (uint16_t subcarrier = 0; subcarrier < station->subcarrier_count; subcarrier++)
+    {
+        float sum = 0.0f;
+        for (uint16_t sample = 0; sample < station->window_fill; sample++)
+        {
+            sum += station->window[sample][subcarrier];
+        }
+        float mean = sum / station->window_fill;
+        float m2 = 0.0f;
+        for (uint16_t sample = 0; sample < station->window_fill; sample++)
+        {
+            float deviation = station->window[sample][subcarrier] - mean;
+            m2 += deviation * deviation;
+        }
+        station->mean[subcarrier] = mean;
+        station->m2[subcarrier] = m2;
+    }
+}
+
+// Average runs of adjacent amplitudes down to at most CSI_FEATURE_MAX_SUBCARRIERS
+// bins, in place. Returns the number of bins.
+static int csi_features_bin(uint16_t *amplitudes, int count)
+{
+    int width = (count + CSI_FEATURE_MAX_SUBCARRIERS - 1) / CSI_FEATURE_MAX_SUBCARRIERS;
+    if (width <= 1)
+    {
+        return count;
+    }
+
+    int bins = 0;
+    for (int first = 0; first < count; first += width)
+    {
+        int last = first + width < count ? first + width : count;
+        uint32_t sum = 0;
+        for (int index = first; index < last; index++)
+        {
+            sum += amplitudes[index];
+        }
+        amplitudes[bins++] = (uint16_t)(sum / (uint32_t)(last - first));
+    }
+    return bins;
+}
+
+bool csi_features_update(uint8_t station_index, const wifi_csi_info_t *csi_data, csi_capture_profile_t capture_profile,
+                         int64_t timestamp_us)
+{
+    g_csi_features.frames++;
+
+    csi_feature_station_t *station = csi_features_station(station_index);
+    if (!station)
+    {
+        g_csi_features.untracked_frames++;
+        return false;
+    }
+
+    csi_capture_layout_t layout;
+    csi_capture_layout(capture_profile, csi_data, &layout);
+    csi_ltf_t field = csi_capture_primary_field(&layout);
+
+    int8_t selected_iq[CSI_LTF_HT40_PAIRS * 2];
+    uint16_t amplitudes[CSI_LTF_HT40_PAIRS];
+    int subcarrier_count = csi_subcarrier_mask_gather(csi_data->buf + layout.offset[field] * 2, layout.pairs[field],
+                                                      CSI_LTF_HT40_PAIRS, selected_iq);
+    if (subcarrier_count == 0)
+    {
+        return false;
+    }
+    csi_compute_amplitudes_q8(selected_iq, subcarrier_count, amplitudes);
+    uint16_t source_shape = (uint16_t)(field << 12 | subcarrier_count);
+    subcarrier_count = csi_features_bin(amplitudes, subcarrier_count);
+
+    if (station->report_pending)
+    {
+        station->report_pending = false;
+        station->frames_since_report = 0;
+        station->rssi_sum = 0;
+    }
+
+    // A different mask, training field or bandwidth starts the window over
+    if (subcarrier_count != station->subcarrier_count || source_shape != station->source_shape ||
+        station->mask_generation != csi_subcarrier_mask_generation())
+    {
+        csi_features_restart_window(station, (uint16_t)subcarrier_count, source_shape);
+    }
+
+    uint16_t *slot = station->window[station->window_head];
+    if (station->window_fill < CONFIG_CSI_FEATURE_WINDOW)
+    {
+        station->window_fill++;
+        float count = station->window_fill;
+        for (int subcarrier = 0; subcarrier < subcarrier_count; subcarrier++)
+        {
+            float value = amplitudes[subcarrier];
+            float delta = value - station->mean[subcarrier];
+            station->mean[subcarrier] += delta / count;
+            station->m2[subcarrier] += delta * (value - station->mean[subcarrier]);
+        }
+    }
+    else
+    {
+        const float count = CONFIG_CSI_FEATURE_WINDOW;
+        for (int subcarrier = 0; subcarrier < subcarrier_count; subcarrier++)
+        {
+            float value = amplitudes[subcarrier];
+            float oldest = slot[subcarrier];
+            float previous_mean = station->mean[subcarrier];
+            station->mean[subcarrier] += (value - oldest) / count;
+            station->m2[subcarrier] += (value - oldest) * (value - station->mean[subcarrier] + oldest - previous_mean);
+        }
+    }
+    memcpy(slot, amplitudes, subcarrier_count * sizeof(uint16_t));
+
+    if (++station->window_head == CONFIG_CSI_FEATURE_WINDOW)
+    {
+        station->window_head = 0;
+        csi_features_resync(station);
+    }
+
+    station->frames_since_report++;
+    station->rssi_sum += csi_data->rx_ctrl.rssi;
+
+    // A clock stepped back by time sync reschedules instead of silencing the station
+    int64_t interval_us = (int64_t)g_csi_features.interval_ms * 1000;
+    if (timestamp_us < station->next_report_us && station->next_report_us - timestamp_us <= interval_us)
+    {
+        return false;
+    }
+    // Drift-free cadence, but never a burst of reports after a quiet spell
+    station->next_report_us = (station->next_report_us && timestamp_us - station->next_report_us < interval_us)
+                                  ? station->next_report_us + interval_us
+                                  : timestamp_us + interval_us;
+    station->report_pending = true;
+    g_csi_features.reports++;
+    return true;
+}
+
+bool csi_features_report(uint8_t station_index, csi_feature_report_t *report)
+{
+    csi_feature_station_t *station = station_index < STATION_TABLE_MAX_STATIONS
+                                         ? g_csi_features.stations[station_index]
+                                         : NULL;
+    if (!station || station->window_fill == 0)
+    {
+        return false;
+    }
+
+    float energy = 0.0f;
+    float motion = 0.0f;
+    for (uint16_t subcarrier = 0; subcarrier < station->subcarrier_count; subcarrier++)
+    {
+        float mean = station->mean[subcarrier];
+        float variance = station->m2[subcarrier] / station->window_fill;
+        energy += variance + mean * mean;
+        motion += variance / (mean * mean + 1.0f);
+    }
+
+    // Q8 amplitudes: energy back to amplitude units squared; the motion ratio is unitless
+    report->subcarrier_count = station->subcarrier_count;
+    report->frame_count = station->frames_since_report > UINT16_MAX ? UINT16_MAX : (uint16_t)station->frames_since_report;
+    report->window_frames = station->window_fill;
+    report->rssi_mean = station->frames_since_report ? (int8_t)(station->rssi_sum / (int32_t)station->frames_since_report) : 0;
+    report->energy = energy / station->subcarrier_count / 65536.0f;
+    report->motion_score = motion / station->subcarrier_count;
+    report->mean = station->mean;
+    report->m2 = station->m2;
+    return true;
+}
+
+void csi_features_print()
+{
+    printf("Features: report every %lu ms, window %d frames, %u/%d stations tracked\n",
+           (unsigned long)g_csi_features.interval_ms, CONFIG_CSI_FEATURE_WINDOW,
+           g_csi_features.allocated_stations, CONFIG_CSI_FEATURE_MAX_STATIONS);
+    printf("  %lu frames, %lu reports, %lu frames untracked\n", (unsigned long)g_csi_features.frames,
+           (unsigned long)g_csi_features.reports, (unsigned long)g_csi_features.untracked_frames);
+}
@@ -0,0 +1,106 @@
+#ifndef CSI_FEATURES_H
+#define CSI_FEATURES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "csi_math.h"
+#include "csi_subcarrier_mask.h"
+#include "csi_capture_profile.h"
+#include "station_table.h"
+
+// Per-station motion/presence features, updated in the encoder task for
+// every frame and reported at a much lower rate than frames arrive.
+//
+// Each station keeps a ring of its last CONFIG_CSI_FEATURE_WINDOW amplitude
+// vectors (Q8, masked subcarriers only), taken from the HT-LTF of a frame or
+// its LLTF when it has none. Wider fields than CSI_FEATURE_MAX_SUBCARRIERS
+// (HT40) are averaged over runs of adjacent subcarriers, so every statistic
+// stands for one bin of subcarriers. The per-subcarrier mean and sum of
+// squared deviations follow the window with Welford's update: a plain add
+// while the window fills, then a replace of the oldest sample, so every
+// frame costs O(subcarriers). The sums are recomputed from the ring each
+// time it wraps so float rounding cannot accumulate.
+//
+// Derived per report:
+//   energy        mean squared amplitude over the window and subcarriers
+//   motion score  mean over subcarriers of variance / mean^2, i.e. the
+//                 squared coefficient of variation; gain changes cancel out
+//
+// Station state (about 4.5 KiB with the defaults) is allocated on the first
+// feature frame of a station, for at most CONFIG_CSI_FEATURE_MAX_STATIONS.
+
+#ifndef CONFIG_CSI_FEATURE_WINDOW
+#define CONFIG_CSI_FEATURE_WINDOW 32
+#endif
+#ifndef CONFIG_CSI_FEATURE_MAX_STATIONS
+#define CONFIG_CSI_FEATURE_MAX_STATIONS 16
+#endif
+#ifndef CONFIG_CSI_FEATURE_INTERVAL_MS
+#define CONFIG_CSI_FEATURE_INTERVAL_MS 100
+#endif
+
+#define CSI_FEATURE_MAX_SUBCARRIERS 64 // Bins of the window, see csi_features_bin()
+
+typedef struct
+{
+    uint16_t subcarrier_count;
+    uint16_t source_shape; // Training field and subcarriers the bins are taken from
+    uint16_t window_fill;  // Samples in the ring, up to CONFIG_CSI_FEATURE_WINDOW
+    uint16_t window_head; // Slot the next sample goes to
+    uint32_t frames_since_report;
+    bool report_pending; // Reported as due, counters restart with the next frame
+    int32_t rssi_sum;    // Over the frames since the last report
+    int64_t next_report_us;
+    unsigned int mask_generation;
+
+    float mean[CSI_FEATURE_MAX_SUBCARRIERS];
+    float m2[CSI_FEATURE_MAX_SUBCARRIERS]; // Sum of squared deviations from the mean
+    uint16_t window[CONFIG_CSI_FEATURE_WINDOW][CSI_FEATURE_MAX_SUBCARRIERS];
+} csi_feature_station_t;
+
+// Report of one station, as placed in the feature records
+typedef struct
+{
+    uint16_t subcarrier_count;
+    uint16_t frame_count;   // Frames since the previous report
+    uint16_t window_frames; // Frames the statistics cover
+    int8_t rssi_mean;
+    float energy;
+    float motion_score;
+    const float *mean;
+    const float *m2;
+} csi_feature_report_t;
+
+typedef struct
+{
+    csi_feature_station_t *stations[STATION_TABLE_MAX_STATIONS];
+    uint16_t allocated_stations;
+    volatile uint32_t interval_ms;
+
+    // Encoder task
+    uint32_t frames;
+    uint32_t reports;
+    uint32_t untracked_frames; // Stations beyond CONFIG_CSI_FEATURE_MAX_STATIONS or out of memory
+} csi_features_t;
+
+void csi_features_set_interval(uint32_t interval_ms);
+
+// Add one frame to its station's window. Returns true when the station is
+// due for a report, which csi_features_report() then describes.
+bool csi_features_update(uint8_t station_index, const wifi_csi_info_t *csi_data, csi_capture_profile_t capture_profile,
+                         int64_t timestamp_us);
+
+// Describe a station that csi_features_update() just reported as due. The
+// mean and m2 arrays stay valid until the station's next frame.
+bool csi_features_report(uint8_t station_index, csi_feature_report_t *report);
+
+void csi_features_print();
+
+#endif // CSI_FEATURES_H
@@ -0,0 +1,92 @@
+#include "csi_frame_pool.h"
+
+esp_err_t csi_frame_pool_init(csi_frame_pool_t *pool, uint16_t slot_count)
+{
+    if (!pool || slot_count == 0 || slot_count >= CSI_FRAME_POOL_INVALID_SLOT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pool->slots = calloc(slot_count, sizeof(csi_frame_slot_t));
+    pool->next_free = calloc(slot_count, sizeof(uint16_t));
+    if (!pool->slots || !pool->next_free)
+    {
+        free(pool->slots);
+        free(pool->next_free);
+        pool->slots = NULL;
+        pool->next_free = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Chain every slot onto the free stack
+    for (uint16_t slot = 0; slot < slot_count; slot++)
+    {
+        pool->slots[slot].info.buf = pool->slots[slot].data;
+        pool->next_free[slot] = (slot + 1 < slot_count) ? slot + 1 : CSI_FRAME_POOL_INVALID_SLOT;
+    }
+
+    pool->slot_count = slot_count;
+    atomic_store(&pool->free_head, 0);
+    return ESP_OK;
+}
+
+uint16_t csi_frame_pool_acquire(csi_frame_pool_t *pool)
+{
+    uint_fast32_t head = atomic_load(&pool->free_head);
+
+    while (true)
+    {
+        uint16_t slot = head & 0xFFFF;
+        if (slot == CSI_FRAME_POOL_INVALID_SLOT)
+        {
+            return CSI_FRAME_POOL_INVALID_SLOT;
+        }
+
+        uint_fast32_t next_head = ((head + 0x10000) & 0xFFFF0000) | pool->next_free[slot];
+        if (atomic_compare_exchange_weak(&pool->free_head, &head, next_head))
+        {
+            return slot;
+        }
+    }
+}
+
+void csi_frame_pool_release(csi_frame_pool_t *pool, uint16_t slot)
+{
+    if (slot >= pool->slot_count)
+    {
+        return;
+    }
+
+    uint_fast32_t head = atomic_load(&pool->free_head);
+    uint_fast32_t next_head;
+
+    do
+    {
+        pool->next_free[slot] = head & 0xFFFF;
+        next_head = ((head + 0x10000) & 0xFFFF0000) | slot;
+    } while (!atomic_compare_exchange_weak(&pool->free_head, &head, next_head));
+}
+
+uint16_t csi_frame_pool_capture(csi_frame_pool_t *pool, const wifi_csi_info_t *csi_info)
+{
+    if (csi_info->len > CSI_FRAME_MAX_LENGTH)
+    {
+        return CSI_FRAME_POOL_INVALID_SLOT;
+    }
+
+    uint16_t slot = csi_frame_pool_acquire(pool);
+    if (slot == CSI_FRAME_POOL_INVALID_SLOT)
+    {
+        return slot;
+    }
+
+    csi_frame_slot_t *frame = &pool->slots[slot];
+    frame->info = *csi_info;
+    frame->info.buf = frame->data;
+    frame->info.hdr = NULL; // Driver-owned, only valid during the callback
+    frame->info.payload = NULL;
+    frame->info.payload_len = 0;
+    memcpy(frame->data, csi_info->buf, csi_info->len);
+
+    return slot;
+}
@@ -0,0 +1,56 @@
+#ifndef CSI_FRAME_POOL_H
+#define CSI_FRAME_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+// Preallocated pool of fixed-size CSI frame slots. The WiFi callback copies a
+// frame into a free slot and queues the slot index; the processing task
+// releases the slot once the frame is encoded. Free slots are kept on a
+// lock-free stack so neither side takes a lock or touches the heap.
+
+// Largest CSI buffer the ESP32 can report (LLTF + HT40 HT-LTF + STBC HT-LTF)
+#define CSI_FRAME_MAX_LENGTH 612
+
+#define CSI_FRAME_POOL_INVALID_SLOT 0xFFFF
+
+typedef struct
+{
+    wifi_csi_info_t info;    // info.buf points at data below
+    uint8_t station_index;   // station_table index, set by the capturing callback
+    uint32_t sequence;       // Per-station frame number, see csi_streams.h
+    uint8_t capture_profile; // csi_capture_profile_t in force when the frame was captured
+    int64_t timestamp_us;    // Wall clock if known at capture (burst backlog), 0 = from the radio timestamp
+    int8_t data[CSI_FRAME_MAX_LENGTH];
+} csi_frame_slot_t;
+
+typedef struct
+{
+    csi_frame_slot_t *slots;
+    uint16_t *next_free;
+    atomic_uint_fast32_t free_head; // ABA tag in the upper 16 bits, slot index in the lower 16
+    uint16_t slot_count;
+} csi_frame_pool_t;
+
+esp_err_t csi_frame_pool_init(csi_frame_pool_t *pool, uint16_t slot_count);
+
+// Pop a free slot, CSI_FRAME_POOL_INVALID_SLOT if the pool is exhausted
+uint16_t csi_frame_pool_acquire(csi_frame_pool_t *pool);
+
+// Push a slot back onto the free stack
+void csi_frame_pool_release(csi_frame_pool_t *pool, uint16_t slot);
+
+static inline csi_frame_slot_t *csi_frame_pool_slot(csi_frame_pool_t *pool, uint16_t slot)
+{
+    return &pool->slots[slot];
+}
+
+// Copy a frame from the WiFi driver into a free slot. Only csi_info->len bytes
+// of CSI are copied. Returns the slot index or CSI_FRAME_POOL_INVALID_SLOT.
+uint16_t csi_frame_pool_capture(csi_frame_pool_t *pool, const wifi_csi_info_t *csi_info);
+
+#endif // CSI_FRAME_POOL_H
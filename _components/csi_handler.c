@@ -0,0 +1,556 @@
+#include "csi_handler.h"
+
+csi_config_t g_csi_config;
+
+// Every sink ring must take a wrapped record of the largest size the encoders install
+_Static_assert(CONFIG_CSI_ENCODED_RING_SIZE >= SPSC_RING_MIN_CAPACITY(CSI_RECORD_MAX_SIZE),
+               "CSI_ENCODED_RING_SIZE below two maximum-size records");
+
+// Payload of an encoder variant: the processing mode, the phase mode split by
+// the sanitizer setting
+typedef enum
+{
+    CSI_ENCODER_PAYLOAD_RAW,
+    CSI_ENCODER_PAYLOAD_AMPLITUDE,
+    CSI_ENCODER_PAYLOAD_PHASE,
+    CSI_ENCODER_PAYLOAD_PHASE_SANITIZED,
+    CSI_ENCODER_PAYLOAD_FEATURES,
+    CSI_ENCODER_PAYLOAD_COUNT
+} csi_encoder_payload_t;
+
+typedef enum
+{
+    CSI_ENCODER_TEXT,
+    CSI_ENCODER_BINARY,
+    CSI_ENCODER_BINARY_COMPRESSED,
+    CSI_ENCODER_KIND_COUNT
+} csi_encoder_kind_t;
+
+// Encode one frame as a binary wire record with the given payload, over the
+// subcarriers selected by the mask and compressed if asked to. Only ever
+// called with constant payload and compressed, so every variant below is
+// compiled down to the code of its own payload.
+// Returns the record length in bytes, or 0 if it does not fit in the output buffer.
+static inline __attribute__((always_inline)) size_t encode_csi_binary_record_as(
+    const csi_frame_slot_t *frame, int64_t timestamp_us, uint8_t *output, size_t capacity,
+    csi_encoder_payload_t payload, bool compressed)
+{
+    const wifi_csi_info_t *csi_data = &frame->info;
+    uint8_t station_index = frame->station_index;
+    if (!csi_data || !csi_data->buf || !output || capacity < sizeof(csi_wire_record_header_t))
+    {
+        return 0;
+    }
+
+    const wifi_pkt_rx_ctrl_t *rx_info = &csi_data->rx_ctrl;
+    csi_wire_record_header_t header = {0};
+
+    header.magic = CSI_WIRE_MAGIC;
+    header.version = CSI_WIRE_VERSION;
+    memcpy(header.mac, csi_data->mac, sizeof(header.mac));
+    header.flags = is_time_synchronized() ? CSI_WIRE_FLAG_TIME_SYNCED : 0;
+    header.timestamp_us = timestamp_us;
+    header.csi_length = csi_data->len;
+
+    header.rx_ctrl.rssi = rx_info->rssi;
+    header.rx_ctrl.rate = rx_info->rate;
+    header.rx_ctrl.sig_mode = rx_info->sig_mode;
+    header.rx_ctrl.mcs = rx_info->mcs;
+    header.rx_ctrl.cwb = rx_info->cwb;
+    header.rx_ctrl.stbc = rx_info->stbc;
+    header.rx_ctrl.rx_flags = (rx_info->smoothing ? CSI_WIRE_RX_SMOOTHING : 0) |
+                              (rx_info->not_sounding ? CSI_WIRE_RX_NOT_SOUNDING : 0) |
+                              (rx_info->aggregation ? CSI_WIRE_RX_AGGREGATION : 0) |
+                              (rx_info->fec_coding ? CSI_WIRE_RX_FEC_CODING : 0) |
+                              (rx_info->sgi ? CSI_WIRE_RX_SGI : 0);
+    header.rx_ctrl.noise_floor = rx_info->noise_floor;
+    header.rx_ctrl.ampdu_cnt = rx_info->ampdu_cnt;
+    header.rx_ctrl.channel = rx_info->channel;
+    header.rx_ctrl.secondary_channel = rx_info->secondary_channel;
+    header.rx_ctrl.ant = rx_info->ant;
+    header.rx_ctrl.local_timestamp = rx_info->timestamp;
+    header.rx_ctrl.sig_len = rx_info->sig_len;
+    header.rx_ctrl.rx_state = rx_info->rx_state;
+    csi_stream_snapshot(station_index, frame->sequence, &header.stream);
+
+    uint8_t *payload_buffer = output + sizeof(header);
+    size_t payload_capacity = capacity - sizeof(header);
+    size_t payload_size = 0;
+    int value_count = 0;
+    size_t value_size = 0;
+
+    int8_t selected_iq[CSI_MAX_ENCODED_SUBCARRIERS * 2];
+    int16_t values[CSI_MAX_ENCODED_SUBCARRIERS];
+    const void *payload_values = values;
+    int pair_count = 0;
+    uint16_t kept[CSI_LTF_COUNT] = {0};
+    header.layout.capture_profile = frame->capture_profile;
+
+    switch (payload)
+    {
+    case CSI_ENCODER_PAYLOAD_FEATURES:
+    {
+        // Window summary, then mean and standard deviation per subcarrier
+        csi_feature_report_t report;
+        if (!csi_features_report(station_index, &report))
+        {
+            return 0;
+        }
+        payload_size = sizeof(csi_wire_features_t) + report.subcarrier_count * sizeof(csi_wire_subcarrier_stats_t);
+        if (payload_size > payload_capacity)
+        {
+            return 0;
+        }
+
+        csi_wire_features_t features = {
+            .frame_count = report.frame_count,
+            .window_frames = report.window_frames,
+            .rssi_mean = report.rssi_mean,
+            .energy = report.energy,
+            .motion_score = report.motion_score};
+        memcpy(payload_buffer, &features, sizeof(features));
+
+        csi_wire_subcarrier_stats_t *stats = (csi_wire_subcarrier_stats_t *)(payload_buffer + sizeof(features));
+        for (uint16_t subcarrier = 0; subcarrier < report.subcarrier_count; subcarrier++)
+        {
+            csi_wire_subcarrier_stats_t entry = {
+                .mean_q8 = (uint16_t)(report.mean[subcarrier] + 0.5f),
+                .stddev_q8 = (uint16_t)(sqrtf(report.m2[subcarrier] / report.window_frames) + 0.5f)};
+            memcpy(&stats[subcarrier], &entry, sizeof(entry));
+        }
+
+        header.payload_type = CSI_WIRE_PAYLOAD_FEATURES;
+        header.value_count = report.subcarrier_count;
+        header.record_length = sizeof(header) + payload_size;
+        memcpy(output, &header, sizeof(header));
+        return header.record_length;
+    }
+
+    case CSI_ENCODER_PAYLOAD_RAW:
+        header.payload_type = CSI_WIRE_PAYLOAD_RAW_IQ;
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        value_count = pair_count * 2;
+        value_size = sizeof(int8_t);
+        payload_values = selected_iq;
+        break;
+
+    case CSI_ENCODER_PAYLOAD_AMPLITUDE:
+        header.payload_type = CSI_WIRE_PAYLOAD_AMPLITUDE_Q8;
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        value_count = pair_count;
+        value_size = sizeof(uint16_t);
+        csi_compute_amplitudes_q8(selected_iq, pair_count, (uint16_t *)values);
+        break;
+
+    case CSI_ENCODER_PAYLOAD_PHASE:
+        header.payload_type = CSI_WIRE_PAYLOAD_PHASE_Q15;
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        value_count = pair_count;
+        value_size = sizeof(int16_t);
+        csi_compute_phases_q15(selected_iq, pair_count, values);
+        break;
+
+    case CSI_ENCODER_PAYLOAD_PHASE_SANITIZED:
+        header.payload_type = CSI_WIRE_PAYLOAD_PHASE_SANITIZED;
+        value_count = csi_phase_gather_sanitized(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                                 CSI_MAX_ENCODED_SUBCARRIERS, values, kept);
+        value_size = sizeof(int16_t);
+        break;
+
+    default:
+        return 0;
+    }
+
+    header.layout.lltf_pairs = kept[CSI_LTF_LLTF];
+    header.layout.htltf_pairs = kept[CSI_LTF_HTLTF];
+    header.layout.stbc_htltf_pairs = kept[CSI_LTF_STBC_HTLTF];
+
+    if (compressed)
+    {
+        uint8_t compression_flags = 0;
+        uint8_t delta_sequence = 0;
+        payload_size = csi_compression_encode(station_index, header.payload_type, payload_values, value_size,
+                                              value_count, payload_buffer, payload_capacity, &compression_flags,
+                                              &delta_sequence);
+        if (payload_size == 0 && value_count > 0)
+        {
+            return 0;
+        }
+        header.flags |= compression_flags;
+        header.delta_sequence = delta_sequence;
+    }
+    else
+    {
+        payload_size = value_count * value_size;
+        if (payload_size > payload_capacity)
+        {
+            return 0;
+        }
+        memcpy(payload_buffer, payload_values, payload_size);
+    }
+
+    header.value_count = value_count;
+    header.record_length = sizeof(header) + payload_size;
+    memcpy(output, &header, sizeof(header));
+
+    return header.record_length;
+}
+
+int format_csi_trailing_columns(const csi_frame_slot_t *frame, const uint16_t *kept, char *text, size_t capacity)
+{
+    csi_wire_stream_t stream;
+    csi_stream_snapshot(frame->station_index, frame->sequence, &stream);
+    return snprintf(text, capacity, ",%lu,%u,%u,%u,%u,%s,%u,%u,%u", (unsigned long)stream.frame_sequence,
+                    stream.alloc_drops, stream.queue_drops, stream.decimated, stream.ring_drops,
+                    csi_capture_profile_name((csi_capture_profile_t)frame->capture_profile),
+                    kept ? kept[CSI_LTF_LLTF] : 0, kept ? kept[CSI_LTF_HTLTF] : 0,
+                    kept ? kept[CSI_LTF_STBC_HTLTF] : 0);
+}
+
+size_t finish_csi_text_record(const csi_frame_slot_t *frame, const uint16_t *kept, char *text, int offset,
+                              size_t capacity)
+{
+    if (offset < 0 || offset + 1 >= (int)capacity)
+    {
+        return 0;
+    }
+    text[offset++] = ']';
+    offset += format_csi_trailing_columns(frame, kept, text + offset, capacity - offset);
+    if (offset + 2 > (int)capacity)
+    {
+        return 0;
+    }
+    memcpy(text + offset, "\n", 2);
+    return offset + 1;
+}
+
+// Feature report as a text line:
+// CSI_FEATURES,<role>,<mac>,<rssi_mean>,<timestamp>,<frames>,<window>,<energy>,<motion>,[<mean>:<stddev> ...],<stream>
+static size_t encode_csi_feature_text_record(const csi_frame_slot_t *frame, int64_t timestamp_us, char *text,
+                                             size_t capacity)
+{
+    const wifi_csi_info_t *csi_data = &frame->info;
+    csi_feature_report_t report;
+    if (!csi_features_report(frame->station_index, &report))
+    {
+        return 0;
+    }
+
+    char mac_string[20] = {0};
+    format_mac_address((uint8_t *)csi_data->mac, mac_string);
+
+    char frame_time[TIMESTAMP_STRING_LENGTH];
+    format_timestamp_microseconds(timestamp_us, frame_time, sizeof(frame_time));
+
+    int offset = snprintf(text, capacity, "CSI_FEATURES,%s,%s,%d,%s,%u,%u,%.2f,%.5f,[",
+                          g_csi_config.device_role, mac_string, report.rssi_mean, frame_time,
+                          report.frame_count, report.window_frames, report.energy, report.motion_score);
+
+    for (uint16_t subcarrier = 0; subcarrier < report.subcarrier_count && offset > 0 && offset < (int)capacity; subcarrier++)
+    {
+        offset += snprintf(text + offset, capacity - offset, "%.2f:%.2f ", report.mean[subcarrier] / 256.0f,
+                           sqrtf(report.m2[subcarrier] / report.window_frames) / 256.0f);
+    }
+
+    return finish_csi_text_record(frame, NULL, text, offset, capacity);
+}
+
+// Encode one frame as a CSV text line (the columns of output_csi_header())
+// with the given payload, a constant like in encode_csi_binary_record_as().
+// Returns the line length including the newline, or 0 if it does not fit in
+// the output buffer.
+static inline __attribute__((always_inline)) size_t encode_csi_text_record_as(
+    const csi_frame_slot_t *frame, int64_t timestamp_us, uint8_t *output, size_t capacity,
+    csi_encoder_payload_t payload)
+{
+    const wifi_csi_info_t *csi_data = &frame->info;
+    if (!csi_data || !csi_data->buf || !output || capacity == 0)
+    {
+        return 0;
+    }
+
+    char *text = (char *)output;
+    const wifi_pkt_rx_ctrl_t *rx_info = &csi_data->rx_ctrl;
+
+    if (payload == CSI_ENCODER_PAYLOAD_FEATURES)
+    {
+        return encode_csi_feature_text_record(frame, timestamp_us, text, capacity);
+    }
+
+    char mac_string[20] = {0};
+    format_mac_address((uint8_t *)csi_data->mac, mac_string);
+
+    char frame_time[TIMESTAMP_STRING_LENGTH];
+    format_timestamp_microseconds(timestamp_us, frame_time, sizeof(frame_time));
+
+    int offset = snprintf(text, capacity,
+                          "CSI_DATA,%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%s,%d,[",
+                          g_csi_config.device_role, mac_string,
+                          rx_info->rssi, rx_info->rate, rx_info->sig_mode, rx_info->mcs, rx_info->cwb,
+                          rx_info->smoothing, rx_info->not_sounding, rx_info->aggregation, rx_info->stbc,
+                          rx_info->fec_coding, rx_info->sgi, rx_info->noise_floor, rx_info->ampdu_cnt,
+                          rx_info->channel, rx_info->secondary_channel, rx_info->timestamp, rx_info->ant,
+                          rx_info->sig_len, rx_info->rx_state, is_time_synchronized(), frame_time, csi_data->len);
+
+    int8_t selected_iq[CSI_MAX_ENCODED_SUBCARRIERS * 2];
+    uint16_t kept[CSI_LTF_COUNT];
+    int pair_count = 0;
+
+    switch (payload)
+    {
+    case CSI_ENCODER_PAYLOAD_RAW:
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        for (int idx = 0; idx < pair_count * 2 && offset > 0 && offset < (int)capacity; idx++)
+        {
+            offset += snprintf(text + offset, capacity - offset, "%d ", selected_iq[idx]);
+        }
+        break;
+
+    case CSI_ENCODER_PAYLOAD_AMPLITUDE:
+    {
+        float amplitudes[CSI_MAX_ENCODED_SUBCARRIERS];
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        csi_compute_amplitudes(selected_iq, pair_count, amplitudes);
+        for (int idx = 0; idx < pair_count && offset > 0 && offset < (int)capacity; idx++)
+        {
+            offset += snprintf(text + offset, capacity - offset, "%.4f ", amplitudes[idx]);
+        }
+        break;
+    }
+
+    case CSI_ENCODER_PAYLOAD_PHASE:
+    {
+        float phases[CSI_MAX_ENCODED_SUBCARRIERS];
+        pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+        csi_compute_phases(selected_iq, pair_count, phases);
+        for (int idx = 0; idx < pair_count && offset > 0 && offset < (int)capacity; idx++)
+        {
+            offset += snprintf(text + offset, capacity - offset, "%.4f ", phases[idx]);
+        }
+        break;
+    }
+
+    case CSI_ENCODER_PAYLOAD_PHASE_SANITIZED:
+    {
+        int16_t sanitized[CSI_MAX_ENCODED_SUBCARRIERS];
+        pair_count = csi_phase_gather_sanitized(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                                CSI_MAX_ENCODED_SUBCARRIERS, sanitized, kept);
+        for (int idx = 0; idx < pair_count && offset > 0 && offset < (int)capacity; idx++)
+        {
+            offset += snprintf(text + offset, capacity - offset, "%.4f ",
+                               sanitized[idx] * CSI_PHASE_SANITIZED_TO_RADIANS);
+        }
+        break;
+    }
+
+    default:
+        return 0;
+    }
+
+    return finish_csi_text_record(frame, kept, text, offset, capacity);
+}
+
+// One text, binary and compressed binary encoder per payload
+#define CSI_DEFINE_ENCODERS(name, payload)                                                                      \
+    static size_t encode_csi_##name##_text(const csi_frame_slot_t *frame, int64_t timestamp_us,                 \
+                                           uint8_t *output, size_t capacity)                                    \
+    {                                                                                                           \
+        return encode_csi_text_record_as(frame, timestamp_us, output, capacity, payload);                       \
+    }                                                                                                           \
+    static size_t encode_csi_##name##_binary(const csi_frame_slot_t *frame, int64_t timestamp_us,               \
+                                             uint8_t *output, size_t capacity)                                  \
+    {                                                                                                           \
+        return encode_csi_binary_record_as(frame, timestamp_us, output, capacity, payload, false);              \
+    }                                                                                                           \
+    static size_t encode_csi_##name##_binary_compressed(const csi_frame_slot_t *frame, int64_t timestamp_us,    \
+                                                        uint8_t *output, size_t capacity)                       \
+    {                                                                                                           \
+        return encode_csi_binary_record_as(frame, timestamp_us, output, capacity, payload, true);               \
+    }
+
+CSI_DEFINE_ENCODERS(raw, CSI_ENCODER_PAYLOAD_RAW)
+CSI_DEFINE_ENCODERS(amplitude, CSI_ENCODER_PAYLOAD_AMPLITUDE)
+CSI_DEFINE_ENCODERS(phase, CSI_ENCODER_PAYLOAD_PHASE)
+CSI_DEFINE_ENCODERS(phase_sanitized, CSI_ENCODER_PAYLOAD_PHASE_SANITIZED)
+CSI_DEFINE_ENCODERS(features, CSI_ENCODER_PAYLOAD_FEATURES)
+
+#define CSI_ENCODER_ROW(name)                                                                                   \
+    {                                                                                                           \
+        [CSI_ENCODER_TEXT] = encode_csi_##name##_text,                                                          \
+        [CSI_ENCODER_BINARY] = encode_csi_##name##_binary,                                                      \
+        [CSI_ENCODER_BINARY_COMPRESSED] = encode_csi_##name##_binary_compressed,                                \
+    }
+
+// Dispatch table, read only when the settings change
+static csi_record_encoder_t g_csi_encoders[CSI_ENCODER_PAYLOAD_COUNT][CSI_ENCODER_KIND_COUNT] = {
+    [CSI_ENCODER_PAYLOAD_RAW] = CSI_ENCODER_ROW(raw),
+    [CSI_ENCODER_PAYLOAD_AMPLITUDE] = CSI_ENCODER_ROW(amplitude),
+    [CSI_ENCODER_PAYLOAD_PHASE] = CSI_ENCODER_ROW(phase),
+    [CSI_ENCODER_PAYLOAD_PHASE_SANITIZED] = CSI_ENCODER_ROW(phase_sanitized),
+    [CSI_ENCODER_PAYLOAD_FEATURES] = CSI_ENCODER_ROW(features),
+};
+
+// Payloads a mode produces: both phase entries for the phase mode. Returns
+// the number of payloads, 0 for an unknown mode.
+static int csi_mode_payloads(csi_processing_mode_t mode, csi_encoder_payload_t payloads[2])
+{
+    switch (mode)
+    {
+    case CSI_MODE_RAW_DATA:
+        payloads[0] = CSI_ENCODER_PAYLOAD_RAW;
+        return 1;
+    case CSI_MODE_AMPLITUDE:
+        payloads[0] = CSI_ENCODER_PAYLOAD_AMPLITUDE;
+        return 1;
+    case CSI_MODE_PHASE_INFO:
+        payloads[0] = CSI_ENCODER_PAYLOAD_PHASE;
+        payloads[1] = CSI_ENCODER_PAYLOAD_PHASE_SANITIZED;
+        return 2;
+    case CSI_MODE_FEATURES:
+        payloads[0] = CSI_ENCODER_PAYLOAD_FEATURES;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+void select_csi_encoders()
+{
+    csi_encoder_payload_t payloads[2];
+    int payload_count = csi_mode_payloads(g_csi_config.mode, payloads);
+    csi_record_encoder_t text_encoder = NULL;
+    csi_record_encoder_t binary_encoder = NULL;
+    if (payload_count > 0)
+    {
+        // The sanitized phase is the second payload of the phase mode
+        const csi_record_encoder_t *encoders =
+            g_csi_encoders[payloads[(payload_count > 1 && csi_phase_sanitize_enabled()) ? 1 : 0]];
+        text_encoder = encoders[CSI_ENCODER_TEXT];
+        binary_encoder = encoders[csi_compression_enabled() ? CSI_ENCODER_BINARY_COMPRESSED : CSI_ENCODER_BINARY];
+    }
+
+    csi_sink_set_encoder(CSI_WIRE_FORMAT_TEXT, text_encoder, CSI_RECORD_MAX_SIZE);
+    csi_sink_set_encoder(CSI_WIRE_FORMAT_BINARY, binary_encoder, CSI_BINARY_RECORD_MAX_SIZE);
+    csi_pipeline_set_frame_stage(g_csi_config.mode == CSI_MODE_FEATURES ? csi_feature_stage : NULL);
+}
+
+void override_csi_encoder(csi_processing_mode_t mode, csi_wire_format_t format, csi_record_encoder_t encoder)
+{
+    csi_encoder_payload_t payloads[2];
+    int payload_count = csi_mode_payloads(mode, payloads);
+    for (int index = 0; index < payload_count; index++)
+    {
+        if (format == CSI_WIRE_FORMAT_TEXT)
+        {
+            g_csi_encoders[payloads[index]][CSI_ENCODER_TEXT] = encoder;
+        }
+        else
+        {
+            g_csi_encoders[payloads[index]][CSI_ENCODER_BINARY] = encoder;
+            g_csi_encoders[payloads[index]][CSI_ENCODER_BINARY_COMPRESSED] = encoder;
+        }
+    }
+}
+
+bool csi_feature_stage(const csi_frame_slot_t *frame, int64_t timestamp_us)
+{
+    return csi_features_update(frame->station_index, &frame->info, (csi_capture_profile_t)frame->capture_profile,
+                               timestamp_us);
+}
+
+void enhanced_csi_callback(void *context, wifi_csi_info_t *csi_data)
+{
+    csi_pipeline_capture(csi_data);
+}
+
+// Start the shared pipeline with a serial text sink for the default callback
+static esp_err_t start_default_csi_pipeline()
+{
+    esp_err_t result = csi_pipeline_register_serial_sink(CSI_WIRE_FORMAT_TEXT, true);
+    if (result != ESP_OK && result != ESP_ERR_INVALID_ARG)
+    {
+        return result;
+    }
+
+    csi_pipeline_config_t pipeline_config = CSI_PIPELINE_DEFAULT_CONFIG();
+    result = csi_pipeline_start(&pipeline_config);
+    return (result == ESP_ERR_INVALID_STATE) ? ESP_OK : result;
+}
+
+void output_csi_header()
+{
+    const char *header_format = "data_type,node_role,source_mac,rssi,data_rate,signal_mode,"
+                                "mcs_index,channel_width,smoothing_enabled,not_sounding,"
+                                "aggregation_flag,stbc_enabled,fec_type,short_gi,noise_level,"
+                                "ampdu_count,primary_channel,secondary_channel,local_time,"
+                                "antenna_id,signal_length,rx_status,time_sync_flag,"
+                                "timestamp_value,data_length,csi_measurements,frame_sequence,"
+                                "alloc_drops,queue_drops,decimated,ring_drops,capture_profile,"
+                                "lltf_subcarriers,htltf_subcarriers,stbc_htltf_subcarriers\n";
+    printf("%s", header_format);
+}
+
+esp_err_t initialize_csi_collection(const char *role_name, csi_processing_mode_t mode,
+                                    wifi_csi_cb_t custom_callback)
+{
+    // Store configuration
+    strncpy(g_csi_config.device_role, role_name, sizeof(g_csi_config.device_role) - 1);
+    g_csi_config.mode = mode;
+    g_csi_config.enable_filtering = true;
+    g_csi_config.buffer_size = CSI_FRAME_MAX_LENGTH;
+    select_csi_encoders();
+
+    // Enable CSI functionality
+    esp_err_t result = esp_wifi_set_csi(true);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    // Training fields to capture, see csi_capture_profile.h
+    result = csi_capture_profile_apply(csi_capture_profile_current());
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    // The default callback needs the shared pipeline running before frames arrive
+    if (custom_callback == NULL)
+    {
+        result = start_default_csi_pipeline();
+        if (result != ESP_OK)
+        {
+            return result;
+        }
+    }
+
+    // Set callback function
+    wifi_csi_cb_t callback_func = (custom_callback != NULL) ? custom_callback : enhanced_csi_callback;
+    result = esp_wifi_set_csi_rx_cb(callback_func, NULL);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    // Output header
+    output_csi_header();
+
+    return ESP_OK;
+}
+
+void set_csi_processing_mode(csi_processing_mode_t new_mode)
+{
+    g_csi_config.mode = new_mode;
+    select_csi_encoders();
+}
+
+csi_config_t get_csi_configuration()
+{
+    return g_csi_config;
+}
@@ -0,0 +1,54 @@
+#include "csi_math.h"
+
+void csi_compute_amplitudes(const int8_t *iq, int pair_count, float *amplitudes)
+{
+#ifdef CSI_MATH_HAVE_ESP_DSP
+    // Square I and Q with the esp-dsp vector multiply, then sum pairs using strided add
+    float iq_values[CSI_MATH_DSP_BLOCK * 2];
+    float squares[CSI_MATH_DSP_BLOCK * 2];
+
+    for (int base = 0; base < pair_count; base += CSI_MATH_DSP_BLOCK)
+    {
+        int block = (pair_count - base < CSI_MATH_DSP_BLOCK) ? pair_count - base : CSI_MATH_DSP_BLOCK;
+        for (int idx = 0; idx < block * 2; idx++)
+        {
+            iq_values[idx] = iq[base * 2 + idx];
+        }
+        dsps_mul_f32(iq_values, iq_values, squares, block * 2, 1, 1, 1);
+        dsps_add_f32(squares, squares + 1, amplitudes + base, block, 2, 2, 1);
+        for (int idx = 0; idx < block; idx++)
+        {
+            amplitudes[base + idx] = sqrtf(amplitudes[base + idx]);
+        }
+    }
+#else
+    for (int idx = 0; idx < pair_count; idx++)
+    {
+        amplitudes[idx] = csi_iq_amplitude(iq[idx * 2], iq[idx * 2 + 1]);
+    }
+#endif
+}
+
+void csi_compute_amplitudes_q8(const int8_t *iq, int pair_count, uint16_t *amplitudes)
+{
+    for (int idx = 0; idx < pair_count; idx++)
+    {
+        amplitudes[idx] = csi_iq_amplitude_q8(iq[idx * 2], iq[idx * 2 + 1]);
+    }
+}
+
+void csi_compute_phases_q15(const int8_t *iq, int pair_count, int16_t *phases)
+{
+    for (int idx = 0; idx < pair_count; idx++)
+    {
+        phases[idx] = csi_iq_phase_q15(iq[idx * 2], iq[idx * 2 + 1]);
+    }
+}
+
+void csi_compute_phases(const int8_t *iq, int pair_count, float *phases)
+{
+    for (int idx = 0; idx < pair_count; idx++)
+    {
+        phases[idx] = csi_iq_phase(iq[idx * 2], iq[idx * 2 + 1]);
+    }
+}
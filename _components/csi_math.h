@@ -0,0 +1,143 @@
+#ifndef CSI_MATH_H
+#define CSI_MATH_H
+
+// Amplitude and phase kernels over int8 I/Q pairs. The ESP32 FPU is single
+// precision only, so nothing here touches double: amplitudes use an exact
+// integer square plus sqrtf (or an integer square root for the Q8 variant)
+// and phases use an integer CORDIC.
+//
+// Error versus the previous double sqrt()/atan2() output, measured
+// exhaustively over all 65536 int8 I/Q pairs:
+//   csi_iq_amplitude     |err| < 1e-5      (float sqrtf of an exact integer)
+//   csi_iq_amplitude_q8  |err| < 1.96e-3   (8 fractional bits, ~1/512)
+//   csi_iq_phase_q15     |err| < 1e-4 rad  (18-step CORDIC plus Q15 rounding)
+//   csi_iq_phase         |err| < 1e-4 rad
+
+#include <stdint.h>
+#include <math.h>
+#include "sdkconfig.h"
+
+#if defined(CONFIG_CSI_KERNELS_USE_ESP_DSP) && __has_include("dsps_add.h")
+#include "dsps_add.h"
+#include "dsps_mul.h"
+#define CSI_MATH_HAVE_ESP_DSP 1
+#define CSI_MATH_DSP_BLOCK 64
+#endif
+
+#define CSI_PHASE_Q15_TO_RADIANS ((float)M_PI / 32768.0f)
+
+// CORDIC rotation angles atan(2^-i) in units of pi / 2^20
+static const int32_t csi_cordic_angles[] = {
+    262144, 154753, 81767, 41506, 20834, 10427, 5215, 2608, 1304,
+    652, 326, 163, 81, 41, 20, 10, 5, 3};
+
+#define CSI_CORDIC_ITERATIONS (sizeof(csi_cordic_angles) / sizeof(csi_cordic_angles[0]))
+
+static inline uint32_t csi_isqrt32(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static inline float csi_iq_amplitude(int8_t real_part, int8_t imag_part)
+{
+    int32_t power = (int32_t)real_part * real_part + (int32_t)imag_part * imag_part;
+    return sqrtf((float)power);
+}
+
+// Amplitude with 8 fractional bits, rounded to nearest (max 181.02 -> 46341)
+static inline uint16_t csi_iq_amplitude_q8(int8_t real_part, int8_t imag_part)
+{
+    uint32_t power = (uint32_t)((int32_t)real_part * real_part + (int32_t)imag_part * imag_part) << 16;
+    uint32_t root = csi_isqrt32(power);
+
+    // Round up when value >= (root + 0.5)^2, i.e. value - root^2 > root
+    return (uint16_t)(root + ((power - root * root) > root ? 1 : 0));
+}
+
+// Phase in Q15 units of pi: -32768..32767 covers [-pi, pi)
+static inline int16_t csi_iq_phase_q15(int8_t real_part, int8_t imag_part)
+{
+    int32_t x = (int32_t)real_part << 20;
+    int32_t y = (int32_t)imag_part << 20;
+    int32_t angle = 0;
+
+    if (x == 0 && y == 0)
+    {
+        return 0;
+    }
+
+    // Rotate into the right half-plane by +/- 90 degrees
+    if (x < 0)
+    {
+        int32_t previous_x = x;
+        if (y >= 0)
+        {
+            x = y;
+            y = -previous_x;
+            angle = 1 << 19;
+        }
+        else
+        {
+            x = -y;
+            y = previous_x;
+            angle = -(1 << 19);
+        }
+    }
+
+    for (unsigned int iteration = 0; iteration < CSI_CORDIC_ITERATIONS; iteration++)
+    {
+        int32_t previous_x = x;
+        if (y > 0)
+        {
+            x += y >> iteration;
+            y -= previous_x >> iteration;
+            angle += csi_cordic_angles[iteration];
+        }
+        else
+        {
+            x -= y >> iteration;
+            y += previous_x >> iteration;
+            angle -= csi_cordic_angles[iteration];
+        }
+    }
+
+    // pi / 2^20 -> pi / 2^15 with rounding, +pi wraps to the representable edge
+    angle = (angle + (1 << 4)) >> 5;
+    return (int16_t)(angle > INT16_MAX ? INT16_MAX : (angle < INT16_MIN ? INT16_MIN : angle));
+}
+
+static inline float csi_iq_phase(int8_t real_part, int8_t imag_part)
+{
+    return csi_iq_phase_q15(real_part, imag_part) * CSI_PHASE_Q15_TO_RADIANS;
+}
+
+// Vector forms over interleaved I/Q pairs (iq[2k] = real, iq[2k + 1] = imaginary)
+
+void csi_compute_amplitudes(const int8_t *iq, int pair_count, float *amplitudes);
+
+void csi_compute_amplitudes_q8(const int8_t *iq, int pair_count, uint16_t *amplitudes);
+
+void csi_compute_phases_q15(const int8_t *iq, int pair_count, int16_t *phases);
+
+void csi_compute_phases(const int8_t *iq, int pair_count, float *phases);
+
+#endif // CSI_MATH_H
@@ -0,0 +1,177 @@
+#include "csi_overload.h"
+
+static const char *OVERLOAD_TAG = "CSI_OVERLOAD";
+
+csi_overload_t g_csi_overload = {.decimation_factor = 1};
+
+const char *csi_overload_policy_name(csi_overload_policy_t policy)
+{
+    switch (policy)
+    {
+    case CSI_OVERLOAD_DROP_OLDEST:
+        return "drop-oldest";
+    case CSI_OVERLOAD_DECIMATE:
+        return "decimate";
+    case CSI_OVERLOAD_DROP_NEWEST:
+    default:
+        return "drop-newest";
+    }
+}
+
+// Aggregated drop report, runs in the esp_timer task
+static void csi_overload_report(void *argument)
+{
+    uint32_t allocation_failures = g_pipeline_stats.allocation_failures;
+    uint32_t queue_drops = g_pipeline_stats.queue_drops;
+    uint32_t decimated = g_pipeline_stats.frames_decimated;
+    uint32_t ring_drops = g_pipeline_stats.ring_drops;
+
+    uint32_t new_allocation_failures = allocation_failures - g_csi_overload.reported_allocation_failures;
+    uint32_t new_queue_drops = queue_drops - g_csi_overload.reported_queue_drops;
+    uint32_t new_decimated = decimated - g_csi_overload.reported_decimated;
+    uint32_t new_ring_drops = ring_drops - g_csi_overload.reported_ring_drops;
+
+    if (new_allocation_failures || new_queue_drops || new_decimated || new_ring_drops)
+    {
+        ESP_LOGW(OVERLOAD_TAG, "Last %d ms: %lu pool, %lu queue (%s), %lu decimated (1/%lu), %lu ring drops",
+                 CONFIG_CSI_DROP_REPORT_INTERVAL_MS, (unsigned long)new_allocation_failures,
+                 (unsigned long)new_queue_drops, csi_overload_policy_name(g_csi_overload.policy),
+                 (unsigned long)new_decimated, (unsigned long)g_csi_overload.decimation_factor,
+                 (unsigned long)new_ring_drops);
+    }
+
+    g_csi_overload.reported_allocation_failures = allocation_failures;
+    g_csi_overload.reported_queue_drops = queue_drops;
+    g_csi_overload.reported_decimated = decimated;
+    g_csi_overload.reported_ring_drops = ring_drops;
+}
+
+esp_err_t csi_overload_init(csi_frame_pool_t *pool, uint32_t queue_depth, csi_overload_policy_t policy)
+{
+    if (!pool || queue_depth == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_csi_overload.policy = policy;
+    g_csi_overload.pool = pool;
+    g_csi_overload.high_watermark = (queue_depth * CONFIG_CSI_DECIMATION_HIGH_WATERMARK + 99) / 100;
+    g_csi_overload.low_watermark = queue_depth * CONFIG_CSI_DECIMATION_LOW_WATERMARK / 100;
+    g_csi_overload.decimation_factor = 1;
+
+    if (CONFIG_CSI_DROP_REPORT_INTERVAL_MS > 0)
+    {
+        const esp_timer_create_args_t timer_args = {
+            .callback = csi_overload_report,
+            .name = "csi_drop_report"};
+
+        esp_err_t result = esp_timer_create(&timer_args, &g_csi_overload.report_timer);
+        if (result != ESP_OK)
+        {
+            return result;
+        }
+        return esp_timer_start_periodic(g_csi_overload.report_timer, CONFIG_CSI_DROP_REPORT_INTERVAL_MS * 1000ULL);
+    }
+    return ESP_OK;
+}
+
+void csi_overload_set_policy(csi_overload_policy_t policy)
+{
+    g_csi_overload.policy = policy;
+    g_csi_overload.decimation_factor = 1;
+}
+
+// Adjust the decimation factor from the queue fill level, at most once per interval
+static void csi_overload_adapt()
+{
+    int64_t now_us = esp_timer_get_time();
+    if (now_us < g_csi_overload.next_adaptation_us)
+    {
+        return;
+    }
+    g_csi_overload.next_adaptation_us = now_us + CSI_OVERLOAD_ADAPT_INTERVAL_US;
+
+    uint32_t depth = csi_scheduler_depth();
+    uint32_t factor = g_csi_overload.decimation_factor;
+
+    if (depth >= g_csi_overload.high_watermark && factor < CONFIG_CSI_DECIMATION_MAX_FACTOR)
+    {
+        factor *= 2;
+    }
+    else if (depth <= g_csi_overload.low_watermark && factor > 1)
+    {
+        factor /= 2;
+    }
+
+    g_csi_overload.decimation_factor = factor > CONFIG_CSI_DECIMATION_MAX_FACTOR ? CONFIG_CSI_DECIMATION_MAX_FACTOR : factor;
+}
+
+bool csi_overload_admit(uint8_t station_index)
+{
+    if (g_csi_overload.policy != CSI_OVERLOAD_DECIMATE)
+    {
+        return true;
+    }
+
+    csi_overload_adapt();
+
+    uint32_t factor = g_csi_overload.decimation_factor;
+    if (factor <= 1)
+    {
+        return true;
+    }
+
+    // Count per station so each one keeps 1/N of its own frames
+    uint8_t *phase = &g_csi_overload.station_phase[station_index < STATION_TABLE_MAX_STATIONS ? station_index : CSI_OVERLOAD_UNKNOWN_STATION];
+    bool keep = (*phase % factor) == 0;
+    *phase = (uint8_t)((*phase + 1) % factor);
+
+    if (!keep)
+    {
+        g_pipeline_stats.frames_decimated++;
+        csi_stream_t *stream = csi_stream(station_index);
+        if (stream)
+        {
+            stream->decimated++;
+        }
+    }
+    return keep;
+}
+
+// Count a queue drop against the station of the frame and release its slot
+static void csi_overload_drop_slot(uint16_t frame_slot)
+{
+    csi_stream_t *stream = csi_stream(csi_frame_pool_slot(g_csi_overload.pool, frame_slot)->station_index);
+    if (stream)
+    {
+        stream->queue_drops++;
+    }
+    csi_frame_pool_release(g_csi_overload.pool, frame_slot);
+    g_pipeline_stats.queue_drops++;
+}
+
+bool csi_overload_enqueue(uint16_t frame_slot)
+{
+    uint8_t station_index = csi_frame_pool_slot(g_csi_overload.pool, frame_slot)->station_index;
+    if (csi_scheduler_enqueue(station_index, frame_slot))
+    {
+        return true;
+    }
+
+    if (g_csi_overload.policy == CSI_OVERLOAD_DROP_OLDEST)
+    {
+        uint16_t oldest_slot = csi_scheduler_evict_oldest(station_index);
+        if (oldest_slot != CSI_FRAME_POOL_INVALID_SLOT)
+        {
+            csi_overload_drop_slot(oldest_slot);
+        }
+
+        if (csi_scheduler_enqueue(station_index, frame_slot))
+        {
+            return true;
+        }
+    }
+
+    csi_overload_drop_slot(frame_slot);
+    return false;
+}
@@ -0,0 +1,87 @@
+#ifndef CSI_OVERLOAD_H
+#define CSI_OVERLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "csi_frame_pool.h"
+#include "csi_scheduler.h"
+#include "station_table.h"
+#include "csi_streams.h"
+#include "pipeline_stats.h"
+
+// What the WiFi callback does when frames arrive faster than the encoder
+// drains the CSI queue. A station's queue is full once it holds its share of
+// the queue depth (see csi_scheduler.h), so every policy acts per station:
+//   DROP_NEWEST  discard the incoming frame (the old tail-drop behaviour)
+//   DROP_OLDEST  evict the station's oldest queued frame so its freshest
+//                samples survive
+//   DECIMATE     above the high watermark (frames queued over all stations)
+//                keep only every Nth frame of each station, doubling N while
+//                the queue stays high and halving it again below the low
+//                watermark; full queues drop newest
+// Drops are never logged per frame. A periodic timer logs one aggregated
+// line per interval, and only if something was dropped.
+
+// Defaults for projects whose Kconfig does not define the overload options
+#ifndef CONFIG_CSI_DECIMATION_HIGH_WATERMARK
+#define CONFIG_CSI_DECIMATION_HIGH_WATERMARK 75
+#endif
+#ifndef CONFIG_CSI_DECIMATION_LOW_WATERMARK
+#define CONFIG_CSI_DECIMATION_LOW_WATERMARK 25
+#endif
+#ifndef CONFIG_CSI_DECIMATION_MAX_FACTOR
+#define CONFIG_CSI_DECIMATION_MAX_FACTOR 8
+#endif
+#ifndef CONFIG_CSI_DROP_REPORT_INTERVAL_MS
+#define CONFIG_CSI_DROP_REPORT_INTERVAL_MS 1000
+#endif
+
+#define CSI_OVERLOAD_ADAPT_INTERVAL_US 50000
+#define CSI_OVERLOAD_UNKNOWN_STATION STATION_TABLE_MAX_STATIONS
+
+typedef enum
+{
+    CSI_OVERLOAD_DROP_NEWEST = 0,
+    CSI_OVERLOAD_DROP_OLDEST = 1,
+    CSI_OVERLOAD_DECIMATE = 2
+} csi_overload_policy_t;
+
+typedef struct
+{
+    csi_overload_policy_t policy;
+    csi_frame_pool_t *pool;
+    uint32_t high_watermark;
+    uint32_t low_watermark;
+    volatile uint32_t decimation_factor; // 1 keeps every frame
+    int64_t next_adaptation_us;
+    uint8_t station_phase[STATION_TABLE_MAX_STATIONS + 1]; // Last entry for stations without an index
+    uint32_t reported_allocation_failures;
+    uint32_t reported_queue_drops;
+    uint32_t reported_decimated;
+    uint32_t reported_ring_drops;
+    esp_timer_handle_t report_timer;
+} csi_overload_t;
+
+extern csi_overload_t g_csi_overload;
+
+const char *csi_overload_policy_name(csi_overload_policy_t policy);
+
+// Watermarks are percentages of the queue depth
+esp_err_t csi_overload_init(csi_frame_pool_t *pool, uint32_t queue_depth, csi_overload_policy_t policy);
+
+void csi_overload_set_policy(csi_overload_policy_t policy);
+
+// Called from the WiFi callback before the frame is copied. False means the
+// frame is decimated away.
+bool csi_overload_admit(uint8_t station_index);
+
+// Queue a captured frame slot on its station's queue, applying the drop
+// policy if that queue is full. The slot is released here if it cannot be queued.
+bool csi_overload_enqueue(uint16_t frame_slot);
+
+#endif // CSI_OVERLOAD_H
@@ -0,0 +1,105 @@
+#include "csi_phase.h"
+
+volatile bool g_csi_phase_sanitize;
+
+void csi_phase_sanitize_field(const int8_t *iq, int pairs, int16_t *phases)
+{
+    int32_t unwrapped[CSI_PHASE_MAX_FIELD_PAIRS];
+    int negative = pairs / 2; // Positions of the negative subcarriers, which come first in subcarrier order
+    int32_t count = 0;
+    int64_t sum_k = 0;
+    int64_t sum_kk = 0;
+    int64_t sum_y = 0;
+    int64_t sum_ky = 0;
+    int16_t previous = 0;
+    int32_t accumulated = 0;
+    int32_t previous_k = 0;
+    int32_t step = 0; // Between the last two neighbouring subcarriers
+
+    for (int order = 0; order < pairs; order++)
+    {
+        int position = order < negative ? pairs - negative + order : order - negative;
+        int8_t real_part = iq[position * 2];
+        int8_t imag_part = iq[position * 2 + 1];
+        if (real_part == 0 && imag_part == 0)
+        {
+            unwrapped[position] = INT32_MIN;
+            continue;
+        }
+
+        // Across null subcarriers, unwrap against the phase the last step predicts
+        int16_t phase = csi_iq_phase_q15(real_part, imag_part);
+        int32_t k = csi_phase_subcarrier(position, pairs);
+        if (count == 0)
+        {
+            accumulated = phase;
+        }
+        else if (k - previous_k == 1)
+        {
+            step = (int16_t)(uint16_t)(phase - previous);
+            accumulated += step;
+        }
+        else
+        {
+            int32_t predicted = accumulated + step * (k - previous_k);
+            accumulated = predicted + (int16_t)(uint16_t)(phase - (uint16_t)predicted);
+        }
+        previous = phase;
+        previous_k = k;
+        unwrapped[position] = accumulated;
+
+        count++;
+        sum_k += k;
+        sum_kk += k * k;
+        sum_y += accumulated;
+        sum_ky += (int64_t)k * accumulated;
+    }
+
+    float slope = 0.0f;
+    float offset = 0.0f;
+    if (count > 0)
+    {
+        int64_t denominator = count * sum_kk - sum_k * sum_k;
+        if (denominator != 0)
+        {
+            slope = (float)(count * sum_ky - sum_k * sum_y) / (float)denominator;
+        }
+        offset = ((float)sum_y - slope * (float)sum_k) / (float)count;
+    }
+
+    const float scale = 1.0f / (1 << CSI_PHASE_SANITIZED_SHIFT);
+    for (int position = 0; position < pairs; position++)
+    {
+        if (unwrapped[position] == INT32_MIN)
+        {
+            phases[position] = 0;
+            continue;
+        }
+        float residual = ((float)unwrapped[position] - slope * csi_phase_subcarrier(position, pairs) - offset) * scale;
+        int32_t value = lrintf(residual);
+        phases[position] = (int16_t)(value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value));
+    }
+}
+
+int csi_phase_gather_sanitized(const wifi_csi_info_t *csi_data, csi_capture_profile_t profile, int max_pairs,
+                               int16_t *values, uint16_t kept[CSI_LTF_COUNT])
+{
+    csi_capture_layout_t layout;
+    csi_capture_layout(profile, csi_data, &layout);
+
+    int16_t field_phases[CSI_PHASE_MAX_FIELD_PAIRS];
+    int total = 0;
+    for (int field = 0; field < CSI_LTF_COUNT; field++)
+    {
+        int pairs = 0;
+        if (layout.pairs[field])
+        {
+            csi_phase_sanitize_field(csi_data->buf + layout.offset[field] * 2, layout.pairs[field], field_phases);
+            pairs = csi_subcarrier_mask_gather_values(field_phases, layout.pairs[field], max_pairs - total,
+                                                      values + total);
+        }
+        kept[field] = (uint16_t)pairs;
+        total += pairs;
+    }
+    return total;
+}
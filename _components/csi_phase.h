@@ -0,0 +1,71 @@
+#ifndef CSI_PHASE_H
+#define CSI_PHASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "esp_wifi.h"
+#include "csi_math.h"
+#include "csi_frame_pool.h"
+#include "csi_subcarrier_mask.h"
+#include "csi_capture_profile.h"
+
+// Phase sanitization for the PHASE mode. The raw phase of a subcarrier is
+// wrapped to [-pi, pi) and carries a linear term across the band from the
+// symbol timing offset and a constant one from the carrier frequency and
+// phase offsets, both of which change from frame to frame. Per training
+// field, the sanitizer
+//
+//   1. takes the CORDIC phase of every subcarrier with a non-zero I/Q pair
+//      (null DC and guard subcarriers are reported as 0, 0 and left out),
+//   2. unwraps it in subcarrier order, -N/2 .. N/2 - 1, with int16
+//      wrap-around arithmetic on the Q15 phases; across null subcarriers
+//      against the phase the previous step predicts,
+//   3. fits phase = slope * k + offset by closed-form least squares over the
+//      subcarrier indices k it kept (integer sums, one float division), and
+//   4. emits the residual in CSI_PHASE_SANITIZED units, 0 for left out
+//      subcarriers,
+//
+// before the subcarrier mask is applied, so the fit uses the whole field and
+// the output has the same positions as the other modes. The residual is
+// small and changes slowly between frames, which is what the delta
+// compression needs; a consumer gets the phase without unwrapping or
+// detrending it. The removed slope and offset are not kept.
+
+#define CSI_PHASE_SANITIZED_SHIFT 5 // Q15 units of pi to the output units
+#define CSI_PHASE_SANITIZED_TO_RADIANS ((float)M_PI / 1024.0f) // int16 covers +/- 32 pi
+
+#define CSI_PHASE_MAX_FIELD_PAIRS (CSI_FRAME_MAX_LENGTH / 2)
+
+extern volatile bool g_csi_phase_sanitize;
+
+static inline void csi_phase_set_sanitize(bool enabled)
+{
+    g_csi_phase_sanitize = enabled;
+}
+
+static inline bool csi_phase_sanitize_enabled()
+{
+    return g_csi_phase_sanitize;
+}
+
+// Subcarrier index of a buffer position: the first (pairs + 1) / 2 positions
+// are 0 upwards, the rest the negative subcarriers (64: 0..31, -32..-1; 121:
+// 0..60, -60..-1)
+static inline int csi_phase_subcarrier(int position, int pairs)
+{
+    return position < (pairs + 1) / 2 ? position : position - pairs;
+}
+
+// Sanitized phase of every position of one training field
+void csi_phase_sanitize_field(const int8_t *iq, int pairs, int16_t *phases);
+
+// Sanitized phases of every training field of a frame, masked and next to
+// each other like csi_capture_gather() lays out the I/Q pairs, at most
+// max_pairs in total. kept receives the values taken from each field.
+// Returns the total number of values.
+int csi_phase_gather_sanitized(const wifi_csi_info_t *csi_data, csi_capture_profile_t profile, int max_pairs,
+                               int16_t *values, uint16_t kept[CSI_LTF_COUNT]);
+
+#endif // CSI_PHASE_H
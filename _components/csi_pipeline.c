@@ -0,0 +1,213 @@
+#include "csi_pipeline.h"
+
+static const char *PIPELINE_TAG = "CSI_PIPELINE";
+
+csi_pipeline_t g_csi_pipeline;
+
+bool csi_pipeline_capture(const wifi_csi_info_t *csi_info)
+{
+    if (!g_csi_pipeline.running || !csi_info || !csi_info->buf)
+    {
+        return false;
+    }
+
+    g_pipeline_stats.frames_seen++;
+
+    if (g_csi_pipeline.filter && !g_csi_pipeline.filter(csi_info->mac))
+    {
+        g_pipeline_stats.frames_filtered++;
+        return false;
+    }
+
+    // Numbered before any stage can drop it, so every gap is accounted for
+    uint8_t station_index = station_table_lookup(csi_info->mac);
+    uint32_t sequence = csi_stream_next_sequence(station_index);
+    csi_scheduler_note_arrival(station_index);
+
+    // The burst recorder keeps frames in a buffer of its own
+    csi_capture_hook_t capture_hook = g_csi_pipeline.capture_hook;
+    if (capture_hook && capture_hook(csi_info, station_index, sequence))
+    {
+        return false;
+    }
+
+    // Thin the stream per station while the queue is backed up
+    if (!csi_overload_admit(station_index))
+    {
+        return false;
+    }
+
+    // Copy the frame into a preallocated pool slot
+    uint16_t frame_slot = csi_frame_pool_capture(&g_csi_pipeline.frame_pool, csi_info);
+    if (frame_slot == CSI_FRAME_POOL_INVALID_SLOT)
+    {
+        g_pipeline_stats.allocation_failures++;
+        csi_stream_t *stream = csi_stream(station_index);
+        if (stream)
+        {
+            stream->alloc_drops++;
+        }
+        return false;
+    }
+    csi_frame_slot_t *frame = csi_frame_pool_slot(&g_csi_pipeline.frame_pool, frame_slot);
+    frame->station_index = station_index;
+    frame->sequence = sequence;
+    frame->capture_profile = (uint8_t)csi_capture_profile_current();
+    frame->timestamp_us = 0;
+
+    // Queue the slot index (non-blocking); drops are counted and reported in aggregate
+    return csi_overload_enqueue(frame_slot);
+}
+
+// Encode stage: turns captured frames into wire records for every enabled sink
+static void csi_pipeline_encoder_task(void *parameters)
+{
+    ESP_LOGI(PIPELINE_TAG, "CSI encoder task started on core %d", xPortGetCoreID());
+
+    while (true)
+    {
+        uint16_t frame_slot = csi_scheduler_dequeue();
+        if (frame_slot == CSI_FRAME_POOL_INVALID_SLOT)
+        {
+            // Every station queue is empty; the callback notifies after each frame
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        esp_cpu_cycle_count_t encode_start = esp_cpu_get_cycle_count();
+        pipeline_stats_record_queue_depth(csi_scheduler_depth() + 1);
+
+        csi_frame_slot_t *frame = csi_frame_pool_slot(&g_csi_pipeline.frame_pool, frame_slot);
+        wifi_csi_info_t *csi_data = &frame->info;
+
+        // Wall-clock arrival time from the radio timestamp, not the dequeue time. Frames
+        // from a backlog come with theirs, they would throw the timestamp model off.
+        int64_t frame_time_us = frame->timestamp_us;
+        if (frame_time_us == 0)
+        {
+            frame_time_us = radio_timestamp_to_wall_us(csi_data->rx_ctrl.timestamp);
+        }
+        if (frame_time_us < 0)
+        {
+            frame_time_us = get_timestamp_microseconds();
+        }
+
+        // Encode once per format into each sink's ring; a sink that has fallen behind drops its own copy
+        csi_frame_stage_t frame_stage = g_csi_pipeline.frame_stage;
+        if ((!frame_stage || frame_stage(frame, frame_time_us)) && csi_sink_publish(frame, frame_time_us) > 0)
+        {
+            pipeline_stats_record_encode(encode_start);
+        }
+
+        csi_frame_pool_release(&g_csi_pipeline.frame_pool, frame_slot);
+    }
+}
+
+void csi_pipeline_set_frame_stage(csi_frame_stage_t frame_stage)
+{
+    g_csi_pipeline.frame_stage = frame_stage;
+}
+
+void csi_pipeline_set_capture_hook(csi_capture_hook_t capture_hook)
+{
+    g_csi_pipeline.capture_hook = capture_hook;
+}
+
+bool csi_pipeline_inject(const wifi_csi_info_t *csi_info, uint8_t station_index, uint32_t sequence,
+                         uint8_t capture_profile, int64_t timestamp_us)
+{
+    if (!g_csi_pipeline.running)
+    {
+        return false;
+    }
+
+    uint16_t frame_slot = csi_frame_pool_capture(&g_csi_pipeline.frame_pool, csi_info);
+    if (frame_slot == CSI_FRAME_POOL_INVALID_SLOT)
+    {
+        return false;
+    }
+    csi_frame_slot_t *frame = csi_frame_pool_slot(&g_csi_pipeline.frame_pool, frame_slot);
+    frame->station_index = station_index;
+    frame->sequence = sequence;
+    frame->capture_profile = capture_profile;
+    frame->timestamp_us = timestamp_us;
+
+    csi_scheduler_note_arrival(station_index);
+    if (!csi_scheduler_enqueue(station_index, frame_slot))
+    {
+        csi_frame_pool_release(&g_csi_pipeline.frame_pool, frame_slot);
+        return false;
+    }
+    return true;
+}
+
+esp_err_t csi_pipeline_start(const csi_pipeline_config_t *config)
+{
+    if (g_csi_pipeline.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config || config->queue_depth == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The queue plus the frame the encoder is working on, plus one in flight in the callback
+    esp_err_t result = csi_frame_pool_init(&g_csi_pipeline.frame_pool, config->queue_depth + 2);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(PIPELINE_TAG, "Failed to allocate CSI frame pool");
+        return result;
+    }
+
+    result = csi_scheduler_init(&g_csi_pipeline.frame_pool, config->queue_depth);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(PIPELINE_TAG, "Failed to initialize CSI station queues");
+        return result;
+    }
+
+    result = csi_overload_init(&g_csi_pipeline.frame_pool, config->queue_depth, config->overload_policy);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(PIPELINE_TAG, "Failed to initialize CSI overload handling");
+        return result;
+    }
+
+    if (xTaskCreatePinnedToCore(csi_pipeline_encoder_task, "csi_encoder", config->encoder_stack_size, NULL,
+                                config->encoder_priority, &g_csi_pipeline.encoder_task,
+                                config->encoder_core) != pdPASS)
+    {
+        ESP_LOGE(PIPELINE_TAG, "Failed to create CSI encoder task");
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline_stats_register_task("encoder", g_csi_pipeline.encoder_task);
+    csi_scheduler_set_consumer(g_csi_pipeline.encoder_task);
+
+    g_csi_pipeline.filter = config->filter;
+    g_csi_pipeline.running = true;
+
+    ESP_LOGI(PIPELINE_TAG, "CSI queue depth %u, overload policy %s", config->queue_depth,
+             csi_overload_policy_name(config->overload_policy));
+    return ESP_OK;
+}
+
+// Serial sink: records go to the console UART in their own low-priority task
+static esp_err_t csi_serial_sink_write(csi_sink_t *sink, const uint8_t *record, size_t record_length)
+{
+    return fwrite(record, 1, record_length, stdout) == record_length ? ESP_OK : ESP_FAIL;
+}
+
+static int64_t csi_serial_sink_idle(csi_sink_t *sink)
+{
+    fflush(stdout);
+    return -1;
+}
+
+esp_err_t csi_pipeline_register_serial_sink(csi_wire_format_t format, bool enabled)
+{
+    return csi_sink_register(CSI_SINK_SERIAL, csi_serial_sink_write, csi_serial_sink_idle, NULL,
+                             format, enabled, CONFIG_CSI_ENCODED_RING_SIZE,
+                             CONFIG_CSI_SLOW_SINK_TASK_PRIORITY, CONFIG_CSI_SLOW_SINK_TASK_STACK_SIZE,
+                             CSI_TASK_CORE(CONFIG_CSI_TRANSMIT_TASK_CORE));
+}
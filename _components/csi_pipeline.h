@@ -0,0 +1,145 @@
+#ifndef CSI_PIPELINE_H
+#define CSI_PIPELINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "timestamp_manager.h"
+#include "csi_frame_pool.h"
+#include "csi_capture_profile.h"
+#include "station_table.h"
+#include "csi_scheduler.h"
+#include "csi_overload.h"
+#include "csi_sink.h"
+#include "pipeline_stats.h"
+
+// Deferred CSI capture shared by every firmware built on these components:
+//
+//   WiFi callback -- copy into pool slot --> station queue --> encoder task --> sinks
+//
+// csi_pipeline_capture() is the only thing that runs in the WiFi driver's
+// callback context. It filters, copies the frame into a preallocated slot and
+// queues the slot index on its station's queue without blocking, logging or
+// touching the heap. The encoder takes frames from the station queues in
+// weighted round robin (csi_scheduler.h).
+// Timestamping and encoding happen in the encoder task, output in the sink
+// tasks.
+
+// Defaults for projects whose Kconfig does not define the pipeline options
+#ifndef CONFIG_CSI_DATA_QUEUE_DEPTH
+#define CONFIG_CSI_DATA_QUEUE_DEPTH 64
+#endif
+#ifndef CONFIG_CSI_ENCODER_TASK_PRIORITY
+#define CONFIG_CSI_ENCODER_TASK_PRIORITY 6
+#endif
+#ifndef CONFIG_CSI_ENCODER_TASK_STACK_SIZE
+#define CONFIG_CSI_ENCODER_TASK_STACK_SIZE 8192
+#endif
+#ifndef CONFIG_CSI_ENCODER_TASK_CORE
+#define CONFIG_CSI_ENCODER_TASK_CORE -1
+#endif
+#ifndef CONFIG_CSI_TRANSMIT_TASK_CORE
+#define CONFIG_CSI_TRANSMIT_TASK_CORE -1
+#endif
+#ifndef CONFIG_CSI_SLOW_SINK_TASK_PRIORITY
+#define CONFIG_CSI_SLOW_SINK_TASK_PRIORITY 3
+#endif
+#ifndef CONFIG_CSI_SLOW_SINK_TASK_STACK_SIZE
+#define CONFIG_CSI_SLOW_SINK_TASK_STACK_SIZE 4096
+#endif
+#ifndef CONFIG_CSI_ENCODED_RING_SIZE
+#define CONFIG_CSI_ENCODED_RING_SIZE 16384
+#endif
+
+#if CONFIG_CSI_OVERLOAD_DROP_OLDEST
+#define CSI_OVERLOAD_DEFAULT_POLICY CSI_OVERLOAD_DROP_OLDEST
+#elif CONFIG_CSI_OVERLOAD_DECIMATE
+#define CSI_OVERLOAD_DEFAULT_POLICY CSI_OVERLOAD_DECIMATE
+#else
+#define CSI_OVERLOAD_DEFAULT_POLICY CSI_OVERLOAD_DROP_NEWEST
+#endif
+
+// Pipeline tasks run on the core the WiFi driver task is not pinned to
+#if CONFIG_FREERTOS_UNICORE
+#define CSI_PIPELINE_DEFAULT_CORE 0
+#elif CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define CSI_PIPELINE_DEFAULT_CORE 0
+#else
+#define CSI_PIPELINE_DEFAULT_CORE 1
+#endif
+
+#define CSI_TASK_CORE(configured) ((configured) < 0 ? CSI_PIPELINE_DEFAULT_CORE : (configured))
+
+// Decide in the WiFi callback whether a station's frames are kept
+typedef bool (*csi_frame_filter_t)(const uint8_t mac[6]);
+
+// Runs in the WiFi callback for every kept frame, once it is numbered.
+// Returns true if it took the frame, which then skips the frame pool.
+typedef bool (*csi_capture_hook_t)(const wifi_csi_info_t *csi_info, uint8_t station_index, uint32_t sequence);
+
+// Runs in the encoder task once per frame, before the sinks' encoders.
+// Returns false to consume the frame without publishing a record.
+typedef bool (*csi_frame_stage_t)(const csi_frame_slot_t *frame, int64_t timestamp_us);
+
+typedef struct
+{
+    uint16_t queue_depth;
+    csi_overload_policy_t overload_policy;
+    csi_frame_filter_t filter; // NULL keeps every station
+    UBaseType_t encoder_priority;
+    uint32_t encoder_stack_size;
+    BaseType_t encoder_core;
+} csi_pipeline_config_t;
+
+#define CSI_PIPELINE_DEFAULT_CONFIG()                            \
+    {                                                            \
+        .queue_depth = CONFIG_CSI_DATA_QUEUE_DEPTH,              \
+        .overload_policy = CSI_OVERLOAD_DEFAULT_POLICY,          \
+        .filter = NULL,                                          \
+        .encoder_priority = CONFIG_CSI_ENCODER_TASK_PRIORITY,    \
+        .encoder_stack_size = CONFIG_CSI_ENCODER_TASK_STACK_SIZE, \
+        .encoder_core = CSI_TASK_CORE(CONFIG_CSI_ENCODER_TASK_CORE) \
+    }
+
+typedef struct
+{
+    bool running;
+    csi_frame_filter_t filter;
+    volatile csi_frame_stage_t frame_stage;
+    volatile csi_capture_hook_t capture_hook;
+    csi_frame_pool_t frame_pool;
+    TaskHandle_t encoder_task;
+} csi_pipeline_t;
+
+extern csi_pipeline_t g_csi_pipeline;
+
+// WiFi callback entry point: filter, copy and enqueue. Returns true if the
+// frame was queued for encoding.
+bool csi_pipeline_capture(const wifi_csi_info_t *csi_info);
+
+// Install the per-frame stage, NULL to publish every frame
+void csi_pipeline_set_frame_stage(csi_frame_stage_t frame_stage);
+
+// Install the capture hook, NULL to send every frame through the frame pool
+void csi_pipeline_set_capture_hook(csi_capture_hook_t capture_hook);
+
+// Queue a frame captured earlier, with its wall-clock time, from a task that
+// is the only producer while it runs (the WiFi callback must be hooked). It
+// never drops: false means there is no free slot or no room in the station's
+// queue right now, and the caller tries again later.
+bool csi_pipeline_inject(const wifi_csi_info_t *csi_info, uint8_t station_index, uint32_t sequence,
+                         uint8_t capture_profile, int64_t timestamp_us);
+
+// Allocate the frame pool and queue and start the encoder task. Sinks may be
+// registered before or after.
+esp_err_t csi_pipeline_start(const csi_pipeline_config_t *config);
+
+esp_err_t csi_pipeline_register_serial_sink(csi_wire_format_t format, bool enabled);
+
+#endif // CSI_PIPELINE_H
@@ -0,0 +1,525 @@
+#include "csi_replay.h"
+
+static const char *REPLAY_TAG = "CSI_REPLAY";
+
+static const char *const g_csi_replay_shape_names[CSI_REPLAY_SHAPE_COUNT] = {"LEGACY", "HT20", "HT40", "HT40_STBC"};
+
+csi_replay_t g_csi_replay;
+
+// Small xorshift generator, so generated frames are the same on every run
+static uint32_t csi_replay_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+void csi_replay_synthesize_iq(int8_t *data, uint16_t pairs, int variant, uint32_t *random_state)
+{
+    for (int pair = 0; pair < pairs; pair++)
+    {
+        int noise_i = (int)(csi_replay_random(random_state) % 7) - 3;
+        int noise_q = (int)(csi_replay_random(random_state) % 7) - 3;
+        float angle = 0.09f * pair + 0.02f * variant;
+        data[pair * 2] = (int8_t)(40.0f * cosf(angle) + noise_i);
+        data[pair * 2 + 1] = (int8_t)(40.0f * sinf(angle) + noise_q);
+    }
+}
+
+static esp_err_t csi_replay_allocate()
+{
+    if (!g_csi_replay.templates)
+    {
+        g_csi_replay.templates = calloc(CONFIG_CSI_REPLAY_MAX_FRAMES, sizeof(csi_replay_template_t));
+    }
+    return g_csi_replay.templates ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t csi_replay_generate(csi_replay_shape_t shape, uint16_t frame_count)
+{
+    if (g_csi_replay.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (shape >= CSI_REPLAY_SHAPE_COUNT || frame_count == 0 || frame_count > CONFIG_CSI_REPLAY_MAX_FRAMES)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t result = csi_replay_allocate();
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    uint32_t random_state = 0x2545F491u;
+    for (uint16_t index = 0; index < frame_count; index++)
+    {
+        csi_replay_template_t *frame = &g_csi_replay.templates[index];
+        memset(frame, 0, sizeof(*frame));
+        frame->rx_ctrl.rssi = -48 - index % 4;
+        frame->rx_ctrl.rate = shape == CSI_REPLAY_SHAPE_LEGACY ? 11 : 0;
+        frame->rx_ctrl.sig_mode = shape == CSI_REPLAY_SHAPE_LEGACY ? 0 : 1;
+        frame->rx_ctrl.mcs = shape == CSI_REPLAY_SHAPE_LEGACY ? 0 : 7;
+        frame->rx_ctrl.cwb = shape >= CSI_REPLAY_SHAPE_HT40;
+        frame->rx_ctrl.stbc = shape == CSI_REPLAY_SHAPE_HT40_STBC;
+        frame->rx_ctrl.noise_floor = -92;
+        frame->rx_ctrl.channel = 6;
+        frame->rx_ctrl.secondary_channel = frame->rx_ctrl.cwb ? 1 : 0;
+        frame->rx_ctrl.sig_len = 1024;
+
+        uint16_t expected[CSI_LTF_COUNT];
+        uint16_t pairs = csi_capture_expected_pairs(csi_capture_profile_current(), &frame->rx_ctrl, expected);
+        frame->len = pairs * 2;
+        csi_replay_synthesize_iq(frame->data, pairs, index, &random_state);
+    }
+    g_csi_replay.template_count = frame_count;
+    return ESP_OK;
+}
+
+static void csi_replay_inject()
+{
+    uint8_t station = g_csi_replay.next_station;
+    g_csi_replay.next_station = station + 1 < g_csi_replay.station_count ? station + 1 : 0;
+    uint16_t template_index = g_csi_replay.next_template[station];
+    g_csi_replay.next_template[station] = template_index + 1 < g_csi_replay.template_count ? template_index + 1 : 0;
+
+    const csi_replay_template_t *frame = &g_csi_replay.templates[template_index];
+    wifi_csi_info_t csi_info = {0};
+    csi_info.rx_ctrl = frame->rx_ctrl;
+    csi_info.rx_ctrl.timestamp = (uint32_t)esp_timer_get_time();
+    memcpy(csi_info.mac, g_csi_replay_mac_prefix, sizeof(g_csi_replay_mac_prefix));
+    csi_info.mac[5] = station;
+    csi_info.buf = (int8_t *)frame->data;
+    csi_info.len = frame->len;
+
+    g_csi_replay.callback(NULL, &csi_info);
+    g_csi_replay.injected++;
+    g_csi_replay.window_injected++;
+}
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+
+static void IRAM_ATTR csi_replay_tick(void *argument)
+{
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(g_csi_replay.task, &higher_priority_woken);
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+#else
+
+static void csi_replay_tick(void *argument)
+{
+    xTaskNotifyGive(g_csi_replay.task);
+}
+
+#endif
+
+// Make the replay task the only producer while it runs, and hand the
+// callback back to the driver once it stops
+static void csi_replay_claim_callback(bool claim)
+{
+    if (claim == g_csi_replay.wifi_csi_paused)
+    {
+        return;
+    }
+    esp_err_t result = esp_wifi_set_csi(!claim);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(REPLAY_TAG, "Failed to turn CSI %s in the driver: %s", claim ? "off" : "on", esp_err_to_name(result));
+        if (claim)
+        {
+            g_csi_replay.running = false;
+        }
+        return;
+    }
+    g_csi_replay.wifi_csi_paused = claim;
+}
+
+// Start over after START or STOP: counters, station positions and the timer
+static void csi_replay_plan(int64_t now_us)
+{
+    g_csi_replay.planned_generation = g_csi_replay.generation;
+    csi_replay_claim_callback(g_csi_replay.running);
+    if (g_csi_replay.timer_running)
+    {
+        esp_timer_stop(g_csi_replay.timer);
+        g_csi_replay.timer_running = false;
+    }
+
+    g_csi_replay.total_hz = g_csi_replay.running ? g_csi_replay.rate_hz * g_csi_replay.station_count : 0;
+    g_csi_replay.start_us = now_us;
+    g_csi_replay.scheduled = 0;
+    g_csi_replay.next_station = 0;
+    for (int station = 0; station < CONFIG_CSI_REPLAY_MAX_STATIONS; station++)
+    {
+        g_csi_replay.next_template[station] = g_csi_replay.template_count ? station % g_csi_replay.template_count : 0;
+    }
+    g_pipeline_stats.replay_rate_hz = g_csi_replay.running ? g_csi_replay.rate_hz : 0;
+    g_pipeline_stats.replay_stations = g_csi_replay.running ? g_csi_replay.station_count : 0;
+
+    if (g_csi_replay.total_hz > 0)
+    {
+        int64_t period_us = 1000000 / g_csi_replay.total_hz;
+        if (period_us < CSI_REPLAY_MIN_TICK_US)
+        {
+            period_us = CSI_REPLAY_MIN_TICK_US;
+        }
+        esp_err_t result = esp_timer_start_periodic(g_csi_replay.timer, (uint64_t)period_us);
+        g_csi_replay.timer_running = result == ESP_OK;
+        if (result != ESP_OK)
+        {
+            ESP_LOGE(REPLAY_TAG, "Failed to start the replay timer: %s", esp_err_to_name(result));
+        }
+    }
+}
+
+// Paced replay: every frame whose time has come, skipping those too far behind
+static void csi_replay_run_due(int64_t now_us)
+{
+    uint64_t due = (uint64_t)(now_us - g_csi_replay.start_us) * g_csi_replay.total_hz / 1000000;
+    uint64_t max_lag = (uint64_t)g_csi_replay.total_hz * CSI_REPLAY_MAX_LAG_MS / 1000 + 1;
+    if (due > g_csi_replay.scheduled + max_lag)
+    {
+        g_csi_replay.skipped += (uint32_t)(due - max_lag - g_csi_replay.scheduled);
+        g_csi_replay.scheduled = due - max_lag;
+    }
+    for (; g_csi_replay.scheduled < due; g_csi_replay.scheduled++)
+    {
+        csi_replay_inject();
+    }
+}
+
+// As fast as possible, for CSI_REPLAY_MAX_BUSY_MS or until the replay changes
+static void csi_replay_run_flat_out(int64_t now_us)
+{
+    int64_t busy_until_us = now_us + CSI_REPLAY_MAX_BUSY_MS * 1000LL;
+    do
+    {
+        for (int frame = 0; frame < 16; frame++)
+        {
+            csi_replay_inject();
+        }
+    } while (g_csi_replay.generation == g_csi_replay.planned_generation && esp_timer_get_time() < busy_until_us);
+    vTaskDelay(1);
+}
+
+static void csi_replay_finish_window(int64_t now_us)
+{
+    int64_t elapsed_us = now_us - g_csi_replay.window_start_us;
+    g_pipeline_stats.replay_sent_hz = (uint32_t)(g_csi_replay.window_injected * 1000000ULL / elapsed_us);
+    g_pipeline_stats.replay_skipped = g_csi_replay.skipped;
+    g_csi_replay.window_injected = 0;
+    g_csi_replay.window_start_us = now_us;
+}
+
+static void csi_replay_task(void *parameters)
+{
+    g_csi_replay.window_start_us = esp_timer_get_time();
+
+    for (;;)
+    {
+        bool flat_out = g_csi_replay.running && g_csi_replay.planned_generation == g_csi_replay.generation &&
+                        g_csi_replay.rate_hz == 0;
+        int64_t now_us = esp_timer_get_time();
+        if (flat_out)
+        {
+            csi_replay_run_flat_out(now_us);
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CSI_REPLAY_WINDOW_MS));
+        }
+
+        now_us = esp_timer_get_time();
+        if (g_csi_replay.running && g_csi_replay.stop_us && now_us >= g_csi_replay.stop_us)
+        {
+            g_csi_replay.running = false;
+            g_csi_replay.generation++;
+        }
+        if (g_csi_replay.planned_generation != g_csi_replay.generation)
+        {
+            csi_replay_plan(now_us);
+        }
+        else if (g_csi_replay.running && g_csi_replay.total_hz > 0)
+        {
+            csi_replay_run_due(now_us);
+        }
+
+        if (now_us - g_csi_replay.window_start_us >= CSI_REPLAY_WINDOW_MS * 1000LL)
+        {
+            csi_replay_finish_window(now_us);
+        }
+    }
+}
+
+esp_err_t csi_replay_init(wifi_csi_cb_t callback, UBaseType_t priority, uint32_t stack_size, BaseType_t core)
+{
+    if (!callback)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_csi_replay.callback = callback;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = csi_replay_tick,
+        .dispatch_method = CSI_REPLAY_TIMER_DISPATCH,
+        .name = "csi_replay",
+        .skip_unhandled_events = true};
+    esp_err_t result = esp_timer_create(&timer_args, &g_csi_replay.timer);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    if (xTaskCreatePinnedToCore(csi_replay_task, "csi_replay", stack_size, NULL, priority, &g_csi_replay.task,
+                                core) != pdPASS)
+    {
+        ESP_LOGE(REPLAY_TAG, "Failed to create replay task");
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline_stats_register_task("replay", g_csi_replay.task);
+    return ESP_OK;
+}
+
+esp_err_t csi_replay_start(uint32_t rate_hz, uint8_t station_count, uint32_t duration_s)
+{
+    if (!g_csi_replay.task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (rate_hz > CSI_REPLAY_MAX_RATE_HZ || station_count == 0 || station_count > CONFIG_CSI_REPLAY_MAX_STATIONS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_csi_replay.template_count == 0)
+    {
+        esp_err_t result = csi_replay_generate(CSI_REPLAY_SHAPE_HT20, CONFIG_CSI_REPLAY_MAX_FRAMES);
+        if (result != ESP_OK)
+        {
+            return result;
+        }
+    }
+
+    g_csi_replay.running = false;
+    g_csi_replay.rate_hz = rate_hz;
+    g_csi_replay.station_count = station_count;
+    g_csi_replay.stop_us = duration_s ? esp_timer_get_time() + duration_s * 1000000LL : 0;
+    g_csi_replay.running = true;
+    g_csi_replay.generation++;
+    xTaskNotifyGive(g_csi_replay.task);
+    return ESP_OK;
+}
+
+void csi_replay_stop()
+{
+    if (g_csi_replay.running)
+    {
+        g_csi_replay.running = false;
+        g_csi_replay.generation++;
+        xTaskNotifyGive(g_csi_replay.task);
+    }
+}
+
+void csi_replay_print()
+{
+    printf("Replay: %u frames loaded (max %d), ", g_csi_replay.template_count, CONFIG_CSI_REPLAY_MAX_FRAMES);
+    if (!g_csi_replay.running)
+    {
+        printf("stopped\n");
+    }
+    else if (g_csi_replay.rate_hz == 0)
+    {
+        printf("as fast as possible to %u stations\n", g_csi_replay.station_count);
+    }
+    else
+    {
+        printf("%lu Hz to each of %u stations\n", (unsigned long)g_csi_replay.rate_hz, g_csi_replay.station_count);
+    }
+    printf("  %llu frames injected, %lu skipped, %lu Hz over the last second\n",
+           (unsigned long long)g_csi_replay.injected, (unsigned long)g_csi_replay.skipped,
+           (unsigned long)g_pipeline_stats.replay_sent_hz);
+}
+
+static int csi_replay_hex_digit(char digit)
+{
+    if (digit >= '0' && digit <= '9')
+    {
+        return digit - '0';
+    }
+    if (digit >= 'a' && digit <= 'f')
+    {
+        return digit - 'a' + 10;
+    }
+    if (digit >= 'A' && digit <= 'F')
+    {
+        return digit - 'A' + 10;
+    }
+    return -1;
+}
+
+// CSI_REPLAY FRAME <index> <rssi> <rate> <sig_mode> <mcs> <cwb> <stbc> <noise_floor> <channel>
+//                  <secondary_channel> <sig_len> <len>
+static bool csi_replay_frame_command(const char *arguments)
+{
+    int index, rssi, rate, sig_mode, mcs, cwb, stbc, noise_floor, channel, secondary_channel, sig_len, length;
+    if (sscanf(arguments, "%d %d %d %d %d %d %d %d %d %d %d %d", &index, &rssi, &rate, &sig_mode, &mcs, &cwb, &stbc,
+               &noise_floor, &channel, &secondary_channel, &sig_len, &length) != 12 ||
+        index < 0 || index > g_csi_replay.template_count || index >= CONFIG_CSI_REPLAY_MAX_FRAMES || length <= 0 ||
+        length > CSI_FRAME_MAX_LENGTH || length % 2 != 0)
+    {
+        printf("Usage: CSI_REPLAY FRAME <0-%d> <rssi> <rate> <sig_mode> <mcs> <cwb> <stbc> <noise_floor> <channel> "
+               "<secondary_channel> <sig_len> <2-%d bytes>, in order\n",
+               CONFIG_CSI_REPLAY_MAX_FRAMES - 1, CSI_FRAME_MAX_LENGTH);
+        return false;
+    }
+    if (csi_replay_allocate() != ESP_OK)
+    {
+        printf("Out of memory for the replay frames\n");
+        return false;
+    }
+
+    csi_replay_template_t *frame = &g_csi_replay.templates[index];
+    memset(frame, 0, sizeof(*frame));
+    frame->rx_ctrl.rssi = rssi;
+    frame->rx_ctrl.rate = rate;
+    frame->rx_ctrl.sig_mode = sig_mode;
+    frame->rx_ctrl.mcs = mcs;
+    frame->rx_ctrl.cwb = cwb;
+    frame->rx_ctrl.stbc = stbc;
+    frame->rx_ctrl.noise_floor = noise_floor;
+    frame->rx_ctrl.channel = channel;
+    frame->rx_ctrl.secondary_channel = secondary_channel;
+    frame->rx_ctrl.sig_len = sig_len;
+    frame->len = (uint16_t)length;
+    if (index == g_csi_replay.template_count)
+    {
+        g_csi_replay.template_count++;
+    }
+    printf("Replay frame %d: %d bytes\n", index, length);
+    return true;
+}
+
+// CSI_REPLAY DATA <index> <offset> <hex bytes>
+static bool csi_replay_data_command(const char *arguments)
+{
+    int index, offset, consumed = 0;
+    if (sscanf(arguments, "%d %d %n", &index, &offset, &consumed) != 2 || index < 0 ||
+        index >= g_csi_replay.template_count || offset < 0)
+    {
+        printf("Usage: CSI_REPLAY DATA <frame> <offset> <hex, up to %d bytes>\n", CSI_REPLAY_MAX_DATA_BYTES);
+        return false;
+    }
+
+    csi_replay_template_t *frame = &g_csi_replay.templates[index];
+    const char *hex = arguments + consumed;
+    int written = 0;
+    while (hex[0] && hex[0] != ' ' && hex[0] != '\r' && hex[0] != '\n')
+    {
+        int high = csi_replay_hex_digit(hex[0]);
+        int low = hex[1] ? csi_replay_hex_digit(hex[1]) : -1;
+        if (high < 0 || low < 0 || offset + written >= frame->len)
+        {
+            printf("Bad or too much data for frame %d (%u bytes)\n", index, frame->len);
+            return false;
+        }
+        frame->data[offset + written++] = (int8_t)(uint8_t)(high << 4 | low);
+        hex += 2;
+    }
+    return true;
+}
+
+bool csi_replay_command(const char *arguments)
+{
+    char action[12] = {0};
+    int consumed = 0;
+    sscanf(arguments, "%11s %n", action, &consumed);
+    const char *rest = arguments + consumed;
+
+    if (action[0] == '\0')
+    {
+        csi_replay_print();
+        return true;
+    }
+    if (strcasecmp(action, "STOP") == 0)
+    {
+        csi_replay_stop();
+        printf("Replay stopped after %llu frames\n", (unsigned long long)g_csi_replay.injected);
+        return true;
+    }
+    if (strcasecmp(action, "START") == 0)
+    {
+        char rate_text[8] = {0};
+        int stations = 1, seconds = 0;
+        int parsed = sscanf(rest, "%7s %d %d", rate_text, &stations, &seconds);
+        char *end = NULL;
+        long rate_hz = strcasecmp(rate_text, "MAX") == 0 ? 0 : strtol(rate_text, &end, 10);
+        if (parsed < 1 || (end && (*end != '\0' || rate_hz <= 0 || rate_hz > CSI_REPLAY_MAX_RATE_HZ)) ||
+            stations < 1 || stations > CONFIG_CSI_REPLAY_MAX_STATIONS || seconds < 0)
+        {
+            printf("Usage: CSI_REPLAY START <1-%d Hz|MAX> [1-%d stations] [seconds]\n", CSI_REPLAY_MAX_RATE_HZ,
+                   CONFIG_CSI_REPLAY_MAX_STATIONS);
+            return false;
+        }
+        esp_err_t result = csi_replay_start((uint32_t)rate_hz, (uint8_t)stations, (uint32_t)seconds);
+        if (result != ESP_OK)
+        {
+            printf("Replay not started: %s\n", esp_err_to_name(result));
+            return false;
+        }
+        csi_replay_print();
+        return true;
+    }
+
+    if (g_csi_replay.running)
+    {
+        printf("Stop the replay first (CSI_REPLAY STOP)\n");
+        return false;
+    }
+    if (strcasecmp(action, "GENERATE") == 0)
+    {
+        char shape_text[12] = {0};
+        int frames = CONFIG_CSI_REPLAY_MAX_FRAMES;
+        sscanf(rest, "%11s %d", shape_text, &frames);
+        int shape = 0;
+        while (shape < CSI_REPLAY_SHAPE_COUNT && strcasecmp(shape_text, g_csi_replay_shape_names[shape]) != 0)
+        {
+            shape++;
+        }
+        if (shape == CSI_REPLAY_SHAPE_COUNT || frames < 1 || frames > CONFIG_CSI_REPLAY_MAX_FRAMES)
+        {
+            printf("Usage: CSI_REPLAY GENERATE <LEGACY|HT20|HT40|HT40_STBC> [1-%d frames]\n",
+                   CONFIG_CSI_REPLAY_MAX_FRAMES);
+            return false;
+        }
+        esp_err_t result = csi_replay_generate((csi_replay_shape_t)shape, (uint16_t)frames);
+        if (result != ESP_OK)
+        {
+            printf("Generating frames failed: %s\n", esp_err_to_name(result));
+            return false;
+        }
+        printf("Replay: %d generated %s frames of %u bytes (%s capture)\n", frames, g_csi_replay_shape_names[shape],
+               g_csi_replay.templates[0].len, csi_capture_profile_name(csi_capture_profile_current()));
+        return true;
+    }
+    if (strcasecmp(action, "CLEAR") == 0)
+    {
+        free(g_csi_replay.templates);
+        g_csi_replay.templates = NULL;
+        g_csi_replay.template_count = 0;
+        printf("Replay frames cleared\n");
+        return true;
+    }
+    if (strcasecmp(action, "FRAME") == 0)
+    {
+        return csi_replay_frame_command(rest);
+    }
+    if (strcasecmp(action, "DATA") == 0)
+    {
+        return csi_replay_data_command(rest);
+    }
+
+    printf("Usage: CSI_REPLAY [START <rate_hz|MAX> [stations] [seconds] | STOP | GENERATE <shape> [frames] | CLEAR]\n");
+    return false;
+}
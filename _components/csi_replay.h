@@ -0,0 +1,162 @@
+#ifndef CSI_REPLAY_H
+#define CSI_REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "sdkconfig.h"
+#include "csi_frame_pool.h"
+#include "csi_capture_profile.h"
+#include "csi_pipeline.h"
+#include "pipeline_stats.h"
+
+// Synthetic CSI source for load tests. The replay task calls the same
+// callback the WiFi driver does, so replayed frames go through the filter,
+// frame pool, station queues, encoders and sinks like real ones, and the
+// CSI_STATS counters show which stage drops them.
+//
+// Frames come from a table of templates, either generated (CSI_REPLAY
+// GENERATE) or taken from a recorded CSV and uploaded over the control port
+// (csi_data_collector.py --replay). Replay station n has the MAC
+// 02:52:50:00:00:<n> and steps through the templates on its own, starting
+// at template n. The radio timestamp is the time of injection.
+//
+// CSI_REPLAY START <rate_hz> spreads rate x stations frames per second
+// evenly over the stations. As with the traffic generator, an esp_timer
+// wakes the task, at most every CSI_REPLAY_MIN_TICK_US, and the task injects
+// the frames that are due by the clock. Frames more than CSI_REPLAY_MAX_LAG_MS
+// overdue are skipped and counted, not sent in a burst. START MAX injects
+// back to back, pausing for a tick every CSI_REPLAY_MAX_BUSY_MS so the
+// lower priority tasks on the core still run.
+//
+// The capture path has a single producer (station table, station queues,
+// burst ring), and the WiFi task would preempt the replay task in the middle
+// of a capture. While a replay runs the task therefore turns CSI off in the
+// driver with esp_wifi_set_csi(false) and is the only caller of the
+// callback; it turns CSI back on when the replay stops.
+
+#ifndef CONFIG_CSI_REPLAY_MAX_FRAMES
+#define CONFIG_CSI_REPLAY_MAX_FRAMES 32
+#endif
+#ifndef CONFIG_CSI_REPLAY_MAX_STATIONS
+#define CONFIG_CSI_REPLAY_MAX_STATIONS 8
+#endif
+#ifndef CONFIG_CSI_REPLAY_TASK_PRIORITY
+#define CONFIG_CSI_REPLAY_TASK_PRIORITY 5
+#endif
+
+// Replay stands in for the WiFi driver, so it runs on the core the driver's callback would
+#if CONFIG_FREERTOS_UNICORE
+#define CSI_REPLAY_DEFAULT_CORE 0
+#else
+#define CSI_REPLAY_DEFAULT_CORE (1 - CSI_PIPELINE_DEFAULT_CORE)
+#endif
+
+#define CSI_REPLAY_MAX_RATE_HZ 10000 // Per station
+#define CSI_REPLAY_MIN_TICK_US 1000
+#define CSI_REPLAY_MAX_LAG_MS 10
+#define CSI_REPLAY_MAX_BUSY_MS 50
+#define CSI_REPLAY_WINDOW_MS 1000      // Achieved rate is measured over this long
+#define CSI_REPLAY_MAX_DATA_BYTES 200 // Per CSI_REPLAY DATA command, within MAX_COMMAND_LENGTH
+
+_Static_assert(CONFIG_CSI_REPLAY_MAX_STATIONS <= STATION_TABLE_MAX_STATIONS, "replay stations beyond the station table");
+
+static const uint8_t g_csi_replay_mac_prefix[5] = {0x02, 0x52, 0x50, 0x00, 0x00};
+
+typedef struct
+{
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint16_t len;
+    int8_t data[CSI_FRAME_MAX_LENGTH];
+} csi_replay_template_t;
+
+typedef enum
+{
+    CSI_REPLAY_SHAPE_LEGACY = 0, // Non-HT 20 MHz
+    CSI_REPLAY_SHAPE_HT20 = 1,
+    CSI_REPLAY_SHAPE_HT40 = 2,
+    CSI_REPLAY_SHAPE_HT40_STBC = 3,
+    CSI_REPLAY_SHAPE_COUNT
+} csi_replay_shape_t;
+
+typedef struct
+{
+    wifi_csi_cb_t callback;
+    csi_replay_template_t *templates; // CONFIG_CSI_REPLAY_MAX_FRAMES, allocated on first use
+    uint16_t template_count;
+
+    // Set by the commands, picked up by the task when generation changes
+    volatile bool running;
+    volatile uint32_t rate_hz; // Per station, 0 = as fast as possible
+    volatile uint8_t station_count;
+    volatile int64_t stop_us; // 0 = until CSI_REPLAY STOP
+    volatile uint32_t generation;
+
+    // Replay task
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    uint32_t planned_generation;
+    bool timer_running;
+    bool wifi_csi_paused; // CSI turned off in the driver for this replay
+    uint32_t total_hz;
+    int64_t start_us;
+    uint64_t scheduled; // Frames due since start_us, injected or skipped
+    uint8_t next_station;
+    uint16_t next_template[CONFIG_CSI_REPLAY_MAX_STATIONS];
+    uint64_t injected;
+    uint32_t skipped;
+    int64_t window_start_us;
+    uint32_t window_injected;
+} csi_replay_t;
+
+extern csi_replay_t g_csi_replay;
+
+// Whether a MAC is one of the replay stations; the pipeline filter lets them through
+static inline bool csi_replay_station(const uint8_t mac[6])
+{
+    return mac[5] < g_csi_replay.station_count &&
+           memcmp(mac, g_csi_replay_mac_prefix, sizeof(g_csi_replay_mac_prefix)) == 0;
+}
+
+// A smooth channel response with a little noise that changes with variant
+void csi_replay_synthesize_iq(int8_t *data, uint16_t pairs, int variant, uint32_t *random_state);
+
+// Replace the templates with frame_count generated frames of one kind, as
+// long as the current capture profile makes them
+esp_err_t csi_replay_generate(csi_replay_shape_t shape, uint16_t frame_count);
+
+// Timer dispatch: wake the task, which works out from the clock what is due
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define CSI_REPLAY_TIMER_DISPATCH ESP_TIMER_ISR
+#else
+#define CSI_REPLAY_TIMER_DISPATCH ESP_TIMER_TASK
+#endif
+
+// Frames are handed to callback, which should be the one given to the WiFi driver
+esp_err_t csi_replay_init(wifi_csi_cb_t callback, UBaseType_t priority, uint32_t stack_size, BaseType_t core);
+
+// rate_hz frames per second to each of station_count stations, 0 for as fast
+// as possible; runs for duration_s seconds, 0 until csi_replay_stop()
+esp_err_t csi_replay_start(uint32_t rate_hz, uint8_t station_count, uint32_t duration_s);
+
+void csi_replay_stop();
+
+// Snapshot from another task; counters may be slightly stale
+void csi_replay_print();
+
+// CSI_REPLAY [START <rate_hz|MAX> [stations] [seconds] | STOP | GENERATE <shape> [frames] | CLEAR
+//            | FRAME ... | DATA ...]
+bool csi_replay_command(const char *arguments);
+
+#endif // CSI_REPLAY_H
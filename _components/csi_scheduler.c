@@ -0,0 +1,336 @@
+#include "csi_scheduler.h"
+
+csi_scheduler_t g_csi_scheduler = {.weight_generation = 1, .weight_lock = portMUX_INITIALIZER_UNLOCKED};
+
+esp_err_t csi_scheduler_init(csi_frame_pool_t *pool, uint32_t budget)
+{
+    if (!pool || budget == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_csi_scheduler.pool = pool;
+    g_csi_scheduler.budget = budget;
+    return ESP_OK;
+}
+
+void csi_scheduler_set_consumer(TaskHandle_t consumer)
+{
+    g_csi_scheduler.consumer = consumer;
+}
+
+// Frames a station may have waiting: its weighted part of the budget
+static uint32_t csi_scheduler_share(const csi_station_queue_t *queue, bool empty)
+{
+    uint32_t weight = csi_scheduler_queue_weight(queue);
+    uint32_t total_weight = g_csi_scheduler.active_weight + (empty ? weight : 0);
+    uint32_t share = total_weight > weight ? g_csi_scheduler.budget * weight / total_weight : g_csi_scheduler.budget;
+
+    if (share < CSI_SCHEDULER_MIN_SHARE)
+    {
+        share = CSI_SCHEDULER_MIN_SHARE;
+    }
+    return share < CONFIG_CSI_STATION_QUEUE_DEPTH ? share : CONFIG_CSI_STATION_QUEUE_DEPTH;
+}
+
+bool csi_scheduler_enqueue(uint8_t station_index, uint16_t frame_slot)
+{
+    csi_station_queue_t *queue = csi_scheduler_queue(station_index);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    uint32_t waiting = head - tail;
+
+    if (waiting >= csi_scheduler_share(queue, waiting == 0))
+    {
+        return false;
+    }
+
+    queue->slots[head & (CONFIG_CSI_STATION_QUEUE_DEPTH - 1)] = frame_slot;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    atomic_fetch_add_explicit(&g_csi_scheduler.depth, 1, memory_order_relaxed);
+
+    if (g_csi_scheduler.consumer)
+    {
+        xTaskNotifyGive(g_csi_scheduler.consumer);
+    }
+    return true;
+}
+
+// Claim the oldest slot of a queue, CSI_FRAME_POOL_INVALID_SLOT if it is empty
+static uint16_t csi_scheduler_take(csi_station_queue_t *queue)
+{
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    while (tail != atomic_load_explicit(&queue->head, memory_order_acquire))
+    {
+        uint16_t frame_slot = queue->slots[tail & (CONFIG_CSI_STATION_QUEUE_DEPTH - 1)];
+        if (atomic_compare_exchange_weak_explicit(&queue->tail, &tail, tail + 1, memory_order_acq_rel,
+                                                  memory_order_acquire))
+        {
+            atomic_fetch_sub_explicit(&g_csi_scheduler.depth, 1, memory_order_relaxed);
+            return frame_slot;
+        }
+    }
+    return CSI_FRAME_POOL_INVALID_SLOT;
+}
+
+uint16_t csi_scheduler_evict_oldest(uint8_t station_index)
+{
+    return csi_scheduler_take(csi_scheduler_queue(station_index));
+}
+
+// Look a station's weight up again after CSI_WEIGHT changed the table
+static uint32_t csi_scheduler_resolve_weight(uint16_t queue_index)
+{
+    csi_station_queue_t *queue = &g_csi_scheduler.queues[queue_index];
+    unsigned int generation = atomic_load_explicit(&g_csi_scheduler.weight_generation, memory_order_acquire);
+    if (queue->weight_generation == generation)
+    {
+        return csi_scheduler_queue_weight(queue);
+    }
+
+    uint8_t weight = CSI_SCHEDULER_DEFAULT_WEIGHT;
+    if (queue_index < STATION_TABLE_MAX_STATIONS)
+    {
+        const uint8_t *mac = station_table_mac((uint8_t)queue_index);
+        portENTER_CRITICAL(&g_csi_scheduler.weight_lock);
+        for (uint8_t entry = 0; entry < g_csi_scheduler.weight_count; entry++)
+        {
+            if (memcmp(g_csi_scheduler.weights[entry].mac, mac, 6) == 0)
+            {
+                weight = g_csi_scheduler.weights[entry].weight;
+            }
+        }
+        portEXIT_CRITICAL(&g_csi_scheduler.weight_lock);
+    }
+
+    queue->weight = weight;
+    queue->weight_generation = generation;
+    return weight;
+}
+
+// Encoder task, once per round: sum the weights of the active stations
+static void csi_scheduler_refresh_active(unsigned int station_count)
+{
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t active_weight = 0;
+
+    for (unsigned int position = 0; position <= station_count; position++)
+    {
+        uint16_t queue_index = position < station_count ? position : CSI_SCHEDULER_UNKNOWN_QUEUE;
+        csi_station_queue_t *queue = &g_csi_scheduler.queues[queue_index];
+        uint32_t last_arrival_ms = queue->last_arrival_ms;
+        bool waiting = atomic_load_explicit(&queue->head, memory_order_relaxed) !=
+                       atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+        if (waiting || (last_arrival_ms && (int32_t)(now_ms - last_arrival_ms) <= CSI_SCHEDULER_ACTIVE_MS))
+        {
+            active_weight += csi_scheduler_resolve_weight(queue_index);
+        }
+    }
+    g_csi_scheduler.active_weight = active_weight;
+}
+
+uint16_t csi_scheduler_dequeue()
+{
+    unsigned int station_count = station_table_count();
+    unsigned int positions = station_count + 1;
+
+    for (unsigned int empty_run = 0; empty_run < positions;)
+    {
+        if (g_csi_scheduler.position >= positions)
+        {
+            g_csi_scheduler.position = 0;
+            csi_scheduler_refresh_active(station_count);
+        }
+
+        uint16_t queue_index = g_csi_scheduler.position < station_count ? g_csi_scheduler.position
+                                                                        : CSI_SCHEDULER_UNKNOWN_QUEUE;
+        csi_station_queue_t *queue = &g_csi_scheduler.queues[queue_index];
+        uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+        if (tail == atomic_load_explicit(&queue->head, memory_order_acquire))
+        {
+            queue->deficit = 0;
+            g_csi_scheduler.granted = false;
+            g_csi_scheduler.position++;
+            empty_run++;
+            continue;
+        }
+        empty_run = 0;
+
+        if (!g_csi_scheduler.granted)
+        {
+            queue->deficit += (int32_t)(csi_scheduler_resolve_weight(queue_index) * CONFIG_CSI_SCHEDULER_QUANTUM_BYTES);
+            g_csi_scheduler.granted = true;
+        }
+
+        uint16_t frame_slot = queue->slots[tail & (CONFIG_CSI_STATION_QUEUE_DEPTH - 1)];
+        int32_t cost = csi_frame_pool_slot(g_csi_scheduler.pool, frame_slot)->info.len;
+        if (queue->deficit < cost)
+        {
+            g_csi_scheduler.granted = false;
+            g_csi_scheduler.position++;
+            continue;
+        }
+
+        // Fails only if the callback evicted this frame meanwhile; look at the station again
+        if (!atomic_compare_exchange_strong_explicit(&queue->tail, &tail, tail + 1, memory_order_acq_rel,
+                                                     memory_order_acquire))
+        {
+            continue;
+        }
+        atomic_fetch_sub_explicit(&g_csi_scheduler.depth, 1, memory_order_relaxed);
+        queue->deficit -= cost;
+        queue->served++;
+        return frame_slot;
+    }
+    return CSI_FRAME_POOL_INVALID_SLOT;
+}
+
+esp_err_t csi_scheduler_save_weights()
+{
+    uint8_t packed[1 + CSI_SCHEDULER_MAX_WEIGHTS * 7];
+    packed[0] = g_csi_scheduler.weight_count;
+    for (uint8_t entry = 0; entry < g_csi_scheduler.weight_count; entry++)
+    {
+        memcpy(&packed[1 + entry * 7], g_csi_scheduler.weights[entry].mac, 6);
+        packed[1 + entry * 7 + 6] = g_csi_scheduler.weights[entry].weight;
+    }
+    return storage_save_blob(CSI_SCHEDULER_NVS_NAMESPACE, CSI_SCHEDULER_NVS_KEY, packed,
+                             1 + g_csi_scheduler.weight_count * 7);
+}
+
+esp_err_t csi_scheduler_load_weights()
+{
+    uint8_t packed[1 + CSI_SCHEDULER_MAX_WEIGHTS * 7];
+    size_t packed_length = sizeof(packed);
+
+    esp_err_t result = storage_load_blob(CSI_SCHEDULER_NVS_NAMESPACE, CSI_SCHEDULER_NVS_KEY, packed, &packed_length);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    uint8_t entry_count = packed_length > 0 ? packed[0] : 0;
+    if (packed_length < 1 || entry_count > CSI_SCHEDULER_MAX_WEIGHTS || packed_length != 1 + entry_count * 7u)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    portENTER_CRITICAL(&g_csi_scheduler.weight_lock);
+    for (uint8_t entry = 0; entry < entry_count; entry++)
+    {
+        memcpy(g_csi_scheduler.weights[entry].mac, &packed[1 + entry * 7], 6);
+        g_csi_scheduler.weights[entry].weight = packed[1 + entry * 7 + 6];
+    }
+    g_csi_scheduler.weight_count = entry_count;
+    portEXIT_CRITICAL(&g_csi_scheduler.weight_lock);
+    atomic_fetch_add_explicit(&g_csi_scheduler.weight_generation, 1, memory_order_release);
+    return ESP_OK;
+}
+
+esp_err_t csi_scheduler_set_weight(const uint8_t mac[6], uint8_t weight)
+{
+    if (weight < 1 || weight > CSI_SCHEDULER_MAX_WEIGHT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t result = ESP_OK;
+    portENTER_CRITICAL(&g_csi_scheduler.weight_lock);
+    uint8_t entry = 0;
+    while (entry < g_csi_scheduler.weight_count && memcmp(g_csi_scheduler.weights[entry].mac, mac, 6) != 0)
+    {
+        entry++;
+    }
+
+    if (weight == CSI_SCHEDULER_DEFAULT_WEIGHT)
+    {
+        if (entry < g_csi_scheduler.weight_count)
+        {
+            g_csi_scheduler.weights[entry] = g_csi_scheduler.weights[--g_csi_scheduler.weight_count];
+        }
+    }
+    else if (entry < g_csi_scheduler.weight_count)
+    {
+        g_csi_scheduler.weights[entry].weight = weight;
+    }
+    else if (g_csi_scheduler.weight_count < CSI_SCHEDULER_MAX_WEIGHTS)
+    {
+        memcpy(g_csi_scheduler.weights[entry].mac, mac, 6);
+        g_csi_scheduler.weights[entry].weight = weight;
+        g_csi_scheduler.weight_count++;
+    }
+    else
+    {
+        result = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&g_csi_scheduler.weight_lock);
+
+    atomic_fetch_add_explicit(&g_csi_scheduler.weight_generation, 1, memory_order_release);
+    return result;
+}
+
+void csi_scheduler_print()
+{
+    unsigned int station_count = station_table_count();
+    printf("Scheduler: %lu of %lu frames queued, quantum %d bytes, %u stations\n",
+           (unsigned long)csi_scheduler_depth(), (unsigned long)g_csi_scheduler.budget,
+           CONFIG_CSI_SCHEDULER_QUANTUM_BYTES, station_count);
+    for (unsigned int station = 0; station <= station_count; station++)
+    {
+        uint16_t queue_index = station < station_count ? station : CSI_SCHEDULER_UNKNOWN_QUEUE;
+        const csi_station_queue_t *queue = &g_csi_scheduler.queues[queue_index];
+        if (queue_index == CSI_SCHEDULER_UNKNOWN_QUEUE && queue->served == 0)
+        {
+            continue;
+        }
+
+        uint32_t waiting = (uint32_t)(atomic_load(&queue->head) - atomic_load(&queue->tail));
+        if (queue_index == CSI_SCHEDULER_UNKNOWN_QUEUE)
+        {
+            printf("  (untracked)      ");
+        }
+        else
+        {
+            const uint8_t *mac = station_table_mac((uint8_t)station);
+            printf("  %02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        }
+        printf(" weight %lu, %lu waiting (share %lu), %lu served\n", (unsigned long)csi_scheduler_queue_weight(queue),
+               (unsigned long)waiting, (unsigned long)csi_scheduler_share(queue, waiting == 0),
+               (unsigned long)queue->served);
+    }
+}
+
+bool csi_scheduler_command(const char *arguments)
+{
+    char mac_text[20] = {0};
+    char weight_text[8] = {0};
+    int parsed = sscanf(arguments, "%19s %7s", mac_text, weight_text);
+
+    if (parsed < 1)
+    {
+        csi_scheduler_print();
+        return true;
+    }
+
+    uint8_t mac[6];
+    int weight = strcasecmp(weight_text, "DEFAULT") == 0 ? CSI_SCHEDULER_DEFAULT_WEIGHT : atoi(weight_text);
+    if (parsed != 2 || !parse_mac_address(mac_text, mac) || weight < 1 || weight > CSI_SCHEDULER_MAX_WEIGHT)
+    {
+        printf("Usage: CSI_WEIGHT <aa:bb:cc:dd:ee:ff> <1-%d|DEFAULT>\n", CSI_SCHEDULER_MAX_WEIGHT);
+        return false;
+    }
+
+    esp_err_t result = csi_scheduler_set_weight(mac, (uint8_t)weight);
+    if (result != ESP_OK)
+    {
+        printf("Weight update failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    result = csi_scheduler_save_weights();
+    printf("Weight %d for %s%s\n", weight, mac_text, result == ESP_OK ? "" : ", but saving to NVS failed");
+    return true;
+}
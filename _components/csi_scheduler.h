@@ -0,0 +1,164 @@
+#ifndef CSI_SCHEDULER_H
+#define CSI_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "storage_manager.h"
+#include "csi_frame_pool.h"
+#include "station_table.h"
+#include "mac_allowlist.h"
+
+// Per-station queues between the WiFi callback and the encoder task. Every
+// station has its own ring of frame slot indices, so one chatty station can
+// only ever fill its own ring, and the encoder drains the rings by deficit
+// round robin (DRR):
+//
+//   each time the round reaches a station with frames waiting, its deficit
+//   grows by weight x CONFIG_CSI_SCHEDULER_QUANTUM_BYTES; it is served while
+//   the deficit covers the CSI length of its oldest frame, then the round
+//   moves on. A station whose ring runs empty loses its deficit.
+//
+// Frames cost their CSI length, so a station sending HT40 or full captures
+// does not get more encoder time than one sending LLTF only. The weight of a
+// station (1 by default) is set per MAC with CSI_WEIGHT and saved in NVS.
+//
+// Admission is fair as well: a station may have at most its weighted share
+// of the queue budget (the configured CSI queue depth) waiting, counted over
+// the active stations, but always CSI_SCHEDULER_MIN_SHARE. A station is
+// active while it has frames queued and for CSI_SCHEDULER_ACTIVE_MS after its
+// last frame arrived, even one it lost for want of a frame slot; otherwise a
+// station the encoder keeps draining would leave the whole pool to a flood.
+// A burst from one station therefore only drops its own frames. Frames of
+// stations the station table has no room for share one extra ring.
+//
+// Each ring has a single producer, the capture callback (csi_replay.h), which
+// also evicts from it under DROP_OLDEST; taking a slot from the tail is a
+// compare-and-swap so the eviction and the encoder never both claim the same
+// frame.
+
+#ifndef CONFIG_CSI_STATION_QUEUE_DEPTH
+#define CONFIG_CSI_STATION_QUEUE_DEPTH 64
+#endif
+#ifndef CONFIG_CSI_SCHEDULER_QUANTUM_BYTES
+#define CONFIG_CSI_SCHEDULER_QUANTUM_BYTES 256
+#endif
+
+_Static_assert((CONFIG_CSI_STATION_QUEUE_DEPTH & (CONFIG_CSI_STATION_QUEUE_DEPTH - 1)) == 0,
+               "CONFIG_CSI_STATION_QUEUE_DEPTH must be a power of two");
+
+#define CSI_SCHEDULER_QUEUE_COUNT (STATION_TABLE_MAX_STATIONS + 1)
+#define CSI_SCHEDULER_UNKNOWN_QUEUE STATION_TABLE_MAX_STATIONS
+#define CSI_SCHEDULER_MIN_SHARE 2
+#define CSI_SCHEDULER_ACTIVE_MS 100
+#define CSI_SCHEDULER_DEFAULT_WEIGHT 1
+#define CSI_SCHEDULER_MAX_WEIGHT 16
+#define CSI_SCHEDULER_MAX_WEIGHTS 16 // MACs with a weight other than the default
+
+#define CSI_SCHEDULER_NVS_NAMESPACE "csi_cfg"
+#define CSI_SCHEDULER_NVS_KEY "weights"
+
+typedef struct
+{
+    uint16_t slots[CONFIG_CSI_STATION_QUEUE_DEPTH];
+    atomic_uint_fast32_t head; // Free-running write position, WiFi callback
+    atomic_uint_fast32_t tail; // Free-running read position, claimed by compare-and-swap
+    volatile uint8_t weight;   // Cached by the encoder task, 0 until first resolved
+    volatile uint32_t last_arrival_ms; // WiFi callback, 0 if no frame arrived yet
+
+    // Encoder task
+    int32_t deficit;
+    unsigned int weight_generation;
+    uint32_t served;
+} csi_station_queue_t;
+
+typedef struct
+{
+    uint8_t mac[6];
+    uint8_t weight;
+} csi_station_weight_t;
+
+typedef struct
+{
+    csi_station_queue_t queues[CSI_SCHEDULER_QUEUE_COUNT];
+    csi_frame_pool_t *pool;
+    uint32_t budget;                     // Frames queued over all stations that shares add up to
+    atomic_uint_fast32_t depth;          // Frames queued over all stations
+    volatile uint32_t active_weight;     // Weights of the active stations, as of the last round
+    TaskHandle_t consumer;
+
+    // Encoder task
+    uint16_t position; // In the round; station_table_count() stands for the unknown-station queue
+    bool granted;      // The station at position already got its quantum this turn
+
+    // Command task, read by the encoder task under the lock
+    csi_station_weight_t weights[CSI_SCHEDULER_MAX_WEIGHTS];
+    uint8_t weight_count;
+    atomic_uint weight_generation;
+    portMUX_TYPE weight_lock;
+} csi_scheduler_t;
+
+extern csi_scheduler_t g_csi_scheduler;
+
+static inline csi_station_queue_t *csi_scheduler_queue(uint8_t station_index)
+{
+    return &g_csi_scheduler.queues[station_index < STATION_TABLE_MAX_STATIONS ? station_index
+                                                                              : CSI_SCHEDULER_UNKNOWN_QUEUE];
+}
+
+static inline uint32_t csi_scheduler_queue_weight(const csi_station_queue_t *queue)
+{
+    return queue->weight ? queue->weight : CSI_SCHEDULER_DEFAULT_WEIGHT;
+}
+
+esp_err_t csi_scheduler_init(csi_frame_pool_t *pool, uint32_t budget);
+
+// Task woken whenever a frame is queued
+void csi_scheduler_set_consumer(TaskHandle_t consumer);
+
+static inline uint32_t csi_scheduler_depth()
+{
+    return (uint32_t)atomic_load_explicit(&g_csi_scheduler.depth, memory_order_relaxed);
+}
+
+// WiFi callback: a frame of the station arrived, whether or not it gets a slot
+static inline void csi_scheduler_note_arrival(uint8_t station_index)
+{
+    csi_scheduler_queue(station_index)->last_arrival_ms = (uint32_t)(esp_timer_get_time() / 1000) | 1;
+}
+
+// WiFi callback: queue a frame slot for its station. False if the station
+// already has its share waiting; the caller keeps the slot.
+bool csi_scheduler_enqueue(uint8_t station_index, uint16_t frame_slot);
+
+// WiFi callback: make room in a station's queue under DROP_OLDEST
+uint16_t csi_scheduler_evict_oldest(uint8_t station_index);
+
+// Encoder task: the next frame slot in DRR order, CSI_FRAME_POOL_INVALID_SLOT
+// once every queue is empty
+uint16_t csi_scheduler_dequeue();
+
+// Persist the weights as an entry count followed by MAC and weight per entry
+esp_err_t csi_scheduler_save_weights();
+
+esp_err_t csi_scheduler_load_weights();
+
+// Weight of a MAC; the default weight removes its entry
+esp_err_t csi_scheduler_set_weight(const uint8_t mac[6], uint8_t weight);
+
+// Snapshot from another task; counters may be slightly stale
+void csi_scheduler_print();
+
+// CSI_WEIGHT [<mac> <1-16|DEFAULT>]
+bool csi_scheduler_command(const char *arguments);
+
+#endif // CSI_SCHEDULER_H
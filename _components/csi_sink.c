@@ -0,0 +1,299 @@
+#include "csi_sink.h"
+
+static const char *SINK_TAG = "CSI_SINK";
+
+csi_sink_t g_csi_sinks[CSI_SINK_COUNT] = {
+    [CSI_SINK_UDP] = {.name = "UDP"},
+    [CSI_SINK_SERIAL] = {.name = "SERIAL"},
+    [CSI_SINK_SD] = {.name = "SD"},
+};
+
+static csi_record_encoder_t g_csi_record_encoders[CSI_SINK_FORMAT_COUNT];
+
+// Ring space reserved per record, by format
+static size_t g_csi_record_max_sizes[CSI_SINK_FORMAT_COUNT] = {1024, 1024};
+
+static const char *csi_wire_format_name(csi_wire_format_t format)
+{
+    return format == CSI_WIRE_FORMAT_BINARY ? "binary" : "text";
+}
+
+void csi_sink_set_encoder(csi_wire_format_t format, csi_record_encoder_t encoder, size_t max_record_size)
+{
+    if (format < CSI_SINK_FORMAT_COUNT)
+    {
+        g_csi_record_max_sizes[format] = max_record_size;
+        g_csi_record_encoders[format] = encoder;
+    }
+}
+
+csi_record_encoder_t csi_sink_encoder(csi_wire_format_t format)
+{
+    return format < CSI_SINK_FORMAT_COUNT ? g_csi_record_encoders[format] : NULL;
+}
+
+static void csi_sink_task(void *parameters)
+{
+    csi_sink_t *sink = (csi_sink_t *)parameters;
+    ESP_LOGI(SINK_TAG, "%s sink task started on core %d", sink->name, xPortGetCoreID());
+
+    while (true)
+    {
+        uint32_t record_length;
+        const uint8_t *record;
+
+        while ((record = spsc_ring_peek(&sink->ring, &record_length)) != NULL)
+        {
+            if (sink->write(sink, record, record_length) == ESP_OK)
+            {
+                sink->records_written++;
+            }
+            else
+            {
+                sink->write_failures++;
+            }
+            spsc_ring_consume(&sink->ring);
+        }
+
+        int64_t wait_us = sink->idle ? sink->idle(sink) : -1;
+        TickType_t wait_ticks = portMAX_DELAY;
+        if (wait_us >= 0)
+        {
+            wait_ticks = (TickType_t)((wait_us + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+        }
+        ulTaskNotifyTake(pdTRUE, wait_ticks);
+    }
+}
+
+esp_err_t csi_sink_register(csi_sink_id_t id, csi_sink_write_fn_t write, csi_sink_idle_fn_t idle, void *context,
+                            csi_wire_format_t format, bool enabled, uint32_t ring_size,
+                            UBaseType_t priority, uint32_t stack_size, BaseType_t core)
+{
+    if (id >= CSI_SINK_COUNT || !write || g_csi_sinks[id].write)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    csi_sink_t *sink = &g_csi_sinks[id];
+    esp_err_t result = spsc_ring_init(&sink->ring, ring_size);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    sink->idle = idle;
+    sink->context = context;
+    sink->format = format;
+    sink->write = write;
+
+    if (xTaskCreatePinnedToCore(csi_sink_task, sink->name, stack_size, sink, priority, &sink->task, core) != pdPASS)
+    {
+        sink->write = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    pipeline_stats_register_task(sink->name, sink->task);
+    sink->enabled = enabled;
+    ESP_LOGI(SINK_TAG, "%s sink %s (%s)", sink->name, enabled ? "enabled" : "disabled", csi_wire_format_name(format));
+    return ESP_OK;
+}
+
+esp_err_t csi_sink_set_enabled(csi_sink_id_t id, bool enabled)
+{
+    if (id >= CSI_SINK_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!g_csi_sinks[id].write)
+    {
+        return enabled ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+    }
+
+    g_csi_sinks[id].enabled = enabled;
+    return ESP_OK;
+}
+
+esp_err_t csi_sink_set_format(csi_sink_id_t id, csi_wire_format_t format)
+{
+    if (id >= CSI_SINK_COUNT || format >= CSI_SINK_FORMAT_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_csi_sinks[id].format = format;
+    return ESP_OK;
+}
+
+bool csi_sink_any_enabled()
+{
+    for (int id = 0; id < CSI_SINK_COUNT; id++)
+    {
+        if (g_csi_sinks[id].enabled)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool csi_sink_has_room(uint32_t records)
+{
+    for (int id = 0; id < CSI_SINK_COUNT; id++)
+    {
+        csi_sink_t *sink = &g_csi_sinks[id];
+        if (!sink->enabled)
+        {
+            continue;
+        }
+        uint32_t needed = records * spsc_ring_align((uint32_t)g_csi_record_max_sizes[sink->format]);
+        if (sink->ring.capacity - spsc_ring_used(&sink->ring) < needed)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int csi_sink_publish(const csi_frame_slot_t *frame, int64_t timestamp_us)
+{
+    const uint8_t *encoded[CSI_SINK_FORMAT_COUNT] = {NULL};
+    size_t encoded_length[CSI_SINK_FORMAT_COUNT] = {0};
+    bool failed[CSI_SINK_FORMAT_COUNT] = {false}; // Encoder returned 0, no sink of the format gets the frame
+    int accepted = 0;
+    bool dropped = false;
+
+    for (int id = 0; id < CSI_SINK_COUNT; id++)
+    {
+        csi_sink_t *sink = &g_csi_sinks[id];
+        csi_wire_format_t format = sink->format;
+        csi_record_encoder_t encoder = g_csi_record_encoders[format];
+        if (!sink->enabled || !encoder || failed[format])
+        {
+            continue;
+        }
+
+        size_t max_record_size = g_csi_record_max_sizes[format];
+        uint8_t *record = spsc_ring_reserve(&sink->ring, max_record_size);
+        if (!record)
+        {
+            sink->ring_drops++;
+            g_pipeline_stats.ring_drops++;
+            dropped = true;
+            continue;
+        }
+
+        if (encoded[format])
+        {
+            memcpy(record, encoded[format], encoded_length[format]);
+        }
+        else
+        {
+            encoded_length[format] = encoder(frame, timestamp_us, record, max_record_size);
+            if (encoded_length[format] == 0)
+            {
+                failed[format] = true;
+                continue;
+            }
+            encoded[format] = record;
+        }
+
+        spsc_ring_commit(&sink->ring, encoded_length[format]);
+        xTaskNotifyGive(sink->task);
+        accepted++;
+    }
+
+    // A sink's stream misses this record, so the station's next one must not be a delta
+    csi_stream_t *stream = csi_stream(frame->station_index);
+    if (dropped)
+    {
+        csi_compression_reset_station(frame->station_index);
+        if (stream)
+        {
+            stream->ring_drops++;
+        }
+    }
+    if (stream && accepted > 0)
+    {
+        stream->records++;
+    }
+
+    return accepted;
+}
+
+void csi_sink_print()
+{
+    for (int id = 0; id < CSI_SINK_COUNT; id++)
+    {
+        csi_sink_t *sink = &g_csi_sinks[id];
+        if (!sink->write)
+        {
+            printf("Sink %-6s: not available\n", sink->name);
+            continue;
+        }
+        printf("Sink %-6s: %s, %s, %lu written, %lu failed, %lu ring drops\n", sink->name,
+               sink->enabled ? "on" : "off", csi_wire_format_name(sink->format),
+               (unsigned long)sink->records_written, (unsigned long)sink->write_failures,
+               (unsigned long)sink->ring_drops);
+    }
+}
+
+static int csi_sink_find(const char *name)
+{
+    for (int id = 0; id < CSI_SINK_COUNT; id++)
+    {
+        if (strcasecmp(name, g_csi_sinks[id].name) == 0)
+        {
+            return id;
+        }
+    }
+    return -1;
+}
+
+bool csi_sink_command(const char *arguments)
+{
+    char sink_name[8] = {0};
+    char state[8] = {0};
+    char format_name[8] = {0};
+    sscanf(arguments, "%7s %7s %7s", sink_name, state, format_name);
+
+    if (strcasecmp(sink_name, "LIST") == 0)
+    {
+        csi_sink_print();
+        return true;
+    }
+
+    if (strcasecmp(sink_name, "NONE") == 0)
+    {
+        for (int id = 0; id < CSI_SINK_COUNT; id++)
+        {
+            csi_sink_set_enabled((csi_sink_id_t)id, false);
+        }
+        printf("All CSI sinks disabled\n");
+        return true;
+    }
+
+    int id = csi_sink_find(sink_name);
+    bool enable = strcasecmp(state, "ON") == 0;
+    if (id < 0 || (!enable && strcasecmp(state, "OFF") != 0) ||
+        (format_name[0] && strcasecmp(format_name, "TEXT") != 0 && strcasecmp(format_name, "BINARY") != 0))
+    {
+        printf("Usage: CSI_SINK <UDP|SERIAL|SD> <ON|OFF> [TEXT|BINARY] | NONE | LIST\n");
+        return false;
+    }
+
+    if (format_name[0])
+    {
+        csi_sink_set_format((csi_sink_id_t)id, strcasecmp(format_name, "BINARY") == 0 ? CSI_WIRE_FORMAT_BINARY : CSI_WIRE_FORMAT_TEXT);
+    }
+
+    esp_err_t result = csi_sink_set_enabled((csi_sink_id_t)id, enable);
+    if (result != ESP_OK)
+    {
+        printf("%s sink: %s\n", g_csi_sinks[id].name, esp_err_to_name(result));
+        return false;
+    }
+
+    printf("%s sink %s (%s)\n", g_csi_sinks[id].name, enable ? "enabled" : "disabled",
+           csi_wire_format_name(g_csi_sinks[id].format));
+    return true;
+}
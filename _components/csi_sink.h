@@ -0,0 +1,100 @@
+#ifndef CSI_SINK_H
+#define CSI_SINK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "csi_wire_format.h"
+#include "spsc_ring.h"
+#include "csi_compression.h"
+#include "csi_frame_pool.h"
+#include "csi_streams.h"
+#include "pipeline_stats.h"
+
+// Output sinks for encoded CSI records (UDP, serial, SD card). Each sink has
+// its own ring and its own task, so a slow sink only ever drops its own
+// records and never holds up the encoder or a faster sink. The encoder
+// encodes every frame once per wire format in use and copies the record into
+// the ring of every enabled sink that wants that format.
+
+typedef enum
+{
+    CSI_SINK_UDP = 0,
+    CSI_SINK_SERIAL = 1,
+    CSI_SINK_SD = 2,
+    CSI_SINK_COUNT
+} csi_sink_id_t;
+
+#define CSI_SINK_FORMAT_COUNT 2 // CSI_WIRE_FORMAT_TEXT, CSI_WIRE_FORMAT_BINARY
+
+typedef struct csi_sink csi_sink_t;
+
+// Write one record, called from the sink's task
+typedef esp_err_t (*csi_sink_write_fn_t)(csi_sink_t *sink, const uint8_t *record, size_t record_length);
+
+// Called once the ring is drained: flush whatever is pending and return the
+// microseconds until the sink wants to run again, or -1 to wait for records
+typedef int64_t (*csi_sink_idle_fn_t)(csi_sink_t *sink);
+
+// Encode one captured frame in a wire format, returns the record length or 0.
+// The slot also carries the frame's station index and sequence number.
+typedef size_t (*csi_record_encoder_t)(const csi_frame_slot_t *frame, int64_t timestamp_us,
+                                      uint8_t *output, size_t capacity);
+
+struct csi_sink
+{
+    const char *name;
+    volatile bool enabled;
+    volatile csi_wire_format_t format;
+    csi_sink_write_fn_t write; // NULL while the sink is not available in this build
+    csi_sink_idle_fn_t idle;
+    void *context;
+    spsc_ring_t ring;
+    TaskHandle_t task;
+    volatile uint32_t records_written; // Sink task
+    volatile uint32_t write_failures;  // Sink task
+    volatile uint32_t ring_drops;      // Encoder
+};
+
+extern csi_sink_t g_csi_sinks[CSI_SINK_COUNT];
+
+// Install the encoder used for one wire format and the largest record it
+// produces, which is what a sink of that format reserves per record
+void csi_sink_set_encoder(csi_wire_format_t format, csi_record_encoder_t encoder, size_t max_record_size);
+
+// Encoder installed for a wire format, NULL if none
+csi_record_encoder_t csi_sink_encoder(csi_wire_format_t format);
+
+// Give a sink its ring and task. Registered sinks start in the given state.
+esp_err_t csi_sink_register(csi_sink_id_t id, csi_sink_write_fn_t write, csi_sink_idle_fn_t idle, void *context,
+                            csi_wire_format_t format, bool enabled, uint32_t ring_size,
+                            UBaseType_t priority, uint32_t stack_size, BaseType_t core);
+
+esp_err_t csi_sink_set_enabled(csi_sink_id_t id, bool enabled);
+
+esp_err_t csi_sink_set_format(csi_sink_id_t id, csi_wire_format_t format);
+
+bool csi_sink_any_enabled();
+
+// Whether every enabled sink's ring has room for that many more records of the
+// largest size in its format, so frames fed in at the producer's pace are not
+// dropped
+bool csi_sink_has_room(uint32_t records);
+
+// Encoder side: encode a frame once per format in use and queue it on every
+// enabled sink. Returns the number of sinks that accepted the record.
+int csi_sink_publish(const csi_frame_slot_t *frame, int64_t timestamp_us);
+
+void csi_sink_print();
+
+// CSI_SINK <UDP|SERIAL|SD> <ON|OFF> [TEXT|BINARY] | NONE | LIST
+bool csi_sink_command(const char *arguments);
+
+#endif // CSI_SINK_H
@@ -0,0 +1,418 @@
+#include "csi_stimulus.h"
+
+static const char *STIMULUS_TAG = "CSI_STIMULUS";
+
+csi_stimulus_t g_csi_stimulus = {.socket_descriptor = -1, .rate_hz = CONFIG_CSI_STIMULUS_RATE_HZ};
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+
+static void IRAM_ATTR csi_stimulus_tick(void *argument)
+{
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(g_csi_stimulus.task, &higher_priority_woken);
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+#else
+
+static void csi_stimulus_tick(void *argument)
+{
+    xTaskNotifyGive(g_csi_stimulus.task);
+}
+
+#endif
+
+// RFC 1071 Internet checksum
+static uint16_t csi_stimulus_checksum(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t sum = 0;
+    for (size_t index = 0; index + 1 < length; index += 2)
+    {
+        sum += (uint32_t)(bytes[index] << 8 | bytes[index + 1]);
+    }
+    if (length & 1)
+    {
+        sum += (uint32_t)bytes[length - 1] << 8;
+    }
+    while (sum >> 16)
+    {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return htons((uint16_t)~sum);
+}
+
+static csi_stimulus_target_t *csi_stimulus_find(const uint8_t mac[6])
+{
+    for (int slot = 0; slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        if (g_csi_stimulus.targets[slot].in_use && memcmp(g_csi_stimulus.targets[slot].mac, mac, 6) == 0)
+        {
+            return &g_csi_stimulus.targets[slot];
+        }
+    }
+    return NULL;
+}
+
+static csi_stimulus_target_t *csi_stimulus_find_address(uint32_t address)
+{
+    for (int slot = 0; slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        if (g_csi_stimulus.targets[slot].in_use && g_csi_stimulus.targets[slot].address == address)
+        {
+            return &g_csi_stimulus.targets[slot];
+        }
+    }
+    return NULL;
+}
+
+static void csi_stimulus_apply(const csi_stimulus_change_t *change)
+{
+    csi_stimulus_target_t *target = csi_stimulus_find(change->mac);
+
+    if (change->op == CSI_STIMULUS_REMOVE)
+    {
+        if (target)
+        {
+            target->in_use = false;
+        }
+        return;
+    }
+
+    for (int slot = 0; !target && slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        if (!g_csi_stimulus.targets[slot].in_use)
+        {
+            target = &g_csi_stimulus.targets[slot];
+            memset(target, 0, sizeof(*target));
+            memcpy(target->mac, change->mac, 6);
+            target->in_use = true;
+        }
+    }
+    if (!target)
+    {
+        ESP_LOGW(STIMULUS_TAG, "Target table full, station not stimulated");
+        return;
+    }
+    target->address = change->address;
+}
+
+// Any task: queue a change for the stimulus task
+static esp_err_t csi_stimulus_post(csi_stimulus_change_op_t op, const uint8_t mac[6], uint32_t address)
+{
+    if (!g_csi_stimulus.changes)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    csi_stimulus_change_t change = {.op = op, .address = address};
+    memcpy(change.mac, mac, 6);
+    if (xQueueSend(g_csi_stimulus.changes, &change, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (g_csi_stimulus.task)
+    {
+        xTaskNotifyGive(g_csi_stimulus.task);
+    }
+    return ESP_OK;
+}
+
+esp_err_t csi_stimulus_add_station(const uint8_t mac[6], uint32_t address)
+{
+    return csi_stimulus_post(CSI_STIMULUS_ADD, mac, address);
+}
+
+esp_err_t csi_stimulus_remove_station(const uint8_t mac[6])
+{
+    return csi_stimulus_post(CSI_STIMULUS_REMOVE, mac, 0);
+}
+
+esp_err_t csi_stimulus_set_rate(uint16_t rate_hz)
+{
+    if (rate_hz > CSI_STIMULUS_MAX_RATE_HZ)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_csi_stimulus.rate_hz = rate_hz;
+    if (g_csi_stimulus.task)
+    {
+        xTaskNotifyGive(g_csi_stimulus.task);
+    }
+    return ESP_OK;
+}
+
+// Rebuild the round-robin list and restart the timer if the tick period changed
+static void csi_stimulus_plan(int64_t now_us)
+{
+    g_csi_stimulus.active_count = 0;
+    for (int slot = 0; slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        csi_stimulus_target_t *target = &g_csi_stimulus.targets[slot];
+        target->allowed = target->in_use && target->address && mac_allowlist_contains(target->mac);
+        if (target->allowed)
+        {
+            g_csi_stimulus.active[g_csi_stimulus.active_count++] = (uint8_t)slot;
+        }
+    }
+
+    uint16_t rate_hz = g_csi_stimulus.rate_hz;
+    g_csi_stimulus.planned_rate_hz = rate_hz;
+    g_pipeline_stats.stimulus_rate_hz = rate_hz;
+    g_pipeline_stats.stimulus_targets = g_csi_stimulus.active_count;
+
+    if (rate_hz == 0 || g_csi_stimulus.active_count == 0)
+    {
+        if (g_csi_stimulus.running)
+        {
+            esp_timer_stop(g_csi_stimulus.timer);
+            g_csi_stimulus.running = false;
+        }
+        return;
+    }
+
+    // Past the aggregate limit every station gets a lower rate, telemetry shows how much
+    uint32_t total_hz = (uint32_t)rate_hz * g_csi_stimulus.active_count;
+    if (total_hz > CONFIG_CSI_STIMULUS_MAX_TOTAL_HZ)
+    {
+        total_hz = CONFIG_CSI_STIMULUS_MAX_TOTAL_HZ;
+    }
+    int64_t period_us = 1000000 / total_hz;
+    if (g_csi_stimulus.running && period_us == g_csi_stimulus.period_us)
+    {
+        return;
+    }
+
+    if (g_csi_stimulus.running)
+    {
+        esp_timer_stop(g_csi_stimulus.timer);
+    }
+    // Read the clock first: the first alarm is never earlier than this deadline
+    g_csi_stimulus.next_due_us = esp_timer_get_time() + period_us;
+    esp_err_t result = esp_timer_start_periodic(g_csi_stimulus.timer, (uint64_t)period_us);
+    g_csi_stimulus.running = result == ESP_OK;
+    g_csi_stimulus.period_us = period_us;
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(STIMULUS_TAG, "Failed to start the stimulus timer: %s", esp_err_to_name(result));
+    }
+}
+
+static void csi_stimulus_send(csi_stimulus_target_t *target, int64_t now_us)
+{
+    csi_stimulus_echo_t echo = {
+        .type = CSI_STIMULUS_ICMP_ECHO_REQUEST,
+        .id = htons(CSI_STIMULUS_ECHO_ID),
+        .sequence = htons(++target->sequence),
+        .sent_us = now_us};
+    echo.checksum = csi_stimulus_checksum(&echo, sizeof(echo));
+
+    struct sockaddr_in destination = {.sin_family = AF_INET};
+    destination.sin_addr.s_addr = target->address;
+
+    if (sendto(g_csi_stimulus.socket_descriptor, &echo, sizeof(echo), 0, (struct sockaddr *)&destination,
+               sizeof(destination)) < 0)
+    {
+        target->send_failures++;
+        return;
+    }
+    target->sent++;
+    target->window_sent++;
+}
+
+// One request to the next station in turn, for the latest tick that is due
+static void csi_stimulus_run_tick(int64_t now_us)
+{
+    int64_t late_us = now_us - g_csi_stimulus.next_due_us;
+    int64_t missed = late_us / g_csi_stimulus.period_us;
+    g_csi_stimulus.missed_ticks += (uint32_t)missed;
+    g_csi_stimulus.next_due_us += (missed + 1) * g_csi_stimulus.period_us;
+
+    uint32_t lateness_us = (uint32_t)(late_us - missed * g_csi_stimulus.period_us);
+    g_csi_stimulus.window_ticks++;
+    g_csi_stimulus.window_lateness_total_us += lateness_us;
+    if (lateness_us > g_csi_stimulus.window_lateness_max_us)
+    {
+        g_csi_stimulus.window_lateness_max_us = lateness_us;
+    }
+
+    if (g_csi_stimulus.next_active >= g_csi_stimulus.active_count)
+    {
+        g_csi_stimulus.next_active = 0;
+    }
+    csi_stimulus_send(&g_csi_stimulus.targets[g_csi_stimulus.active[g_csi_stimulus.next_active++]], now_us);
+}
+
+// Count the echo replies that arrived since the last look
+static void csi_stimulus_receive_replies(int64_t now_us)
+{
+    uint8_t packet[64];
+    int length;
+    while ((length = recv(g_csi_stimulus.socket_descriptor, packet, sizeof(packet), MSG_DONTWAIT)) > 0)
+    {
+        // Raw ICMP sockets deliver the IP header in front of the message
+        int header_length = (packet[0] & 0x0f) * 4;
+        if (length < header_length + (int)sizeof(csi_stimulus_echo_t))
+        {
+            continue;
+        }
+
+        csi_stimulus_echo_t echo;
+        memcpy(&echo, packet + header_length, sizeof(echo));
+        if (echo.type != CSI_STIMULUS_ICMP_ECHO_REPLY || ntohs(echo.id) != CSI_STIMULUS_ECHO_ID)
+        {
+            continue;
+        }
+
+        uint32_t source;
+        memcpy(&source, packet + 12, sizeof(source));
+        csi_stimulus_target_t *target = csi_stimulus_find_address(source);
+        if (target)
+        {
+            target->replies++;
+            target->window_replies++;
+            target->rtt_total_us += (uint64_t)(now_us - echo.sent_us);
+        }
+    }
+}
+
+// Achieved rates over the window that just ended
+static void csi_stimulus_finish_window(int64_t now_us)
+{
+    int64_t elapsed_us = now_us - g_csi_stimulus.window_start_us;
+    uint32_t sent = 0;
+    uint32_t replies = 0;
+
+    for (int slot = 0; slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        csi_stimulus_target_t *target = &g_csi_stimulus.targets[slot];
+        target->sent_hz = (uint16_t)(target->window_sent * 1000000LL / elapsed_us);
+        target->reply_hz = (uint16_t)(target->window_replies * 1000000LL / elapsed_us);
+        if (target->allowed)
+        {
+            sent += target->window_sent;
+            replies += target->window_replies;
+        }
+        target->window_sent = 0;
+        target->window_replies = 0;
+    }
+
+    // Per station, averaged over the stations being sent to
+    uint32_t divisor = g_csi_stimulus.active_count ? g_csi_stimulus.active_count : 1;
+    g_pipeline_stats.stimulus_sent_hz = (uint32_t)(sent * 1000000LL / elapsed_us / divisor);
+    g_pipeline_stats.stimulus_reply_hz = (uint32_t)(replies * 1000000LL / elapsed_us / divisor);
+    g_pipeline_stats.stimulus_lateness_max_us = g_csi_stimulus.window_lateness_max_us;
+    g_pipeline_stats.stimulus_lateness_avg_us =
+        g_csi_stimulus.window_ticks ? (uint32_t)(g_csi_stimulus.window_lateness_total_us / g_csi_stimulus.window_ticks) : 0;
+    g_pipeline_stats.stimulus_missed_ticks = g_csi_stimulus.missed_ticks;
+
+    g_csi_stimulus.window_start_us = now_us;
+    g_csi_stimulus.window_ticks = 0;
+    g_csi_stimulus.window_lateness_total_us = 0;
+    g_csi_stimulus.window_lateness_max_us = 0;
+}
+
+static void csi_stimulus_task(void *parameters)
+{
+    g_csi_stimulus.window_start_us = esp_timer_get_time();
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CSI_STIMULUS_WINDOW_MS));
+
+        bool changed = g_csi_stimulus.planned_rate_hz != g_csi_stimulus.rate_hz;
+        csi_stimulus_change_t change;
+        while (xQueueReceive(g_csi_stimulus.changes, &change, 0) == pdTRUE)
+        {
+            csi_stimulus_apply(&change);
+            changed = true;
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        if (g_csi_stimulus.running && now_us >= g_csi_stimulus.next_due_us)
+        {
+            csi_stimulus_run_tick(now_us);
+        }
+        csi_stimulus_receive_replies(now_us);
+
+        if (now_us - g_csi_stimulus.window_start_us >= CSI_STIMULUS_WINDOW_MS * 1000LL)
+        {
+            csi_stimulus_finish_window(now_us);
+            changed = true; // Picks up allowlist edits
+        }
+        if (changed)
+        {
+            csi_stimulus_plan(now_us);
+        }
+    }
+}
+
+esp_err_t csi_stimulus_init()
+{
+    g_csi_stimulus.changes = xQueueCreate(CSI_STIMULUS_CHANGE_QUEUE_DEPTH, sizeof(csi_stimulus_change_t));
+    return g_csi_stimulus.changes ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t csi_stimulus_start(UBaseType_t priority, uint32_t stack_size, BaseType_t core)
+{
+    if (!g_csi_stimulus.changes)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    g_csi_stimulus.socket_descriptor = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (g_csi_stimulus.socket_descriptor < 0)
+    {
+        ESP_LOGE(STIMULUS_TAG, "Failed to create ICMP socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = csi_stimulus_tick,
+        .dispatch_method = CSI_STIMULUS_TIMER_DISPATCH,
+        .name = "csi_stimulus",
+        .skip_unhandled_events = true};
+    esp_err_t result = esp_timer_create(&timer_args, &g_csi_stimulus.timer);
+    if (result != ESP_OK)
+    {
+        close(g_csi_stimulus.socket_descriptor);
+        g_csi_stimulus.socket_descriptor = -1;
+        return result;
+    }
+
+    if (xTaskCreatePinnedToCore(csi_stimulus_task, "csi_stimulus", stack_size, NULL, priority, &g_csi_stimulus.task,
+                                core) != pdPASS)
+    {
+        ESP_LOGE(STIMULUS_TAG, "Failed to create stimulus task");
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline_stats_register_task("stimulus", g_csi_stimulus.task);
+    return ESP_OK;
+}
+
+void csi_stimulus_print()
+{
+    printf("Stimulus: %u Hz per station, %lu targets, tick %lld us, %lu ticks missed\n", g_csi_stimulus.rate_hz,
+           (unsigned long)g_pipeline_stats.stimulus_targets, (long long)(g_csi_stimulus.running ? g_csi_stimulus.period_us : 0),
+           (unsigned long)g_csi_stimulus.missed_ticks);
+    printf("  Lateness avg/max: %lu / %lu us\n", (unsigned long)g_pipeline_stats.stimulus_lateness_avg_us,
+           (unsigned long)g_pipeline_stats.stimulus_lateness_max_us);
+    for (int slot = 0; slot < CONFIG_CSI_STIMULUS_MAX_TARGETS; slot++)
+    {
+        const csi_stimulus_target_t *target = &g_csi_stimulus.targets[slot];
+        if (!target->in_use)
+        {
+            continue;
+        }
+        char address_text[16];
+        inet_ntop(AF_INET, &target->address, address_text, sizeof(address_text));
+        printf("  %02x:%02x:%02x:%02x:%02x:%02x %s%s: %u Hz sent, %u Hz replies, %lu/%lu replied, "
+               "rtt %lu us, %lu failures\n",
+               target->mac[0], target->mac[1], target->mac[2], target->mac[3], target->mac[4], target->mac[5],
+               address_text, target->allowed ? "" : " (not allowlisted)", target->sent_hz, target->reply_hz,
+               (unsigned long)target->replies, (unsigned long)target->sent,
+               (unsigned long)(target->replies ? target->rtt_total_us / target->replies : 0),
+               (unsigned long)target->send_failures);
+    }
+}
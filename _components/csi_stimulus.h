@@ -0,0 +1,158 @@
+#ifndef CSI_STIMULUS_H
+#define CSI_STIMULUS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "mac_allowlist.h"
+#include "pipeline_stats.h"
+
+// AP-side traffic generator. The AP only measures CSI on frames a station
+// sends, so each allowlisted station with an address is sent an ICMP echo
+// request at a fixed rate and answers with an echo reply: one data frame
+// from the station's own MAC per request, whatever else it is doing. (A
+// discarded UDP datagram or a null data frame is only ACKed, and ACKs carry
+// no transmitter address, so their CSI cannot be told apart by station.)
+//
+// An esp_timer ticks at rate x stations and the stimulus task sends one
+// request per tick, to the stations in turn, so requests are spread evenly
+// over the period instead of going out in bursts. The timer only wakes the
+// task; sockets are never touched from the timer dispatch. The task keeps
+// the timer's drift-free schedule itself: a tick it gets to late is sent at
+// once and measured as lateness, ticks it missed entirely are skipped and
+// counted rather than sent in a burst.
+//
+// Station addresses arrive from the DHCP events through a change queue; the
+// task owns the target table. Allowlist membership is rechecked once per
+// report window, so CSI_ALLOW changes take effect within a second.
+
+#ifndef CONFIG_CSI_STIMULUS_RATE_HZ
+#define CONFIG_CSI_STIMULUS_RATE_HZ 0
+#endif
+#ifndef CONFIG_CSI_STIMULUS_MAX_TOTAL_HZ
+#define CONFIG_CSI_STIMULUS_MAX_TOTAL_HZ 4000
+#endif
+#ifndef CONFIG_CSI_STIMULUS_MAX_TARGETS
+#define CONFIG_CSI_STIMULUS_MAX_TARGETS 10
+#endif
+#ifndef CONFIG_CSI_STIMULUS_TASK_PRIORITY
+#define CONFIG_CSI_STIMULUS_TASK_PRIORITY 7
+#endif
+
+#define CSI_STIMULUS_MAX_RATE_HZ 1000
+#define CSI_STIMULUS_WINDOW_MS 1000 // Achieved rates are measured over this long
+#define CSI_STIMULUS_CHANGE_QUEUE_DEPTH 8
+#define CSI_STIMULUS_ECHO_ID 0x4353 // "CS", tells our replies from other pings
+#define CSI_STIMULUS_ICMP_ECHO_REPLY 0
+#define CSI_STIMULUS_ICMP_ECHO_REQUEST 8
+
+typedef struct __attribute__((packed))
+{
+    uint8_t type;
+    uint8_t code;
+    uint16_t checksum;
+    uint16_t id;
+    uint16_t sequence;
+    int64_t sent_us; // Echoed back, gives the round trip time
+} csi_stimulus_echo_t;
+
+typedef struct
+{
+    bool in_use;
+    bool allowed; // On the allowlist at the last check
+    uint8_t mac[6];
+    uint32_t address; // IPv4, network byte order
+    uint16_t sequence;
+    uint32_t sent;
+    uint32_t replies;
+    uint32_t send_failures;
+    uint64_t rtt_total_us;
+    uint32_t window_sent;
+    uint32_t window_replies;
+    uint16_t sent_hz; // Achieved over the last window
+    uint16_t reply_hz;
+} csi_stimulus_target_t;
+
+typedef enum
+{
+    CSI_STIMULUS_ADD = 0,
+    CSI_STIMULUS_REMOVE = 1
+} csi_stimulus_change_op_t;
+
+typedef struct
+{
+    csi_stimulus_change_op_t op;
+    uint8_t mac[6];
+    uint32_t address;
+} csi_stimulus_change_t;
+
+typedef struct
+{
+    // Stimulus task only
+    csi_stimulus_target_t targets[CONFIG_CSI_STIMULUS_MAX_TARGETS];
+    uint8_t active[CONFIG_CSI_STIMULUS_MAX_TARGETS]; // Targets being sent to, in round-robin order
+    uint8_t active_count;
+    uint8_t next_active;
+    int socket_descriptor;
+    esp_timer_handle_t timer;
+    bool running;
+    int64_t period_us;
+    int64_t next_due_us;
+    uint16_t planned_rate_hz;
+    int64_t window_start_us;
+    uint32_t window_ticks;
+    int64_t window_lateness_total_us;
+    uint32_t window_lateness_max_us;
+    uint32_t missed_ticks;
+
+    QueueHandle_t changes;
+    TaskHandle_t task;
+    volatile uint16_t rate_hz; // Requested per station, 0 = off
+} csi_stimulus_t;
+
+extern csi_stimulus_t g_csi_stimulus;
+
+// Timer dispatch: wake the task, which decides from the clock whether a tick is due
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define CSI_STIMULUS_TIMER_DISPATCH ESP_TIMER_ISR
+#else
+#define CSI_STIMULUS_TIMER_DISPATCH ESP_TIMER_TASK
+#endif
+
+// A station got an address; it is only sent to while it is on the allowlist
+esp_err_t csi_stimulus_add_station(const uint8_t mac[6], uint32_t address);
+
+esp_err_t csi_stimulus_remove_station(const uint8_t mac[6]);
+
+// Requests per second to every target, 0 stops the generator
+esp_err_t csi_stimulus_set_rate(uint16_t rate_hz);
+
+static inline uint16_t csi_stimulus_rate()
+{
+    return g_csi_stimulus.rate_hz;
+}
+
+// Before WiFi starts, so no station address is missed; changes wait for the task
+esp_err_t csi_stimulus_init();
+
+// Once the network stack is up
+esp_err_t csi_stimulus_start(UBaseType_t priority, uint32_t stack_size, BaseType_t core);
+
+// Snapshot from another task; counters may be slightly stale
+void csi_stimulus_print();
+
+#endif // CSI_STIMULUS_H
@@ -0,0 +1,40 @@
+#include "csi_streams.h"
+
+csi_stream_t g_csi_streams[STATION_TABLE_MAX_STATIONS];
+
+void csi_streams_print()
+{
+    unsigned int station_count = station_table_count();
+    printf("Streams (%u stations):\n", station_count);
+    for (unsigned int station = 0; station < station_count; station++)
+    {
+        const uint8_t *mac = station_table_mac((uint8_t)station);
+        const csi_stream_t *stream = &g_csi_streams[station];
+        printf("  %02x:%02x:%02x:%02x:%02x:%02x seq %lu, sent %lu, drops: alloc %lu queue %lu decimated %lu ring %lu\n",
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (unsigned long)stream->sequence,
+               (unsigned long)stream->records, (unsigned long)stream->alloc_drops,
+               (unsigned long)stream->queue_drops, (unsigned long)stream->decimated,
+               (unsigned long)stream->ring_drops);
+    }
+}
+
+void csi_stream_snapshot(uint8_t station_index, uint32_t frame_sequence, csi_wire_stream_t *snapshot)
+{
+    const csi_stream_t *stream = csi_stream(station_index);
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!stream)
+    {
+        return;
+    }
+    snapshot->frame_sequence = frame_sequence;
+    snapshot->alloc_drops = (uint16_t)stream->alloc_drops;
+    snapshot->queue_drops = (uint16_t)stream->queue_drops;
+    snapshot->decimated = (uint16_t)stream->decimated;
+    snapshot->ring_drops = (uint16_t)stream->ring_drops;
+}
+
+bool csi_streams_command(const char *arguments)
+{
+    csi_streams_print();
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef CSI_STREAMS_H
+#define CSI_STREAMS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "station_table.h"
+#include "csi_wire_format.h"
+
+// Per-station frame sequence and drop accounting. The WiFi callback numbers
+// every frame of a station it lets through the allowlist, before any stage
+// can drop it, so each sequence number either reaches the host or is
+// counted by exactly one stage:
+//
+//   alloc      no free frame pool slot
+//   queue      CSI queue full (the dropped or the evicted frame's station)
+//   decimated  thinned out by the DECIMATE overload policy
+//   ring       the encoded record did not fit a sink ring (any sink)
+//
+// Records carry the sequence number and the counters as they stand when
+// the frame is encoded, so a host can tell sequence gaps caused on the
+// device from datagrams lost on the way. Counters that were bumped for a
+// later frame still queued show up one record early; the totals match.
+//
+// Each counter has a single writer: the WiFi callback for the first four
+// and for the sequence, the encoder task for ring drops.
+
+typedef struct
+{
+    volatile uint32_t sequence; // Last sequence number handed out, the first frame is 1
+    volatile uint32_t alloc_drops;
+    volatile uint32_t queue_drops;
+    volatile uint32_t decimated;
+    volatile uint32_t ring_drops;
+    volatile uint32_t records; // Frames published to at least one sink
+} csi_stream_t;
+
+extern csi_stream_t g_csi_streams[STATION_TABLE_MAX_STATIONS];
+
+// NULL for frames of stations the table had no room for
+static inline csi_stream_t *csi_stream(uint8_t station_index)
+{
+    return station_index < STATION_TABLE_MAX_STATIONS ? &g_csi_streams[station_index] : NULL;
+}
+
+// WiFi callback: number the next frame of a station, 0 if it has no stream
+static inline uint32_t csi_stream_next_sequence(uint8_t station_index)
+{
+    csi_stream_t *stream = csi_stream(station_index);
+    return stream ? ++stream->sequence : 0;
+}
+
+void csi_streams_print();
+
+// Counters as stamped into a record of the station, all zero if untracked
+void csi_stream_snapshot(uint8_t station_index, uint32_t frame_sequence, csi_wire_stream_t *snapshot);
+
+bool csi_streams_command(const char *arguments);
+
+#endif // CSI_STREAMS_H
@@ -0,0 +1,219 @@
+#include "csi_subcarrier_mask.h"
+
+csi_subcarrier_mask_t g_csi_subcarrier_mask = {
+    .bits = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF},
+    .preset = CSI_SUBCARRIER_MASK_ALL,
+    .update_lock = portMUX_INITIALIZER_UNLOCKED};
+
+const char *csi_subcarrier_mask_preset_name(csi_subcarrier_mask_preset_t preset)
+{
+    switch (preset)
+    {
+    case CSI_SUBCARRIER_MASK_HT20:
+        return "HT20";
+    case CSI_SUBCARRIER_MASK_HT40:
+        return "HT40";
+    case CSI_SUBCARRIER_MASK_CUSTOM:
+        return "CUSTOM";
+    case CSI_SUBCARRIER_MASK_ALL:
+    default:
+        return "ALL";
+    }
+}
+
+static void csi_subcarrier_mask_set_range(uint32_t bits[CSI_SUBCARRIER_MASK_WORDS], int first, int last)
+{
+    for (int position = first; position <= last && position < CSI_SUBCARRIER_MASK_POSITIONS; position++)
+    {
+        bits[position / 32] |= 1UL << (position % 32);
+    }
+}
+
+void csi_subcarrier_mask_preset_bits(csi_subcarrier_mask_preset_t preset, uint32_t bits[CSI_SUBCARRIER_MASK_WORDS])
+{
+    memset(bits, 0, CSI_SUBCARRIER_MASK_WORDS * sizeof(uint32_t));
+
+    switch (preset)
+    {
+    case CSI_SUBCARRIER_MASK_ALL:
+        csi_subcarrier_mask_set_range(bits, 0, CSI_SUBCARRIER_MASK_POSITIONS - 1);
+        break;
+    case CSI_SUBCARRIER_MASK_HT20:
+        csi_subcarrier_mask_set_range(bits, 1, 28);  // +1..+28
+        csi_subcarrier_mask_set_range(bits, 36, 63); // -28..-1
+        break;
+    case CSI_SUBCARRIER_MASK_HT40:
+        csi_subcarrier_mask_set_range(bits, 2, 58);   // +2..+58
+        csi_subcarrier_mask_set_range(bits, 70, 126); // -58..-2
+        break;
+    default:
+        break;
+    }
+}
+
+bool csi_subcarrier_mask_parse_ranges(const char *text, uint32_t bits[CSI_SUBCARRIER_MASK_WORDS])
+{
+    memset(bits, 0, CSI_SUBCARRIER_MASK_WORDS * sizeof(uint32_t));
+    const char *cursor = text;
+    bool any = false;
+
+    while (*cursor)
+    {
+        char *end;
+        long first = strtol(cursor, &end, 10);
+        long last = first;
+        if (end == cursor)
+        {
+            return false;
+        }
+        if (*end == '-')
+        {
+            cursor = end + 1;
+            last = strtol(cursor, &end, 10);
+            if (end == cursor)
+            {
+                return false;
+            }
+        }
+        if (first < 0 || last < first || last >= CSI_SUBCARRIER_MASK_POSITIONS)
+        {
+            return false;
+        }
+
+        csi_subcarrier_mask_set_range(bits, (int)first, (int)last);
+        any = true;
+
+        if (*end == ',')
+        {
+            end++;
+        }
+        else if (*end != '\0')
+        {
+            return false;
+        }
+        cursor = end;
+    }
+    return any;
+}
+
+void csi_subcarrier_mask_set(csi_subcarrier_mask_preset_t preset, const uint32_t custom_bits[CSI_SUBCARRIER_MASK_WORDS])
+{
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS];
+    if (preset == CSI_SUBCARRIER_MASK_CUSTOM && custom_bits)
+    {
+        memcpy(bits, custom_bits, sizeof(bits));
+    }
+    else
+    {
+        if (preset == CSI_SUBCARRIER_MASK_CUSTOM)
+        {
+            preset = CSI_SUBCARRIER_MASK_ALL;
+        }
+        csi_subcarrier_mask_preset_bits(preset, bits);
+    }
+
+    portENTER_CRITICAL(&g_csi_subcarrier_mask.update_lock);
+    atomic_fetch_add_explicit(&g_csi_subcarrier_mask.sequence, 1, memory_order_acq_rel);
+    atomic_thread_fence(memory_order_release);
+    memcpy(g_csi_subcarrier_mask.bits, bits, sizeof(bits));
+    g_csi_subcarrier_mask.preset = preset;
+    atomic_thread_fence(memory_order_release);
+    atomic_fetch_add_explicit(&g_csi_subcarrier_mask.sequence, 1, memory_order_release);
+    atomic_fetch_add_explicit(&g_csi_subcarrier_mask.generation, 1, memory_order_release);
+    portEXIT_CRITICAL(&g_csi_subcarrier_mask.update_lock);
+}
+
+csi_subcarrier_mask_preset_t csi_subcarrier_mask_get(uint32_t bits[CSI_SUBCARRIER_MASK_WORDS])
+{
+    unsigned int sequence;
+    csi_subcarrier_mask_preset_t preset;
+
+    do
+    {
+        sequence = atomic_load_explicit(&g_csi_subcarrier_mask.sequence, memory_order_acquire);
+        memcpy(bits, g_csi_subcarrier_mask.bits, CSI_SUBCARRIER_MASK_WORDS * sizeof(uint32_t));
+        preset = g_csi_subcarrier_mask.preset;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) || sequence != atomic_load_explicit(&g_csi_subcarrier_mask.sequence, memory_order_relaxed));
+
+    return preset;
+}
+
+int csi_subcarrier_mask_gather(const int8_t *iq, int pair_count, int max_pairs, int8_t *selected_iq)
+{
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS];
+    csi_subcarrier_mask_preset_t preset = csi_subcarrier_mask_get(bits);
+
+    if (preset == CSI_SUBCARRIER_MASK_ALL)
+    {
+        int kept = pair_count < max_pairs ? pair_count : max_pairs;
+        memcpy(selected_iq, iq, kept * 2);
+        return kept;
+    }
+
+    int kept = 0;
+    int last = pair_count < CSI_SUBCARRIER_MASK_POSITIONS ? pair_count : CSI_SUBCARRIER_MASK_POSITIONS;
+    for (int position = 0; position < last && kept < max_pairs; position++)
+    {
+        if (csi_subcarrier_mask_test(bits, position))
+        {
+            selected_iq[kept * 2] = iq[position * 2];
+            selected_iq[kept * 2 + 1] = iq[position * 2 + 1];
+            kept++;
+        }
+    }
+    return kept;
+}
+
+int csi_subcarrier_mask_gather_values(const int16_t *values, int count, int max_values, int16_t *selected)
+{
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS];
+    csi_subcarrier_mask_preset_t preset = csi_subcarrier_mask_get(bits);
+
+    if (preset == CSI_SUBCARRIER_MASK_ALL)
+    {
+        int kept = count < max_values ? count : max_values;
+        memcpy(selected, values, kept * sizeof(values[0]));
+        return kept;
+    }
+
+    int kept = 0;
+    int last = count < CSI_SUBCARRIER_MASK_POSITIONS ? count : CSI_SUBCARRIER_MASK_POSITIONS;
+    for (int position = 0; position < last && kept < max_values; position++)
+    {
+        if (csi_subcarrier_mask_test(bits, position))
+        {
+            selected[kept++] = values[position];
+        }
+    }
+    return kept;
+}
+
+void csi_subcarrier_mask_print()
+{
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS];
+    csi_subcarrier_mask_preset_t preset = csi_subcarrier_mask_get(bits);
+    int selected = 0;
+
+    printf("Subcarrier mask: %s [", csi_subcarrier_mask_preset_name(preset));
+    for (int position = 0; position < CSI_SUBCARRIER_MASK_POSITIONS; position++)
+    {
+        if (!csi_subcarrier_mask_test(bits, position))
+        {
+            continue;
+        }
+        int last = position;
+        while (last + 1 < CSI_SUBCARRIER_MASK_POSITIONS && csi_subcarrier_mask_test(bits, last + 1))
+        {
+            last++;
+        }
+        printf(selected ? ",%d" : "%d", position);
+        if (last > position)
+        {
+            printf("-%d", last);
+        }
+        selected += last - position + 1;
+        position = last;
+    }
+    printf("] %d positions\n", selected);
+}
@@ -0,0 +1,81 @@
+#ifndef CSI_SUBCARRIER_MASK_H
+#define CSI_SUBCARRIER_MASK_H
+
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Selects which I/Q pair positions of the captured CSI buffer the encoders
+// emit. Positions follow the buffer layout of the ESP32 HT-LTF: subcarriers
+// 0..31 then -32..-1 for HT20, 0..63 then -64..-1 for HT40. The presets drop
+// the DC and guard subcarriers, which carry no channel information:
+//
+//   ALL   every position (the capture as is)
+//   HT20  subcarriers -28..-1 and 1..28, 56 of 64
+//   HT40  subcarriers -58..-2 and 2..58, 114 of 128
+//
+// A custom mask is a list of position ranges. The encoder reads the mask once
+// per frame under the same sequence counter scheme as the MAC allowlist.
+
+#define CSI_SUBCARRIER_MASK_POSITIONS 128 // One HT40 HT-LTF
+#define CSI_SUBCARRIER_MASK_WORDS (CSI_SUBCARRIER_MASK_POSITIONS / 32)
+
+typedef enum
+{
+    CSI_SUBCARRIER_MASK_ALL = 0,
+    CSI_SUBCARRIER_MASK_HT20 = 1,
+    CSI_SUBCARRIER_MASK_HT40 = 2,
+    CSI_SUBCARRIER_MASK_CUSTOM = 3
+} csi_subcarrier_mask_preset_t;
+
+typedef struct
+{
+    uint32_t bits[CSI_SUBCARRIER_MASK_WORDS];
+    csi_subcarrier_mask_preset_t preset;
+    atomic_uint sequence; // Odd while an update is in progress
+    atomic_uint generation; // Bumped on every change, for state derived from the mask
+    portMUX_TYPE update_lock;
+} csi_subcarrier_mask_t;
+
+extern csi_subcarrier_mask_t g_csi_subcarrier_mask;
+
+const char *csi_subcarrier_mask_preset_name(csi_subcarrier_mask_preset_t preset);
+
+static inline bool csi_subcarrier_mask_test(const uint32_t bits[CSI_SUBCARRIER_MASK_WORDS], int position)
+{
+    return (bits[position / 32] >> (position % 32)) & 1;
+}
+
+// Bitmap of a preset; CUSTOM has no bitmap of its own and yields nothing
+void csi_subcarrier_mask_preset_bits(csi_subcarrier_mask_preset_t preset, uint32_t bits[CSI_SUBCARRIER_MASK_WORDS]);
+
+// Parse "<first>[-<last>][,...]" position ranges, e.g. "1-28,36-63"
+bool csi_subcarrier_mask_parse_ranges(const char *text, uint32_t bits[CSI_SUBCARRIER_MASK_WORDS]);
+
+void csi_subcarrier_mask_set(csi_subcarrier_mask_preset_t preset, const uint32_t custom_bits[CSI_SUBCARRIER_MASK_WORDS]);
+
+// Consistent copy of the current bitmap, returns the preset it came from
+csi_subcarrier_mask_preset_t csi_subcarrier_mask_get(uint32_t bits[CSI_SUBCARRIER_MASK_WORDS]);
+
+static inline unsigned int csi_subcarrier_mask_generation()
+{
+    return atomic_load_explicit(&g_csi_subcarrier_mask.generation, memory_order_acquire);
+}
+
+// Copy the selected I/Q pairs of a frame next to each other, at most
+// max_pairs of them. Positions past the mask (longer captures) are kept only
+// by the ALL preset. Returns the number of pairs copied.
+int csi_subcarrier_mask_gather(const int8_t *iq, int pair_count, int max_pairs, int8_t *selected_iq);
+
+// Same selection over one value per position
+int csi_subcarrier_mask_gather_values(const int16_t *values, int count, int max_values, int16_t *selected);
+
+// Print the mask as position ranges
+void csi_subcarrier_mask_print();
+
+#endif // CSI_SUBCARRIER_MASK_H
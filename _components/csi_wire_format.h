@@ -0,0 +1,160 @@
+#ifndef CSI_WIRE_FORMAT_H
+#define CSI_WIRE_FORMAT_H
+
+// Compact binary CSI record layout shared by the firmware encoders and the
+// host-side decoders. Only fixed-width types are used so the definitions can
+// be included outside of ESP-IDF. All multi-byte fields are little-endian.
+
+#include <stdint.h>
+
+#define CSI_WIRE_MAGIC   0x1DC5 // Serialized as 0xC5 0x1D, never valid ASCII
+#define CSI_WIRE_VERSION 4 // 2: compressed payloads, 3: stream counters, 4: capture layout
+
+typedef enum
+{
+    CSI_WIRE_FORMAT_TEXT = 0,
+    CSI_WIRE_FORMAT_BINARY = 1
+} csi_wire_format_t;
+
+// Payload encodings carried after the record header
+typedef enum
+{
+    CSI_WIRE_PAYLOAD_RAW_IQ = 1,       // int8 I/Q pairs exactly as captured
+    CSI_WIRE_PAYLOAD_AMPLITUDE_Q8 = 2, // uint16 amplitude, 8 fractional bits
+    CSI_WIRE_PAYLOAD_PHASE_Q15 = 3,    // int16 phase, full scale = +/- pi
+    CSI_WIRE_PAYLOAD_FEATURES = 4,     // csi_wire_features_t, then value_count csi_wire_subcarrier_stats_t
+    CSI_WIRE_PAYLOAD_PHASE_SANITIZED = 5 // int16 unwrapped phase minus its linear fit per field, pi / 1024 units
+} csi_wire_payload_type_t;
+
+// Record flag bits
+#define CSI_WIRE_FLAG_TIME_SYNCED 0x01
+#define CSI_WIRE_FLAG_COMPRESSED  0x02 // Payload is zigzag varints, see csi_compression.h
+#define CSI_WIRE_FLAG_DELTA       0x04 // Compressed against the station's record delta_sequence - 1
+
+// rx_flags bits of csi_wire_rx_ctrl_t
+#define CSI_WIRE_RX_SMOOTHING    0x01
+#define CSI_WIRE_RX_NOT_SOUNDING 0x02
+#define CSI_WIRE_RX_AGGREGATION  0x04
+#define CSI_WIRE_RX_FEC_CODING   0x08
+#define CSI_WIRE_RX_SGI          0x10
+
+// Packed copy of the wifi_pkt_rx_ctrl_t fields the text format reports.
+// The bitfield struct itself differs per target, so fields are re-packed.
+typedef struct __attribute__((packed))
+{
+    int8_t rssi;
+    uint8_t rate;
+    uint8_t sig_mode;
+    uint8_t mcs;
+    uint8_t cwb;
+    uint8_t stbc;
+    uint8_t rx_flags;
+    int8_t noise_floor;
+    uint8_t ampdu_cnt;
+    uint8_t channel;
+    uint8_t secondary_channel;
+    uint8_t ant;
+    uint32_t local_timestamp;
+    uint16_t sig_len;
+    uint8_t rx_state;
+    uint8_t reserved;
+} csi_wire_rx_ctrl_t;
+
+// Per-station frame number and drop counters, see csi_streams.h. The
+// counters are the low 16 bits of the device totals; hosts take deltas
+// modulo 65536 between consecutive records of a station.
+typedef struct __attribute__((packed))
+{
+    uint32_t frame_sequence; // Frame number of the station, 1 for its first frame, 0 if untracked
+    uint16_t alloc_drops;    // No free frame slot
+    uint16_t queue_drops;    // CSI queue overflow
+    uint16_t decimated;      // Overload decimation
+    uint16_t ring_drops;     // Record did not fit a sink ring
+} csi_wire_stream_t;
+
+// Training fields the payload values come from, in this order (see
+// csi_capture_profile.h). Counts are I/Q pairs after the subcarrier mask,
+// so raw payloads hold two values per pair and the others one. The counts
+// are zero for feature records.
+typedef struct __attribute__((packed))
+{
+    uint8_t capture_profile; // csi_capture_profile_t the frame was captured under
+    uint8_t reserved;
+    uint16_t lltf_pairs;
+    uint16_t htltf_pairs;
+    uint16_t stbc_htltf_pairs;
+} csi_wire_layout_t;
+
+// Record header, followed by value_count payload values (or their
+// compressed form, record_length still gives the size)
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t payload_type;
+    uint16_t record_length; // Header plus payload, in bytes
+    uint8_t mac[6];
+    uint8_t flags;
+    uint8_t delta_sequence; // Per-station counter of compressed records, 0 otherwise
+    int64_t timestamp_us; // Wall-clock microseconds since the epoch
+    csi_wire_rx_ctrl_t rx_ctrl;
+    uint16_t csi_length; // Length of the captured CSI buffer, in bytes
+    uint16_t value_count;
+    csi_wire_stream_t stream; // Version 3 and later
+    csi_wire_layout_t layout; // Version 4 and later
+} csi_wire_record_header_t;
+
+// Feature record summary over a station's sliding window. rx_ctrl in the
+// record header is that of the frame which completed the report.
+typedef struct __attribute__((packed))
+{
+    uint16_t frame_count;   // Frames since the station's previous feature record
+    uint16_t window_frames; // Frames the statistics are taken over
+    int8_t rssi_mean;       // Over frame_count frames
+    uint8_t reserved;
+    float energy;       // Mean squared amplitude, IEEE 754 single precision
+    float motion_score; // Mean per-subcarrier variance / mean^2
+} csi_wire_features_t;
+
+// Per-subcarrier window statistics, amplitudes with 8 fractional bits
+typedef struct __attribute__((packed))
+{
+    uint16_t mean_q8;
+    uint16_t stddev_q8;
+} csi_wire_subcarrier_stats_t;
+
+_Static_assert(sizeof(csi_wire_rx_ctrl_t) == 20, "csi_wire_rx_ctrl_t layout changed");
+_Static_assert(sizeof(csi_wire_layout_t) == 8, "csi_wire_layout_t layout changed");
+_Static_assert(sizeof(csi_wire_stream_t) == 12, "csi_wire_stream_t layout changed");
+_Static_assert(sizeof(csi_wire_features_t) == 14, "csi_wire_features_t layout changed");
+_Static_assert(sizeof(csi_wire_record_header_t) == 66, "csi_wire_record_header_t layout changed");
+
+// SD card capture files: one CSI_CAPTURE_HEADER_SIZE byte sector holding
+// csi_capture_file_header_t (zero padded), then binary records back to back.
+// Writes are whole sectors, so the data area may contain runs of zero bytes
+// between records; readers skip zero bytes until the next record magic.
+#define CSI_CAPTURE_MAGIC "CSI_CAP"
+#define CSI_CAPTURE_VERSION 1
+#define CSI_CAPTURE_HEADER_SIZE 512
+
+#define CSI_CAPTURE_FLAG_CLOSED 0x01 // Counters are final, the file was closed cleanly
+
+typedef struct __attribute__((packed))
+{
+    char magic[8]; // CSI_CAPTURE_MAGIC, NUL terminated
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t file_index;
+    uint32_t wire_version; // CSI_WIRE_VERSION of the records
+    uint32_t flags;
+    int64_t created_us;         // Wall-clock time the file was opened
+    int64_t first_timestamp_us; // Oldest record timestamp, 0 if empty
+    int64_t last_timestamp_us;  // Newest record timestamp
+    uint64_t data_bytes;        // Bytes after the header, including padding
+    uint32_t record_count;
+    uint32_t reserved;
+} csi_capture_file_header_t;
+
+_Static_assert(sizeof(csi_capture_file_header_t) == 64, "csi_capture_file_header_t layout changed");
+
+#endif // CSI_WIRE_FORMAT_H
@@ -0,0 +1,96 @@
+#include "frame_batcher.h"
+
+esp_err_t frame_batcher_init(frame_batcher_t *batcher, size_t budget_bytes, uint32_t deadline_ms,
+                             frame_batch_flush_cb_t flush_callback, void *flush_context)
+{
+    if (!batcher || budget_bytes == 0 || !flush_callback)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(batcher, 0, sizeof(*batcher));
+    batcher->buffer = malloc(budget_bytes);
+    if (!batcher->buffer)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    batcher->budget_bytes = budget_bytes;
+    batcher->deadline_us = (int64_t)deadline_ms * 1000;
+    batcher->flush_callback = flush_callback;
+    batcher->flush_context = flush_context;
+    return ESP_OK;
+}
+
+esp_err_t frame_batcher_flush(frame_batcher_t *batcher)
+{
+    if (batcher->used_bytes == 0)
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t result = batcher->flush_callback(batcher->buffer, batcher->used_bytes, batcher->flush_context);
+    batcher->used_bytes = 0;
+    batcher->frame_count = 0;
+    return result;
+}
+
+esp_err_t frame_batcher_append(frame_batcher_t *batcher, const void *frame_data, size_t frame_length)
+{
+    esp_err_t result = ESP_OK;
+
+    if (batcher->used_bytes + frame_length > batcher->budget_bytes)
+    {
+        result = frame_batcher_flush(batcher);
+    }
+
+    if (frame_length > batcher->budget_bytes)
+    {
+        esp_err_t oversize_result = batcher->flush_callback(frame_data, frame_length, batcher->flush_context);
+        return (result != ESP_OK) ? result : oversize_result;
+    }
+
+    if (batcher->used_bytes == 0)
+    {
+        batcher->oldest_frame_time_us = esp_timer_get_time();
+    }
+
+    memcpy(batcher->buffer + batcher->used_bytes, frame_data, frame_length);
+    batcher->used_bytes += frame_length;
+    batcher->frame_count++;
+
+    if (batcher->deadline_us == 0)
+    {
+        esp_err_t flush_result = frame_batcher_flush(batcher);
+        return (result != ESP_OK) ? result : flush_result;
+    }
+
+    return result;
+}
+
+int64_t frame_batcher_time_to_deadline_us(const frame_batcher_t *batcher)
+{
+    if (batcher->used_bytes == 0)
+    {
+        return -1;
+    }
+
+    int64_t remaining = batcher->oldest_frame_time_us + batcher->deadline_us - esp_timer_get_time();
+    return remaining > 0 ? remaining : 0;
+}
+
+esp_err_t frame_batcher_poll(frame_batcher_t *batcher)
+{
+    if (frame_batcher_time_to_deadline_us(batcher) == 0)
+    {
+        return frame_batcher_flush(batcher);
+    }
+    return ESP_OK;
+}
+
+void frame_batcher_deinit(frame_batcher_t *batcher)
+{
+    free(batcher->buffer);
+    batcher->buffer = NULL;
+    batcher->used_bytes = 0;
+}
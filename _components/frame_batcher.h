@@ -0,0 +1,49 @@
+#ifndef FRAME_BATCHER_H
+#define FRAME_BATCHER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+
+// Packs several self-delimiting encoded frames (newline terminated text lines
+// or length-prefixed binary records) into one datagram. A batch is handed to
+// the flush callback once the next frame would exceed the byte budget or the
+// oldest frame in it has waited longer than the deadline.
+
+typedef esp_err_t (*frame_batch_flush_cb_t)(const void *batch_data, size_t batch_length, void *context);
+
+typedef struct
+{
+    uint8_t *buffer;
+    size_t budget_bytes;
+    size_t used_bytes;
+    uint32_t frame_count;
+    int64_t deadline_us;
+    int64_t oldest_frame_time_us;
+    frame_batch_flush_cb_t flush_callback;
+    void *flush_context;
+} frame_batcher_t;
+
+// Allocate the batch buffer. A deadline of 0 sends every frame on its own.
+esp_err_t frame_batcher_init(frame_batcher_t *batcher, size_t budget_bytes, uint32_t deadline_ms,
+                             frame_batch_flush_cb_t flush_callback, void *flush_context);
+
+// Hand the pending frames to the flush callback and start a new batch
+esp_err_t frame_batcher_flush(frame_batcher_t *batcher);
+
+// Append one encoded frame, flushing first if it would not fit in the budget.
+// Frames larger than the whole budget are sent on their own.
+esp_err_t frame_batcher_append(frame_batcher_t *batcher, const void *frame_data, size_t frame_length);
+
+// Microseconds left before the pending batch must be sent, -1 if it is empty
+int64_t frame_batcher_time_to_deadline_us(const frame_batcher_t *batcher);
+
+// Flush the pending batch if its deadline has passed
+esp_err_t frame_batcher_poll(frame_batcher_t *batcher);
+
+void frame_batcher_deinit(frame_batcher_t *batcher);
+
+#endif // FRAME_BATCHER_H
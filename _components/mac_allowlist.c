@@ -0,0 +1,223 @@
+#include "mac_allowlist.h"
+
+static mac_allowlist_t g_mac_allowlist = {.update_lock = portMUX_INITIALIZER_UNLOCKED};
+
+bool parse_mac_address(const char *text, uint8_t mac[6])
+{
+    unsigned int bytes[6];
+    if (!text || sscanf(text, "%2x:%2x:%2x:%2x:%2x:%2x", &bytes[0], &bytes[1], &bytes[2],
+                        &bytes[3], &bytes[4], &bytes[5]) != 6)
+    {
+        return false;
+    }
+
+    for (int byte = 0; byte < 6; byte++)
+    {
+        mac[byte] = (uint8_t)bytes[byte];
+    }
+    return true;
+}
+
+bool mac_allowlist_contains(const uint8_t mac[6])
+{
+    uint64_t key = mac_allowlist_key(mac);
+    unsigned int sequence;
+    bool found;
+
+    do
+    {
+        sequence = atomic_load_explicit(&g_mac_allowlist.sequence, memory_order_acquire);
+        found = false;
+
+        uint32_t slot = mac_allowlist_slot(key);
+        for (int probe = 0; probe < MAC_ALLOWLIST_CAPACITY; probe++)
+        {
+            uint64_t stored = g_mac_allowlist.keys[slot];
+            if (stored == key)
+            {
+                found = true;
+                break;
+            }
+            if (stored == MAC_ALLOWLIST_EMPTY_KEY)
+            {
+                break;
+            }
+            slot = (slot + 1) & (MAC_ALLOWLIST_CAPACITY - 1);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1) || sequence != atomic_load_explicit(&g_mac_allowlist.sequence, memory_order_relaxed));
+
+    return found;
+}
+
+// Updates never get preempted, so a reader on the same core never sees them
+// half done and one on the other core only spins for a few microseconds
+static void mac_allowlist_begin_update()
+{
+    portENTER_CRITICAL(&g_mac_allowlist.update_lock);
+    atomic_fetch_add_explicit(&g_mac_allowlist.sequence, 1, memory_order_acq_rel);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void mac_allowlist_end_update()
+{
+    atomic_thread_fence(memory_order_release);
+    atomic_fetch_add_explicit(&g_mac_allowlist.sequence, 1, memory_order_acq_rel);
+    portEXIT_CRITICAL(&g_mac_allowlist.update_lock);
+}
+
+// Rebuild the table from a compact key list
+static void mac_allowlist_rebuild(const uint64_t *keys, uint16_t key_count)
+{
+    memset(g_mac_allowlist.keys, 0, sizeof(g_mac_allowlist.keys));
+    g_mac_allowlist.entry_count = 0;
+
+    for (uint16_t index = 0; index < key_count; index++)
+    {
+        uint32_t slot = mac_allowlist_slot(keys[index]);
+        while (g_mac_allowlist.keys[slot] != MAC_ALLOWLIST_EMPTY_KEY && g_mac_allowlist.keys[slot] != keys[index])
+        {
+            slot = (slot + 1) & (MAC_ALLOWLIST_CAPACITY - 1);
+        }
+        if (g_mac_allowlist.keys[slot] == MAC_ALLOWLIST_EMPTY_KEY)
+        {
+            g_mac_allowlist.keys[slot] = keys[index];
+            g_mac_allowlist.entry_count++;
+        }
+    }
+}
+
+uint16_t mac_allowlist_export(uint64_t *keys, uint16_t max_keys)
+{
+    uint16_t exported = 0;
+    for (int slot = 0; slot < MAC_ALLOWLIST_CAPACITY && exported < max_keys; slot++)
+    {
+        if (g_mac_allowlist.keys[slot] != MAC_ALLOWLIST_EMPTY_KEY)
+        {
+            keys[exported++] = g_mac_allowlist.keys[slot];
+        }
+    }
+    return exported;
+}
+
+esp_err_t mac_allowlist_add(const uint8_t mac[6])
+{
+    if (mac_allowlist_contains(mac))
+    {
+        return ESP_OK;
+    }
+    if (g_mac_allowlist.entry_count >= MAC_ALLOWLIST_MAX_ENTRIES)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint64_t key = mac_allowlist_key(mac);
+    uint32_t slot = mac_allowlist_slot(key);
+    while (g_mac_allowlist.keys[slot] != MAC_ALLOWLIST_EMPTY_KEY)
+    {
+        slot = (slot + 1) & (MAC_ALLOWLIST_CAPACITY - 1);
+    }
+
+    mac_allowlist_begin_update();
+    g_mac_allowlist.keys[slot] = key;
+    g_mac_allowlist.entry_count++;
+    mac_allowlist_end_update();
+    return ESP_OK;
+}
+
+esp_err_t mac_allowlist_remove(const uint8_t mac[6])
+{
+    uint64_t key = mac_allowlist_key(mac);
+    uint64_t keys[MAC_ALLOWLIST_MAX_ENTRIES];
+    uint16_t key_count = mac_allowlist_export(keys, MAC_ALLOWLIST_MAX_ENTRIES);
+    uint16_t kept = 0;
+
+    for (uint16_t index = 0; index < key_count; index++)
+    {
+        if (keys[index] != key)
+        {
+            keys[kept++] = keys[index];
+        }
+    }
+
+    if (kept == key_count)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    mac_allowlist_begin_update();
+    mac_allowlist_rebuild(keys, kept);
+    mac_allowlist_end_update();
+    return ESP_OK;
+}
+
+void mac_allowlist_clear()
+{
+    mac_allowlist_begin_update();
+    mac_allowlist_rebuild(NULL, 0);
+    mac_allowlist_end_update();
+}
+
+uint16_t mac_allowlist_count()
+{
+    return g_mac_allowlist.entry_count;
+}
+
+esp_err_t mac_allowlist_save()
+{
+    uint64_t keys[MAC_ALLOWLIST_MAX_ENTRIES];
+    uint8_t packed[1 + MAC_ALLOWLIST_MAX_ENTRIES * 6];
+    uint16_t key_count = mac_allowlist_export(keys, MAC_ALLOWLIST_MAX_ENTRIES);
+
+    packed[0] = (uint8_t)key_count;
+    for (uint16_t index = 0; index < key_count; index++)
+    {
+        mac_allowlist_key_to_mac(keys[index], &packed[1 + index * 6]);
+    }
+
+    return storage_save_blob(MAC_ALLOWLIST_NVS_NAMESPACE, MAC_ALLOWLIST_NVS_KEY, packed, 1 + key_count * 6);
+}
+
+esp_err_t mac_allowlist_load()
+{
+    uint8_t packed[1 + MAC_ALLOWLIST_MAX_ENTRIES * 6];
+    size_t packed_length = sizeof(packed);
+
+    esp_err_t result = storage_load_blob(MAC_ALLOWLIST_NVS_NAMESPACE, MAC_ALLOWLIST_NVS_KEY, packed, &packed_length);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    uint16_t key_count = (packed_length > 0) ? packed[0] : 0;
+    if (packed_length < 1 || key_count > MAC_ALLOWLIST_MAX_ENTRIES || packed_length != 1 + key_count * 6u)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint64_t keys[MAC_ALLOWLIST_MAX_ENTRIES];
+    for (uint16_t index = 0; index < key_count; index++)
+    {
+        keys[index] = mac_allowlist_key(&packed[1 + index * 6]);
+    }
+
+    mac_allowlist_begin_update();
+    mac_allowlist_rebuild(keys, key_count);
+    mac_allowlist_end_update();
+    return ESP_OK;
+}
+
+void mac_allowlist_print()
+{
+    uint64_t keys[MAC_ALLOWLIST_MAX_ENTRIES];
+    uint16_t key_count = mac_allowlist_export(keys, MAC_ALLOWLIST_MAX_ENTRIES);
+
+    printf("Allowlist (%u/%u entries):\n", key_count, MAC_ALLOWLIST_MAX_ENTRIES);
+    for (uint16_t index = 0; index < key_count; index++)
+    {
+        uint8_t mac[6];
+        mac_allowlist_key_to_mac(keys[index], mac);
+        printf("  %02x:%02x:%02x:%02x:%02x:%02x\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+}
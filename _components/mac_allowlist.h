@@ -0,0 +1,85 @@
+#ifndef MAC_ALLOWLIST_H
+#define MAC_ALLOWLIST_H
+
+#include "storage_manager.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Set of allowed station MACs, stored as packed 48-bit keys in an
+// open-addressing hash table with linear probing. Lookups run in the WiFi
+// callback without locks. The rare updates from the command processor run
+// inside a critical section and are published through a sequence counter;
+// a reader on the other core simply retries if an update raced with it.
+
+#define MAC_ALLOWLIST_CAPACITY 128 // Power of two, at most half of it is used
+#define MAC_ALLOWLIST_MAX_ENTRIES (MAC_ALLOWLIST_CAPACITY / 2)
+#define MAC_ALLOWLIST_EMPTY_KEY 0ULL
+
+#define MAC_ALLOWLIST_NVS_NAMESPACE "csi_cfg"
+#define MAC_ALLOWLIST_NVS_KEY "allowlist"
+
+typedef struct
+{
+    uint64_t keys[MAC_ALLOWLIST_CAPACITY];
+    uint16_t entry_count;
+    atomic_uint sequence; // Odd while an update is in progress
+    portMUX_TYPE update_lock;
+} mac_allowlist_t;
+
+// Pack a 6-byte MAC into a key. Bit 48 is always set so no MAC maps to the
+// empty marker.
+static inline uint64_t mac_allowlist_key(const uint8_t mac[6])
+{
+    return (1ULL << 48) |
+           ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+           ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5];
+}
+
+static inline void mac_allowlist_key_to_mac(uint64_t key, uint8_t mac[6])
+{
+    for (int byte = 0; byte < 6; byte++)
+    {
+        mac[byte] = (uint8_t)(key >> (40 - 8 * byte));
+    }
+}
+
+static inline uint32_t mac_allowlist_slot(uint64_t key)
+{
+    // Fibonacci hashing of the 48-bit key
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 57) & (MAC_ALLOWLIST_CAPACITY - 1);
+}
+
+// Parse "aa:bb:cc:dd:ee:ff" (any case)
+bool parse_mac_address(const char *text, uint8_t mac[6]);
+
+// Hot-path membership test, safe to call from the WiFi callback
+bool mac_allowlist_contains(const uint8_t mac[6]);
+
+// Copy the current entries into a compact array, returns the entry count
+uint16_t mac_allowlist_export(uint64_t *keys, uint16_t max_keys);
+
+esp_err_t mac_allowlist_add(const uint8_t mac[6]);
+
+// Removal rebuilds the table so probe chains never need tombstones
+esp_err_t mac_allowlist_remove(const uint8_t mac[6]);
+
+void mac_allowlist_clear();
+
+uint16_t mac_allowlist_count();
+
+// Persist the entries as an entry count followed by packed 6-byte MACs, so an
+// emptied list is still distinguishable from one that was never saved
+esp_err_t mac_allowlist_save();
+
+// Load persisted entries, replacing the current set. Returns
+// ESP_ERR_NVS_NOT_FOUND if nothing has been saved yet.
+esp_err_t mac_allowlist_load();
+
+// Print the allowlist entries
+void mac_allowlist_print();
+
+#endif // MAC_ALLOWLIST_H
@@ -0,0 +1,127 @@
+#include "pipeline_stats.h"
+
+pipeline_stats_t g_pipeline_stats = {.encode_cycles_min = UINT32_MAX};
+
+void pipeline_stats_register_task(const char *name, TaskHandle_t handle)
+{
+    if (!handle || g_pipeline_stats.task_count >= PIPELINE_STATS_MAX_TASKS)
+    {
+        return;
+    }
+
+    g_pipeline_stats.tasks[g_pipeline_stats.task_count].name = name;
+    g_pipeline_stats.tasks[g_pipeline_stats.task_count].handle = handle;
+    g_pipeline_stats.task_count++;
+}
+
+static uint32_t pipeline_stats_encode_cycles_average()
+{
+    uint32_t encoded = g_pipeline_stats.frames_encoded;
+    return encoded ? (uint32_t)(g_pipeline_stats.encode_cycles_total / encoded) : 0;
+}
+
+// Smallest free stack (in bytes) seen for a registered task
+static uint32_t pipeline_stats_stack_free(uint8_t task_index)
+{
+    return (uint32_t)uxTaskGetStackHighWaterMark(g_pipeline_stats.tasks[task_index].handle) * sizeof(StackType_t);
+}
+
+size_t pipeline_stats_format_telemetry(char *buffer, size_t buffer_size)
+{
+    uint32_t cycles_min = g_pipeline_stats.frames_encoded ? g_pipeline_stats.encode_cycles_min : 0;
+
+    int written = snprintf(buffer, buffer_size,
+                           "%s,%lld,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%llu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu"
+                           ",%lu,%lu,%lu,%lu,%ld,%lu,%ld",
+                           PIPELINE_STATS_TELEMETRY_PREFIX, (long long)esp_timer_get_time(),
+                           (unsigned long)g_pipeline_stats.frames_seen,
+                           (unsigned long)g_pipeline_stats.frames_filtered,
+                           (unsigned long)g_pipeline_stats.allocation_failures,
+                           (unsigned long)g_pipeline_stats.queue_drops,
+                           (unsigned long)g_pipeline_stats.queue_high_water,
+                           (unsigned long)g_pipeline_stats.frames_encoded,
+                           (unsigned long)g_pipeline_stats.ring_drops,
+                           (unsigned long)cycles_min,
+                           (unsigned long)pipeline_stats_encode_cycles_average(),
+                           (unsigned long)g_pipeline_stats.encode_cycles_max,
+                           (unsigned long)g_pipeline_stats.datagrams_sent,
+                           (unsigned long)g_pipeline_stats.send_failures,
+                           (unsigned long long)g_pipeline_stats.bytes_sent,
+                           (unsigned long)g_pipeline_stats.frames_decimated,
+                           (unsigned long)g_pipeline_stats.stimulus_rate_hz,
+                           (unsigned long)g_pipeline_stats.stimulus_targets,
+                           (unsigned long)g_pipeline_stats.stimulus_sent_hz,
+                           (unsigned long)g_pipeline_stats.stimulus_reply_hz,
+                           (unsigned long)g_pipeline_stats.stimulus_lateness_avg_us,
+                           (unsigned long)g_pipeline_stats.stimulus_lateness_max_us,
+                           (unsigned long)g_pipeline_stats.stimulus_missed_ticks,
+                           (unsigned long)g_pipeline_stats.replay_rate_hz,
+                           (unsigned long)g_pipeline_stats.replay_stations,
+                           (unsigned long)g_pipeline_stats.replay_sent_hz,
+                           (unsigned long)g_pipeline_stats.replay_skipped,
+                           (long)g_pipeline_stats.time_offset_us,
+                           (unsigned long)g_pipeline_stats.time_rtt_us,
+                           (long)g_pipeline_stats.time_drift_ppb);
+
+    for (uint8_t task_index = 0; task_index < g_pipeline_stats.task_count; task_index++)
+    {
+        if (written < 0 || (size_t)written >= buffer_size)
+        {
+            break;
+        }
+        written += snprintf(buffer + written, buffer_size - written, ",%s=%lu",
+                            g_pipeline_stats.tasks[task_index].name,
+                            (unsigned long)pipeline_stats_stack_free(task_index));
+    }
+
+    if (written < 0 || (size_t)written + 1 >= buffer_size)
+    {
+        return 0;
+    }
+
+    buffer[written++] = '\n';
+    buffer[written] = '\0';
+    return (size_t)written;
+}
+
+void pipeline_stats_print()
+{
+    uint32_t cycles_min = g_pipeline_stats.frames_encoded ? g_pipeline_stats.encode_cycles_min : 0;
+
+    printf("--- CSI Pipeline ---\n");
+    printf("Frames Seen / Filtered: %lu / %lu\n",
+           (unsigned long)g_pipeline_stats.frames_seen, (unsigned long)g_pipeline_stats.frames_filtered);
+    printf("Allocation Failures: %lu\n", (unsigned long)g_pipeline_stats.allocation_failures);
+    printf("Queue Drops: %lu (high-water %lu)\n",
+           (unsigned long)g_pipeline_stats.queue_drops, (unsigned long)g_pipeline_stats.queue_high_water);
+    printf("Frames Decimated: %lu\n", (unsigned long)g_pipeline_stats.frames_decimated);
+    printf("Frames Encoded: %lu (ring drops %lu)\n",
+           (unsigned long)g_pipeline_stats.frames_encoded, (unsigned long)g_pipeline_stats.ring_drops);
+    printf("Encode Cycles min/avg/max: %lu / %lu / %lu\n", (unsigned long)cycles_min,
+           (unsigned long)pipeline_stats_encode_cycles_average(), (unsigned long)g_pipeline_stats.encode_cycles_max);
+    printf("Datagrams Sent: %lu (%llu bytes, %lu failures)\n", (unsigned long)g_pipeline_stats.datagrams_sent,
+           (unsigned long long)g_pipeline_stats.bytes_sent, (unsigned long)g_pipeline_stats.send_failures);
+    if (g_pipeline_stats.stimulus_rate_hz)
+    {
+        printf("Stimulus: %lu Hz requested, %lu sent / %lu replies per station (%lu stations)\n",
+               (unsigned long)g_pipeline_stats.stimulus_rate_hz, (unsigned long)g_pipeline_stats.stimulus_sent_hz,
+               (unsigned long)g_pipeline_stats.stimulus_reply_hz, (unsigned long)g_pipeline_stats.stimulus_targets);
+    }
+    if (g_pipeline_stats.replay_stations)
+    {
+        printf("Replay: %lu frames/s injected to %lu stations (%lu skipped)\n",
+               (unsigned long)g_pipeline_stats.replay_sent_hz, (unsigned long)g_pipeline_stats.replay_stations,
+               (unsigned long)g_pipeline_stats.replay_skipped);
+    }
+    if (g_pipeline_stats.time_rtt_us)
+    {
+        printf("Time Sync: offset %ld us, round trip %lu us, drift %ld ppb\n", (long)g_pipeline_stats.time_offset_us,
+               (unsigned long)g_pipeline_stats.time_rtt_us, (long)g_pipeline_stats.time_drift_ppb);
+    }
+
+    for (uint8_t task_index = 0; task_index < g_pipeline_stats.task_count; task_index++)
+    {
+        printf("Stack Free %s: %lu bytes\n", g_pipeline_stats.tasks[task_index].name,
+               (unsigned long)pipeline_stats_stack_free(task_index));
+    }
+}
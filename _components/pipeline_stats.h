@@ -0,0 +1,121 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+
+// Counters for each stage of the CSI pipeline: WiFi callback -> queue ->
+// encoder -> ring -> transmitter -> socket. Every counter has exactly one
+// writer (the callback, the encoder task or the transmit task), so plain
+// volatile increments are enough; readers may see a slightly stale value.
+
+#define PIPELINE_STATS_MAX_TASKS 8
+#define PIPELINE_STATS_TELEMETRY_PREFIX "CSI_STATS"
+
+typedef struct
+{
+    const char *name;
+    TaskHandle_t handle;
+} pipeline_stats_task_t;
+
+typedef struct
+{
+    // WiFi callback
+    volatile uint32_t frames_seen;
+    volatile uint32_t frames_filtered;
+    volatile uint32_t allocation_failures;
+    volatile uint32_t queue_drops;
+    volatile uint32_t frames_decimated;
+
+    // Encoder task
+    volatile uint32_t queue_high_water;
+    volatile uint32_t frames_encoded;
+    volatile uint32_t ring_drops;
+    volatile uint32_t encode_cycles_min;
+    volatile uint32_t encode_cycles_max;
+    volatile uint64_t encode_cycles_total;
+
+    // Transmit task
+    volatile uint32_t datagrams_sent;
+    volatile uint32_t send_failures;
+    volatile uint64_t bytes_sent;
+
+    // Stimulus task, refreshed once per report window (see csi_stimulus.h)
+    volatile uint32_t stimulus_rate_hz; // Requested per station
+    volatile uint32_t stimulus_targets;
+    volatile uint32_t stimulus_sent_hz;  // Achieved per station
+    volatile uint32_t stimulus_reply_hz; // Echo replies, i.e. stimulated frames, per station
+    volatile uint32_t stimulus_lateness_avg_us;
+    volatile uint32_t stimulus_lateness_max_us;
+    volatile uint32_t stimulus_missed_ticks;
+
+    // Replay task, refreshed once per report window (see csi_replay.h)
+    volatile uint32_t replay_rate_hz; // Requested per station, 0 with stations set = as fast as possible
+    volatile uint32_t replay_stations;
+    volatile uint32_t replay_sent_hz; // Injected frames per second, all stations
+    volatile uint32_t replay_skipped;
+
+    // Time sync task, refreshed after every good round (see time_sync.h)
+    volatile int32_t time_offset_us; // Last correction, host clock - AP clock
+    volatile uint32_t time_rtt_us;
+    volatile int32_t time_drift_ppb;
+
+    pipeline_stats_task_t tasks[PIPELINE_STATS_MAX_TASKS];
+    uint8_t task_count;
+} pipeline_stats_t;
+
+extern pipeline_stats_t g_pipeline_stats;
+
+// Track a task's stack high-water mark in the status output and telemetry
+void pipeline_stats_register_task(const char *name, TaskHandle_t handle);
+
+static inline void pipeline_stats_record_queue_depth(uint32_t depth)
+{
+    if (depth > g_pipeline_stats.queue_high_water)
+    {
+        g_pipeline_stats.queue_high_water = depth;
+    }
+}
+
+static inline void pipeline_stats_record_encode(esp_cpu_cycle_count_t start_cycles)
+{
+    uint32_t cycles = (uint32_t)(esp_cpu_get_cycle_count() - start_cycles);
+
+    if (cycles < g_pipeline_stats.encode_cycles_min)
+    {
+        g_pipeline_stats.encode_cycles_min = cycles;
+    }
+    if (cycles > g_pipeline_stats.encode_cycles_max)
+    {
+        g_pipeline_stats.encode_cycles_max = cycles;
+    }
+    g_pipeline_stats.encode_cycles_total += cycles;
+    g_pipeline_stats.frames_encoded++;
+}
+
+static inline void pipeline_stats_record_send(int bytes_sent)
+{
+    if (bytes_sent < 0)
+    {
+        g_pipeline_stats.send_failures++;
+        return;
+    }
+    g_pipeline_stats.datagrams_sent++;
+    g_pipeline_stats.bytes_sent += (uint32_t)bytes_sent;
+}
+
+// One-line telemetry record:
+// CSI_STATS,<uptime_us>,seen,filtered,alloc_fail,queue_drops,queue_hwm,encoded,ring_drops,
+// cyc_min,cyc_avg,cyc_max,datagrams,send_fail,bytes_sent,decimated,stim_rate_hz,stim_targets,
+// stim_sent_hz,stim_reply_hz,stim_late_avg_us,stim_late_max_us,stim_missed,replay_rate_hz,
+// replay_stations,replay_sent_hz,replay_skipped,time_offset_us,time_rtt_us,time_drift_ppb
+// [,task=stack_free...]\n
+size_t pipeline_stats_format_telemetry(char *buffer, size_t buffer_size);
+
+void pipeline_stats_print();
+
+#endif // PIPELINE_STATS_H
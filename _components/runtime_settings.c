@@ -0,0 +1,29 @@
+#include "runtime_settings.h"
+
+runtime_settings_t g_runtime_settings = {.version = RUNTIME_SETTINGS_VERSION};
+
+esp_err_t runtime_settings_load()
+{
+    runtime_settings_t stored;
+    size_t stored_length = sizeof(stored);
+
+    esp_err_t result = storage_load_blob(RUNTIME_SETTINGS_NVS_NAMESPACE, RUNTIME_SETTINGS_NVS_KEY, &stored, &stored_length);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+    if (stored_length != sizeof(stored) || stored.version != RUNTIME_SETTINGS_VERSION)
+    {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    g_runtime_settings = stored;
+    return ESP_OK;
+}
+
+esp_err_t runtime_settings_save()
+{
+    g_runtime_settings.version = RUNTIME_SETTINGS_VERSION;
+    return storage_save_blob(RUNTIME_SETTINGS_NVS_NAMESPACE, RUNTIME_SETTINGS_NVS_KEY,
+                             &g_runtime_settings, sizeof(g_runtime_settings));
+}
@@ -0,0 +1,44 @@
+#ifndef RUNTIME_SETTINGS_H
+#define RUNTIME_SETTINGS_H
+
+#include "storage_manager.h"
+#include <stdint.h>
+#include <string.h>
+
+// Capture settings that can be changed over the command interfaces and
+// survive a reboot. The application fills g_runtime_settings with its build
+// defaults, then runtime_settings_load() replaces them with whatever was
+// saved. Every command that changes a value saves the whole set.
+
+#define RUNTIME_SETTINGS_VERSION 6
+#define RUNTIME_SETTINGS_NVS_NAMESPACE "csi_cfg"
+#define RUNTIME_SETTINGS_NVS_KEY "settings"
+
+typedef struct __attribute__((packed))
+{
+    uint8_t version;
+    uint8_t csi_mode;        // csi_processing_mode_t
+    uint8_t overload_policy; // csi_overload_policy_t
+    uint8_t wifi_channel;
+    uint16_t queue_depth; // Applied at the next boot
+    uint16_t batch_max_bytes;
+    uint16_t batch_deadline_ms;
+    uint8_t subcarrier_mask_preset; // csi_subcarrier_mask_preset_t
+    uint8_t compression;
+    uint8_t subcarrier_mask[16]; // Custom mask bitmap, copied in and out with memcpy
+    uint16_t feature_interval_ms;
+    uint8_t capture_profile; // csi_capture_profile_t
+    uint16_t stimulus_rate_hz; // Per station, 0 = traffic generator off
+    uint8_t phase_sanitize; // PHASE mode emits unwrapped, detrended phase
+} runtime_settings_t;
+
+extern runtime_settings_t g_runtime_settings;
+
+// Replace the current settings with the saved ones. Returns
+// ESP_ERR_NVS_NOT_FOUND if nothing was saved, ESP_ERR_INVALID_VERSION if the
+// saved set is from another firmware layout; the defaults stay in place.
+esp_err_t runtime_settings_load();
+
+esp_err_t runtime_settings_save();
+
+#endif // RUNTIME_SETTINGS_H
@@ -0,0 +1,378 @@
+#include "sd_capture.h"
+
+static const char *SD_TAG = "SD_CAPTURE";
+
+static sd_capture_t g_sd_capture = {.active_buffer = -1, .file_descriptor = -1};
+
+// Next free file index, one past the highest CSInnnnn.BIN on the card
+static uint32_t sd_capture_scan_file_index()
+{
+    uint32_t next_index = 0;
+    DIR *directory = opendir(SD_CAPTURE_MOUNT_POINT);
+    if (!directory)
+    {
+        return 0;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        unsigned int index;
+        if (sscanf(entry->d_name, "CSI%5u.BIN", &index) == 1 && index + 1 > next_index)
+        {
+            next_index = index + 1;
+        }
+    }
+    closedir(directory);
+    return next_index;
+}
+
+static esp_err_t sd_capture_write_header()
+{
+    uint8_t sector[SD_CAPTURE_SECTOR_SIZE] = {0};
+    memcpy(sector, &g_sd_capture.header, sizeof(g_sd_capture.header));
+
+    if (lseek(g_sd_capture.file_descriptor, 0, SEEK_SET) != 0 ||
+        write(g_sd_capture.file_descriptor, sector, sizeof(sector)) != (ssize_t)sizeof(sector))
+    {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sd_capture_open_file()
+{
+    char path[32];
+    uint32_t file_index = g_sd_capture.next_file_index++;
+    snprintf(path, sizeof(path), SD_CAPTURE_MOUNT_POINT "/CSI%05u.BIN", (unsigned int)(file_index % 100000));
+
+    g_sd_capture.file_descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (g_sd_capture.file_descriptor < 0)
+    {
+        ESP_LOGE(SD_TAG, "Failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    memset(&g_sd_capture.header, 0, sizeof(g_sd_capture.header));
+    memcpy(g_sd_capture.header.magic, CSI_CAPTURE_MAGIC, sizeof(CSI_CAPTURE_MAGIC));
+    g_sd_capture.header.version = CSI_CAPTURE_VERSION;
+    g_sd_capture.header.header_size = CSI_CAPTURE_HEADER_SIZE;
+    g_sd_capture.header.file_index = file_index;
+    g_sd_capture.header.wire_version = CSI_WIRE_VERSION;
+    g_sd_capture.header.created_us = get_timestamp_microseconds();
+
+    // Preallocate the whole file: seeking past the end of a file open for
+    // writing makes FATFS allocate the cluster chain in one go
+    bool preallocated = lseek(g_sd_capture.file_descriptor, SD_CAPTURE_FILE_SIZE - 1, SEEK_SET) >= 0 &&
+                        write(g_sd_capture.file_descriptor, "", 1) == 1;
+
+    if (sd_capture_write_header() != ESP_OK)
+    {
+        ESP_LOGE(SD_TAG, "Failed to write header of %s", path);
+        close(g_sd_capture.file_descriptor);
+        g_sd_capture.file_descriptor = -1;
+        return ESP_FAIL;
+    }
+
+    g_sd_capture.files_created++;
+    ESP_LOGI(SD_TAG, "Capturing to %s%s", path, preallocated ? "" : " (preallocation failed)");
+    return ESP_OK;
+}
+
+// Finalize the header and cut the preallocated tail off
+static void sd_capture_close_file()
+{
+    if (g_sd_capture.file_descriptor < 0)
+    {
+        return;
+    }
+
+    g_sd_capture.header.flags |= CSI_CAPTURE_FLAG_CLOSED;
+    if (sd_capture_write_header() != ESP_OK ||
+        ftruncate(g_sd_capture.file_descriptor, CSI_CAPTURE_HEADER_SIZE + g_sd_capture.header.data_bytes) != 0)
+    {
+        g_sd_capture.write_errors++;
+    }
+
+    fsync(g_sd_capture.file_descriptor);
+    close(g_sd_capture.file_descriptor);
+    g_sd_capture.file_descriptor = -1;
+}
+
+// Writer task: the only code that calls into FATFS while capturing
+static void sd_capture_writer_task(void *parameters)
+{
+    uint8_t buffer_index;
+
+    while (true)
+    {
+        if (xQueueReceive(g_sd_capture.full_buffers, &buffer_index, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+
+        sd_capture_buffer_t *buffer = &g_sd_capture.buffers[buffer_index];
+        bool rotate = g_sd_capture.rotate_requested;
+        g_sd_capture.rotate_requested = false;
+
+        if (g_sd_capture.file_descriptor >= 0 &&
+            (rotate ||
+             CSI_CAPTURE_HEADER_SIZE + g_sd_capture.header.data_bytes + buffer->used > SD_CAPTURE_FILE_SIZE))
+        {
+            sd_capture_close_file();
+        }
+
+        if (g_sd_capture.file_descriptor < 0 && sd_capture_open_file() != ESP_OK)
+        {
+            g_sd_capture.write_errors++;
+            g_sd_capture.records_lost += buffer->record_count;
+        }
+        else
+        {
+            // Data always continues on a sector boundary
+            off_t data_offset = CSI_CAPTURE_HEADER_SIZE + g_sd_capture.header.data_bytes;
+            if (lseek(g_sd_capture.file_descriptor, data_offset, SEEK_SET) == data_offset &&
+                write(g_sd_capture.file_descriptor, buffer->data, buffer->used) == (ssize_t)buffer->used)
+            {
+                csi_capture_file_header_t *header = &g_sd_capture.header;
+                if (header->record_count == 0)
+                {
+                    header->first_timestamp_us = buffer->first_timestamp_us;
+                }
+                if (buffer->record_count > 0)
+                {
+                    header->last_timestamp_us = buffer->last_timestamp_us;
+                }
+                header->record_count += buffer->record_count;
+                header->data_bytes += buffer->used;
+                g_sd_capture.buffers_written++;
+
+                if (buffer->sync)
+                {
+                    sd_capture_write_header();
+                    fsync(g_sd_capture.file_descriptor);
+                }
+            }
+            else
+            {
+                // Card removed or full: start a fresh file with the next buffer
+                ESP_LOGE(SD_TAG, "SD write failed, reopening capture file");
+                g_sd_capture.write_errors++;
+                g_sd_capture.records_lost += buffer->record_count;
+                close(g_sd_capture.file_descriptor);
+                g_sd_capture.file_descriptor = -1;
+            }
+        }
+
+        buffer->used = 0;
+        buffer->record_count = 0;
+        buffer->sync = false;
+        xQueueSend(g_sd_capture.free_buffers, &buffer_index, 0);
+    }
+}
+
+// Sink task side: pad the active buffer to a whole sector and hand it over
+static void sd_capture_submit_active(bool sync)
+{
+    if (g_sd_capture.active_buffer < 0)
+    {
+        return;
+    }
+
+    sd_capture_buffer_t *buffer = &g_sd_capture.buffers[g_sd_capture.active_buffer];
+    size_t padded = (buffer->used + SD_CAPTURE_SECTOR_SIZE - 1) & ~(size_t)(SD_CAPTURE_SECTOR_SIZE - 1);
+    memset(buffer->data + buffer->used, 0, padded - buffer->used);
+    buffer->used = padded;
+    buffer->sync = sync;
+
+    uint8_t buffer_index = (uint8_t)g_sd_capture.active_buffer;
+    xQueueSend(g_sd_capture.full_buffers, &buffer_index, 0);
+    g_sd_capture.active_buffer = -1;
+}
+
+static bool sd_capture_take_buffer()
+{
+    uint8_t buffer_index;
+    if (xQueueReceive(g_sd_capture.free_buffers, &buffer_index, 0) != pdTRUE)
+    {
+        return false;
+    }
+
+    g_sd_capture.active_buffer = buffer_index;
+    g_sd_capture.active_since_us = esp_timer_get_time();
+    return true;
+}
+
+static esp_err_t sd_capture_sink_write(csi_sink_t *sink, const uint8_t *record, size_t record_length)
+{
+    if (record_length > SD_CAPTURE_BUFFER_SIZE)
+    {
+        g_sd_capture.records_dropped++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (g_sd_capture.active_buffer >= 0 &&
+        g_sd_capture.buffers[g_sd_capture.active_buffer].used + record_length > SD_CAPTURE_BUFFER_SIZE)
+    {
+        sd_capture_submit_active(false);
+    }
+
+    // Both buffers are queued for the writer: the card is not keeping up
+    if (g_sd_capture.active_buffer < 0 && !sd_capture_take_buffer())
+    {
+        g_sd_capture.records_dropped++;
+        return ESP_FAIL;
+    }
+
+    sd_capture_buffer_t *buffer = &g_sd_capture.buffers[g_sd_capture.active_buffer];
+    memcpy(buffer->data + buffer->used, record, record_length);
+    buffer->used += record_length;
+
+    int64_t timestamp_us = 0;
+    if (record_length >= sizeof(csi_wire_record_header_t) && record[0] == (CSI_WIRE_MAGIC & 0xFF) &&
+        record[1] == (CSI_WIRE_MAGIC >> 8))
+    {
+        memcpy(&timestamp_us, record + offsetof(csi_wire_record_header_t, timestamp_us), sizeof(timestamp_us));
+    }
+    if (buffer->record_count == 0)
+    {
+        buffer->first_timestamp_us = timestamp_us;
+    }
+    buffer->last_timestamp_us = timestamp_us;
+    buffer->record_count++;
+    return ESP_OK;
+}
+
+// Flush a partly filled buffer once it has waited for the flush interval
+static int64_t sd_capture_sink_idle(csi_sink_t *sink)
+{
+    if (g_sd_capture.active_buffer < 0)
+    {
+        return -1;
+    }
+
+    int64_t remaining_us = g_sd_capture.active_since_us + CONFIG_CSI_SD_FLUSH_INTERVAL_MS * 1000LL - esp_timer_get_time();
+    if (remaining_us <= 0 || g_sd_capture.rotate_requested)
+    {
+        sd_capture_submit_active(true);
+        return -1;
+    }
+    return remaining_us;
+}
+
+static esp_err_t sd_capture_mount()
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = 2,
+        .allocation_unit_size = 32 * 1024};
+
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+#if CONFIG_CSI_SD_SDMMC_1_LINE
+    host.flags = SDMMC_HOST_FLAG_1BIT;
+    slot_config.width = 1;
+#endif
+
+    esp_err_t result = esp_vfs_fat_sdmmc_mount(SD_CAPTURE_MOUNT_POINT, &host, &slot_config, &mount_config,
+                                                &g_sd_capture.card);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    sdmmc_card_print_info(stdout, g_sd_capture.card);
+    return ESP_OK;
+}
+
+esp_err_t sd_capture_register_sink(bool enabled, UBaseType_t sink_priority, uint32_t sink_stack_size,
+                                   BaseType_t core)
+{
+    esp_err_t result = sd_capture_mount();
+    if (result != ESP_OK)
+    {
+        ESP_LOGW(SD_TAG, "No SD card mounted (%s), SD sink disabled", esp_err_to_name(result));
+        return result;
+    }
+
+    g_sd_capture.free_buffers = xQueueCreate(SD_CAPTURE_BUFFER_COUNT, sizeof(uint8_t));
+    g_sd_capture.full_buffers = xQueueCreate(SD_CAPTURE_BUFFER_COUNT, sizeof(uint8_t));
+    if (!g_sd_capture.free_buffers || !g_sd_capture.full_buffers)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint8_t buffer_index = 0; buffer_index < SD_CAPTURE_BUFFER_COUNT; buffer_index++)
+    {
+        g_sd_capture.buffers[buffer_index].data = heap_caps_aligned_alloc(SD_CAPTURE_SECTOR_SIZE, SD_CAPTURE_BUFFER_SIZE,
+                                                                          MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+        if (!g_sd_capture.buffers[buffer_index].data)
+        {
+            ESP_LOGE(SD_TAG, "Failed to allocate SD capture buffers");
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(g_sd_capture.free_buffers, &buffer_index, 0);
+    }
+
+    g_sd_capture.next_file_index = sd_capture_scan_file_index();
+
+    if (xTaskCreatePinnedToCore(sd_capture_writer_task, "sd_writer", 4096, NULL, CONFIG_CSI_SD_WRITER_TASK_PRIORITY,
+                                &g_sd_capture.writer_task, core) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    pipeline_stats_register_task("sd_writer", g_sd_capture.writer_task);
+
+    return csi_sink_register(CSI_SINK_SD, sd_capture_sink_write, sd_capture_sink_idle, NULL, CSI_WIRE_FORMAT_BINARY,
+                             enabled, CONFIG_CSI_ENCODED_RING_SIZE, sink_priority, sink_stack_size, core);
+}
+
+void sd_capture_request_rotation()
+{
+    g_sd_capture.rotate_requested = true;
+    if (g_csi_sinks[CSI_SINK_SD].task)
+    {
+        xTaskNotifyGive(g_csi_sinks[CSI_SINK_SD].task);
+    }
+}
+
+void sd_capture_print()
+{
+    if (!g_sd_capture.card)
+    {
+        return;
+    }
+
+    printf("SD Capture: file %lu, %lu records, %llu bytes; %lu buffers written, %lu errors, %lu dropped, %lu lost\n",
+           (unsigned long)g_sd_capture.header.file_index, (unsigned long)g_sd_capture.header.record_count,
+           (unsigned long long)g_sd_capture.header.data_bytes, (unsigned long)g_sd_capture.buffers_written,
+           (unsigned long)g_sd_capture.write_errors, (unsigned long)g_sd_capture.records_dropped,
+           (unsigned long)g_sd_capture.records_lost);
+}
+
+bool sd_capture_command(const char *arguments)
+{
+    char action[8] = {0};
+    sscanf(arguments, "%7s", action);
+
+    if (!g_sd_capture.card)
+    {
+        printf("No SD card mounted\n");
+        return false;
+    }
+
+    if (strcasecmp(action, "ROTATE") == 0)
+    {
+        sd_capture_request_rotation();
+        printf("SD capture file rotation requested\n");
+        return true;
+    }
+    if (strcasecmp(action, "STATUS") == 0)
+    {
+        sd_capture_print();
+        return true;
+    }
+
+    printf("Usage: CSI_SD ROTATE | STATUS\n");
+    return false;
+}
@@ -0,0 +1,107 @@
+#ifndef SD_CAPTURE_H
+#define SD_CAPTURE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdmmc_host.h"
+#include "sdkconfig.h"
+#include "csi_wire_format.h"
+#include "csi_sink.h"
+#include "timestamp_manager.h"
+
+// SD card sink for untethered capture. Records are copied into one of two
+// sector-aligned RAM buffers by the SD sink task; a full buffer is handed to
+// a lower-priority writer task, which is the only one that touches FATFS.
+// A slow FAT update therefore only delays the writer while the other buffer
+// (and the sink ring in front of it) keeps absorbing frames.
+//
+// Files are named CSInnnnn.BIN (8.3 names, no LFN needed). Each is
+// preallocated to the rotation size when opened, so the FAT is not extended
+// cluster by cluster while capturing. It is trimmed to its real length when
+// it is closed, and its header sector is rewritten with the final counters.
+
+#define SD_CAPTURE_MOUNT_POINT "/sdcard"
+#define SD_CAPTURE_SECTOR_SIZE CSI_CAPTURE_HEADER_SIZE
+#define SD_CAPTURE_BUFFER_COUNT 2
+
+#ifndef CONFIG_CSI_SD_BUFFER_SIZE_KB
+#define CONFIG_CSI_SD_BUFFER_SIZE_KB 16
+#endif
+#ifndef CONFIG_CSI_SD_FILE_SIZE_MB
+#define CONFIG_CSI_SD_FILE_SIZE_MB 256
+#endif
+#ifndef CONFIG_CSI_SD_FLUSH_INTERVAL_MS
+#define CONFIG_CSI_SD_FLUSH_INTERVAL_MS 2000
+#endif
+#ifndef CONFIG_CSI_SD_WRITER_TASK_PRIORITY
+#define CONFIG_CSI_SD_WRITER_TASK_PRIORITY 2
+#endif
+
+#define SD_CAPTURE_BUFFER_SIZE ((size_t)CONFIG_CSI_SD_BUFFER_SIZE_KB * 1024)
+#define SD_CAPTURE_FILE_SIZE ((uint64_t)CONFIG_CSI_SD_FILE_SIZE_MB * 1024 * 1024)
+
+typedef struct
+{
+    uint8_t *data;
+    size_t used;
+    uint32_t record_count;
+    int64_t first_timestamp_us;
+    int64_t last_timestamp_us;
+    bool sync; // fsync after writing, set for timed flushes
+} sd_capture_buffer_t;
+
+typedef struct
+{
+    sdmmc_card_t *card;
+    sd_capture_buffer_t buffers[SD_CAPTURE_BUFFER_COUNT];
+    QueueHandle_t free_buffers; // Buffer indices ready to be filled
+    QueueHandle_t full_buffers; // Buffer indices waiting for the writer
+    TaskHandle_t writer_task;
+
+    // Sink task
+    int active_buffer; // -1 when no buffer is being filled
+    int64_t active_since_us;
+    volatile bool rotate_requested;
+
+    // Writer task
+    int file_descriptor;
+    uint32_t next_file_index;
+    csi_capture_file_header_t header;
+
+    volatile uint32_t buffers_written;
+    volatile uint32_t write_errors;
+    volatile uint32_t files_created;
+    volatile uint32_t records_dropped; // Sink task: no free buffer
+    volatile uint32_t records_lost;    // Writer task: write failed
+} sd_capture_t;
+
+// Mount the card, allocate the buffers and register the SD sink. Fails
+// without side effects on other sinks if no card is present.
+esp_err_t sd_capture_register_sink(bool enabled, UBaseType_t sink_priority, uint32_t sink_stack_size,
+                                   BaseType_t core);
+
+// Close the current file after the next buffer and continue in a new one
+void sd_capture_request_rotation();
+
+void sd_capture_print();
+
+// CSI_SD ROTATE | STATUS
+bool sd_capture_command(const char *arguments);
+
+#endif // SD_CAPTURE_H
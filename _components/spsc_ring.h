@@ -0,0 +1,171 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+// Lock-free single-producer / single-consumer ring of variable-length
+// records. The producer reserves space, writes the record in place and
+// commits it; the consumer peeks at the oldest record and consumes it when
+// done. Records are always contiguous: if one does not fit before the end of
+// the buffer a wrap marker is left and it starts again at offset 0.
+
+#define SPSC_RING_HEADER_SIZE 4
+#define SPSC_RING_WRAP_MARKER 0xFFFFFFFFu
+
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t capacity;       // Power of two
+    atomic_uint_fast32_t head; // Free-running write position, producer owned
+    atomic_uint_fast32_t tail; // Free-running read position, consumer owned
+    uint32_t reserved_length;
+} spsc_ring_t;
+
+// Space a record takes, header and alignment included
+#define SPSC_RING_ALIGN(length) (((length) + SPSC_RING_HEADER_SIZE + 3) & ~3u)
+
+// Smallest ring that always takes a record of max_length, even one that has
+// to wrap and leaves up to a record's worth unused at the end of the buffer
+#define SPSC_RING_MIN_CAPACITY(max_length) (2 * SPSC_RING_ALIGN(max_length))
+
+static inline uint32_t spsc_ring_align(uint32_t length)
+{
+    return SPSC_RING_ALIGN(length);
+}
+
+// Use memory the caller allocated, e.g. from PSRAM. Capacity must be a power of two.
+static inline esp_err_t spsc_ring_init_buffer(spsc_ring_t *ring, uint8_t *buffer, uint32_t capacity)
+{
+    if (!buffer || capacity < 64 || (capacity & (capacity - 1)) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ring->buffer = buffer;
+    ring->capacity = capacity;
+    ring->reserved_length = 0;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    return ESP_OK;
+}
+
+// Capacity is rounded up to a power of two
+static inline esp_err_t spsc_ring_init(spsc_ring_t *ring, uint32_t capacity)
+{
+    uint32_t rounded = 64;
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    uint8_t *buffer = malloc(rounded);
+    if (!buffer)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return spsc_ring_init_buffer(ring, buffer, rounded);
+}
+
+// Producer: get contiguous space for a record of up to max_length bytes,
+// NULL if the ring is too full right now
+static inline uint8_t *spsc_ring_reserve(spsc_ring_t *ring, uint32_t max_length)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t needed = spsc_ring_align(max_length);
+    uint32_t offset = head & (ring->capacity - 1);
+    uint32_t until_end = ring->capacity - offset;
+    uint32_t free_space = ring->capacity - (head - tail);
+
+    if (needed > until_end)
+    {
+        // The record would straddle the end, it has to start at offset 0
+        if (needed + until_end > free_space)
+        {
+            return NULL;
+        }
+
+        uint32_t marker = SPSC_RING_WRAP_MARKER;
+        memcpy(ring->buffer + offset, &marker, sizeof(marker));
+        head += until_end;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        offset = 0;
+    }
+    else if (needed > free_space)
+    {
+        return NULL;
+    }
+
+    ring->reserved_length = max_length;
+    return ring->buffer + offset + SPSC_RING_HEADER_SIZE;
+}
+
+// Producer: publish the reserved record with its final length
+static inline void spsc_ring_commit(spsc_ring_t *ring, uint32_t length)
+{
+    if (length > ring->reserved_length)
+    {
+        length = ring->reserved_length;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t offset = head & (ring->capacity - 1);
+    uint32_t header = length;
+    memcpy(ring->buffer + offset, &header, sizeof(header));
+
+    atomic_store_explicit(&ring->head, head + spsc_ring_align(length), memory_order_release);
+    ring->reserved_length = 0;
+}
+
+// Consumer: oldest committed record, NULL if the ring is empty
+static inline const uint8_t *spsc_ring_peek(spsc_ring_t *ring, uint32_t *length)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    while (true)
+    {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == head)
+        {
+            return NULL;
+        }
+
+        uint32_t offset = tail & (ring->capacity - 1);
+        uint32_t header;
+        memcpy(&header, ring->buffer + offset, sizeof(header));
+
+        if (header == SPSC_RING_WRAP_MARKER)
+        {
+            // Skip the unused end of the buffer
+            tail += ring->capacity - offset;
+            atomic_store_explicit(&ring->tail, tail, memory_order_release);
+            continue;
+        }
+
+        *length = header;
+        return ring->buffer + offset + SPSC_RING_HEADER_SIZE;
+    }
+}
+
+// Consumer: release the record returned by the last spsc_ring_peek()
+static inline void spsc_ring_consume(spsc_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t header;
+    memcpy(&header, ring->buffer + (tail & (ring->capacity - 1)), sizeof(header));
+    atomic_store_explicit(&ring->tail, tail + spsc_ring_align(header), memory_order_release);
+}
+
+// Bytes currently held, including headers and alignment; approximate when
+// called from a thread other than the consumer
+static inline uint32_t spsc_ring_used(spsc_ring_t *ring)
+{
+    return (uint32_t)(atomic_load(&ring->head) - atomic_load(&ring->tail));
+}
+
+#endif // SPSC_RING_H
@@ -0,0 +1,30 @@
+#include "station_table.h"
+
+station_table_t g_station_table;
+
+uint8_t station_table_lookup(const uint8_t mac[6])
+{
+    uint64_t key = mac_allowlist_key(mac);
+    uint32_t slot = station_table_slot(key);
+
+    while (g_station_table.keys[slot] != MAC_ALLOWLIST_EMPTY_KEY)
+    {
+        if (g_station_table.keys[slot] == key)
+        {
+            return g_station_table.indices[slot];
+        }
+        slot = (slot + 1) & (STATION_TABLE_CAPACITY - 1);
+    }
+
+    unsigned int station_count = atomic_load_explicit(&g_station_table.station_count, memory_order_relaxed);
+    if (station_count >= STATION_TABLE_MAX_STATIONS)
+    {
+        return STATION_TABLE_INVALID_INDEX;
+    }
+
+    memcpy(g_station_table.macs[station_count], mac, 6);
+    g_station_table.indices[slot] = (uint8_t)station_count;
+    g_station_table.keys[slot] = key;
+    atomic_store_explicit(&g_station_table.station_count, station_count + 1, memory_order_release);
+    return (uint8_t)station_count;
+}
@@ -0,0 +1,52 @@
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "mac_allowlist.h"
+
+// Dense per-station index for the MACs that pass the allowlist. The WiFi
+// callback maps a MAC to a small index once per frame, and per-station state
+// anywhere in the pipeline is then a plain array indexed by it. Entries are
+// only ever added, so an index stays valid for the lifetime of the firmware.
+//
+// Lookups and inserts happen in the capture callback only, which has one
+// caller at a time (the WiFi driver, or the replay task while it has CSI
+// turned off in the driver); other tasks receive the index along with the
+// frame and read entries through station_table_mac().
+
+#define STATION_TABLE_MAX_STATIONS MAC_ALLOWLIST_MAX_ENTRIES
+#define STATION_TABLE_CAPACITY (STATION_TABLE_MAX_STATIONS * 2) // Power of two
+#define STATION_TABLE_INVALID_INDEX 0xFF
+
+typedef struct
+{
+    uint64_t keys[STATION_TABLE_CAPACITY]; // mac_allowlist_key() or 0
+    uint8_t indices[STATION_TABLE_CAPACITY];
+    uint8_t macs[STATION_TABLE_MAX_STATIONS][6];
+    atomic_uint station_count; // Published after the entry is written
+} station_table_t;
+
+extern station_table_t g_station_table;
+
+static inline uint32_t station_table_slot(uint64_t key)
+{
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 57) & (STATION_TABLE_CAPACITY - 1);
+}
+
+// Index for a MAC, adding it on first sight. Returns
+// STATION_TABLE_INVALID_INDEX once the table is full.
+uint8_t station_table_lookup(const uint8_t mac[6]);
+
+static inline const uint8_t *station_table_mac(uint8_t station_index)
+{
+    return g_station_table.macs[station_index];
+}
+
+static inline unsigned int station_table_count()
+{
+    return atomic_load_explicit(&g_station_table.station_count, memory_order_acquire);
+}
+
+#endif // STATION_TABLE_H
@@ -0,0 +1,132 @@
+#include "storage_manager.h"
+
+static const char *STORAGE_TAG = "storage_mgr";
+
+storage_init_result_t initialize_non_volatile_storage()
+{
+    storage_init_result_t result = {false, false, ESP_OK};
+
+    ESP_LOGI(STORAGE_TAG, "Initializing NVS storage system...");
+
+    // Attempt initial NVS initialization
+    esp_err_t init_result = nvs_flash_init();
+
+    // Handle different initialization scenarios
+    if (init_result == ESP_OK)
+    {
+        ESP_LOGI(STORAGE_TAG, "NVS initialized successfully");
+        result.success = true;
+        result.error_code = init_result;
+    }
+    else if (init_result == ESP_ERR_NVS_NO_FREE_PAGES ||
+             init_result == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(STORAGE_TAG, "NVS partition needs formatting (reason: %s)",
+                 esp_err_to_name(init_result));
+
+        // Attempt to erase and re-initialize
+        esp_err_t erase_result = nvs_flash_erase();
+        if (erase_result != ESP_OK)
+        {
+            ESP_LOGE(STORAGE_TAG, "Failed to erase NVS partition: %s",
+                     esp_err_to_name(erase_result));
+            result.error_code = erase_result;
+            return result;
+        }
+
+        // Try initialization again after erase
+        init_result = nvs_flash_init();
+        if (init_result == ESP_OK)
+        {
+            ESP_LOGI(STORAGE_TAG, "NVS initialized successfully after format");
+            result.success = true;
+            result.required_format = true;
+            result.error_code = init_result;
+        }
+        else
+        {
+            ESP_LOGE(STORAGE_TAG, "NVS initialization failed even after format: %s",
+                     esp_err_to_name(init_result));
+            result.error_code = init_result;
+        }
+    }
+    else
+    {
+        ESP_LOGE(STORAGE_TAG, "Critical NVS initialization error: %s",
+                 esp_err_to_name(init_result));
+        result.error_code = init_result;
+    }
+
+    return result;
+}
+
+void setup_nvs_storage()
+{
+    storage_init_result_t result = initialize_non_volatile_storage();
+
+    if (!result.success)
+    {
+        ESP_ERROR_CHECK(result.error_code);
+    }
+}
+
+esp_err_t get_storage_statistics(size_t *used_entries, size_t *free_entries,
+                                 size_t *total_entries)
+{
+    esp_err_t result = nvs_get_stats(NULL, NULL);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(STORAGE_TAG, "Failed to get NVS statistics: %s", esp_err_to_name(result));
+        return result;
+    }
+
+    *used_entries = 0;
+    *free_entries = 0;
+    *total_entries = 0;
+
+    ESP_LOGI(STORAGE_TAG, "Storage statistics retrieved");
+    return ESP_OK;
+}
+
+esp_err_t storage_save_blob(const char *name_space, const char *key, const void *data, size_t length)
+{
+    nvs_handle_t handle;
+    esp_err_t result = nvs_open(name_space, NVS_READWRITE, &handle);
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(STORAGE_TAG, "Failed to open NVS namespace %s: %s", name_space, esp_err_to_name(result));
+        return result;
+    }
+
+    result = nvs_set_blob(handle, key, data, length);
+    if (result == ESP_OK)
+    {
+        result = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (result != ESP_OK)
+    {
+        ESP_LOGE(STORAGE_TAG, "Failed to store %s/%s: %s", name_space, key, esp_err_to_name(result));
+    }
+    return result;
+}
+
+esp_err_t storage_load_blob(const char *name_space, const char *key, void *data, size_t *length)
+{
+    nvs_handle_t handle;
+    esp_err_t result = nvs_open(name_space, NVS_READONLY, &handle);
+    if (result != ESP_OK)
+    {
+        return result;
+    }
+
+    result = nvs_get_blob(handle, key, data, length);
+    nvs_close(handle);
+
+    if (result != ESP_OK && result != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGW(STORAGE_TAG, "Failed to read %s/%s: %s", name_space, key, esp_err_to_name(result));
+    }
+    return result;
+}
@@ -0,0 +1,311 @@
+#include "time_sync.h"
+
+static const char *TIME_SYNC_TAG = "TIME_SYNC";
+
+static time_sync_t g_time_sync = {.socket_descriptor = -1, .interval_s = CONFIG_CSI_TIME_SYNC_INTERVAL_S};
+
+static void time_sync_connect()
+{
+    g_time_sync.connected_generation = g_time_sync.generation;
+    struct sockaddr_in server = {0};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(g_time_sync.server_port);
+    server.sin_addr.s_addr = g_time_sync.server_address;
+    if (connect(g_time_sync.socket_descriptor, (struct sockaddr *)&server, sizeof(server)) < 0)
+    {
+        ESP_LOGW(TIME_SYNC_TAG, "Failed to connect to the time server: %s", strerror(errno));
+    }
+
+    // A new server has a clock of its own, start over from a step
+    g_time_sync.last_round_us = 0;
+    g_time_sync.next_round_us = 0;
+}
+
+// One request and its response; false if none came back in time
+static bool time_sync_exchange(time_sync_sample_t *sample)
+{
+    time_sync_packet_t packet = {0};
+    memcpy(packet.magic, TIME_SYNC_MAGIC, sizeof(packet.magic));
+    packet.version = TIME_SYNC_VERSION;
+    packet.type = TIME_SYNC_REQUEST;
+    packet.sequence = ++g_time_sync.sequence;
+    packet.origin_us = get_timestamp_microseconds();
+    if (send(g_time_sync.socket_descriptor, &packet, sizeof(packet), 0) < 0)
+    {
+        return false;
+    }
+
+    // Late answers to earlier requests are skipped, the receive timeout ends the wait
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        time_sync_packet_t response;
+        int received = recv(g_time_sync.socket_descriptor, &response, sizeof(response), 0);
+        int64_t arrival_us = get_timestamp_microseconds();
+        if (received < 0)
+        {
+            return false;
+        }
+        if (received != sizeof(response) || memcmp(response.magic, TIME_SYNC_MAGIC, sizeof(response.magic)) != 0 ||
+            response.type != TIME_SYNC_RESPONSE || response.sequence != packet.sequence ||
+            response.origin_us != packet.origin_us)
+        {
+            continue;
+        }
+
+        sample->offset_us = ((response.receive_us - packet.origin_us) + (response.transmit_us - arrival_us)) / 2;
+        sample->rtt_us = (arrival_us - packet.origin_us) - (response.transmit_us - response.receive_us);
+        return sample->rtt_us >= 0;
+    }
+    return false;
+}
+
+static void time_sync_apply(const time_sync_sample_t *sample, int64_t now_us)
+{
+    int64_t step_threshold_us = CONFIG_CSI_TIME_SYNC_STEP_THRESHOLD_MS * 1000LL;
+    if (!is_time_synchronized() || g_time_sync.last_round_us == 0 || sample->offset_us > step_threshold_us ||
+        sample->offset_us < -step_threshold_us)
+    {
+        if (!step_system_time(sample->offset_us))
+        {
+            ESP_LOGE(TIME_SYNC_TAG, "Failed to set the system time");
+            return;
+        }
+        g_time_sync.steps++;
+        ESP_LOGI(TIME_SYNC_TAG, "Clock stepped by %lld us (round trip %lld us)", (long long)sample->offset_us,
+                 (long long)sample->rtt_us);
+    }
+    else
+    {
+        // What is left after the last round's corrections is frequency error
+        int64_t elapsed_us = now_us - g_time_sync.last_round_us;
+        if (elapsed_us > 0)
+        {
+            g_time_sync.drift_ppb += sample->offset_us * 1000000000LL / elapsed_us / 2;
+            if (g_time_sync.drift_ppb > TIME_SYNC_MAX_DRIFT_PPB)
+            {
+                g_time_sync.drift_ppb = TIME_SYNC_MAX_DRIFT_PPB;
+            }
+            else if (g_time_sync.drift_ppb < -TIME_SYNC_MAX_DRIFT_PPB)
+            {
+                g_time_sync.drift_ppb = -TIME_SYNC_MAX_DRIFT_PPB;
+            }
+        }
+        if (!slew_system_time(sample->offset_us))
+        {
+            ESP_LOGW(TIME_SYNC_TAG, "Failed to slew the system time");
+        }
+    }
+
+    g_time_sync.last_sample = *sample;
+    g_time_sync.last_round_us = now_us;
+    g_time_sync.last_success_us = now_us;
+    g_pipeline_stats.time_offset_us = (int32_t)(sample->offset_us > INT32_MAX   ? INT32_MAX
+                                                : sample->offset_us < INT32_MIN ? INT32_MIN
+                                                                                : sample->offset_us);
+    g_pipeline_stats.time_rtt_us = (uint32_t)sample->rtt_us;
+    g_pipeline_stats.time_drift_ppb = (int32_t)g_time_sync.drift_ppb;
+}
+
+// A burst of exchanges, of which the one with the shortest round trip is used
+static void time_sync_round()
+{
+    time_sync_sample_t best = {0};
+    bool have_sample = false;
+    for (int exchange = 0; exchange < CONFIG_CSI_TIME_SYNC_SAMPLES; exchange++)
+    {
+        time_sync_sample_t sample;
+        if (time_sync_exchange(&sample) && (!have_sample || sample.rtt_us < best.rtt_us))
+        {
+            best = sample;
+            have_sample = true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_SAMPLE_SPACING_MS));
+    }
+
+    g_time_sync.rounds++;
+    if (!have_sample || best.rtt_us > CONFIG_CSI_TIME_SYNC_MAX_RTT_MS * 1000LL)
+    {
+        g_time_sync.failed_rounds++;
+        ESP_LOGD(TIME_SYNC_TAG, "No usable time sample (%s)", have_sample ? "round trip too long" : "no response");
+        return;
+    }
+    time_sync_apply(&best, esp_timer_get_time());
+}
+
+// Slew the clock by the estimated frequency error since the last tick
+static void time_sync_correct_frequency(int64_t now_us)
+{
+    int64_t elapsed_us = now_us - g_time_sync.last_tick_us;
+    g_time_sync.last_tick_us = now_us;
+    if (g_time_sync.last_round_us == 0 || g_time_sync.drift_ppb == 0 || elapsed_us <= 0)
+    {
+        return;
+    }
+
+    int64_t correction_ns = g_time_sync.drift_ppb * elapsed_us / 1000000 + g_time_sync.frequency_residual_ns;
+    g_time_sync.frequency_residual_ns = correction_ns % 1000;
+    if (correction_ns / 1000 != 0)
+    {
+        slew_system_time(correction_ns / 1000);
+    }
+}
+
+static void time_sync_task(void *parameters)
+{
+    g_time_sync.last_tick_us = esp_timer_get_time();
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TIME_SYNC_FREQUENCY_TICK_MS));
+        int64_t now_us = esp_timer_get_time();
+        time_sync_correct_frequency(now_us);
+
+        if (g_time_sync.connected_generation != g_time_sync.generation && g_time_sync.server_address)
+        {
+            time_sync_connect();
+        }
+        if (g_time_sync.server_address && now_us >= g_time_sync.next_round_us)
+        {
+            g_time_sync.next_round_us = now_us + g_time_sync.interval_s * 1000000LL;
+            time_sync_round();
+        }
+
+        if (g_time_sync.last_success_us && is_time_synchronized() &&
+            now_us - g_time_sync.last_success_us > CONFIG_CSI_TIME_SYNC_HOLDOVER_S * 1000000LL)
+        {
+            reset_time_sync_status();
+            g_time_sync.last_round_us = 0;
+            ESP_LOGW(TIME_SYNC_TAG, "No time sync for %d s, clock no longer synchronized",
+                     CONFIG_CSI_TIME_SYNC_HOLDOVER_S);
+        }
+    }
+}
+
+esp_err_t time_sync_start(UBaseType_t priority, uint32_t stack_size)
+{
+    if (g_time_sync.socket_descriptor >= 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TIME_SYNC_TAG, "Failed to create time sync socket: %s", strerror(errno));
+        return ESP_FAIL;
+    }
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = TIME_SYNC_RESPONSE_TIMEOUT_MS * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    g_time_sync.socket_descriptor = sock;
+    if (xTaskCreate(time_sync_task, "time_sync", stack_size, NULL, priority, &g_time_sync.task) != pdPASS)
+    {
+        close(sock);
+        g_time_sync.socket_descriptor = -1;
+        return ESP_ERR_NO_MEM;
+    }
+
+    pipeline_stats_register_task("time_sync", g_time_sync.task);
+    return ESP_OK;
+}
+
+void time_sync_set_server(uint32_t address, uint16_t port)
+{
+    if (address == g_time_sync.server_address && port == g_time_sync.server_port)
+    {
+        return;
+    }
+    g_time_sync.server_address = address;
+    g_time_sync.server_port = port;
+    g_time_sync.generation++;
+    if (g_time_sync.task)
+    {
+        xTaskNotifyGive(g_time_sync.task);
+    }
+}
+
+void time_sync_print()
+{
+    if (!g_time_sync.server_address)
+    {
+        printf("Time sync: no server, clock %s\n", is_time_synchronized() ? "synchronized" : "not synchronized");
+        return;
+    }
+
+    char address_text[16];
+    struct in_addr address = {.s_addr = g_time_sync.server_address};
+    inet_ntop(AF_INET, &address, address_text, sizeof(address_text));
+    printf("Time sync: server %s:%u every %lu s, clock %s\n", address_text, g_time_sync.server_port,
+           (unsigned long)g_time_sync.interval_s, is_time_synchronized() ? "synchronized" : "not synchronized");
+    if (g_time_sync.last_success_us)
+    {
+        printf("  last offset %lld us, round trip %lld us, drift %lld ppb, %lld s ago\n",
+               (long long)g_time_sync.last_sample.offset_us, (long long)g_time_sync.last_sample.rtt_us,
+               (long long)g_time_sync.drift_ppb,
+               (long long)((esp_timer_get_time() - g_time_sync.last_success_us) / 1000000));
+    }
+    printf("  %lu rounds, %lu failed, %lu steps\n", (unsigned long)g_time_sync.rounds,
+           (unsigned long)g_time_sync.failed_rounds, (unsigned long)g_time_sync.steps);
+}
+
+bool time_sync_command(const char *arguments)
+{
+    char action[12] = {0};
+    char value[24] = {0};
+    sscanf(arguments, "%11s %23s", action, value);
+
+    if (action[0] == '\0')
+    {
+        time_sync_print();
+        return true;
+    }
+    if (strcasecmp(action, "OFF") == 0)
+    {
+        time_sync_set_server(0, 0);
+        printf("Time sync stopped\n");
+        return true;
+    }
+    if (strcasecmp(action, "INTERVAL") == 0)
+    {
+        int interval_s = atoi(value);
+        if (interval_s < 1 || interval_s > 3600)
+        {
+            printf("Usage: CSI_TIMESYNC INTERVAL <1-3600 s>\n");
+            return false;
+        }
+        g_time_sync.interval_s = (uint32_t)interval_s;
+        g_time_sync.next_round_us = 0;
+        printf("Time sync every %d s\n", interval_s);
+        return true;
+    }
+    if (strcasecmp(action, "SERVER") == 0)
+    {
+        // Without an address, the host that sent the command over the control port
+        char address_text[16] = {0};
+        unsigned int port = TIME_SYNC_DEFAULT_PORT;
+        struct in_addr address = {0};
+        struct sockaddr_in sender = {0};
+        bool parsed;
+        if (strchr(value, '.'))
+        {
+            parsed = sscanf(value, "%15[0-9.]:%u", address_text, &port) >= 1 &&
+                     inet_pton(AF_INET, address_text, &address) == 1;
+        }
+        else
+        {
+            parsed = control_channel_request_sender(&sender) && (value[0] == '\0' || sscanf(value, "%u", &port) == 1);
+            address = sender.sin_addr;
+        }
+        if (!parsed || port == 0 || port > 65535)
+        {
+            printf("Usage: CSI_TIMESYNC SERVER <ip>[:port], or SERVER [port] over the control port\n");
+            return false;
+        }
+        time_sync_set_server(address.s_addr, (uint16_t)port);
+        printf("Time server %s:%u\n", inet_ntoa(address), port);
+        return true;
+    }
+
+    printf("Usage: CSI_TIMESYNC [SERVER [<ip>:]<port> | INTERVAL <s> | OFF]\n");
+    return false;
+}
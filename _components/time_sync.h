@@ -0,0 +1,132 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "timestamp_manager.h"
+#include "control_channel.h"
+#include "pipeline_stats.h"
+
+// NTP-style clock synchronization with a time server on the collector host.
+//
+//   request:  time_sync_packet_t with origin_us = AP wall clock when sent (t1)
+//   response: the same packet, receive_us (t2) and transmit_us (t3) filled in
+//             with the host clock; the AP notes its wall clock on arrival (t4)
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2, round trip = (t4 - t1) - (t3 - t2)
+//
+// Every CONFIG_CSI_TIME_SYNC_INTERVAL_S the task sends a burst of
+// CONFIG_CSI_TIME_SYNC_SAMPLES requests and keeps the one with the shortest
+// round trip, the one least delayed by queueing on either side. The first
+// round, and any offset over CONFIG_CSI_TIME_SYNC_STEP_THRESHOLD_MS, steps the
+// wall clock. Smaller offsets are slewed with adjtime(), and each one also
+// corrects the estimated frequency error of the AP's clock. Once a second the
+// task slews the clock by that frequency error, so it stays close to the host
+// between rounds. Both feed the hardware timestamp model, which samples the
+// wall clock. Without a good round for CONFIG_CSI_TIME_SYNC_HOLDOVER_S the
+// clock no longer counts as synchronized.
+
+#ifndef CONFIG_CSI_TIME_SYNC_INTERVAL_S
+#define CONFIG_CSI_TIME_SYNC_INTERVAL_S 16
+#endif
+#ifndef CONFIG_CSI_TIME_SYNC_SAMPLES
+#define CONFIG_CSI_TIME_SYNC_SAMPLES 8
+#endif
+#ifndef CONFIG_CSI_TIME_SYNC_STEP_THRESHOLD_MS
+#define CONFIG_CSI_TIME_SYNC_STEP_THRESHOLD_MS 50
+#endif
+#ifndef CONFIG_CSI_TIME_SYNC_MAX_RTT_MS
+#define CONFIG_CSI_TIME_SYNC_MAX_RTT_MS 20
+#endif
+#ifndef CONFIG_CSI_TIME_SYNC_HOLDOVER_S
+#define CONFIG_CSI_TIME_SYNC_HOLDOVER_S 300
+#endif
+
+#define TIME_SYNC_DEFAULT_PORT 10001 // On the host, next to the data and control ports
+#define TIME_SYNC_MAGIC "CSIT"
+#define TIME_SYNC_VERSION 1
+#define TIME_SYNC_RESPONSE_TIMEOUT_MS 100
+#define TIME_SYNC_SAMPLE_SPACING_MS 20
+#define TIME_SYNC_FREQUENCY_TICK_MS 1000
+#define TIME_SYNC_MAX_DRIFT_PPB 500000 // Far beyond any crystal, guards against bad rounds
+
+typedef enum
+{
+    TIME_SYNC_REQUEST = 1,
+    TIME_SYNC_RESPONSE = 2,
+} time_sync_packet_type_t;
+
+typedef struct __attribute__((packed))
+{
+    char magic[4];
+    uint8_t version;
+    uint8_t type; // time_sync_packet_type_t
+    uint16_t reserved;
+    uint32_t sequence;
+    int64_t origin_us;   // t1, AP clock, echoed by the host
+    int64_t receive_us;  // t2, host clock
+    int64_t transmit_us; // t3, host clock
+} time_sync_packet_t;
+
+_Static_assert(sizeof(time_sync_packet_t) == 36, "time sync packet layout");
+
+typedef struct
+{
+    int64_t offset_us; // Host clock - AP clock
+    int64_t rtt_us;
+} time_sync_sample_t;
+
+typedef struct
+{
+    int socket_descriptor;
+    TaskHandle_t task;
+
+    // Set by CSI_TIMESYNC, picked up by the task when generation changes
+    volatile uint32_t server_address; // 0 = no server
+    volatile uint16_t server_port;
+    volatile uint32_t interval_s;
+    volatile uint32_t generation;
+
+    // Time sync task
+    uint32_t connected_generation;
+    uint32_t sequence;
+    int64_t next_round_us; // esp_timer time
+    int64_t last_tick_us;
+    int64_t last_round_us;   // Of the last good round, 0 = none since the last step
+    int64_t last_success_us; // 0 = never synchronized over UDP
+    int64_t drift_ppb;       // Host clock rate relative to the AP clock
+    int64_t frequency_residual_ns;
+    time_sync_sample_t last_sample;
+    uint32_t rounds;
+    uint32_t failed_rounds;
+    uint32_t steps;
+} time_sync_t;
+
+esp_err_t time_sync_start(UBaseType_t priority, uint32_t stack_size);
+
+// Use the time server at address:port (network order address), 0 to stop
+void time_sync_set_server(uint32_t address, uint16_t port);
+
+// Snapshot from another task; values may be one round old
+void time_sync_print();
+
+// CSI_TIMESYNC [SERVER [port] | SERVER <ip>[:port] | INTERVAL <s> | OFF]
+bool time_sync_command(const char *arguments);
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,306 @@
+#include "timestamp_manager.h"
+
+static bool time_sync_established = false;
+
+static hw_timestamp_model_t hw_timestamp_model = {0};
+
+void reset_hw_timestamp_model() {
+    hw_timestamp_model.reset_requested = true;
+}
+
+bool validate_timestamp_format(const char* input_string) {
+    if (!input_string) {
+        return false;
+    }
+    
+    long long sec_val;
+    long usec_val;
+    int fields_parsed = sscanf(input_string, TIMESTAMP_FORMAT_EXTENDED, &sec_val, &usec_val);
+    
+    if (fields_parsed > 0) {
+        return true;
+    }
+    
+    fields_parsed = sscanf(input_string, TIMESTAMP_FORMAT_SIMPLE, &sec_val, &usec_val);
+    return (fields_parsed > 0);
+}
+
+timestamp_parse_result_t parse_timestamp_string(const char* timestamp_str) {
+    timestamp_parse_result_t result = {0, 0, false};
+    
+    if (!timestamp_str) {
+        return result;
+    }
+    
+    int parsed_fields = sscanf(timestamp_str, TIMESTAMP_FORMAT_EXTENDED, 
+                               &result.seconds, &result.microseconds);
+    
+    if (parsed_fields <= 0) {
+        parsed_fields = sscanf(timestamp_str, TIMESTAMP_FORMAT_SIMPLE, 
+                               &result.seconds, &result.microseconds);
+    }
+    
+    if (parsed_fields > 0) {
+        result.parse_success = true;
+        if (result.microseconds < 0 || result.microseconds >= 1000000) {
+            result.microseconds = 0;
+        }
+    }
+    
+    return result;
+}
+
+bool synchronize_system_time_compensated(const char* timestamp_input, int64_t elapsed_since_receipt_us) {
+    timestamp_parse_result_t parsed_time = parse_timestamp_string(timestamp_input);
+    
+    if (!parsed_time.parse_success) {
+        printf("Warning: Failed to parse timestamp format\n");
+        return false;
+    }
+    
+    if (elapsed_since_receipt_us < 0) {
+        elapsed_since_receipt_us = 0;
+    }
+    int64_t new_time_us = (int64_t)parsed_time.seconds * 1000000LL + parsed_time.microseconds + elapsed_since_receipt_us;
+    struct timeval new_time = {
+        .tv_sec = (time_t)(new_time_us / 1000000LL),
+        .tv_usec = (suseconds_t)(new_time_us % 1000000LL)
+    };
+    
+    if (settimeofday(&new_time, NULL) == 0) {
+        time_sync_established = true;
+        reset_hw_timestamp_model();
+        printf("System time synchronized successfully\n");
+        return true;
+    } else {
+        printf("Error: Failed to set system time\n");
+        return false;
+    }
+}
+
+bool synchronize_system_time(const char* timestamp_input) {
+    return synchronize_system_time_compensated(timestamp_input, 0);
+}
+
+bool step_system_time(int64_t offset_us) {
+    struct timeval current_time;
+    if (gettimeofday(&current_time, NULL) != 0) {
+        return false;
+    }
+    
+    int64_t new_time_us = (int64_t)current_time.tv_sec * 1000000LL + current_time.tv_usec + offset_us;
+    struct timeval new_time = {
+        .tv_sec = (time_t)(new_time_us / 1000000LL),
+        .tv_usec = (suseconds_t)(new_time_us % 1000000LL)
+    };
+    if (settimeofday(&new_time, NULL) != 0) {
+        return false;
+    }
+    time_sync_established = true;
+    reset_hw_timestamp_model();
+    return true;
+}
+
+bool slew_system_time(int64_t offset_us) {
+    struct timeval remaining = {0};
+    if (adjtime(NULL, &remaining) != 0) {
+        return false;
+    }
+    
+    int64_t total_us = offset_us + (int64_t)remaining.tv_sec * 1000000LL + remaining.tv_usec;
+    struct timeval delta = {
+        .tv_sec = (time_t)(total_us / 1000000LL),
+        .tv_usec = (suseconds_t)(total_us % 1000000LL)
+    };
+    return adjtime(&delta, NULL) == 0;
+}
+
+int64_t get_timestamp_microseconds() {
+    struct timeval current_time;
+    if (gettimeofday(&current_time, NULL) != 0) {
+        return -1;
+    }
+    return (int64_t)current_time.tv_sec * 1000000LL + current_time.tv_usec;
+}
+
+static void close_hw_timestamp_window(hw_timestamp_model_t* model) {
+    int64_t new_anchor_wall = model->window_min_radio_us + model->window_min_offset_us;
+    
+    if (model->has_previous_anchor && model->window_samples > 1) {
+        int64_t radio_elapsed = model->window_min_radio_us - model->anchor_radio_us;
+        if (radio_elapsed > 0) {
+            // Drift seen between the previous anchor's prediction and the new anchor
+            int64_t predicted_wall = model->anchor_wall_us + radio_elapsed +
+                                     radio_elapsed * model->drift_ppb / 1000000000LL;
+            int64_t measured_ppb = model->drift_ppb +
+                                   (new_anchor_wall - predicted_wall) * 1000000000LL / radio_elapsed;
+            
+            // Low-pass the estimate, queueing jitter makes single windows noisy
+            model->drift_ppb += (measured_ppb - model->drift_ppb) / 4;
+            if (model->drift_ppb > TIMESTAMP_MODEL_MAX_DRIFT_PPB) {
+                model->drift_ppb = TIMESTAMP_MODEL_MAX_DRIFT_PPB;
+            } else if (model->drift_ppb < -TIMESTAMP_MODEL_MAX_DRIFT_PPB) {
+                model->drift_ppb = -TIMESTAMP_MODEL_MAX_DRIFT_PPB;
+            }
+        }
+    }
+    
+    model->anchor_radio_us = model->window_min_radio_us;
+    model->anchor_wall_us = new_anchor_wall;
+    model->has_previous_anchor = model->window_samples > 1;
+    model->valid = true;
+    model->window_samples = 0;
+    model->window_end_radio_us = model->last_radio_us + TIMESTAMP_MODEL_WINDOW_US;
+}
+
+int64_t radio_timestamp_to_wall_us(uint32_t radio_timestamp) {
+    hw_timestamp_model_t* model = &hw_timestamp_model;
+    
+    if (model->reset_requested) {
+        model->reset_requested = false;
+        model->valid = false;
+        model->has_previous_anchor = false;
+        model->drift_ppb = 0;
+        model->window_samples = 0;
+        model->next_sample_radio_us = model->last_radio_us;
+        model->window_end_radio_us = model->last_radio_us;
+    }
+    
+    // Unwrap the 32-bit counter relative to the newest frame seen. Frames
+    // come in scheduler order, so one may be older than the previous one;
+    // it is mapped like any other but does not move the newest frame back.
+    int64_t radio_us;
+    if (!model->has_radio_time) {
+        model->has_radio_time = true;
+        model->last_radio_us = radio_timestamp;
+        model->last_radio_low = radio_timestamp;
+        model->next_sample_radio_us = radio_timestamp;
+        radio_us = radio_timestamp;
+    } else {
+        radio_us = model->last_radio_us + (int32_t)(radio_timestamp - model->last_radio_low);
+        if (radio_us > model->last_radio_us) {
+            model->last_radio_us = radio_us;
+            model->last_radio_low = radio_timestamp;
+        }
+    }
+    
+    // Only frames at or past the sample time are sampled, so an older frame,
+    // which waited longer in its queue, never feeds the offset window
+    if (radio_us >= model->next_sample_radio_us) {
+        int64_t wall_us = get_timestamp_microseconds();
+        if (wall_us >= 0) {
+            int64_t offset = wall_us - radio_us;
+            if (model->window_samples == 0 || offset < model->window_min_offset_us) {
+                model->window_min_offset_us = offset;
+                model->window_min_radio_us = radio_us;
+            }
+            model->window_samples++;
+            
+            // The very first sample anchors the model straight away
+            if (!model->valid || radio_us >= model->window_end_radio_us) {
+                close_hw_timestamp_window(model);
+            }
+        }
+        model->next_sample_radio_us = radio_us + TIMESTAMP_MODEL_SAMPLE_INTERVAL_US;
+    }
+    
+    if (!model->valid) {
+        return -1;
+    }
+    
+    int64_t radio_elapsed = radio_us - model->anchor_radio_us;
+    return model->anchor_wall_us + radio_elapsed + radio_elapsed * model->drift_ppb / 1000000000LL;
+}
+
+size_t format_timestamp_microseconds(int64_t timestamp_us, char* buffer, size_t buffer_size) {
+    if (!buffer || buffer_size < TIMESTAMP_STRING_LENGTH) {
+        return 0;
+    }
+    
+    if (timestamp_us < 0) {
+        memcpy(buffer, "0.0", 4);
+        return 3;
+    }
+    
+    uint64_t seconds = (uint64_t)timestamp_us / 1000000ULL;
+    uint32_t microseconds = (uint32_t)((uint64_t)timestamp_us % 1000000ULL);
+    
+    // Seconds are written back to front into a scratch area
+    char digits[20];
+    int digit_count = 0;
+    do {
+        digits[digit_count++] = (char)('0' + seconds % 10);
+        seconds /= 10;
+    } while (seconds > 0);
+    
+    size_t length = 0;
+    while (digit_count > 0) {
+        buffer[length++] = digits[--digit_count];
+    }
+    
+    buffer[length++] = '.';
+    for (int place = 5; place >= 0; place--) {
+        buffer[length + place] = (char)('0' + microseconds % 10);
+        microseconds /= 10;
+    }
+    length += 6;
+    buffer[length] = '\0';
+    
+    return length;
+}
+
+char* get_formatted_timestamp() {
+    struct timeval current_time;
+    if (gettimeofday(&current_time, NULL) != 0) {
+        char* error_timestamp = malloc(20);
+        if (error_timestamp) {
+            strcpy(error_timestamp, "0.0");
+        }
+        return error_timestamp;
+    }
+    
+    // Calculate required buffer size
+    int buffer_size = snprintf(NULL, 0, TIMESTAMP_FORMAT_READABLE, 
+                               (long long)current_time.tv_sec, current_time.tv_usec) + 1;
+    
+    char* formatted_time = malloc(buffer_size);
+    if (!formatted_time) {
+        return NULL;
+    }
+    
+    snprintf(formatted_time, buffer_size, TIMESTAMP_FORMAT_READABLE, 
+             (long long)current_time.tv_sec, current_time.tv_usec);
+    
+    return formatted_time;
+}
+
+bool is_time_synchronized() {
+    return time_sync_established;
+}
+
+void get_current_time_components(long long* seconds, long* microseconds) {  // Changed seconds to long long*
+    struct timeval current_time;
+    if (gettimeofday(&current_time, NULL) == 0) {
+        *seconds = (long long)current_time.tv_sec;  // Cast to long long
+        *microseconds = current_time.tv_usec;
+    } else {
+        *seconds = 0;
+        *microseconds = 0;
+    }
+}
+
+void reset_time_sync_status() {
+    time_sync_established = false;
+}
+
+long get_time_difference_ms(struct timeval* start_time) {
+    struct timeval current_time;
+    if (gettimeofday(&current_time, NULL) != 0) {
+        return -1;
+    }
+    
+    long long seconds_diff = (long long)current_time.tv_sec - (long long)start_time->tv_sec;  // Cast to long long
+    long useconds_diff = current_time.tv_usec - start_time->tv_usec;
+    
+    return (long)(seconds_diff * 1000) + (useconds_diff / 1000);  // Cast result to long
+}
@@ -6,13 +6,46 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
-static bool time_sync_established = false;
+// Offset/drift model mapping the radio's 32-bit microsecond counter
+// (rx_ctrl.timestamp) onto the synchronized wall clock. The processing task
+// samples the wall clock for one frame every TIMESTAMP_MODEL_SAMPLE_INTERVAL_US
+// of radio time; within each window the sample with the smallest
+// wall - radio offset (the one that waited least in the queue) becomes the
+// new anchor, and consecutive anchors give the drift.
+#define TIMESTAMP_MODEL_SAMPLE_INTERVAL_US 20000
+#define TIMESTAMP_MODEL_WINDOW_US          2000000
+#define TIMESTAMP_MODEL_MAX_DRIFT_PPB      500000
+
+typedef struct {
+    bool valid;
+    bool has_radio_time;
+    bool has_previous_anchor;    // Anchor came from a full window, usable for drift
+    volatile bool reset_requested;
+    uint32_t last_radio_low;
+    int64_t last_radio_us;       // Unwrapped radio time of the newest frame
+    int64_t anchor_radio_us;
+    int64_t anchor_wall_us;
+    int64_t drift_ppb;           // Wall clock rate relative to the radio clock
+    int64_t next_sample_radio_us;
+    int64_t window_end_radio_us;
+    int64_t window_min_offset_us;
+    int64_t window_min_radio_us;
+    uint32_t window_samples;
+} hw_timestamp_model_t;
+
+// Discard the model, e.g. after the wall clock was stepped. Safe to call from
+// any task; the processing task re-anchors on its next frame.
+void reset_hw_timestamp_model();
 
 #define TIMESTAMP_FORMAT_EXTENDED "SYNC_TIME: %lld.%ld"
 #define TIMESTAMP_FORMAT_SIMPLE   "%lld.%ld"
 #define TIMESTAMP_FORMAT_READABLE "%lld.%06ld"
 
+// Buffer size that fits any formatted timestamp ("<seconds>.<microseconds>" plus NUL)
+#define TIMESTAMP_STRING_LENGTH 28
+
 typedef struct {
     long long seconds;
     long microseconds;
@@ -20,127 +53,55 @@ typedef struct {
 } timestamp_parse_result_t;
 
 // Enhanced timestamp validation function
-bool validate_timestamp_format(const char* input_string) {
-    if (!input_string) {
-        return false;
-    }
-    
-    long long sec_val;
-    long usec_val;
-    int fields_parsed = sscanf(input_string, TIMESTAMP_FORMAT_EXTENDED, &sec_val, &usec_val);
-    
-    if (fields_parsed > 0) {
-        return true;
-    }
-    
-    fields_parsed = sscanf(input_string, TIMESTAMP_FORMAT_SIMPLE, &sec_val, &usec_val);
-    return (fields_parsed > 0);
-}
-
-timestamp_parse_result_t parse_timestamp_string(const char* timestamp_str) {
-    timestamp_parse_result_t result = {0, 0, false};
-    
-    if (!timestamp_str) {
-        return result;
-    }
-    
-    int parsed_fields = sscanf(timestamp_str, TIMESTAMP_FORMAT_EXTENDED, 
-                               &result.seconds, &result.microseconds);
-    
-    if (parsed_fields <= 0) {
-        parsed_fields = sscanf(timestamp_str, TIMESTAMP_FORMAT_SIMPLE, 
-                               &result.seconds, &result.microseconds);
-    }
-    
-    if (parsed_fields > 0) {
-        result.parse_success = true;
-        if (result.microseconds < 0 || result.microseconds >= 1000000) {
-            result.microseconds = 0;
-        }
-    }
-    
-    return result;
-}
+bool validate_timestamp_format(const char* input_string);
+
+timestamp_parse_result_t parse_timestamp_string(const char* timestamp_str);
+
+// Set the wall clock to a received timestamp. elapsed_since_receipt_us is
+// how long ago the timestamp arrived (the line terminator was received); it
+// is added so time spent classifying and dispatching the command does not
+// end up as clock error.
+bool synchronize_system_time_compensated(const char* timestamp_input, int64_t elapsed_since_receipt_us);
 
 // System time synchronization function with validation
-bool synchronize_system_time(const char* timestamp_input) {
-    timestamp_parse_result_t parsed_time = parse_timestamp_string(timestamp_input);
-    
-    if (!parsed_time.parse_success) {
-        printf("Warning: Failed to parse timestamp format\n");
-        return false;
-    }
-    
-    struct timeval new_time = {
-        .tv_sec = (time_t)parsed_time.seconds,  // Cast to time_t
-        .tv_usec = parsed_time.microseconds
-    };
-    
-    if (settimeofday(&new_time, NULL) == 0) {
-        time_sync_established = true;
-        printf("System time synchronized successfully\n");
-        return true;
-    } else {
-        printf("Error: Failed to set system time\n");
-        return false;
-    }
-}
-
-// Get current timestamp as formatted string with memory management
-char* get_formatted_timestamp() {
-    struct timeval current_time;
-    if (gettimeofday(&current_time, NULL) != 0) {
-        char* error_timestamp = malloc(20);
-        if (error_timestamp) {
-            strcpy(error_timestamp, "0.0");
-        }
-        return error_timestamp;
-    }
-    
-    // Calculate required buffer size
-    int buffer_size = snprintf(NULL, 0, TIMESTAMP_FORMAT_READABLE, 
-                               (long long)current_time.tv_sec, current_time.tv_usec) + 1;
-    
-    char* formatted_time = malloc(buffer_size);
-    if (!formatted_time) {
-        return NULL;
-    }
-    
-    snprintf(formatted_time, buffer_size, TIMESTAMP_FORMAT_READABLE, 
-             (long long)current_time.tv_sec, current_time.tv_usec);
-    
-    return formatted_time;
-}
-
-bool is_time_synchronized() {
-    return time_sync_established;
-}
-
-void get_current_time_components(long long* seconds, long* microseconds) {  // Changed seconds to long long*
-    struct timeval current_time;
-    if (gettimeofday(&current_time, NULL) == 0) {
-        *seconds = (long long)current_time.tv_sec;  // Cast to long long
-        *microseconds = current_time.tv_usec;
-    } else {
-        *seconds = 0;
-        *microseconds = 0;
-    }
-}
-
-void reset_time_sync_status() {
-    time_sync_established = false;
-}
-
-long get_time_difference_ms(struct timeval* start_time) {
-    struct timeval current_time;
-    if (gettimeofday(&current_time, NULL) != 0) {
-        return -1;
-    }
-    
-    long long seconds_diff = (long long)current_time.tv_sec - (long long)start_time->tv_sec;  // Cast to long long
-    long useconds_diff = current_time.tv_usec - start_time->tv_usec;
-    
-    return (long)(seconds_diff * 1000) + (useconds_diff / 1000);  // Cast result to long
-}
+bool synchronize_system_time(const char* timestamp_input);
+
+// Move the wall clock by offset_us at once, as SYNC_TIME does. The hardware
+// timestamp model re-anchors on the next frame.
+bool step_system_time(int64_t offset_us);
+
+// Move the wall clock by offset_us gradually with adjtime(), on top of what
+// is left of an earlier slew. The clock never jumps or runs backwards, so
+// the hardware timestamp model keeps its anchor and follows as drift.
+bool slew_system_time(int64_t offset_us);
+
+// Current wall-clock time in microseconds since the epoch, -1 if the clock
+// cannot be read. Allocation-free, intended for the per-frame hot path.
+int64_t get_timestamp_microseconds();
+
+// Map a frame's rx_ctrl.timestamp to wall-clock microseconds. Must be called
+// for every frame from a single task. Frames may come out of radio order (the
+// encoder takes them per station in round robin) as long as no two are more
+// than about 35 minutes of radio time apart; older ones are mapped but not
+// sampled. Reads the wall clock only once per sample interval; returns -1
+// until the model has an anchor.
+int64_t radio_timestamp_to_wall_us(uint32_t radio_timestamp);
+
+// Format a microsecond timestamp as TIMESTAMP_FORMAT_READABLE into a caller
+// buffer without snprintf or heap use. Negative (unavailable) timestamps are
+// written as "0.0". Returns the string length, or 0 if the buffer is too small.
+size_t format_timestamp_microseconds(int64_t timestamp_us, char* buffer, size_t buffer_size);
+
+// Get current timestamp as formatted string with memory management.
+// Prefer get_timestamp_microseconds() / format_timestamp_microseconds() on hot paths.
+char* get_formatted_timestamp();
+
+bool is_time_synchronized();
+
+void get_current_time_components(long long* seconds, long* microseconds);
+
+void reset_time_sync_status();
+
+long get_time_difference_ms(struct timeval* start_time);
 
 #endif // TIMESTAMP_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,577 @@
+#include "udp_subscribers.h"
+
+static const char *SUBSCRIBER_TAG = "UDP_SUBSCRIBERS";
+
+static udp_subscriber_table_t g_udp_subscribers;
+
+static const char *udp_subscriber_payload_name(uint8_t payload_type)
+{
+    switch (payload_type)
+    {
+    case CSI_WIRE_PAYLOAD_RAW_IQ:
+        return "RAW";
+    case CSI_WIRE_PAYLOAD_AMPLITUDE_Q8:
+        return "AMPLITUDE";
+    case CSI_WIRE_PAYLOAD_PHASE_Q15:
+        return "PHASE";
+    case CSI_WIRE_PAYLOAD_FEATURES:
+        return "FEATURES";
+    default:
+        return "ANY";
+    }
+}
+
+static esp_err_t udp_subscriber_flush(const void *batch_data, size_t batch_length, void *context)
+{
+    udp_subscriber_t *subscriber = (udp_subscriber_t *)context;
+
+    int bytes_sent = send(subscriber->socket_descriptor, batch_data, batch_length, 0);
+    pipeline_stats_record_send(bytes_sent);
+
+    if (bytes_sent < 0)
+    {
+        subscriber->send_failures++;
+        return ESP_FAIL;
+    }
+
+    subscriber->datagrams_sent++;
+    subscriber->bytes_sent += (uint32_t)bytes_sent;
+    return ESP_OK;
+}
+
+// Open the subscriber's socket, connected to its destination
+static esp_err_t udp_subscriber_open(udp_subscriber_t *subscriber, const udp_subscription_t *subscription)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        ESP_LOGE(SUBSCRIBER_TAG, "Failed to create UDP socket: %s", strerror(errno));
+        return ESP_FAIL;
+    }
+
+    // Needed for the subnet broadcast fallback, harmless for unicast
+    int broadcast_enable = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable));
+
+    struct sockaddr_in destination = {0};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(subscription->port);
+    destination.sin_addr.s_addr = subscription->address;
+
+    if (connect(sock, (struct sockaddr *)&destination, sizeof(destination)) < 0)
+    {
+        ESP_LOGE(SUBSCRIBER_TAG, "Failed to connect UDP socket: %s", strerror(errno));
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    esp_err_t result = frame_batcher_init(&subscriber->batcher, g_udp_subscribers.batch_budget,
+                                          g_udp_subscribers.batch_deadline_ms, udp_subscriber_flush, subscriber);
+    if (result != ESP_OK)
+    {
+        close(sock);
+        return result;
+    }
+
+    subscriber->subscription = *subscription;
+    subscriber->socket_descriptor = sock;
+    subscriber->datagrams_sent = 0;
+    subscriber->send_failures = 0;
+    subscriber->bytes_sent = 0;
+    subscriber->active = true;
+    return ESP_OK;
+}
+
+static void udp_subscriber_close(udp_subscriber_t *subscriber)
+{
+    if (!subscriber->active)
+    {
+        return;
+    }
+
+    frame_batcher_flush(&subscriber->batcher);
+    frame_batcher_deinit(&subscriber->batcher);
+    close(subscriber->socket_descriptor);
+    subscriber->socket_descriptor = -1;
+    subscriber->active = false;
+}
+
+static int udp_subscriber_find(uint32_t address, uint16_t port)
+{
+    for (int slot = 0; slot < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; slot++)
+    {
+        udp_subscriber_t *subscriber = &g_udp_subscribers.subscribers[slot];
+        if (subscriber->active && subscriber->subscription.address == address && subscriber->subscription.port == port)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Rebuild the list the record path walks
+static void udp_subscribers_rebuild()
+{
+    uint8_t count = 0;
+    bool any_filter = false;
+
+    for (int slot = 0; slot < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; slot++)
+    {
+        udp_subscriber_t *subscriber = &g_udp_subscribers.subscribers[slot];
+        if (subscriber->active)
+        {
+            g_udp_subscribers.active_slots[count++] = (uint8_t)slot;
+            any_filter |= subscriber->subscription.filter_mac ||
+                          subscriber->subscription.payload_type != UDP_SUBSCRIBER_ANY_PAYLOAD;
+        }
+    }
+
+    g_udp_subscribers.active_count = count;
+    g_udp_subscribers.any_filter = any_filter;
+    g_udp_subscribers.subscriber_count = count;
+
+    // The fallback goes quiet once someone subscribes; send what it still holds
+    if (count > 0 && g_udp_subscribers.fallback.active)
+    {
+        frame_batcher_flush(&g_udp_subscribers.fallback.batcher);
+    }
+}
+
+// Send what a subscriber has pending and give it a batch with the current limits
+static void udp_subscriber_rebatch(udp_subscriber_t *subscriber)
+{
+    if (!subscriber->active)
+    {
+        return;
+    }
+
+    frame_batcher_flush(&subscriber->batcher);
+    frame_batcher_deinit(&subscriber->batcher);
+    if (frame_batcher_init(&subscriber->batcher, g_udp_subscribers.batch_budget, g_udp_subscribers.batch_deadline_ms,
+                           udp_subscriber_flush, subscriber) != ESP_OK)
+    {
+        ESP_LOGE(SUBSCRIBER_TAG, "Failed to allocate UDP batch buffer, dropping subscriber");
+        close(subscriber->socket_descriptor);
+        subscriber->socket_descriptor = -1;
+        subscriber->active = false;
+    }
+}
+
+static void udp_subscribers_apply(const udp_subscriber_change_t *change)
+{
+    if (change->op == UDP_SUBSCRIBER_SET_BATCH)
+    {
+        g_udp_subscribers.batch_budget = change->batch_budget;
+        g_udp_subscribers.batch_deadline_ms = change->batch_deadline_ms;
+        for (int slot = 0; slot < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; slot++)
+        {
+            udp_subscriber_rebatch(&g_udp_subscribers.subscribers[slot]);
+        }
+        udp_subscriber_rebatch(&g_udp_subscribers.fallback);
+        return;
+    }
+
+    const udp_subscription_t *subscription = &change->subscription;
+    char address_text[16];
+    inet_ntop(AF_INET, &subscription->address, address_text, sizeof(address_text));
+
+    if (change->op == UDP_SUBSCRIBER_SET_FALLBACK)
+    {
+        udp_subscriber_close(&g_udp_subscribers.fallback);
+        if (subscription->address != 0 && udp_subscriber_open(&g_udp_subscribers.fallback, subscription) == ESP_OK)
+        {
+            ESP_LOGI(SUBSCRIBER_TAG, "Fallback destination %s:%u", address_text, subscription->port);
+        }
+        return;
+    }
+
+    int slot = udp_subscriber_find(subscription->address, subscription->port);
+
+    if (change->op == UDP_SUBSCRIBER_REMOVE)
+    {
+        // Port 0 removes every subscription of the address
+        for (int index = 0; index < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; index++)
+        {
+            udp_subscriber_t *subscriber = &g_udp_subscribers.subscribers[index];
+            if (subscriber->active && subscriber->subscription.address == subscription->address &&
+                (subscription->port == 0 || subscriber->subscription.port == subscription->port))
+            {
+                ESP_LOGI(SUBSCRIBER_TAG, "Unsubscribed %s:%u", address_text, subscriber->subscription.port);
+                udp_subscriber_close(subscriber);
+            }
+        }
+        return;
+    }
+
+    // Re-subscribing replaces the filter and keeps the socket
+    if (slot >= 0)
+    {
+        g_udp_subscribers.subscribers[slot].subscription = *subscription;
+        return;
+    }
+
+    for (slot = 0; slot < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; slot++)
+    {
+        if (!g_udp_subscribers.subscribers[slot].active)
+        {
+            break;
+        }
+    }
+    if (slot == CONFIG_CSI_UDP_MAX_SUBSCRIBERS)
+    {
+        ESP_LOGW(SUBSCRIBER_TAG, "Subscriber table full, ignoring %s:%u", address_text, subscription->port);
+        return;
+    }
+
+    if (udp_subscriber_open(&g_udp_subscribers.subscribers[slot], subscription) == ESP_OK)
+    {
+        ESP_LOGI(SUBSCRIBER_TAG, "Subscribed %s:%u", address_text, subscription->port);
+    }
+}
+
+esp_err_t udp_subscribers_init(size_t batch_budget, uint32_t batch_deadline_ms)
+{
+    g_udp_subscribers.changes = xQueueCreate(UDP_SUBSCRIBER_CHANGE_QUEUE_DEPTH, sizeof(udp_subscriber_change_t));
+    if (!g_udp_subscribers.changes)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_udp_subscribers.batch_budget = batch_budget;
+    g_udp_subscribers.batch_deadline_ms = batch_deadline_ms;
+    return ESP_OK;
+}
+
+// Any task: queue a change for the UDP sink task
+static esp_err_t udp_subscribers_post(const udp_subscriber_change_t *change)
+{
+    if (!g_udp_subscribers.changes)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xQueueSend(g_udp_subscribers.changes, change, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (g_csi_sinks[CSI_SINK_UDP].task)
+    {
+        xTaskNotifyGive(g_csi_sinks[CSI_SINK_UDP].task);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t udp_subscribers_request(udp_subscriber_change_op_t op, const udp_subscription_t *subscription)
+{
+    udp_subscriber_change_t change = {.op = op, .subscription = *subscription};
+    return udp_subscribers_post(&change);
+}
+
+esp_err_t udp_subscribers_add(const udp_subscription_t *subscription)
+{
+    return udp_subscribers_request(UDP_SUBSCRIBER_ADD, subscription);
+}
+
+esp_err_t udp_subscribers_remove(uint32_t address, uint16_t port)
+{
+    udp_subscription_t subscription = {.address = address, .port = port};
+    return udp_subscribers_request(UDP_SUBSCRIBER_REMOVE, &subscription);
+}
+
+esp_err_t udp_subscribers_set_fallback(uint32_t address, uint16_t port)
+{
+    udp_subscription_t subscription = {.address = address, .port = port};
+    return udp_subscribers_request(UDP_SUBSCRIBER_SET_FALLBACK, &subscription);
+}
+
+esp_err_t udp_subscribers_set_batch(size_t batch_budget, uint32_t batch_deadline_ms)
+{
+    if (batch_budget == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    udp_subscriber_change_t change = {
+        .op = UDP_SUBSCRIBER_SET_BATCH,
+        .batch_budget = (uint32_t)batch_budget,
+        .batch_deadline_ms = batch_deadline_ms};
+    return udp_subscribers_post(&change);
+}
+
+uint8_t udp_subscribers_count()
+{
+    return g_udp_subscribers.subscriber_count;
+}
+
+void udp_subscribers_apply_changes()
+{
+    if (!g_udp_subscribers.changes)
+    {
+        return;
+    }
+
+    udp_subscriber_change_t change;
+    bool changed = false;
+    while (xQueueReceive(g_udp_subscribers.changes, &change, 0) == pdTRUE)
+    {
+        udp_subscribers_apply(&change);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        udp_subscribers_rebuild();
+    }
+}
+
+// Station MAC and payload type of an encoded record. Text records carry the
+// MAC as the third field and report UDP_SUBSCRIBER_ANY_PAYLOAD.
+static bool udp_subscriber_inspect(const uint8_t *record, size_t record_length, uint8_t mac[6], uint8_t *payload_type)
+{
+    if (record_length >= sizeof(csi_wire_record_header_t) && record[0] == (CSI_WIRE_MAGIC & 0xFF) &&
+        record[1] == (CSI_WIRE_MAGIC >> 8))
+    {
+        const csi_wire_record_header_t *header = (const csi_wire_record_header_t *)record;
+        memcpy(mac, header->mac, 6);
+        // A PHASE subscription takes phase records whether they are sanitized or not
+        *payload_type = header->payload_type == CSI_WIRE_PAYLOAD_PHASE_SANITIZED ? CSI_WIRE_PAYLOAD_PHASE_Q15
+                                                                                 : header->payload_type;
+        return true;
+    }
+
+    size_t position = 0;
+    for (int commas = 0; commas < 2 && position < record_length; position++)
+    {
+        commas += record[position] == ',';
+    }
+    if (position + 17 > record_length)
+    {
+        return false;
+    }
+
+    for (int octet = 0; octet < 6; octet++)
+    {
+        int high = udp_subscriber_hex_value((char)record[position + octet * 3]);
+        int low = udp_subscriber_hex_value((char)record[position + octet * 3 + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        mac[octet] = (uint8_t)(high << 4 | low);
+    }
+    *payload_type = UDP_SUBSCRIBER_ANY_PAYLOAD;
+    return true;
+}
+
+esp_err_t udp_subscribers_append(const uint8_t *record, size_t record_length)
+{
+    if (g_udp_subscribers.active_count == 0)
+    {
+        return g_udp_subscribers.fallback.active
+                   ? frame_batcher_append(&g_udp_subscribers.fallback.batcher, record, record_length)
+                   : ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t mac[6] = {0};
+    uint8_t payload_type = UDP_SUBSCRIBER_ANY_PAYLOAD;
+    bool inspected = g_udp_subscribers.any_filter && udp_subscriber_inspect(record, record_length, mac, &payload_type);
+
+    esp_err_t result = ESP_OK;
+    for (uint8_t index = 0; index < g_udp_subscribers.active_count; index++)
+    {
+        udp_subscriber_t *subscriber = &g_udp_subscribers.subscribers[g_udp_subscribers.active_slots[index]];
+        if (inspected && !udp_subscriber_wants(&subscriber->subscription, mac, payload_type))
+        {
+            continue;
+        }
+        if (frame_batcher_append(&subscriber->batcher, record, record_length) != ESP_OK)
+        {
+            result = ESP_FAIL;
+        }
+    }
+    return result;
+}
+
+int64_t udp_subscribers_poll()
+{
+    if (g_udp_subscribers.active_count == 0)
+    {
+        if (!g_udp_subscribers.fallback.active)
+        {
+            return -1;
+        }
+        frame_batcher_poll(&g_udp_subscribers.fallback.batcher);
+        return frame_batcher_time_to_deadline_us(&g_udp_subscribers.fallback.batcher);
+    }
+
+    int64_t wait_us = -1;
+    for (uint8_t index = 0; index < g_udp_subscribers.active_count; index++)
+    {
+        frame_batcher_t *batcher = &g_udp_subscribers.subscribers[g_udp_subscribers.active_slots[index]].batcher;
+        frame_batcher_poll(batcher);
+
+        int64_t remaining_us = frame_batcher_time_to_deadline_us(batcher);
+        if (remaining_us >= 0 && (wait_us < 0 || remaining_us < wait_us))
+        {
+            wait_us = remaining_us;
+        }
+    }
+    return wait_us;
+}
+
+void udp_subscribers_send_all(const void *data, size_t length)
+{
+    if (g_udp_subscribers.active_count == 0)
+    {
+        if (g_udp_subscribers.fallback.active)
+        {
+            udp_subscriber_flush(data, length, &g_udp_subscribers.fallback);
+        }
+        return;
+    }
+
+    for (uint8_t index = 0; index < g_udp_subscribers.active_count; index++)
+    {
+        udp_subscriber_flush(data, length, &g_udp_subscribers.subscribers[g_udp_subscribers.active_slots[index]]);
+    }
+}
+
+static void udp_subscriber_print(const char *label, const udp_subscriber_t *subscriber)
+{
+    char address_text[16];
+    const udp_subscription_t *subscription = &subscriber->subscription;
+    inet_ntop(AF_INET, &subscription->address, address_text, sizeof(address_text));
+
+    printf("%s %s:%u", label, address_text, subscription->port);
+    if (subscription->filter_mac)
+    {
+        printf(" mac=%02x:%02x:%02x:%02x:%02x:%02x", subscription->mac[0], subscription->mac[1],
+               subscription->mac[2], subscription->mac[3], subscription->mac[4], subscription->mac[5]);
+    }
+    if (subscription->payload_type != UDP_SUBSCRIBER_ANY_PAYLOAD)
+    {
+        printf(" payload=%s", udp_subscriber_payload_name(subscription->payload_type));
+    }
+    printf(", %lu datagrams (%llu bytes), %lu failures\n", (unsigned long)subscriber->datagrams_sent,
+           (unsigned long long)subscriber->bytes_sent, (unsigned long)subscriber->send_failures);
+}
+
+void udp_subscribers_print()
+{
+    printf("UDP subscribers: %u of %d\n", g_udp_subscribers.subscriber_count, CONFIG_CSI_UDP_MAX_SUBSCRIBERS);
+    for (int slot = 0; slot < CONFIG_CSI_UDP_MAX_SUBSCRIBERS; slot++)
+    {
+        if (g_udp_subscribers.subscribers[slot].active)
+        {
+            udp_subscriber_print("  Subscriber", &g_udp_subscribers.subscribers[slot]);
+        }
+    }
+    if (g_udp_subscribers.fallback.active)
+    {
+        udp_subscriber_print(g_udp_subscribers.subscriber_count ? "  Fallback (idle)" : "  Fallback", &g_udp_subscribers.fallback);
+    }
+}
+
+// "a.b.c.d" or "a.b.c.d:port", default_port when the port is left out
+static bool udp_subscriber_parse_destination(const char *text, uint16_t default_port, uint32_t *address,
+                                             uint16_t *port)
+{
+    char address_text[16] = {0};
+    unsigned int parsed_port = default_port;
+
+    int fields = sscanf(text, "%15[0-9.]:%u", address_text, &parsed_port);
+    if (fields < 1 || (fields == 2 && parsed_port == 0) || parsed_port > 65535)
+    {
+        return false;
+    }
+
+    struct in_addr parsed_address;
+    if (inet_pton(AF_INET, address_text, &parsed_address) != 1)
+    {
+        return false;
+    }
+
+    *address = parsed_address.s_addr;
+    *port = (uint16_t)parsed_port;
+    return true;
+}
+
+static bool udp_subscriber_parse_payload_type(const char *text, uint8_t *payload_type)
+{
+    static const uint8_t payload_types[] = {UDP_SUBSCRIBER_ANY_PAYLOAD, CSI_WIRE_PAYLOAD_RAW_IQ,
+                                            CSI_WIRE_PAYLOAD_AMPLITUDE_Q8, CSI_WIRE_PAYLOAD_PHASE_Q15,
+                                            CSI_WIRE_PAYLOAD_FEATURES};
+
+    for (size_t index = 0; index < sizeof(payload_types); index++)
+    {
+        if (strcasecmp(text, udp_subscriber_payload_name(payload_types[index])) == 0)
+        {
+            *payload_type = payload_types[index];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool udp_subscriber_parse_filters(const char *mac_text, const char *payload_text, udp_subscription_t *subscription)
+{
+    subscription->filter_mac = false;
+    subscription->payload_type = UDP_SUBSCRIBER_ANY_PAYLOAD;
+
+    if (mac_text[0] && strcasecmp(mac_text, "ANY") != 0)
+    {
+        if (!parse_mac_address(mac_text, subscription->mac))
+        {
+            return false;
+        }
+        subscription->filter_mac = true;
+    }
+    return !payload_text[0] || udp_subscriber_parse_payload_type(payload_text, &subscription->payload_type);
+}
+
+bool udp_subscribers_command(const char *arguments)
+{
+    char action[8] = {0};
+    char destination[24] = {0};
+    char mac_text[20] = {0};
+    char payload_text[12] = {0};
+    sscanf(arguments, "%7s %23s %19s %11s", action, destination, mac_text, payload_text);
+
+    if (strcasecmp(action, "LIST") == 0)
+    {
+        udp_subscribers_print();
+        return true;
+    }
+
+    // DEL without a port removes every subscription of the address
+    bool remove = strcasecmp(action, "DEL") == 0;
+    udp_subscription_t subscription = {0};
+    bool valid = udp_subscriber_parse_destination(destination, remove ? 0 : UDP_SUBSCRIBER_DEFAULT_PORT,
+                                                  &subscription.address, &subscription.port) &&
+                 udp_subscriber_parse_filters(mac_text, payload_text, &subscription);
+
+    esp_err_t result;
+    if (valid && strcasecmp(action, "ADD") == 0)
+    {
+        result = udp_subscribers_add(&subscription);
+    }
+    else if (valid && remove)
+    {
+        result = udp_subscribers_remove(subscription.address, subscription.port);
+    }
+    else
+    {
+        printf("Usage: CSI_SUBSCRIBE ADD <ip>[:port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY] | DEL <ip>[:port] (all ports if omitted) | LIST\n");
+        return false;
+    }
+
+    if (result != ESP_OK)
+    {
+        printf("Subscriber update failed: %s\n", esp_err_to_name(result));
+        return false;
+    }
+
+    printf("Subscriber update queued for %s\n", destination);
+    return true;
+}
@@ -0,0 +1,154 @@
+#ifndef UDP_SUBSCRIBERS_H
+#define UDP_SUBSCRIBERS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "csi_wire_format.h"
+#include "csi_sink.h"
+#include "frame_batcher.h"
+#include "mac_allowlist.h"
+#include "pipeline_stats.h"
+
+// Hosts receiving the UDP stream. Every subscriber gets its own connect()-ed
+// socket and its own batch, so sending is a plain send() with no address
+// parsing or sockaddr rebuild per datagram. A subscriber may restrict itself
+// to one station MAC and/or one binary payload type.
+//
+// The table belongs to the UDP sink task. Other tasks (commands, discovery)
+// only post membership and batch changes to a queue; the sink task applies
+// them when idle and rebuilds its list of active subscribers, so the
+// per-record path never takes a lock. The fallback destination (normally the subnet
+// broadcast) is only used while nobody is subscribed.
+
+#ifndef CONFIG_CSI_UDP_MAX_SUBSCRIBERS
+#define CONFIG_CSI_UDP_MAX_SUBSCRIBERS 4
+#endif
+
+#define UDP_SUBSCRIBER_DEFAULT_PORT 9999
+#define UDP_SUBSCRIBER_CHANGE_QUEUE_DEPTH 8
+#define UDP_SUBSCRIBER_ANY_PAYLOAD 0
+
+typedef struct
+{
+    uint32_t address; // IPv4, network byte order
+    uint16_t port;    // Host byte order
+    bool filter_mac;
+    uint8_t mac[6];
+    uint8_t payload_type; // csi_wire_payload_type_t, or UDP_SUBSCRIBER_ANY_PAYLOAD
+} udp_subscription_t;
+
+typedef struct
+{
+    bool active;
+    udp_subscription_t subscription;
+    int socket_descriptor;
+    frame_batcher_t batcher;
+    uint32_t datagrams_sent;
+    uint32_t send_failures;
+    uint64_t bytes_sent;
+} udp_subscriber_t;
+
+typedef enum
+{
+    UDP_SUBSCRIBER_ADD = 0,
+    UDP_SUBSCRIBER_REMOVE = 1,
+    UDP_SUBSCRIBER_SET_FALLBACK = 2,
+    UDP_SUBSCRIBER_SET_BATCH = 3
+} udp_subscriber_change_op_t;
+
+typedef struct
+{
+    udp_subscriber_change_op_t op;
+    udp_subscription_t subscription;
+    uint32_t batch_budget; // UDP_SUBSCRIBER_SET_BATCH
+    uint32_t batch_deadline_ms;
+} udp_subscriber_change_t;
+
+typedef struct
+{
+    // Sink task only
+    udp_subscriber_t subscribers[CONFIG_CSI_UDP_MAX_SUBSCRIBERS];
+    uint8_t active_slots[CONFIG_CSI_UDP_MAX_SUBSCRIBERS]; // Rebuilt on membership change
+    uint8_t active_count;
+    bool any_filter;
+    udp_subscriber_t fallback;
+    size_t batch_budget;
+    uint32_t batch_deadline_ms;
+
+    QueueHandle_t changes;
+    volatile uint8_t subscriber_count; // Readable from any task
+} udp_subscriber_table_t;
+
+esp_err_t udp_subscribers_init(size_t batch_budget, uint32_t batch_deadline_ms);
+
+esp_err_t udp_subscribers_add(const udp_subscription_t *subscription);
+
+// A port of 0 removes every subscription of the address
+esp_err_t udp_subscribers_remove(uint32_t address, uint16_t port);
+
+// Destination used while the table is empty; address 0 disables it
+esp_err_t udp_subscribers_set_fallback(uint32_t address, uint16_t port);
+
+// Batch limits for every subscriber; pending batches are sent first
+esp_err_t udp_subscribers_set_batch(size_t batch_budget, uint32_t batch_deadline_ms);
+
+uint8_t udp_subscribers_count();
+
+// Sink task: apply queued membership changes, rebuilding the table once
+void udp_subscribers_apply_changes();
+
+static inline int udp_subscriber_hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 0x20;
+    return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+static inline bool udp_subscriber_wants(const udp_subscription_t *subscription, const uint8_t mac[6], uint8_t payload_type)
+{
+    if (subscription->filter_mac && memcmp(subscription->mac, mac, 6) != 0)
+    {
+        return false;
+    }
+    return subscription->payload_type == UDP_SUBSCRIBER_ANY_PAYLOAD || payload_type == UDP_SUBSCRIBER_ANY_PAYLOAD ||
+           subscription->payload_type == payload_type;
+}
+
+// Sink task: batch a record for every subscriber whose filter matches
+esp_err_t udp_subscribers_append(const uint8_t *record, size_t record_length);
+
+// Sink task: send batches whose deadline passed, returns the microseconds
+// until the next deadline or -1 if nothing is pending
+int64_t udp_subscribers_poll();
+
+// Sink task: send one datagram to every subscriber, unfiltered (telemetry)
+void udp_subscribers_send_all(const void *data, size_t length);
+
+// Snapshot from another task; counters may be slightly stale
+void udp_subscribers_print();
+
+// Optional "[mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY]" filters, empty strings keep everything
+bool udp_subscriber_parse_filters(const char *mac_text, const char *payload_text, udp_subscription_t *subscription);
+
+// CSI_SUBSCRIBE ADD <ip>[:port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY] | DEL <ip>[:port] | LIST
+// DEL without a port removes every subscription of the address.
+bool udp_subscribers_command(const char *arguments);
+
+#endif // UDP_SUBSCRIBERS_H
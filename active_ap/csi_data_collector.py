@@ -5,20 +5,278 @@ import time
 import os
 import signal
 import sys
+import struct
+import subprocess
 from datetime import datetime
 from queue import Queue, Empty
 
+# Binary wire record layout (see _components/csi_wire_format.h)
+CSI_WIRE_MAGIC = 0x1DC5
+CSI_WIRE_VERSION = 4
+CSI_WIRE_SUPPORTED_VERSIONS = (1, 2, 3, 4)  # Version 1 records are never compressed
+CSI_WIRE_HEADER = struct.Struct('<HBBH6sBBq' 'bBBBBBBbBBBBIHBB' 'HH')
+CSI_WIRE_STREAM = struct.Struct('<IHHHH')  # csi_wire_stream_t, ends the header from version 3
+CSI_WIRE_LAYOUT = struct.Struct('<BBHHH')  # csi_wire_layout_t, after the stream block from version 4
+CAPTURE_PROFILES = ('LLTF', 'HTLTF', 'HTLTF_STBC', 'FULL')  # See _components/csi_capture_profile.h
+CSI_WIRE_PAYLOAD_RAW_IQ = 1
+CSI_WIRE_PAYLOAD_AMPLITUDE_Q8 = 2
+CSI_WIRE_PAYLOAD_PHASE_Q15 = 3
+CSI_WIRE_PAYLOAD_FEATURES = 4
+CSI_WIRE_PAYLOAD_PHASE_SANITIZED = 5
+CSI_WIRE_FEATURES = struct.Struct('<HHbBff')  # csi_wire_features_t
+CSI_WIRE_FLAG_TIME_SYNCED = 0x01
+CSI_WIRE_FLAG_COMPRESSED = 0x02
+CSI_WIRE_FLAG_DELTA = 0x04
+
+# Pipeline telemetry datagram sent by the AP (see _components/pipeline_stats.h)
+TELEMETRY_PREFIX = b'CSI_STATS,'
+TELEMETRY_FIELDS = [
+    'uptime_us', 'seen', 'filtered', 'alloc_fail', 'queue_drops', 'queue_hwm',
+    'encoded', 'ring_drops', 'cycles_min', 'cycles_avg', 'cycles_max',
+    'datagrams', 'send_fail', 'bytes_sent', 'decimated',
+    'stim_rate_hz', 'stim_targets', 'stim_sent_hz', 'stim_reply_hz',
+    'stim_late_avg_us', 'stim_late_max_us', 'stim_missed',
+    'replay_rate_hz', 'replay_stations', 'replay_sent_hz', 'replay_skipped',
+    'time_offset_us', 'time_rtt_us', 'time_drift_ppb'
+]
+
+# Control port on the AP, next to the data port (see _components/control_channel.h)
+CONTROL_PORT = 10000
+AP_ADDRESS = '192.168.4.1'
+HELLO_INTERVAL_S = 10  # Re-subscribe periodically so an AP reboot picks us up again
+
+# Time server for the AP's clock sync (see _components/time_sync.h)
+TIME_SYNC_PORT = 10001
+TIME_SYNC_PACKET = struct.Struct('<4sBBHIqqq')  # time_sync_packet_t
+TIME_SYNC_MAGIC = b'CSIT'
+TIME_SYNC_REQUEST = 1
+TIME_SYNC_RESPONSE = 2
+
+# Load test replay on the AP (see _components/csi_replay.h)
+REPLAY_HEADER_FIELDS = ['rssi', 'rate', 'sig_mode', 'mcs', 'bandwidth', 'stbc', 'noise_floor', 'channel',
+                        'secondary_channel', 'sig_len', 'len']
+REPLAY_DATA_CHUNK = 200  # Bytes per CSI_REPLAY DATA command
+
+# Native receiver for high rates (see host_receiver/), CSI_RECEIVER overrides the path
+NATIVE_RECEIVER = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'host_receiver', 'build', 'csi_receiver')
+
+def send_control_command(command, host=AP_ADDRESS, port=CONTROL_PORT, timeout=1.0, retries=3):
+    """Run a console command on the AP. Returns (ok, output) or None if it never answered."""
+    request_id = str(int(time.time() * 1000) % 1000000000)
+    request = f"#{request_id} {command}".encode('utf-8')
+    ack_prefix = f"ACK {request_id} ".encode('utf-8')
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(timeout)
+        for _ in range(retries):
+            sock.sendto(request, (host, port))
+            try:
+                while True:
+                    response, _ = sock.recvfrom(2048)
+                    if response.startswith(ack_prefix):
+                        status, _, output = response[len(ack_prefix):].partition(b'\n')
+                        return status == b'OK', output.decode('utf-8', errors='replace')
+            except socket.timeout:
+                continue
+    return None
+
+def parse_telemetry(data):
+    parts = data.decode('utf-8', errors='ignore').strip().split(',')[1:]
+    stats = {}
+    for name, value in zip(TELEMETRY_FIELDS, parts):
+        stats[name] = int(value)
+    for task_entry in parts[len(TELEMETRY_FIELDS):]:
+        task_name, _, stack_free = task_entry.partition('=')
+        stats['stack_' + task_name] = int(stack_free or 0)
+    return stats
+
+def decode_zigzag_varints(data, offset, count):
+    """Read count zigzag varints starting at offset."""
+    values = []
+    for _ in range(count):
+        result = 0
+        shift = 0
+        while True:
+            byte = data[offset]
+            offset += 1
+            result |= (byte & 0x7F) << shift
+            if byte < 0x80:
+                break
+            shift += 7
+        values.append((result >> 1) ^ -(result & 1))
+    return values
+
+class PayloadDecompressor:
+    """Undo the per-station delta + zigzag-varint coding (see _components/csi_compression.h).
+    
+    Keyframes predict each value from the previous one in the same record,
+    delta records from the same position of the station's previous record.
+    A delta whose reference was lost is dropped until the next keyframe.
+    """
+    def __init__(self):
+        self.references = {}
+        self.discarded = 0
+    
+    def decode(self, mac, payload_type, flags, sequence, data, offset, count):
+        bits = 8 if payload_type == CSI_WIRE_PAYLOAD_RAW_IQ else 16
+        signed = payload_type != CSI_WIRE_PAYLOAD_AMPLITUDE_Q8
+        differences = decode_zigzag_varints(data, offset, count)
+        
+        def wrap(value):
+            value &= (1 << bits) - 1
+            return value - (1 << bits) if signed and value >= 1 << (bits - 1) else value
+        
+        if flags & CSI_WIRE_FLAG_DELTA:
+            reference = self.references.get(mac)
+            if (reference is None or reference[0] != (sequence - 1) & 0xFF or
+                    reference[1] != payload_type or len(reference[2]) != count):
+                self.references.pop(mac, None)
+                self.discarded += 1
+                return None
+            values = [wrap(previous + difference) for previous, difference in zip(reference[2], differences)]
+        else:
+            values = []
+            previous = 0
+            for difference in differences:
+                previous = wrap(previous + difference)
+                values.append(previous)
+        
+        self.references[mac] = (sequence, payload_type, values)
+        return values
+
+STREAM_COLUMNS = ['frame_sequence', 'alloc_drops', 'queue_drops', 'decimated', 'ring_drops']
+# Pairs of each training field in CSI_DATA, in this order
+LAYOUT_COLUMNS = ['capture_profile', 'lltf_subcarriers', 'htltf_subcarriers', 'stbc_htltf_subcarriers']
+TRAILING_COLUMNS = STREAM_COLUMNS + LAYOUT_COLUMNS
+REORDER_RESET_WINDOW = 4096  # A sequence this far behind means the AP restarted
+
+class StationStream:
+    """Loss, reorder and jitter of one station's frame sequence (see _components/csi_streams.h)."""
+    def __init__(self, sequence, counters, device_time_us, arrival_time):
+        self.first_sequence = sequence
+        self.max_sequence = sequence
+        self.counters = counters
+        self.received = 1
+        self.missing = 0       # Sequence numbers not (yet) seen
+        self.device_drops = 0  # Of those, dropped on the AP by one of its stages
+        self.reordered = 0
+        self.duplicates = 0
+        self.jitter_s = 0.0
+        self.transit_s = arrival_time - device_time_us / 1e6
+
+    def update(self, sequence, counters, device_time_us, arrival_time):
+        self.received += 1
+        if sequence == self.max_sequence:
+            self.duplicates += 1
+            return
+        if sequence < self.max_sequence:
+            self.reordered += 1
+            self.missing = max(0, self.missing - 1)
+            return
+
+        self.missing += sequence - self.max_sequence - 1
+        self.max_sequence = sequence
+        # Counters wrap at 16 bits on the wire
+        self.device_drops += sum((new - old) & 0xFFFF for new, old in zip(counters, self.counters))
+        self.counters = counters
+
+        # RFC 3550 interarrival jitter; the radio timestamp wraps every 2^32 us
+        transit_s = arrival_time - device_time_us / 1e6
+        difference = transit_s - self.transit_s
+        difference -= round(difference / 4294.967296) * 4294.967296
+        self.transit_s = transit_s
+        self.jitter_s += (abs(difference) - self.jitter_s) / 16
+
+    def expected(self):
+        return self.max_sequence - self.first_sequence + 1
+
+    def network_loss(self):
+        # Device counters are stamped when a record is encoded, so they can run a little ahead
+        return max(0, self.missing - self.device_drops)
+
+class StreamMonitor:
+    """Per-station stream accounting from the frame_sequence and drop counter columns."""
+    def __init__(self):
+        self.stations = {}
+
+    def update(self, mac, sequence, counters, device_time_us, arrival_time):
+        if not sequence:
+            return  # Untracked station or a record without stream columns
+        station = self.stations.get(mac)
+        if station is None or sequence + REORDER_RESET_WINDOW < station.max_sequence:
+            self.stations[mac] = StationStream(sequence, counters, device_time_us, arrival_time)
+        else:
+            station.update(sequence, counters, device_time_us, arrival_time)
+
+    def status(self, limit=4):
+        # The stations losing the most first
+        stations = sorted(self.stations.items(), key=lambda item: item[1].missing, reverse=True)
+        segments = []
+        for mac, station in stations[:limit]:
+            loss = 100.0 * station.missing / station.expected()
+            segments.append(
+                f"{mac[-8:]} loss {loss:.1f}% (AP {station.device_drops} net {station.network_loss()}) "
+                f"reorder {station.reordered} jitter {station.jitter_s * 1000:.1f}ms")
+        if len(stations) > limit:
+            segments.append(f"+{len(stations) - limit} stations")
+        return ' | '.join(segments)
+
+def is_binary_record(data):
+    return len(data) >= 2 and struct.unpack_from('<H', data)[0] == CSI_WIRE_MAGIC
+
+def split_batched_records(data):
+    """Split one datagram into the frames the device batched into it.
+    
+    Binary records are delimited by their record_length field, text records
+    by their trailing newline. Both kinds may appear in the same datagram.
+    """
+    records = []
+    offset = 0
+    while offset < len(data):
+        if is_binary_record(data[offset:offset + 2]):
+            if len(data) - offset < CSI_WIRE_HEADER.size:
+                records.append(data[offset:])
+                break
+            record_length = struct.unpack_from('<H', data, offset + 4)[0]
+            if record_length < CSI_WIRE_HEADER.size:
+                records.append(data[offset:])
+                break
+            records.append(data[offset:offset + record_length])
+            offset += record_length
+        else:
+            end = data.find(b'\n', offset)
+            if end < 0:
+                end = len(data) - 1
+            line = data[offset:end + 1]
+            if line.strip():
+                records.append(line)
+            offset = end + 1
+    return records
+
 class CSIDataCollector:
     def __init__(self, port=9999, output_file="csi_data.csv"):
         self.port = port
         self.output_file = output_file
         self.is_collecting = False
+        self.time_server = False
         self.packet_count = 0
+        self.frame_count = 0
         self.data_queue = Queue()
         self.socket = None
         
         self.last_status_time = 0
         self.last_packet_count = 0
+        self.last_frame_count = 0
+        self.device_stats = None
+        self.decompressor = PayloadDecompressor()
+        
+        # CSI_MODE FEATURES records go to their own file next to the frames
+        stem, extension = os.path.splitext(output_file)
+        self.features_file = f"{stem}_features{extension or '.csv'}"
+        self.features_headers = [
+            'type', 'role', 'mac', 'rssi_mean', 'real_timestamp', 'frames', 'window',
+            'energy', 'motion_score', 'subcarrier_stats'
+        ] + TRAILING_COLUMNS + ['pc_timestamp']
 
         self.csv_headers = [
             'type', 'role', 'mac', 'rssi', 'rate', 'sig_mode', 'mcs', 
@@ -26,8 +284,9 @@ class CSIDataCollector:
             'stbc', 'fec_coding', 'sgi', 'noise_floor', 'ampdu_cnt', 
             'channel', 'secondary_channel', 'local_timestamp', 'ant', 
             'sig_len', 'rx_state', 'real_time_set', 'real_timestamp', 
-            'len', 'CSI_DATA', 'pc_timestamp'
-        ]
+            'len', 'CSI_DATA'
+        ] + TRAILING_COLUMNS + ['pc_timestamp']
+        self.stream_monitor = StreamMonitor()
         
         signal.signal(signal.SIGINT, self.signal_handler)
         signal.signal(signal.SIGTERM, self.signal_handler)
@@ -58,7 +317,30 @@ class CSIDataCollector:
             print(f"Error setting up UDP socket: {e}")
             return False
     
+    @staticmethod
+    def parse_trailing_columns(raw_data):
+        """The stream counter and capture layout columns after the closing bracket."""
+        columns = raw_data.strip().rpartition(']')[2].strip(',').split(',')
+        if len(columns) == len(STREAM_COLUMNS):
+            columns += [''] * len(LAYOUT_COLUMNS)  # Firmware without capture profiles
+        if len(columns) != len(TRAILING_COLUMNS):
+            return [''] * len(TRAILING_COLUMNS)  # Firmware without stream counters
+        return columns
+
+    def parse_feature_text(self, raw_data):
+        """CSI_FEATURES,<role>,<mac>,<rssi_mean>,<timestamp>,<frames>,<window>,<energy>,<motion>,[<mean>:<stddev> ...],<stream>"""
+        head, _, rest = raw_data.strip().partition('[')
+        parts = head.rstrip(',').split(',')
+        if len(parts) < 9:
+            print(f"Warning: Incomplete feature record received: {len(parts)} fields")
+            return None
+        stats = rest.partition(']')[0].strip()
+        pc_timestamp = datetime.now().strftime("%Y-%m-%d %H:%M:%S.%f")[:-3]
+        return parts[:9] + [stats] + self.parse_trailing_columns(raw_data) + [pc_timestamp]
+    
     def parse_csi_data(self, raw_data):
+        if raw_data.startswith('CSI_FEATURES,'):
+            return self.parse_feature_text(raw_data)
         try:
             data_parts = raw_data.strip().split(',')
             
@@ -105,6 +387,7 @@ class CSIDataCollector:
                     data_parts[23],  # real_timestamp
                     data_parts[24],  # len
                     csi_data_str,    # CSI_DATA
+                ] + self.parse_trailing_columns(raw_data) + [
                     pc_timestamp     # pc_timestamp
                 ]
             
@@ -115,20 +398,118 @@ class CSIDataCollector:
             print(f"Raw data: {raw_data[:100]}...")
             return None
     
+    def parse_binary_record(self, data):
+        try:
+            if len(data) < CSI_WIRE_HEADER.size:
+                print(f"Warning: Truncated binary record received: {len(data)} bytes")
+                return None
+            
+            (magic, version, payload_type, record_length, mac, flags, delta_sequence,
+             timestamp_us, rssi, rate, sig_mode, mcs, cwb, stbc, rx_flags,
+             noise_floor, ampdu_cnt, channel, secondary_channel, ant,
+             local_timestamp, sig_len, rx_state, _, csi_length,
+             value_count) = CSI_WIRE_HEADER.unpack_from(data)
+            
+            if version not in CSI_WIRE_SUPPORTED_VERSIONS:
+                print(f"Warning: Unsupported binary record version {version}")
+                return None
+            
+            if record_length > len(data):
+                print(f"Warning: Binary record length {record_length} exceeds packet size {len(data)}")
+                return None
+            
+            payload_offset = CSI_WIRE_HEADER.size
+            stream_columns = [''] * len(STREAM_COLUMNS)
+            layout_columns = [''] * len(LAYOUT_COLUMNS)
+            if version >= 3:
+                stream_columns = list(CSI_WIRE_STREAM.unpack_from(data, payload_offset))
+                payload_offset += CSI_WIRE_STREAM.size
+            if version >= 4:
+                profile, _, lltf_pairs, htltf_pairs, stbc_pairs = CSI_WIRE_LAYOUT.unpack_from(data, payload_offset)
+                payload_offset += CSI_WIRE_LAYOUT.size
+                profile_name = CAPTURE_PROFILES[profile] if profile < len(CAPTURE_PROFILES) else str(profile)
+                layout_columns = [profile_name, lltf_pairs, htltf_pairs, stbc_pairs]
+            trailing_columns = stream_columns + layout_columns
+            mac_text = ':'.join(f"{b:02X}" for b in mac)
+            pc_timestamp = datetime.now().strftime("%Y-%m-%d %H:%M:%S.%f")[:-3]
+            seconds, microseconds = divmod(timestamp_us, 1000000)
+            
+            if payload_type == CSI_WIRE_PAYLOAD_FEATURES:
+                frames, window, rssi_mean, _, energy, motion = CSI_WIRE_FEATURES.unpack_from(data, payload_offset)
+                stats = struct.unpack_from(f'<{value_count * 2}H', data, payload_offset + CSI_WIRE_FEATURES.size)
+                stats_str = ' '.join(f"{stats[i] / 256.0:.2f}:{stats[i + 1] / 256.0:.2f}"
+                                     for i in range(0, len(stats), 2))
+                return ['CSI_FEATURES', 'AP', mac_text, rssi_mean, f"{seconds}.{microseconds:06d}",
+                        frames, window, f"{energy:.2f}", f"{motion:.5f}", stats_str] + trailing_columns + [pc_timestamp]
+            
+            if payload_type not in (CSI_WIRE_PAYLOAD_RAW_IQ, CSI_WIRE_PAYLOAD_AMPLITUDE_Q8, CSI_WIRE_PAYLOAD_PHASE_Q15,
+                                    CSI_WIRE_PAYLOAD_PHASE_SANITIZED):
+                print(f"Warning: Unknown binary payload type {payload_type}")
+                return None
+            
+            values = None
+            if flags & CSI_WIRE_FLAG_COMPRESSED:
+                values = self.decompressor.decode(mac, payload_type, flags, delta_sequence,
+                                                  data[:record_length], payload_offset, value_count)
+                if values is None:
+                    return None
+            
+            if payload_type == CSI_WIRE_PAYLOAD_RAW_IQ:
+                values = values or struct.unpack_from(f'<{value_count}b', data, payload_offset)
+                csi_data_str = ' '.join(str(v) for v in values)
+            elif payload_type == CSI_WIRE_PAYLOAD_AMPLITUDE_Q8:
+                values = values or struct.unpack_from(f'<{value_count}H', data, payload_offset)
+                csi_data_str = ' '.join(f"{v / 256.0:.4f}" for v in values)
+            elif payload_type == CSI_WIRE_PAYLOAD_PHASE_Q15:
+                values = values or struct.unpack_from(f'<{value_count}h', data, payload_offset)
+                csi_data_str = ' '.join(f"{v * 3.141592653589793 / 32768.0:.4f}" for v in values)
+            elif payload_type == CSI_WIRE_PAYLOAD_PHASE_SANITIZED:
+                values = values or struct.unpack_from(f'<{value_count}h', data, payload_offset)
+                csi_data_str = ' '.join(f"{v * 3.141592653589793 / 1024.0:.4f}" for v in values)
+            
+            return [
+                'CSI_Data', 'AP',
+                mac_text,
+                rssi, rate, sig_mode, mcs, cwb,
+                int(bool(rx_flags & 0x01)),  # smoothing
+                int(bool(rx_flags & 0x02)),  # not_sounding
+                int(bool(rx_flags & 0x04)),  # aggregation
+                stbc,
+                int(bool(rx_flags & 0x08)),  # fec_coding
+                int(bool(rx_flags & 0x10)),  # sgi
+                noise_floor, ampdu_cnt, channel, secondary_channel,
+                local_timestamp, ant, sig_len, rx_state,
+                int(bool(flags & CSI_WIRE_FLAG_TIME_SYNCED)),
+                f"{seconds}.{microseconds:06d}",
+                csi_length,
+                csi_data_str,
+            ] + trailing_columns + [
+                pc_timestamp
+            ]
+        
+        except (struct.error, IndexError) as e:
+            print(f"Error decoding binary record: {e}")
+            return None
+    
+    def parse_packet(self, data):
+        if data.startswith(TELEMETRY_PREFIX):
+            self.device_stats = parse_telemetry(data)
+            return None
+        if is_binary_record(data):
+            return self.parse_binary_record(data)
+        return self.parse_csi_data(data.decode('utf-8', errors='ignore'))
+    
     def udp_receiver_thread(self):
         print("UDP receiver thread started")
         
         while self.is_collecting:
             try:
                 # Receive data from ESP32 (non-blocking due to timeout)
-                data, address = self.socket.recvfrom(4096)  # Match ESP32 buffer size
-                
-                # Decode bytes to string
-                decoded_data = data.decode('utf-8', errors='ignore')
+                data, address = self.socket.recvfrom(65535)  # Full-length captures exceed one MTU
                 
-                # Add to processing queue with metadata
+                # Add to processing queue with metadata (decoded by the writer)
                 packet_info = {
-                    'data': decoded_data,
+                    'data': data,
                     'source_ip': address[0],
                     'source_port': address[1],
                     'received_time': time.time()
@@ -144,6 +525,24 @@ class CSIDataCollector:
                     print(f"Error receiving UDP data: {e}")
                 break
     
+    def write_feature_row(self, row):
+        write_headers = not os.path.exists(self.features_file)
+        with open(self.features_file, 'a', newline='', encoding='utf-8') as featuresfile:
+            writer = csv.writer(featuresfile)
+            if write_headers:
+                writer.writerow(self.features_headers)
+            writer.writerow(row)
+    
+    def track_stream(self, row, received_time):
+        # Feature records skip most sequence numbers by design, so only frame rows count
+        try:
+            sequence_index = self.csv_headers.index('frame_sequence')
+            stream = [int(value) for value in row[sequence_index:sequence_index + len(STREAM_COLUMNS)]]
+            device_time_us = int(row[self.csv_headers.index('local_timestamp')])
+        except ValueError:
+            return
+        self.stream_monitor.update(row[2], stream[0], tuple(stream[1:]), device_time_us, received_time)
+    
     def csv_writer_thread(self):
         print(f"CSV writer thread started - writing to {self.output_file}")
         
@@ -163,13 +562,21 @@ class CSIDataCollector:
                         # Get data from queue (with timeout)
                         packet_info = self.data_queue.get(timeout=1.0)
                         
-                        # Parse the CSI data
-                        csv_row = self.parse_csi_data(packet_info['data'])
+                        # A datagram may carry a batch of frames
+                        for record in split_batched_records(packet_info['data']):
+                            # Parse the CSI data (text or binary record)
+                            csv_row = self.parse_packet(record)
+                            
+                            if csv_row and csv_row[0] == 'CSI_FEATURES':
+                                self.write_feature_row(csv_row)
+                                self.frame_count += 1
+                            elif csv_row:
+                                # Write to CSV file
+                                writer.writerow(csv_row)
+                                self.frame_count += 1
+                                self.track_stream(csv_row, packet_info['received_time'])
                         
-                        if csv_row:
-                            # Write to CSV file
-                            writer.writerow(csv_row)
-                            csvfile.flush()
+                        csvfile.flush()
                         
                         self.data_queue.task_done()
                         
@@ -182,6 +589,19 @@ class CSIDataCollector:
         except Exception as e:
             print(f"Error opening CSV file: {e}")
     
+    def hello_thread(self):
+        # Subscribe to the stream on the AP; later hellos only refresh the subscription
+        while self.is_collecting:
+            try:
+                result = send_control_command(f"CSI_HELLO {self.port}")
+                if result is not None and not result[0]:
+                    print(f"\nAP rejected subscription: {result[1].strip()}")
+                if self.time_server:
+                    send_control_command(f"CSI_TIMESYNC SERVER {TIME_SYNC_PORT}")
+            except OSError:
+                pass
+            time.sleep(HELLO_INTERVAL_S)
+
     def start_collection(self):
         print("Starting CSI data collection...")
         print(f"Output file: {self.output_file}")
@@ -191,12 +611,15 @@ class CSIDataCollector:
             return False
         
         self.is_collecting = True
+        self.time_server = start_time_server()
         
         receiver_thread = threading.Thread(target=self.udp_receiver_thread, daemon=True)
         receiver_thread.start()
         
         writer_thread = threading.Thread(target=self.csv_writer_thread, daemon=True)
         writer_thread.start()
+
+        threading.Thread(target=self.hello_thread, daemon=True).start()
         
         print("Collection started successfully!")
         
@@ -211,22 +634,60 @@ class CSIDataCollector:
                 time_delta = current_time - self.last_status_time
                 
                 pps = 0
+                fps = 0
                 if time_delta > 0:
                     current_packet_count = self.packet_count
                     packet_delta = current_packet_count - self.last_packet_count
                     pps = packet_delta / time_delta
+                    fps = (self.frame_count - self.last_frame_count) / time_delta
                 
                 queue_size = self.data_queue.qsize()
                 
                 status_msg = (
                     f"\rStatus: {self.packet_count} total packets | "
                     f"PPS: {pps:.2f} | "
+                    f"Frames/s: {fps:.2f} | "
                     f"Queue: {queue_size}    "
                 )
+                stream_status = self.stream_monitor.status()
+                if stream_status:
+                    status_msg += f"| {stream_status}    "
+                if self.decompressor.discarded:
+                    status_msg += f"| Deltas without reference: {self.decompressor.discarded}    "
+                if self.device_stats:
+                    stats = self.device_stats
+                    status_msg += (
+                        f"| AP drops: alloc {stats.get('alloc_fail', 0)} "
+                        f"queue {stats.get('queue_drops', 0)} "
+                        f"ring {stats.get('ring_drops', 0)} "
+                        f"decimated {stats.get('decimated', 0)} "
+                        f"send {stats.get('send_fail', 0)}    "
+                    )
+                    if stats.get('stim_rate_hz'):
+                        status_msg += (
+                            f"| Stimulus {stats['stim_rate_hz']} Hz: "
+                            f"sent {stats.get('stim_sent_hz', 0)} Hz "
+                            f"replies {stats.get('stim_reply_hz', 0)} Hz "
+                            f"late max {stats.get('stim_late_max_us', 0)} us    "
+                        )
+                    if stats.get('replay_stations'):
+                        replay_rate = stats.get('replay_rate_hz') or 'MAX'
+                        status_msg += (
+                            f"| Replay {replay_rate} Hz x {stats['replay_stations']}: "
+                            f"sent {stats.get('replay_sent_hz', 0)} /s "
+                            f"skipped {stats.get('replay_skipped', 0)}    "
+                        )
+                    if stats.get('time_rtt_us'):
+                        status_msg += (
+                            f"| Clock offset {stats.get('time_offset_us', 0)} us "
+                            f"rtt {stats['time_rtt_us']} us "
+                            f"drift {stats.get('time_drift_ppb', 0) / 1000:.1f} ppm    "
+                        )
                 print(status_msg, end='', flush=True)
 
                 self.last_status_time = current_time
                 self.last_packet_count = self.packet_count
+                self.last_frame_count = self.frame_count
         
         except KeyboardInterrupt:
             print()
@@ -238,6 +699,11 @@ class CSIDataCollector:
         print("\nStopping CSI data collection...")
         self.is_collecting = False
         
+        try:
+            send_control_command(f"CSI_BYE {self.port}", retries=1)
+        except OSError:
+            pass
+
         if self.socket:
             self.socket.close()
         
@@ -245,9 +711,158 @@ class CSIDataCollector:
             print(f"Processing remaining {self.data_queue.qsize()} items in queue...")
             self.data_queue.join()
         
-        print(f"Collection stopped. Total packets processed: {self.packet_count}")
+        print(f"Collection stopped. Total packets processed: {self.packet_count}, frames: {self.frame_count}")
+
+def native_receiver_ports(arguments):
+    """The ports given to the native receiver with -p / --port, 9999 if none."""
+    ports = []
+    for index, argument in enumerate(arguments):
+        value = None
+        if argument in ('-p', '--port') and index + 1 < len(arguments):
+            value = arguments[index + 1]
+        elif argument.startswith('--port='):
+            value = argument.partition('=')[2]
+        elif argument.startswith('-p') and len(argument) > 2:
+            value = argument[2:]
+        if value:
+            ports += [int(port) for port in value.split(',') if port]
+    return ports or [9999]
+
+def start_time_server(port=TIME_SYNC_PORT):
+    """Answer the AP's time sync requests with this host's clock. False if the port is taken."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        sock.bind(('0.0.0.0', port))
+    except OSError as e:
+        print(f"Time server not started on port {port}: {e}")
+        sock.close()
+        return False
+
+    def serve():
+        while True:
+            try:
+                request, sender = sock.recvfrom(64)
+                receive_us = time.time_ns() // 1000
+                if len(request) != TIME_SYNC_PACKET.size:
+                    continue
+                magic, version, kind, _, sequence, origin_us, _, _ = TIME_SYNC_PACKET.unpack(request)
+                if magic != TIME_SYNC_MAGIC or kind != TIME_SYNC_REQUEST:
+                    continue
+                sock.sendto(TIME_SYNC_PACKET.pack(magic, version, TIME_SYNC_RESPONSE, 0, sequence, origin_us,
+                                                  receive_us, time.time_ns() // 1000), sender)
+            except OSError:
+                continue
+
+    threading.Thread(target=serve, daemon=True).start()
+    return True
+
+def replay_frame_bytes(row):
+    """The I/Q bytes of a CSV row: raw rows as they are, amplitude rows with phase 0."""
+    length = int(row['len'])
+    values = row['CSI_DATA'].strip('[] ').replace(',', ' ').split()
+    try:
+        raw = [int(value) for value in values]
+    except ValueError:
+        raw = None
+    if raw is None or len(raw) != length:
+        raw = []
+        for amplitude in values[:length // 2]:
+            raw += [round(min(float(amplitude), 127.0)), 0]
+        raw += [0] * (length - len(raw))
+    return bytes(value & 0xFF for value in raw)
+
+def upload_replay_frames(path, max_frames=32):
+    """Load the first frames of a collector CSV into the AP's replay table."""
+    result = send_control_command('CSI_REPLAY CLEAR')
+    if not result or not result[0]:
+        print(f"CSI_REPLAY CLEAR failed: {result[1] if result else 'no response'}", end='')
+        return 0
+
+    loaded = 0
+    with open(path, newline='') as csv_file:
+        for row in csv.DictReader(csv_file):
+            if loaded >= max_frames:
+                break
+            # CSI rows are typed CSI_Data, CSI_DATA or CHANNEL_STATE_INFO depending on who wrote them
+            if row.get('type') == 'CSI_FEATURES' or not row.get('len') or not row.get('CSI_DATA'):
+                continue
+            header = ' '.join(str(int(float(row.get(field) or 0))) for field in REPLAY_HEADER_FIELDS)
+            data = replay_frame_bytes(row)
+            commands = [f'CSI_REPLAY FRAME {loaded} {header}']
+            commands += [f'CSI_REPLAY DATA {loaded} {offset} {data[offset:offset + REPLAY_DATA_CHUNK].hex()}'
+                         for offset in range(0, len(data), REPLAY_DATA_CHUNK)]
+            for command in commands:
+                result = send_control_command(command)
+                if not result or not result[0]:
+                    print(f"{command.split(' ', 3)[1]} failed: {result[1] if result else 'no response'}", end='')
+                    return loaded
+            loaded += 1
+    return loaded
+
+def run_native_receiver(arguments):
+    """Hand the stream to the native receiver; this script only keeps the AP subscription."""
+    binary = os.environ.get('CSI_RECEIVER', NATIVE_RECEIVER)
+    if not os.path.exists(binary):
+        print(f"Native receiver not found at {binary}, build it with:")
+        print("  cmake -S host_receiver -B host_receiver/build && cmake --build host_receiver/build")
+        return 1
+
+    ports = native_receiver_ports(arguments)
+    time_server = start_time_server()
+    receiver = subprocess.Popen([binary] + arguments)
+    try:
+        while receiver.poll() is None:
+            for port in ports:
+                try:
+                    send_control_command(f"CSI_HELLO {port}")
+                except OSError:
+                    pass
+            if time_server:
+                try:
+                    send_control_command(f"CSI_TIMESYNC SERVER {TIME_SYNC_PORT}")
+                except OSError:
+                    pass
+            try:
+                receiver.wait(timeout=HELLO_INTERVAL_S)
+            except subprocess.TimeoutExpired:
+                pass
+    except KeyboardInterrupt:
+        # Let the receiver drain its rings; a terminal Ctrl+C has reached it already
+        if receiver.poll() is None:
+            receiver.send_signal(signal.SIGINT)
+        receiver.wait()
+    finally:
+        for port in ports:
+            try:
+                send_control_command(f"CSI_BYE {port}", retries=1)
+            except OSError:
+                pass
+    return receiver.returncode
 
 def main():
+    # python csi_data_collector.py --command "CSI_MODE PHASE" sends one control command and exits
+    if len(sys.argv) > 2 and sys.argv[1] == '--command':
+        result = send_control_command(' '.join(sys.argv[2:]))
+        if result is None:
+            print(f"No response from {AP_ADDRESS}:{CONTROL_PORT}")
+            sys.exit(1)
+        ok, output = result
+        print(output, end='')
+        sys.exit(0 if ok else 1)
+
+    # python csi_data_collector.py --replay FILE.csv [frames] loads recorded frames for CSI_REPLAY START
+    if len(sys.argv) > 2 and sys.argv[1] == '--replay':
+        loaded = upload_replay_frames(sys.argv[2], int(sys.argv[3]) if len(sys.argv) > 3 else 32)
+        if not loaded:
+            print(f"Error: no CSI frames loaded from {sys.argv[2]}")
+            sys.exit(1)
+        print(f"{loaded} frames loaded from {sys.argv[2]}")
+        sys.exit(0)
+
+    # python csi_data_collector.py --native [receiver options] runs host_receiver/csi_receiver
+    if len(sys.argv) > 1 and sys.argv[1] == '--native':
+        sys.exit(run_native_receiver(sys.argv[2:]))
+
     print("ESP32 CSI Data Collector")
     print("=" * 40)
     
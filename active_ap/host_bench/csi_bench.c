@@ -0,0 +1,56 @@
+// Host build of the hot path benchmark in _components/csi_bench.c:
+//
+//   csi_bench [FRAMES]     FRAMES per case, 20000 by default
+//
+// Times are wall time per frame on this machine, useful to compare changes
+// with each other rather than with the ESP32. Allocations are the calls to
+// malloc, calloc and realloc the shared components make, counted by linking
+// with --wrap; allocations inside the C library are not seen.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "csi_bench.h"
+
+#define BENCH_DEFAULT_FRAMES 20000
+
+static uint32_t g_bench_allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    g_bench_allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    g_bench_allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    g_bench_allocations++;
+    return __real_realloc(pointer, size);
+}
+
+uint32_t csi_bench_allocations()
+{
+    return g_bench_allocations;
+}
+
+int main(int argc, char **argv)
+{
+    char *end = NULL;
+    unsigned long frames = argc > 1 ? strtoul(argv[1], &end, 10) : BENCH_DEFAULT_FRAMES;
+    if (argc > 2 || (end && *end != '\0') || frames == 0 || frames > UINT32_MAX)
+    {
+        fprintf(stderr, "Usage: %s [FRAMES]\n", argv[0]);
+        return 2;
+    }
+    return csi_bench_run((uint32_t)frames) == ESP_OK ? 0 : 1;
+}
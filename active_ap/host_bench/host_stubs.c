@@ -0,0 +1,167 @@
+// The ESP-IDF and FreeRTOS calls the shared headers make, for a single
+// threaded host process: clocks are real, storage is empty and the driver and
+// task calls do nothing.
+
+#include <stdint.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static int64_t host_monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND:
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    default:
+        return "ESP_FAIL";
+    }
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    return (esp_cpu_cycle_count_t)host_monotonic_ns();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return host_monotonic_ns() / 1000;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *timer)
+{
+    *timer = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_csi(bool enable)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_csi_config(const wifi_csi_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_csi_rx_cb(wifi_csi_cb_t callback, void *context)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name_space, nvs_open_mode_t open_mode, nvs_handle_t *handle)
+{
+    *handle = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_get_stats(const char *partition, nvs_stats_t *stats)
+{
+    *stats = (nvs_stats_t){0};
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length)
+{
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_size, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    return pdFAIL;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_monotonic_ns() / 1000000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return pdPASS;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// Code and data placement has no meaning on the host
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // HOST_ESP_ATTR_H
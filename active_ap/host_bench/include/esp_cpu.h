@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_CPU_H
+#define HOST_ESP_CPU_H
+
+#include <stdint.h>
+
+// Nanoseconds of the monotonic clock, as if the CPU ran at 1 GHz
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#endif // HOST_ESP_CPU_H
@@ -0,0 +1,38 @@
+#ifndef HOST_ESP_ERR_H
+#define HOST_ESP_ERR_H
+
+// The ESP-IDF error codes the shared headers in _components use
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_VERSION 0x10A
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x1100
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+const char *esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(expression)                                                   \
+    do                                                                                \
+    {                                                                                 \
+        esp_err_t check_result = (expression);                                        \
+        if (check_result != ESP_OK)                                                   \
+        {                                                                             \
+            fprintf(stderr, "%s failed: %s\n", #expression, esp_err_to_name(check_result)); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+#endif // HOST_ESP_ERR_H
@@ -0,0 +1,75 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// The CSI types of the ESP32 WiFi driver (esp_wifi_types_native.h), with the
+// same bit fields, so synthetic frames look like the ones the callback gets.
+// The driver calls only report success.
+
+typedef struct
+{
+    signed rssi : 8;
+    unsigned rate : 5;
+    unsigned : 1;
+    unsigned sig_mode : 2;
+    unsigned : 16;
+    unsigned mcs : 7;
+    unsigned cwb : 1;
+    unsigned : 16;
+    unsigned smoothing : 1;
+    unsigned not_sounding : 1;
+    unsigned : 1;
+    unsigned aggregation : 1;
+    unsigned stbc : 2;
+    unsigned fec_coding : 1;
+    unsigned sgi : 1;
+    signed noise_floor : 8;
+    unsigned ampdu_cnt : 8;
+    unsigned channel : 4;
+    unsigned secondary_channel : 4;
+    unsigned : 8;
+    unsigned timestamp : 32;
+    unsigned : 32;
+    unsigned : 31;
+    unsigned ant : 1;
+    unsigned sig_len : 12;
+    unsigned : 12;
+    unsigned rx_state : 8;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct
+{
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t mac[6];
+    uint8_t dmac[6];
+    bool first_word_invalid;
+    int8_t *buf;
+    uint16_t len;
+    uint8_t *hdr;
+    uint8_t *payload;
+    uint16_t payload_len;
+    uint16_t rx_seq;
+} wifi_csi_info_t;
+
+typedef struct
+{
+    bool lltf_en;
+    bool htltf_en;
+    bool stbc_htltf2_en;
+    bool ltf_merge_en;
+    bool channel_filter_en;
+    bool manu_scale;
+    uint8_t shift;
+    bool dump_ack_en;
+} wifi_csi_config_t;
+
+typedef void (*wifi_csi_cb_t)(void *context, wifi_csi_info_t *data);
+
+esp_err_t esp_wifi_set_csi(bool enable);
+esp_err_t esp_wifi_set_csi_config(const wifi_csi_config_t *config);
+esp_err_t esp_wifi_set_csi_rx_cb(wifi_csi_cb_t callback, void *context);
+
+#endif // HOST_ESP_WIFI_H
@@ -0,0 +1,26 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+// The firmware's menuconfig defaults (main/Kconfig.projbuild) that have no
+// fallback in the shared headers
+
+#define CONFIG_CSI_WIRE_FORMAT_TEXT 1
+#define CONFIG_CSI_DATA_QUEUE_DEPTH 64
+#define CONFIG_CSI_OVERLOAD_DROP_NEWEST 1
+#define CONFIG_CSI_DECIMATION_HIGH_WATERMARK 75
+#define CONFIG_CSI_DECIMATION_LOW_WATERMARK 25
+#define CONFIG_CSI_DECIMATION_MAX_FACTOR 8
+#define CONFIG_CSI_DROP_REPORT_INTERVAL_MS 1000
+#define CONFIG_CSI_ENCODER_TASK_PRIORITY 6
+#define CONFIG_CSI_ENCODER_TASK_STACK_SIZE 6144
+#define CONFIG_CSI_ENCODER_TASK_CORE -1
+#define CONFIG_CSI_TRANSMIT_TASK_PRIORITY 5
+#define CONFIG_CSI_TRANSMIT_TASK_STACK_SIZE 4096
+#define CONFIG_CSI_TRANSMIT_TASK_CORE -1
+#define CONFIG_CSI_SLOW_SINK_TASK_PRIORITY 3
+#define CONFIG_CSI_SLOW_SINK_TASK_STACK_SIZE 4096
+#define CONFIG_CSI_ENCODED_RING_SIZE 16384
+#define CONFIG_CSI_TELEMETRY_INTERVAL_MS 1000
+#define CONFIG_CSI_SUBCARRIER_MASK_ALL 1
+
+#endif // HOST_SDKCONFIG_H
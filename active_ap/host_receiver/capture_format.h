@@ -0,0 +1,164 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+// Host capture files (.csic): CSI frames in fixed-size records, grouped in
+// fixed-size chunks so analysis code can mmap() the file and go straight to
+// a time range or station. All multi-byte fields are little-endian.
+//
+//   file header      CAPTURE_FILE_HEADER_SIZE bytes, capture_file_header_t
+//   chunk k          at CAPTURE_FILE_HEADER_SIZE + k * chunk_size:
+//                      capture_chunk_header_t, padded to chunk_header_size
+//                      record_count records of key.record_size bytes each
+//   index            chunk_count capture_index_entry_t, by chunk index
+//   footer           capture_file_footer_t, the last bytes of the file
+//
+// A record is capture_record_t followed by key.value_count values of
+// key.value_type, padded to a multiple of 8 bytes. Records of a chunk share
+// its key: the CSV type and role columns, the payload and the capture
+// layout, so the values of a chunk can be read as one strided array.
+//
+// The writer fills several chunks at once, one per key, so chunks are not in
+// time order; first/last timestamps in the chunk header and in the index
+// bound the records of each chunk, and record sequence numbers restore the
+// order records were appended in. CAPTURE_FILE_FLAG_CLOSED is set and the
+// index written when the file is closed. Without it, readers find the chunks
+// by their fixed offsets and magic; a chunk's records up to record_count
+// have reached the file.
+
+#include <stdint.h>
+#include "csi_wire_format.h"
+
+#define CAPTURE_FILE_MAGIC "CSI_HCF"
+#define CAPTURE_FILE_VERSION 1
+#define CAPTURE_FILE_HEADER_SIZE 4096
+#define CAPTURE_FOOTER_MAGIC "CSI_END"
+#define CAPTURE_CHUNK_MAGIC "CHNK"
+#define CAPTURE_CHUNK_SIZE (1 << 20)
+#define CAPTURE_CHUNK_HEADER_SIZE 512
+#define CAPTURE_CHUNK_MAX_MACS 32
+#define CAPTURE_CHUNK_MAC_OVERFLOW 0xFF // mac_count when the chunk holds more stations
+#define CAPTURE_NAME_LENGTH 24
+#define CAPTURE_RECORD_ALIGNMENT 8
+
+#define CAPTURE_FILE_FLAG_CLOSED 0x01 // Counters are final and the index is valid
+
+// Columns the CSV the records came from (or go to) has
+#define CAPTURE_KEY_FLAG_STREAM_COLUMNS 0x01 // frame_sequence and the drop counters
+#define CAPTURE_KEY_FLAG_LAYOUT_COLUMNS 0x02 // capture_profile and the pairs per field
+
+#define CAPTURE_RECORD_FLAG_TIME_SYNCED 0x01
+
+// How the values of a record are stored
+typedef enum
+{
+    CAPTURE_VALUE_INT8 = 1,    // Raw I/Q
+    CAPTURE_VALUE_UINT16_Q8 = 2, // Amplitude, 8 fractional bits
+    CAPTURE_VALUE_INT16_Q15 = 3, // Phase, full scale = +/- pi
+    CAPTURE_VALUE_FLOAT32 = 4, // Values parsed from text records or CSV files
+    CAPTURE_VALUE_INT16_PHASE_SANITIZED = 5 // Unwrapped, detrended phase, pi / 1024 units
+} capture_value_type_t;
+
+typedef struct __attribute__((packed))
+{
+    char type[CAPTURE_NAME_LENGTH]; // First CSV column, e.g. CSI_Data for binary records
+    char role[CAPTURE_NAME_LENGTH];
+    uint8_t payload_type; // csi_wire_payload_type_t, 0 if not known (values from text)
+    uint8_t value_type;   // capture_value_type_t
+    uint8_t flags;        // CAPTURE_KEY_FLAG_*
+    uint8_t reserved;
+    uint16_t value_count;
+    uint16_t record_size;
+    csi_wire_layout_t layout;
+} capture_chunk_key_t;
+
+typedef struct __attribute__((packed))
+{
+    int64_t timestamp_us; // real_timestamp, device wall clock
+    int64_t arrival_us;   // pc_timestamp, host wall clock
+    uint8_t mac[6];
+    uint8_t flags; // CAPTURE_RECORD_FLAG_*
+    uint8_t reserved0;
+    csi_wire_rx_ctrl_t rx_ctrl;
+    csi_wire_stream_t stream;
+    uint16_t csi_length;
+    uint32_t sequence; // Low 32 bits of the record's position in the file, in append order
+    uint16_t reserved;
+} capture_record_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t mac[6];
+    uint16_t reserved;
+    uint32_t record_count;
+} capture_mac_entry_t;
+
+typedef struct __attribute__((packed))
+{
+    char magic[4]; // CAPTURE_CHUNK_MAGIC, not NUL terminated
+    uint32_t chunk_index;
+    uint32_t record_count;
+    uint32_t reserved;
+    uint64_t first_sequence;    // Position in the file of the chunk's first record
+    int64_t first_timestamp_us; // Smallest record timestamp of the chunk
+    int64_t last_timestamp_us;  // Largest
+    int64_t first_arrival_us;
+    int64_t last_arrival_us;
+    capture_chunk_key_t key;
+    uint8_t mac_count; // Entries in macs, CAPTURE_CHUNK_MAC_OVERFLOW if there were more stations
+    uint8_t reserved2[7];
+    capture_mac_entry_t macs[CAPTURE_CHUNK_MAX_MACS];
+} capture_chunk_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t chunk_index;
+    uint32_t record_count;
+    int64_t first_timestamp_us;
+    int64_t last_timestamp_us;
+    uint8_t mac_count;
+    uint8_t value_type;
+    uint16_t value_count;
+    uint32_t reserved;
+} capture_index_entry_t;
+
+typedef struct __attribute__((packed))
+{
+    char magic[8]; // CAPTURE_FILE_MAGIC, NUL terminated
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t chunk_size;
+    uint32_t chunk_header_size;
+    uint32_t flags; // CAPTURE_FILE_FLAG_*
+    int64_t created_us;
+    uint64_t chunk_count;  // Final when closed
+    uint64_t record_count; // Final when closed
+    uint64_t index_offset; // Final when closed
+} capture_file_header_t;
+
+typedef struct __attribute__((packed))
+{
+    char magic[8]; // CAPTURE_FOOTER_MAGIC, NUL terminated
+    uint64_t chunk_count;
+    uint64_t record_count;
+    uint64_t index_offset;
+} capture_file_footer_t;
+
+_Static_assert(sizeof(capture_chunk_key_t) == 64, "capture_chunk_key_t layout changed");
+_Static_assert(sizeof(capture_record_t) == 64, "capture_record_t layout changed");
+_Static_assert(sizeof(capture_index_entry_t) == 32, "capture_index_entry_t layout changed");
+_Static_assert(sizeof(capture_file_header_t) == 56, "capture_file_header_t layout changed");
+_Static_assert(sizeof(capture_file_footer_t) == 32, "capture_file_footer_t layout changed");
+_Static_assert(sizeof(capture_chunk_header_t) <= CAPTURE_CHUNK_HEADER_SIZE, "capture chunk header too large");
+
+static inline uint32_t capture_value_size(uint8_t value_type)
+{
+    return value_type == CAPTURE_VALUE_INT8 ? 1 : value_type == CAPTURE_VALUE_FLOAT32 ? 4 : 2;
+}
+
+static inline uint16_t capture_record_size(uint8_t value_type, uint16_t value_count)
+{
+    uint32_t size = sizeof(capture_record_t) + capture_value_size(value_type) * value_count;
+    return (uint16_t)((size + CAPTURE_RECORD_ALIGNMENT - 1) & ~(uint32_t)(CAPTURE_RECORD_ALIGNMENT - 1));
+}
+
+#endif // CAPTURE_FORMAT_H
@@ -0,0 +1,204 @@
+#ifndef CAPTURE_READER_H
+#define CAPTURE_READER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "esp_err.h"
+#include "capture_format.h"
+
+// Reads capture files (capture_format.h) through one read-only mapping. The
+// chunk list comes from the index of a closed file, or from walking the
+// chunk offsets of one that is still being written (or was never closed).
+// Selecting chunks by time or station only touches the pages of the index
+// and of the chunk headers.
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+    const capture_file_header_t *header;
+    const capture_chunk_header_t **chunks; // By chunk index
+    uint32_t chunk_count;
+    uint64_t record_count;
+    bool closed; // Index and counters were used
+} capture_reader_t;
+
+static const capture_chunk_header_t *capture_reader_chunk_at(const capture_reader_t *reader, uint64_t chunk_index)
+{
+    const capture_file_header_t *header = reader->header;
+    uint64_t offset = header->header_size + chunk_index * header->chunk_size;
+    if (offset + header->chunk_header_size > reader->size)
+    {
+        return NULL;
+    }
+
+    const capture_chunk_header_t *chunk = (const capture_chunk_header_t *)(reader->data + offset);
+    uint32_t record_size = chunk->key.record_size;
+    if (memcmp(chunk->magic, CAPTURE_CHUNK_MAGIC, sizeof(chunk->magic)) != 0 || chunk->chunk_index != chunk_index ||
+        record_size != capture_record_size(chunk->key.value_type, chunk->key.value_count) ||
+        header->chunk_header_size + (uint64_t)chunk->record_count * record_size > header->chunk_size ||
+        offset + header->chunk_header_size + (uint64_t)chunk->record_count * record_size > reader->size)
+    {
+        return NULL;
+    }
+    return chunk;
+}
+
+// Use the index and footer if the file was closed and they are consistent
+static bool capture_reader_load_index(capture_reader_t *reader)
+{
+    const capture_file_header_t *header = reader->header;
+    uint64_t index_size = header->chunk_count * sizeof(capture_index_entry_t);
+    if (!(header->flags & CAPTURE_FILE_FLAG_CLOSED) || header->index_offset > reader->size ||
+        index_size + sizeof(capture_file_footer_t) > reader->size - header->index_offset)
+    {
+        return false;
+    }
+
+    capture_file_footer_t footer;
+    memcpy(&footer, reader->data + header->index_offset + index_size, sizeof(footer));
+    if (memcmp(footer.magic, CAPTURE_FOOTER_MAGIC, sizeof(CAPTURE_FOOTER_MAGIC)) != 0 ||
+        footer.chunk_count != header->chunk_count || footer.record_count != header->record_count)
+    {
+        return false;
+    }
+
+    const capture_index_entry_t *index = (const capture_index_entry_t *)(reader->data + header->index_offset);
+    for (uint64_t entry = 0; entry < header->chunk_count; entry++)
+    {
+        const capture_chunk_header_t *chunk = capture_reader_chunk_at(reader, index[entry].chunk_index);
+        if (index[entry].chunk_index != entry || !chunk || chunk->record_count != index[entry].record_count)
+        {
+            return false;
+        }
+        reader->chunks[entry] = chunk;
+        reader->record_count += chunk->record_count;
+    }
+    reader->chunk_count = (uint32_t)header->chunk_count;
+    return reader->record_count == header->record_count;
+}
+
+void capture_reader_close(capture_reader_t *reader)
+{
+    if (reader->data)
+    {
+        munmap((void *)reader->data, reader->size);
+    }
+    free(reader->chunks);
+    memset(reader, 0, sizeof(*reader));
+}
+
+esp_err_t capture_reader_open(capture_reader_t *reader, const char *path)
+{
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 || (size_t)file_status.st_size < CAPTURE_FILE_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s is not a capture file\n", path);
+        close(fd);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    reader->size = (size_t)file_status.st_size;
+    void *data = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Cannot map %s: %s\n", path, strerror(errno));
+        reader->size = 0;
+        return ESP_FAIL;
+    }
+    reader->data = data;
+    reader->header = (const capture_file_header_t *)reader->data;
+
+    const capture_file_header_t *header = reader->header;
+    if (memcmp(header->magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC)) != 0 ||
+        header->version != CAPTURE_FILE_VERSION || header->header_size < sizeof(*header) ||
+        header->chunk_header_size < sizeof(capture_chunk_header_t) || header->chunk_size <= header->chunk_header_size)
+    {
+        fprintf(stderr, "%s is not a version %d capture file\n", path, CAPTURE_FILE_VERSION);
+        capture_reader_close(reader);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    // From the file size, which also bounds the index of a closed file
+    uint64_t max_chunks = (reader->size - header->header_size) / header->chunk_size + 1;
+    reader->chunks = calloc(max_chunks, sizeof(*reader->chunks));
+    if (!reader->chunks)
+    {
+        capture_reader_close(reader);
+        return ESP_ERR_NO_MEM;
+    }
+
+    reader->closed = header->chunk_count <= max_chunks && capture_reader_load_index(reader);
+    if (!reader->closed)
+    {
+        // Chunks that were started but never flushed end the walk
+        reader->chunk_count = 0;
+        reader->record_count = 0;
+        const capture_chunk_header_t *chunk;
+        while (reader->chunk_count < max_chunks && (chunk = capture_reader_chunk_at(reader, reader->chunk_count)))
+        {
+            reader->chunks[reader->chunk_count++] = chunk;
+            reader->record_count += chunk->record_count;
+        }
+    }
+    return ESP_OK;
+}
+
+static inline const capture_record_t *capture_reader_record(const capture_chunk_header_t *chunk, uint32_t record,
+                                                            uint32_t chunk_header_size)
+{
+    return (const capture_record_t *)((const uint8_t *)chunk + chunk_header_size +
+                                      (size_t)record * chunk->key.record_size);
+}
+
+static inline const void *capture_record_values(const capture_record_t *record)
+{
+    return record + 1;
+}
+
+// The full position in the file of a chunk's record
+static inline uint64_t capture_record_sequence(const capture_chunk_header_t *chunk, const capture_record_t *record)
+{
+    return chunk->first_sequence + (uint32_t)(record->sequence - (uint32_t)chunk->first_sequence);
+}
+
+// Whether the chunk may hold records of mac (NULL for any) with timestamps
+// in [from_us, to_us]
+static bool capture_chunk_matches(const capture_chunk_header_t *chunk, int64_t from_us, int64_t to_us,
+                                  const uint8_t *mac)
+{
+    if (chunk->record_count == 0 || chunk->last_timestamp_us < from_us || chunk->first_timestamp_us > to_us)
+    {
+        return false;
+    }
+    if (!mac || chunk->mac_count == CAPTURE_CHUNK_MAC_OVERFLOW)
+    {
+        return true;
+    }
+    for (uint8_t index = 0; index < chunk->mac_count && index < CAPTURE_CHUNK_MAX_MACS; index++)
+    {
+        if (memcmp(chunk->macs[index].mac, mac, 6) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // CAPTURE_READER_H
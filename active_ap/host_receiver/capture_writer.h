@@ -0,0 +1,356 @@
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "esp_err.h"
+#include "capture_format.h"
+#include "csv_frame.h"
+
+// Writes capture files (capture_format.h). Each kind of record fills a chunk
+// of its own, held in memory; flushing writes the records added since the
+// last flush and the chunk header at the chunk's fixed offset, so a reader
+// finds everything up to the last flush even if the receiver dies before
+// closing the file. A full chunk is flushed and its slot reused.
+
+#define CAPTURE_WRITER_OPEN_CHUNKS 16 // Kinds of record filled at the same time, 1 MiB each
+
+typedef struct
+{
+    bool used;
+    uint32_t flushed;  // Records already in the file
+    uint32_t capacity; // Records that fit the chunk
+    uint64_t last_use;
+    capture_chunk_header_t header;
+    uint8_t *records; // chunk_size - chunk_header_size bytes
+} capture_open_chunk_t;
+
+typedef struct
+{
+    int fd;
+    capture_file_header_t header;
+    capture_open_chunk_t chunks[CAPTURE_WRITER_OPEN_CHUNKS];
+    capture_index_entry_t *index; // One entry per finished chunk
+    uint32_t index_count;
+    uint32_t index_capacity;
+    uint64_t appends;
+    uint64_t bytes_written;
+    uint32_t write_errors;
+} capture_writer_t;
+
+static bool capture_writer_put(capture_writer_t *writer, const void *data, size_t length, uint64_t offset)
+{
+    const uint8_t *bytes = data;
+    while (length)
+    {
+        ssize_t written = pwrite(writer->fd, bytes, length, (off_t)offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            writer->write_errors++;
+            return false;
+        }
+        bytes += written;
+        offset += (uint64_t)written;
+        length -= (size_t)written;
+        writer->bytes_written += (uint64_t)written;
+    }
+    return true;
+}
+
+static inline uint64_t capture_chunk_offset(const capture_file_header_t *header, uint32_t chunk_index)
+{
+    return header->header_size + (uint64_t)chunk_index * header->chunk_size;
+}
+
+// Create path, replacing any file of that name
+esp_err_t capture_writer_open(capture_writer_t *writer, const char *path)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    capture_file_header_t *header = &writer->header;
+    memcpy(header->magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+    header->version = CAPTURE_FILE_VERSION;
+    header->header_size = CAPTURE_FILE_HEADER_SIZE;
+    header->chunk_size = CAPTURE_CHUNK_SIZE;
+    header->chunk_header_size = CAPTURE_CHUNK_HEADER_SIZE;
+    header->created_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+    uint8_t block[CAPTURE_FILE_HEADER_SIZE] = {0};
+    memcpy(block, header, sizeof(*header));
+    if (!capture_writer_put(writer, block, sizeof(block), 0))
+    {
+        close(writer->fd);
+        writer->fd = -1;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void capture_writer_flush_chunk(capture_writer_t *writer, capture_open_chunk_t *chunk)
+{
+    capture_chunk_header_t *header = &chunk->header;
+    if (chunk->flushed == header->record_count)
+    {
+        return;
+    }
+
+    uint64_t offset = capture_chunk_offset(&writer->header, header->chunk_index);
+    uint32_t record_size = header->key.record_size;
+    uint8_t block[CAPTURE_CHUNK_HEADER_SIZE] = {0};
+    memcpy(block, header, sizeof(*header));
+
+    // Records first, so the header never counts records that are not there
+    if (capture_writer_put(writer, chunk->records + (size_t)chunk->flushed * record_size,
+                           (size_t)(header->record_count - chunk->flushed) * record_size,
+                           offset + CAPTURE_CHUNK_HEADER_SIZE + (uint64_t)chunk->flushed * record_size) &&
+        capture_writer_put(writer, block, sizeof(block), offset))
+    {
+        chunk->flushed = header->record_count;
+    }
+}
+
+// Flush the chunk and give up its slot
+static void capture_writer_finish_chunk(capture_writer_t *writer, capture_open_chunk_t *chunk)
+{
+    capture_writer_flush_chunk(writer, chunk);
+
+    if (writer->index_count == writer->index_capacity)
+    {
+        uint32_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+        capture_index_entry_t *index = realloc(writer->index, capacity * sizeof(*index));
+        if (!index)
+        {
+            writer->write_errors++;
+            chunk->used = false;
+            return;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    const capture_chunk_header_t *header = &chunk->header;
+    capture_index_entry_t *entry = &writer->index[writer->index_count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->chunk_index = header->chunk_index;
+    entry->record_count = header->record_count;
+    entry->first_timestamp_us = header->first_timestamp_us;
+    entry->last_timestamp_us = header->last_timestamp_us;
+    entry->mac_count = header->mac_count;
+    entry->value_type = header->key.value_type;
+    entry->value_count = header->key.value_count;
+    chunk->used = false;
+}
+
+// The open chunk for key, starting one (and finishing the least recently
+// used one if all slots are taken) when there is none
+static capture_open_chunk_t *capture_writer_chunk(capture_writer_t *writer, const capture_chunk_key_t *key)
+{
+    capture_open_chunk_t *free_slot = NULL;
+    capture_open_chunk_t *oldest = &writer->chunks[0];
+    for (int slot = 0; slot < CAPTURE_WRITER_OPEN_CHUNKS; slot++)
+    {
+        capture_open_chunk_t *chunk = &writer->chunks[slot];
+        if (!chunk->used)
+        {
+            free_slot = free_slot ? free_slot : chunk;
+            continue;
+        }
+        if (memcmp(&chunk->header.key, key, sizeof(*key)) == 0)
+        {
+            return chunk;
+        }
+        oldest = chunk->last_use < oldest->last_use ? chunk : oldest;
+    }
+
+    capture_open_chunk_t *chunk = free_slot;
+    if (!chunk)
+    {
+        capture_writer_finish_chunk(writer, oldest);
+        chunk = oldest;
+    }
+    if (!chunk->records)
+    {
+        chunk->records = malloc(CAPTURE_CHUNK_SIZE - CAPTURE_CHUNK_HEADER_SIZE);
+        if (!chunk->records)
+        {
+            return NULL;
+        }
+    }
+
+    chunk->used = true;
+    chunk->flushed = 0;
+    chunk->capacity = (CAPTURE_CHUNK_SIZE - CAPTURE_CHUNK_HEADER_SIZE) / key->record_size;
+    memset(&chunk->header, 0, sizeof(chunk->header));
+    memcpy(chunk->header.magic, CAPTURE_CHUNK_MAGIC, sizeof(chunk->header.magic));
+    chunk->header.chunk_index = (uint32_t)writer->header.chunk_count++;
+    chunk->header.first_sequence = writer->header.record_count;
+    chunk->header.key = *key;
+    return chunk;
+}
+
+static void capture_chunk_note_mac(capture_chunk_header_t *header, const uint8_t mac[6])
+{
+    if (header->mac_count == CAPTURE_CHUNK_MAC_OVERFLOW)
+    {
+        return;
+    }
+    for (uint8_t index = 0; index < header->mac_count; index++)
+    {
+        if (memcmp(header->macs[index].mac, mac, 6) == 0)
+        {
+            header->macs[index].record_count++;
+            return;
+        }
+    }
+    if (header->mac_count == CAPTURE_CHUNK_MAX_MACS)
+    {
+        header->mac_count = CAPTURE_CHUNK_MAC_OVERFLOW;
+        return;
+    }
+    capture_mac_entry_t *entry = &header->macs[header->mac_count++];
+    memcpy(entry->mac, mac, 6);
+    entry->record_count = 1;
+}
+
+esp_err_t capture_writer_append(capture_writer_t *writer, const csv_frame_t *frame)
+{
+    const capture_chunk_key_t *key = &frame->key;
+    if (key->value_count > CSV_FRAME_MAX_VALUES ||
+        key->record_size != capture_record_size(key->value_type, key->value_count))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    capture_open_chunk_t *chunk = capture_writer_chunk(writer, key);
+    if (!chunk)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    capture_chunk_header_t *header = &chunk->header;
+    const capture_record_t *source = &frame->record;
+    uint8_t *record = chunk->records + (size_t)header->record_count * key->record_size;
+    size_t values_size = (size_t)capture_value_size(key->value_type) * key->value_count;
+    memcpy(record, source, sizeof(*source));
+    ((capture_record_t *)record)->sequence = (uint32_t)writer->header.record_count;
+    memcpy(record + sizeof(*source), frame->values, values_size);
+    memset(record + sizeof(*source) + values_size, 0, key->record_size - sizeof(*source) - values_size);
+
+    if (header->record_count == 0)
+    {
+        header->first_timestamp_us = header->last_timestamp_us = source->timestamp_us;
+        header->first_arrival_us = header->last_arrival_us = source->arrival_us;
+    }
+    header->first_timestamp_us =
+        source->timestamp_us < header->first_timestamp_us ? source->timestamp_us : header->first_timestamp_us;
+    header->last_timestamp_us =
+        source->timestamp_us > header->last_timestamp_us ? source->timestamp_us : header->last_timestamp_us;
+    header->first_arrival_us =
+        source->arrival_us < header->first_arrival_us ? source->arrival_us : header->first_arrival_us;
+    header->last_arrival_us =
+        source->arrival_us > header->last_arrival_us ? source->arrival_us : header->last_arrival_us;
+    capture_chunk_note_mac(header, source->mac);
+
+    header->record_count++;
+    writer->header.record_count++;
+    chunk->last_use = ++writer->appends;
+    if (header->record_count == chunk->capacity)
+    {
+        capture_writer_finish_chunk(writer, chunk);
+    }
+    return ESP_OK;
+}
+
+// Make every record appended so far visible in the file
+void capture_writer_flush(capture_writer_t *writer)
+{
+    for (int slot = 0; slot < CAPTURE_WRITER_OPEN_CHUNKS; slot++)
+    {
+        if (writer->chunks[slot].used)
+        {
+            capture_writer_flush_chunk(writer, &writer->chunks[slot]);
+        }
+    }
+}
+
+static int capture_index_compare(const void *left, const void *right)
+{
+    uint32_t a = ((const capture_index_entry_t *)left)->chunk_index;
+    uint32_t b = ((const capture_index_entry_t *)right)->chunk_index;
+    return (a > b) - (a < b);
+}
+
+// Finish the open chunks, write the index and footer and mark the file closed
+esp_err_t capture_writer_close(capture_writer_t *writer)
+{
+    if (writer->fd < 0)
+    {
+        return ESP_FAIL;
+    }
+    for (int slot = 0; slot < CAPTURE_WRITER_OPEN_CHUNKS; slot++)
+    {
+        if (writer->chunks[slot].used)
+        {
+            capture_writer_finish_chunk(writer, &writer->chunks[slot]);
+        }
+        free(writer->chunks[slot].records);
+        writer->chunks[slot].records = NULL;
+    }
+
+    capture_file_header_t *header = &writer->header;
+    esp_err_t result = ESP_FAIL;
+    if (writer->index_count == header->chunk_count && writer->write_errors == 0)
+    {
+        qsort(writer->index, writer->index_count, sizeof(*writer->index), capture_index_compare);
+
+        // The last chunk is padded to full size, so the index sits where chunk
+        // chunk_count would start
+        header->index_offset = capture_chunk_offset(header, (uint32_t)header->chunk_count);
+        header->flags |= CAPTURE_FILE_FLAG_CLOSED;
+
+        capture_file_footer_t footer = {0};
+        memcpy(footer.magic, CAPTURE_FOOTER_MAGIC, sizeof(CAPTURE_FOOTER_MAGIC));
+        footer.chunk_count = header->chunk_count;
+        footer.record_count = header->record_count;
+        footer.index_offset = header->index_offset;
+
+        size_t index_size = (size_t)writer->index_count * sizeof(*writer->index);
+        if (ftruncate(writer->fd, (off_t)header->index_offset) == 0 &&
+            capture_writer_put(writer, writer->index, index_size, header->index_offset) &&
+            capture_writer_put(writer, &footer, sizeof(footer), header->index_offset + index_size) &&
+            capture_writer_put(writer, header, sizeof(*header), 0))
+        {
+            result = ESP_OK;
+        }
+    }
+
+    if (fsync(writer->fd) != 0 || close(writer->fd) != 0)
+    {
+        result = ESP_FAIL;
+    }
+    writer->fd = -1;
+    free(writer->index);
+    writer->index = NULL;
+    return result;
+}
+
+#endif // CAPTURE_WRITER_H
@@ -0,0 +1,203 @@
+"""Read capture files (.csic) written by csi_receiver --format CAPTURE.
+
+The layout is described in capture_format.h. The file is memory mapped, so
+selecting a time range or station only reads the chunk headers, and the
+values of a chunk come back as one (records x values) numpy array without
+copying when numpy is installed:
+
+    with CaptureFile('csi_data/csi_data_20250608_171407.csic') as capture:
+        for chunk in capture.chunks(start=1718000000.0, mac='24:0A:C4:C9:25:D8'):
+            amplitudes = capture.values(chunk)
+        for record, values in capture.records(start=1718000000.0, end=1718000010.0):
+            print(record['mac'], record['timestamp_us'], values[:4])
+"""
+import mmap
+import struct
+import sys
+from array import array
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+CAPTURE_FILE_MAGIC = b'CSI_HCF\0'
+CAPTURE_FOOTER_MAGIC = b'CSI_END\0'
+CAPTURE_CHUNK_MAGIC = b'CHNK'
+CAPTURE_FILE_VERSION = 1
+CAPTURE_FILE_FLAG_CLOSED = 0x01
+CAPTURE_CHUNK_MAX_MACS = 32
+CAPTURE_CHUNK_MAC_OVERFLOW = 0xFF
+
+FILE_HEADER = struct.Struct('<8sHHIIIqQQQ')  # capture_file_header_t
+FILE_FOOTER = struct.Struct('<8sQQQ')  # capture_file_footer_t
+INDEX_ENTRY = struct.Struct('<IIqqBBHI')  # capture_index_entry_t
+CHUNK_KEY = struct.Struct('<24s24sBBBBHH' 'BBHHH')  # capture_chunk_key_t
+CHUNK_HEAD = struct.Struct('<4sIIIQqqqq')  # capture_chunk_header_t up to the key
+MAC_ENTRY = struct.Struct('<6sHI')  # capture_mac_entry_t
+RECORD = struct.Struct('<qq6sBB' 'bBBBBBBbBBBBIHBB' 'IHHHH' 'HIH')  # capture_record_t
+
+# capture_value_type_t: struct format, scale to the values the CSV shows
+VALUE_TYPES = {
+    1: ('b', 1.0),                   # Raw I/Q
+    2: ('H', 1.0 / 256),             # Amplitude, 8 fractional bits
+    3: ('h', 3.141592653589793 / 32768),  # Phase, full scale = +/- pi
+    4: ('f', 1.0),                   # Values parsed from text records or CSV files
+}
+
+RECORD_FIELDS = (
+    'timestamp_us', 'arrival_us', 'mac', 'flags', None,
+    'rssi', 'rate', 'sig_mode', 'mcs', 'cwb', 'stbc', 'rx_flags', 'noise_floor', 'ampdu_cnt',
+    'channel', 'secondary_channel', 'ant', 'local_timestamp', 'sig_len', 'rx_state', None,
+    'frame_sequence', 'alloc_drops', 'queue_drops', 'decimated', 'ring_drops',
+    'csi_length', 'sequence', None,
+)
+
+
+def format_mac(raw):
+    return ':'.join(f'{byte:02X}' for byte in raw)
+
+
+def parse_mac(text):
+    return bytes(int(part, 16) for part in text.split(':'))
+
+
+class Chunk:
+    """Header of chunk `index`; records start at `records_offset`."""
+
+    def __init__(self, data, offset, header_size):
+        (magic, self.index, self.record_count, _, self.first_sequence, self.first_timestamp_us,
+         self.last_timestamp_us, self.first_arrival_us, self.last_arrival_us) = CHUNK_HEAD.unpack_from(data, offset)
+        if magic != CAPTURE_CHUNK_MAGIC:
+            raise ValueError(f'no chunk at offset {offset}')
+        key = CHUNK_KEY.unpack_from(data, offset + CHUNK_HEAD.size)
+        self.type = key[0].rstrip(b'\0').decode(errors='replace')
+        self.role = key[1].rstrip(b'\0').decode(errors='replace')
+        self.payload_type, self.value_type, self.key_flags = key[2], key[3], key[4]
+        self.value_count, self.record_size = key[6], key[7]
+        self.capture_profile, self.lltf_pairs, self.htltf_pairs, self.stbc_htltf_pairs = key[8], key[10], key[11], key[12]
+
+        macs_offset = offset + CHUNK_HEAD.size + CHUNK_KEY.size
+        self.mac_count = data[macs_offset]
+        self.macs = {}
+        if self.mac_count != CAPTURE_CHUNK_MAC_OVERFLOW:
+            for entry in range(min(self.mac_count, CAPTURE_CHUNK_MAX_MACS)):
+                mac, _, count = MAC_ENTRY.unpack_from(data, macs_offset + 8 + entry * MAC_ENTRY.size)
+                self.macs[mac] = count
+        self.records_offset = offset + header_size
+
+    def matches(self, start_us, end_us, mac):
+        if self.record_count == 0 or self.last_timestamp_us < start_us or self.first_timestamp_us > end_us:
+            return False
+        return mac is None or self.mac_count == CAPTURE_CHUNK_MAC_OVERFLOW or mac in self.macs
+
+
+class CaptureFile:
+    def __init__(self, path):
+        self._file = open(path, 'rb')
+        self.data = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, self.header_size, self.chunk_size, self.chunk_header_size, self.flags,
+         self.created_us, chunk_count, record_count, index_offset) = FILE_HEADER.unpack_from(self.data, 0)
+        if magic != CAPTURE_FILE_MAGIC or version != CAPTURE_FILE_VERSION:
+            raise ValueError(f'{path} is not a version {CAPTURE_FILE_VERSION} capture file')
+
+        self.closed = bool(self.flags & CAPTURE_FILE_FLAG_CLOSED) and self._check_footer(chunk_count, index_offset)
+        count = chunk_count if self.closed else (len(self.data) - self.header_size) // self.chunk_size + 1
+        self._chunks = []
+        for index in range(count):
+            offset = self.header_size + index * self.chunk_size
+            if offset + self.chunk_header_size > len(self.data):
+                break
+            try:
+                chunk = Chunk(self.data, offset, self.chunk_header_size)
+            except ValueError:
+                # Started but never flushed; the chunks after it are not there either
+                break
+            if chunk.records_offset + chunk.record_count * chunk.record_size > len(self.data):
+                break
+            self._chunks.append(chunk)
+        self.record_count = sum(chunk.record_count for chunk in self._chunks)
+
+    def _check_footer(self, chunk_count, index_offset):
+        offset = index_offset + chunk_count * INDEX_ENTRY.size
+        if offset + FILE_FOOTER.size > len(self.data):
+            return False
+        magic, footer_chunks, _, footer_index = FILE_FOOTER.unpack_from(self.data, offset)
+        return magic == CAPTURE_FOOTER_MAGIC and (footer_chunks, footer_index) == (chunk_count, index_offset)
+
+    def close(self):
+        self.data.close()
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def chunks(self, start=None, end=None, mac=None):
+        """Chunks that may hold records with real_timestamp in [start, end] seconds and of mac."""
+        start_us = -2**63 if start is None else round(start * 1e6)
+        end_us = 2**63 - 1 if end is None else round(end * 1e6)
+        raw_mac = parse_mac(mac) if isinstance(mac, str) else mac
+        return [chunk for chunk in self._chunks if chunk.matches(start_us, end_us, raw_mac)]
+
+    def values(self, chunk, scaled=True):
+        """The values of every record of a chunk, one row per record."""
+        code, scale = VALUE_TYPES[chunk.value_type]
+        if numpy is None:
+            rows = []
+            for record in range(chunk.record_count):
+                offset = chunk.records_offset + record * chunk.record_size + RECORD.size
+                row = array(code, self.data[offset:offset + chunk.value_count * struct.calcsize(code)])
+                rows.append([value * scale for value in row] if scaled and scale != 1.0 else list(row))
+            return rows
+        dtype = numpy.dtype(code).newbyteorder('<')
+        view = numpy.ndarray((chunk.record_count, chunk.value_count), dtype=dtype, buffer=self.data,
+                             offset=chunk.records_offset + RECORD.size, strides=(chunk.record_size, dtype.itemsize))
+        return view * scale if scaled and scale != 1.0 else view
+
+    def records(self, start=None, end=None, mac=None):
+        """(record, values) in the order they were received, filtered like chunks()."""
+        start_us = -2**63 if start is None else round(start * 1e6)
+        end_us = 2**63 - 1 if end is None else round(end * 1e6)
+        raw_mac = parse_mac(mac) if isinstance(mac, str) else mac
+        selected = self.chunks(start, end, mac)
+        cursors = [[chunk, 0] for chunk in selected]
+        while cursors:
+            # Few chunks are filled at the same time, so the smallest sequence is near
+            best = min(cursors, key=lambda cursor: self._sequence(*cursor))
+            chunk, record = best
+            offset = chunk.records_offset + record * chunk.record_size
+            fields = RECORD.unpack_from(self.data, offset)
+            best[1] += 1
+            if best[1] == chunk.record_count:
+                cursors.remove(best)
+            if not start_us <= fields[0] <= end_us or (raw_mac is not None and fields[2] != raw_mac):
+                continue
+            info = {name: value for name, value in zip(RECORD_FIELDS, fields) if name}
+            info['mac'] = format_mac(info['mac'])
+            info['type'], info['role'] = chunk.type, chunk.role
+            code, scale = VALUE_TYPES[chunk.value_type]
+            values = array(code, self.data[offset + RECORD.size:
+                                           offset + RECORD.size + chunk.value_count * struct.calcsize(code)])
+            yield info, [value * scale for value in values] if scale != 1.0 else list(values)
+
+    def _sequence(self, chunk, record):
+        offset = chunk.records_offset + record * chunk.record_size + RECORD.size - 6
+        low = struct.unpack_from('<I', self.data, offset)[0]
+        return chunk.first_sequence + ((low - chunk.first_sequence) & 0xFFFFFFFF)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print(f'Usage: {sys.argv[0]} FILE.csic')
+        sys.exit(2)
+    with CaptureFile(sys.argv[1]) as capture:
+        print(f"{sys.argv[1]}: {len(capture.chunks())} chunks, {capture.record_count} records, "
+              f"{'closed' if capture.closed else 'not closed'}")
+        for chunk in capture.chunks():
+            stations = ' '.join(f'{format_mac(mac)}={count}' for mac, count in chunk.macs.items())
+            print(f'  chunk {chunk.index}: {chunk.record_count} x {chunk.value_count} values, '
+                  f'{chunk.type}/{chunk.role}, {chunk.first_timestamp_us / 1e6:.6f}-'
+                  f'{chunk.last_timestamp_us / 1e6:.6f} s, {stations or "more stations"}')
@@ -0,0 +1,369 @@
+// Converts between capture files (capture_format.h) and the frames CSV of
+// csi_data_collector.py, one row or record at a time so files of any size
+// stream through:
+//
+//   info FILE.csic                    chunks, stations and time range
+//   to-csv FILE.csic [OUT.csv]        rows in the order they were received,
+//          [--from S] [--to S]        optionally only real_timestamp in [S, S]
+//          [--mac MAC]                and one station's; stdout without OUT
+//   from-csv FILE.csv OUT.csic        either CSV layout, with or without the
+//                                     stream and capture layout columns
+//
+// to-csv writes the layout the records came with: the legacy columns if no
+// record has stream or layout columns, the full ones otherwise.
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "capture_reader.h"
+#include "capture_writer.h"
+#include "csv_frame.h"
+#include "output_writer.h"
+
+#define CONVERT_MAX_COLUMNS (CSV_FRAME_FIELDS + 1 + CSV_FRAME_TRAILING + 1)
+
+// Where to_csv is in one chunk; chunks are merged by record sequence
+typedef struct
+{
+    const capture_chunk_header_t *chunk;
+    uint32_t next;
+    uint64_t sequence; // Of record next
+} convert_cursor_t;
+
+typedef struct
+{
+    convert_cursor_t *items;
+    uint32_t count;
+} convert_heap_t;
+
+static void convert_heap_push(convert_heap_t *heap, convert_cursor_t cursor)
+{
+    uint32_t index = heap->count++;
+    while (index && heap->items[(index - 1) / 2].sequence > cursor.sequence)
+    {
+        heap->items[index] = heap->items[(index - 1) / 2];
+        index = (index - 1) / 2;
+    }
+    heap->items[index] = cursor;
+}
+
+static convert_cursor_t convert_heap_pop(convert_heap_t *heap)
+{
+    convert_cursor_t top = heap->items[0];
+    convert_cursor_t last = heap->items[--heap->count];
+    uint32_t index = 0;
+    while (true)
+    {
+        uint32_t child = index * 2 + 1;
+        if (child >= heap->count)
+        {
+            break;
+        }
+        if (child + 1 < heap->count && heap->items[child + 1].sequence < heap->items[child].sequence)
+        {
+            child++;
+        }
+        if (heap->items[child].sequence >= last.sequence)
+        {
+            break;
+        }
+        heap->items[index] = heap->items[child];
+        index = child;
+    }
+    if (heap->count)
+    {
+        heap->items[index] = last;
+    }
+    return top;
+}
+
+static void convert_print_mac(const uint8_t mac[6])
+{
+    printf("%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static int convert_info(const char *path)
+{
+    capture_reader_t reader;
+    if (capture_reader_open(&reader, path) != ESP_OK)
+    {
+        return 1;
+    }
+
+    const capture_file_header_t *header = reader.header;
+    int64_t first_us = INT64_MAX, last_us = INT64_MIN;
+    printf("%s: version %u, %u byte chunks, %s\n", path, header->version, header->chunk_size,
+           reader.closed ? "closed" : "not closed (chunks found by scanning)");
+    for (uint32_t index = 0; index < reader.chunk_count; index++)
+    {
+        const capture_chunk_header_t *chunk = reader.chunks[index];
+        first_us = chunk->record_count && chunk->first_timestamp_us < first_us ? chunk->first_timestamp_us : first_us;
+        last_us = chunk->record_count && chunk->last_timestamp_us > last_us ? chunk->last_timestamp_us : last_us;
+
+        printf("  chunk %u: %u records, %.*s/%.*s, %u values of type %u, %.6f-%.6f s, ", chunk->chunk_index,
+               chunk->record_count, (int)strnlen(chunk->key.type, CAPTURE_NAME_LENGTH), chunk->key.type,
+               (int)strnlen(chunk->key.role, CAPTURE_NAME_LENGTH), chunk->key.role, chunk->key.value_count,
+               chunk->key.value_type, chunk->first_timestamp_us / 1e6, chunk->last_timestamp_us / 1e6);
+        if (chunk->mac_count == CAPTURE_CHUNK_MAC_OVERFLOW)
+        {
+            printf("more than %d stations\n", CAPTURE_CHUNK_MAX_MACS);
+            continue;
+        }
+        for (uint8_t mac = 0; mac < chunk->mac_count; mac++)
+        {
+            printf(mac ? " " : "");
+            convert_print_mac(chunk->macs[mac].mac);
+            printf("=%u", chunk->macs[mac].record_count);
+        }
+        printf("\n");
+    }
+    printf("%u chunks, %llu records", reader.chunk_count, (unsigned long long)reader.record_count);
+    if (reader.record_count)
+    {
+        printf(", real_timestamp %.6f-%.6f s", first_us / 1e6, last_us / 1e6);
+    }
+    printf("\n");
+    capture_reader_close(&reader);
+    return 0;
+}
+
+static int convert_to_csv(const char *path, const char *output, int64_t from_us, int64_t to_us, const uint8_t *mac)
+{
+    capture_reader_t reader;
+    if (capture_reader_open(&reader, path) != ESP_OK)
+    {
+        return 1;
+    }
+
+    // Selected chunks, in chunk index and therefore first sequence order
+    const capture_chunk_header_t **selected = calloc(reader.chunk_count + 1, sizeof(*selected));
+    convert_heap_t heap = {.items = calloc(reader.chunk_count + 1, sizeof(convert_cursor_t))};
+    if (!selected || !heap.items)
+    {
+        free(selected);
+        free(heap.items);
+        capture_reader_close(&reader);
+        return 1;
+    }
+    uint32_t selected_count = 0;
+    bool trailing_columns = false;
+    for (uint32_t index = 0; index < reader.chunk_count; index++)
+    {
+        const capture_chunk_header_t *chunk = reader.chunks[index];
+        if (capture_chunk_matches(chunk, from_us, to_us, mac))
+        {
+            selected[selected_count++] = chunk;
+            trailing_columns = trailing_columns || chunk->key.flags != 0;
+        }
+    }
+
+    output_writer_t writer;
+    const char *header_line = trailing_columns ? CSV_FRAME_HEADER : CSV_FRAME_LEGACY_HEADER;
+    esp_err_t opened = output ? output_writer_create(&writer, output, header_line)
+                              : output_writer_open(&writer, "/dev/stdout", header_line);
+    if (opened != ESP_OK)
+    {
+        free(selected);
+        free(heap.items);
+        capture_reader_close(&reader);
+        return 1;
+    }
+
+    csv_clock_t clock;
+    csv_clock_init(&clock);
+    uint32_t chunk_header_size = reader.header->chunk_header_size;
+    uint32_t next_chunk = 0;
+    uint64_t rows = 0;
+    while (heap.count || next_chunk < selected_count)
+    {
+        // Start the chunks whose first record comes before every pending one
+        while (next_chunk < selected_count &&
+               (!heap.count || selected[next_chunk]->first_sequence < heap.items[0].sequence))
+        {
+            const capture_chunk_header_t *chunk = selected[next_chunk++];
+            convert_heap_push(&heap, (convert_cursor_t){chunk, 0, capture_record_sequence(chunk,
+                                                        capture_reader_record(chunk, 0, chunk_header_size))});
+        }
+
+        convert_cursor_t cursor = convert_heap_pop(&heap);
+        const capture_chunk_header_t *chunk = cursor.chunk;
+        const capture_record_t *record = capture_reader_record(chunk, cursor.next, chunk_header_size);
+        if (record->timestamp_us >= from_us && record->timestamp_us <= to_us &&
+            (!mac || memcmp(record->mac, mac, 6) == 0))
+        {
+            csv_frame_t frame = {.key = chunk->key, .record = *record, .values = capture_record_values(record)};
+            char *out = output_writer_reserve(&writer, CSV_FRAME_MAX_ROW(chunk->key.value_count));
+            out = csv_put_frame_row(out, &frame, trailing_columns);
+            output_writer_commit(&writer, csv_end_row(out, &clock, record->arrival_us));
+            rows++;
+        }
+
+        if (++cursor.next < chunk->record_count)
+        {
+            cursor.sequence =
+                capture_record_sequence(chunk, capture_reader_record(chunk, cursor.next, chunk_header_size));
+            convert_heap_push(&heap, cursor);
+        }
+    }
+
+    output_writer_close(&writer);
+    bool failed = writer.write_errors > 0;
+    fprintf(stderr, "%llu rows from %u of %u chunks\n", (unsigned long long)rows, selected_count, reader.chunk_count);
+    free(selected);
+    free(heap.items);
+    capture_reader_close(&reader);
+    return failed ? 1 : 0;
+}
+
+static int convert_from_csv(const char *path, const char *output)
+{
+    FILE *input = fopen(path, "r");
+    if (!input)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length = getline(&line, &line_capacity, input);
+    if (length < 0 || strncmp(line, "type,role,mac,", 14) != 0)
+    {
+        fprintf(stderr, "%s has no frames CSV header\n", path);
+        free(line);
+        fclose(input);
+        return 1;
+    }
+    bool trailing_columns = strstr(line, ",frame_sequence,") != NULL;
+    int columns = CSV_FRAME_FIELDS + 1 + (trailing_columns ? CSV_FRAME_TRAILING : 0) + 1;
+
+    capture_writer_t writer;
+    if (capture_writer_open(&writer, output) != ESP_OK)
+    {
+        free(line);
+        fclose(input);
+        return 1;
+    }
+
+    float *values = malloc(CSV_FRAME_MAX_VALUES * sizeof(float));
+    uint64_t rows = 0, skipped = 0;
+    while (values && (length = getline(&line, &line_capacity, input)) >= 0)
+    {
+        const char *end = line + length;
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r'))
+        {
+            end--;
+        }
+        if (end == line)
+        {
+            continue;
+        }
+
+        csv_span_t spans[CONVERT_MAX_COLUMNS + 1];
+        csv_row_t row;
+        csv_frame_t frame;
+        if (csv_split(line, end, spans, CONVERT_MAX_COLUMNS + 1) != columns)
+        {
+            skipped++;
+            continue;
+        }
+        memset(&row, 0, sizeof(row));
+        memcpy(row.fields, spans, sizeof(row.fields));
+        row.values = spans[CSV_FRAME_FIELDS];
+        if (trailing_columns)
+        {
+            memcpy(row.trailing, &spans[CSV_FRAME_FIELDS + 1], sizeof(row.trailing));
+            row.trailing_count = CSV_FRAME_TRAILING;
+        }
+
+        int64_t arrival_us;
+        if (!csv_row_to_frame(&row, &frame, values) || !csv_parse_local_time(spans[columns - 1], &arrival_us))
+        {
+            skipped++;
+            continue;
+        }
+        frame.record.arrival_us = arrival_us;
+        if (capture_writer_append(&writer, &frame) != ESP_OK)
+        {
+            skipped++;
+            continue;
+        }
+        rows++;
+    }
+
+    bool failed = !values || ferror(input);
+    failed = capture_writer_close(&writer) != ESP_OK || failed;
+    fprintf(stderr, "%llu records in %llu chunks, %llu rows skipped\n", (unsigned long long)rows,
+            (unsigned long long)writer.header.chunk_count, (unsigned long long)skipped);
+    free(values);
+    free(line);
+    fclose(input);
+    return failed ? 1 : 0;
+}
+
+static void convert_print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s info FILE.csic\n"
+            "       %s to-csv FILE.csic [OUT.csv] [--from SECONDS] [--to SECONDS] [--mac MAC]\n"
+            "       %s from-csv FILE.csv OUT.csic\n",
+            program, program, program);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "info") == 0)
+    {
+        return convert_info(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "from-csv") == 0)
+    {
+        return convert_from_csv(argv[2], argv[3]);
+    }
+    if (argc < 3 || strcmp(argv[1], "to-csv") != 0)
+    {
+        convert_print_usage(argv[0]);
+        return 2;
+    }
+
+    const char *output = NULL;
+    int64_t from_us = INT64_MIN, to_us = INT64_MAX;
+    uint8_t mac[6];
+    bool has_mac = false;
+    for (int argument = 3; argument < argc; argument++)
+    {
+        bool has_value = argument + 1 < argc;
+        if (strcmp(argv[argument], "--from") == 0 && has_value)
+        {
+            from_us = llround(strtod(argv[++argument], NULL) * 1e6);
+        }
+        else if (strcmp(argv[argument], "--to") == 0 && has_value)
+        {
+            to_us = llround(strtod(argv[++argument], NULL) * 1e6);
+        }
+        else if (strcmp(argv[argument], "--mac") == 0 && has_value)
+        {
+            const char *text = argv[++argument];
+            if (!csv_parse_mac((csv_span_t){text, strlen(text)}, mac))
+            {
+                fprintf(stderr, "Invalid MAC %s\n", text);
+                return 2;
+            }
+            has_mac = true;
+        }
+        else if (argv[argument][0] != '-' && !output)
+        {
+            output = argv[argument];
+        }
+        else
+        {
+            convert_print_usage(argv[0]);
+            return 2;
+        }
+    }
+    return convert_to_csv(argv[2], output, from_us, to_us, has_mac ? mac : NULL);
+}
@@ -0,0 +1,729 @@
+// Native receiver for the CSI stream of one or more APs. Writes the same CSV
+// files as csi_data_collector.py, at rates the Python script cannot keep up
+// with. Every listener (one UDP socket) has two threads:
+//
+//   receive  recvmmsg() fetches up to --batch datagrams per system call and
+//            copies them into the listener's lock-free ring (spsc_ring.h)
+//   write    decodes the datagrams in the ring into CSV rows, formatted into
+//            a 1 MiB buffer that is written out whole (output_writer.h), or
+//            with --format CAPTURE into a capture file (capture_writer.h)
+//
+// Several ports (one per AP, or per subscription) each get a listener, and
+// --threads opens more than one SO_REUSEPORT socket per port, so the kernel
+// spreads the APs sending to it over several listeners and cores. A full
+// ring drops datagrams instead of stalling the socket; the status line and
+// the final summary count them.
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "spsc_ring.h"
+#include "record_decoder.h"
+
+#define RECEIVER_DEFAULT_PORT 9999 // Data port of the AP, see udp_subscribers.h
+#define RECEIVER_MAX_LISTENERS 64
+#define RECEIVER_DEFAULT_BATCH 64
+#define RECEIVER_MAX_BATCH 1024
+#define RECEIVER_DEFAULT_RING_MB 32
+#define RECEIVER_DATAGRAM_SIZE 65536 // Full captures sent as text exceed one MTU
+#define RECEIVER_SOCKET_BUFFER (8 << 20)
+#define RECEIVER_POLL_TIMEOUT_MS 200   // How often a blocked receive thread checks for shutdown
+#define RECEIVER_IDLE_FLUSH_NS 100000000 // Pending rows reach the file this soon after the stream pauses
+#define RECEIVER_IDLE_SLEEP_NS 200000
+#define RECEIVER_DEFAULT_DIRECTORY "csi_data"
+
+// What the receive thread stores in front of each datagram in the ring
+typedef struct
+{
+    int64_t arrival_ns; // CLOCK_REALTIME when the batch holding it was received
+    uint32_t source_ip;
+    uint16_t source_port;
+    uint16_t reserved;
+} receiver_datagram_t;
+
+// Writer thread counters, copied out once per status interval
+typedef struct
+{
+    uint64_t frame_rows;
+    uint64_t feature_rows;
+    uint64_t malformed;
+    uint64_t unsupported;
+    uint64_t discarded;
+    uint64_t bytes_written;
+    int64_t alloc_fail;
+    int64_t queue_drops;
+    int64_t ring_drops;
+    int64_t decimated;
+    int64_t send_fail;
+    bool has_telemetry;
+    char stream_status[512];
+} receiver_snapshot_t;
+
+typedef struct
+{
+    uint16_t port;
+    int socket;
+    int batch;       // Datagrams per recvmmsg() call
+    int receive_cpu; // -1 unpinned
+    int write_cpu;
+    spsc_ring_t ring;
+    pthread_t receive_thread;
+    pthread_t write_thread;
+    char frames_path[PATH_MAX];
+    char features_path[PATH_MAX];
+    bool capture_format;
+
+    // Receive thread
+    atomic_uint_fast64_t datagrams;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t batches;
+    atomic_uint_fast64_t ring_drops;
+    atomic_bool receive_done;
+
+    // Write thread
+    output_writer_t frames;
+    capture_writer_t capture;
+    output_writer_t features;
+    record_decoder_t decoder;
+    pthread_mutex_t snapshot_lock;
+    receiver_snapshot_t snapshot;
+} receiver_listener_t;
+
+typedef struct
+{
+    uint16_t ports[RECEIVER_MAX_LISTENERS];
+    int port_count;
+    int threads_per_port;
+    int batch;
+    uint32_t ring_bytes;
+    bool pin_threads;
+    bool quiet;
+    bool capture_format; // Frames to a capture file instead of CSV
+    const char *output;
+} receiver_options_t;
+
+static volatile sig_atomic_t g_receiver_stop;
+static receiver_listener_t *g_receiver_listeners;
+static int g_receiver_listener_count;
+
+static void receiver_signal_handler(int signal_number)
+{
+    (void)signal_number;
+    g_receiver_stop = 1;
+}
+
+static int64_t receiver_clock_ns(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void receiver_pin_thread(int cpu)
+{
+    if (cpu < 0)
+    {
+        return;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % CPU_SETSIZE, &cpus);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result != 0)
+    {
+        fprintf(stderr, "Cannot pin thread to CPU %d: %s\n", cpu, strerror(result));
+    }
+}
+
+static void *receiver_receive_thread(void *argument)
+{
+    receiver_listener_t *listener = argument;
+    int batch = listener->batch;
+    receiver_pin_thread(listener->receive_cpu);
+
+    // One receive buffer per message of the batch
+    uint8_t *buffers = malloc((size_t)batch * RECEIVER_DATAGRAM_SIZE);
+    struct mmsghdr *messages = calloc(batch, sizeof(struct mmsghdr));
+    struct iovec *vectors = calloc(batch, sizeof(struct iovec));
+    struct sockaddr_in *sources = calloc(batch, sizeof(struct sockaddr_in));
+    if (!buffers || !messages || !vectors || !sources)
+    {
+        fprintf(stderr, "Port %u: out of memory for %d receive buffers\n", listener->port, batch);
+        g_receiver_stop = 1;
+        goto done;
+    }
+
+    for (int index = 0; index < batch; index++)
+    {
+        vectors[index].iov_base = buffers + (size_t)index * RECEIVER_DATAGRAM_SIZE;
+        vectors[index].iov_len = RECEIVER_DATAGRAM_SIZE;
+        messages[index].msg_hdr.msg_iov = &vectors[index];
+        messages[index].msg_hdr.msg_iovlen = 1;
+        messages[index].msg_hdr.msg_name = &sources[index];
+    }
+
+    while (!g_receiver_stop)
+    {
+        for (int index = 0; index < batch; index++)
+        {
+            messages[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+
+        // Blocks for the first datagram only, then takes whatever else is queued
+        int count = recvmmsg(listener->socket, messages, batch, MSG_WAITFORONE, NULL);
+        if (count < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Port %u: recvmmsg failed: %s\n", listener->port, strerror(errno));
+            break;
+        }
+
+        receiver_datagram_t datagram = {.arrival_ns = receiver_clock_ns(CLOCK_REALTIME)};
+        uint64_t bytes = 0;
+        for (int index = 0; index < count; index++)
+        {
+            uint32_t length = messages[index].msg_len;
+            uint8_t *entry = spsc_ring_reserve(&listener->ring, sizeof(datagram) + length);
+            if (!entry)
+            {
+                atomic_fetch_add_explicit(&listener->ring_drops, 1, memory_order_relaxed);
+                continue;
+            }
+
+            datagram.source_ip = sources[index].sin_addr.s_addr;
+            datagram.source_port = ntohs(sources[index].sin_port);
+            memcpy(entry, &datagram, sizeof(datagram));
+            memcpy(entry + sizeof(datagram), vectors[index].iov_base, length);
+            spsc_ring_commit(&listener->ring, sizeof(datagram) + length);
+            bytes += length;
+        }
+
+        atomic_fetch_add_explicit(&listener->datagrams, count, memory_order_relaxed);
+        atomic_fetch_add_explicit(&listener->bytes, bytes, memory_order_relaxed);
+        atomic_fetch_add_explicit(&listener->batches, 1, memory_order_relaxed);
+    }
+
+done:
+    free(buffers);
+    free(messages);
+    free(vectors);
+    free(sources);
+    atomic_store(&listener->receive_done, true);
+    return NULL;
+}
+
+static void receiver_publish_snapshot(receiver_listener_t *listener)
+{
+    record_decoder_t *decoder = &listener->decoder;
+    receiver_snapshot_t snapshot = {
+        .frame_rows = decoder->frame_rows,
+        .feature_rows = decoder->feature_rows,
+        .malformed = decoder->malformed,
+        .unsupported = decoder->unsupported,
+        .discarded = decoder->discarded,
+        .bytes_written =
+            listener->frames.bytes_written + listener->capture.bytes_written + listener->features.bytes_written,
+        .alloc_fail = record_decoder_telemetry_sum(decoder, TELEMETRY_ALLOC_FAIL),
+        .queue_drops = record_decoder_telemetry_sum(decoder, TELEMETRY_QUEUE_DROPS),
+        .ring_drops = record_decoder_telemetry_sum(decoder, TELEMETRY_RING_DROPS),
+        .decimated = record_decoder_telemetry_sum(decoder, TELEMETRY_DECIMATED),
+        .send_fail = record_decoder_telemetry_sum(decoder, TELEMETRY_SEND_FAIL),
+        .has_telemetry = decoder->telemetry_count > 0,
+    };
+    stream_monitor_status(&decoder->monitor, snapshot.stream_status, sizeof(snapshot.stream_status), 4);
+
+    pthread_mutex_lock(&listener->snapshot_lock);
+    listener->snapshot = snapshot;
+    pthread_mutex_unlock(&listener->snapshot_lock);
+}
+
+static void receiver_flush(receiver_listener_t *listener)
+{
+    if (listener->capture_format)
+    {
+        capture_writer_flush(&listener->capture);
+    }
+    else
+    {
+        output_writer_flush(&listener->frames);
+    }
+    output_writer_flush(&listener->features);
+}
+
+static void *receiver_write_thread(void *argument)
+{
+    receiver_listener_t *listener = argument;
+    receiver_pin_thread(listener->write_cpu);
+
+    int64_t last_row_ns = 0;
+    int64_t last_snapshot_ns = 0;
+    bool pending = false;
+
+    while (true)
+    {
+        uint32_t length;
+        const uint8_t *entry = spsc_ring_peek(&listener->ring, &length);
+        int64_t now_ns;
+
+        if (entry)
+        {
+            receiver_datagram_t datagram;
+            memcpy(&datagram, entry, sizeof(datagram));
+            record_decoder_datagram(&listener->decoder, entry + sizeof(datagram), length - sizeof(datagram),
+                                    datagram.source_ip, datagram.arrival_ns);
+            spsc_ring_consume(&listener->ring);
+            pending = true;
+
+            // Reading the clock per datagram is cheap next to decoding it
+            now_ns = receiver_clock_ns(CLOCK_MONOTONIC);
+            last_row_ns = now_ns;
+        }
+        else
+        {
+            if (atomic_load(&listener->receive_done) && !spsc_ring_peek(&listener->ring, &length))
+            {
+                break;
+            }
+
+            now_ns = receiver_clock_ns(CLOCK_MONOTONIC);
+            if (pending && now_ns - last_row_ns >= RECEIVER_IDLE_FLUSH_NS)
+            {
+                receiver_flush(listener);
+                pending = false;
+            }
+            struct timespec idle = {.tv_nsec = RECEIVER_IDLE_SLEEP_NS};
+            nanosleep(&idle, NULL);
+        }
+
+        if (now_ns - last_snapshot_ns >= 1000000000)
+        {
+            receiver_publish_snapshot(listener);
+            last_snapshot_ns = now_ns;
+        }
+    }
+
+    receiver_flush(listener);
+    receiver_publish_snapshot(listener);
+    return NULL;
+}
+
+static int receiver_open_socket(uint16_t port, bool reuse_port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+    {
+        fprintf(stderr, "SO_REUSEPORT: %s\n", strerror(errno));
+    }
+
+    // A deep socket buffer rides out writer stalls; the kernel caps it at net.core.rmem_max
+    int buffer_size = RECEIVER_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    struct timeval timeout = {.tv_usec = RECEIVER_POLL_TIMEOUT_MS * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        fprintf(stderr, "Cannot bind UDP port %u: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// <stem><suffix><extension>, e.g. csi_data_9999_1.csv or csi_data_features.csv;
+// extension NULL keeps the one of output
+static bool receiver_output_path(char *path, size_t capacity, const char *output, const char *suffix,
+                                 const char *extension)
+{
+    const char *slash = strrchr(output, '/');
+    const char *dot = strrchr(output, '.');
+    int length;
+    if (!dot || (slash && dot < slash))
+    {
+        length = snprintf(path, capacity, "%s%s%s", output, suffix, extension ? extension : ".csv");
+    }
+    else
+    {
+        length = snprintf(path, capacity, "%.*s%s%s", (int)(dot - output), output, suffix,
+                          extension ? extension : dot);
+    }
+    return length > 0 && (size_t)length < capacity;
+}
+
+static void receiver_print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n"
+           "  -p, --port PORT[,PORT...]  UDP ports to listen on (default %d), repeatable\n"
+           "  -t, --threads N            Sockets and thread pairs per port (SO_REUSEPORT, default 1)\n"
+           "  -o, --output FILE          CSV file (default %s/csi_data_<time>.csv); with several\n"
+           "                             listeners each writes FILE_<port>[_<n>].csv\n"
+           "  -f, --format CSV|CAPTURE   Frames as CSV rows (default) or to a capture file\n"
+           "                             FILE.csic (see capture_format.h); features stay CSV\n"
+           "  -b, --batch N              Datagrams per recvmmsg() call (default %d)\n"
+           "  -r, --ring-mb N            Ring between the threads of each listener (default %d MiB)\n"
+           "      --pin                  Pin the threads of each listener to their own cores\n"
+           "  -q, --quiet                No status line\n",
+           program, RECEIVER_DEFAULT_PORT, RECEIVER_DEFAULT_DIRECTORY, RECEIVER_DEFAULT_BATCH,
+           RECEIVER_DEFAULT_RING_MB);
+}
+
+static bool receiver_parse_options(int argc, char **argv, receiver_options_t *options)
+{
+    static const struct option long_options[] = {
+        {"port", required_argument, NULL, 'p'},    {"threads", required_argument, NULL, 't'},
+        {"output", required_argument, NULL, 'o'},  {"batch", required_argument, NULL, 'b'},
+        {"ring-mb", required_argument, NULL, 'r'}, {"pin", no_argument, NULL, 'P'},
+        {"quiet", no_argument, NULL, 'q'},         {"help", no_argument, NULL, 'h'},
+        {"format", required_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0},
+    };
+
+    *options = (receiver_options_t){
+        .threads_per_port = 1,
+        .batch = RECEIVER_DEFAULT_BATCH,
+        .ring_bytes = RECEIVER_DEFAULT_RING_MB << 20,
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "p:t:o:f:b:r:qh", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            for (char *port = strtok(optarg, ","); port; port = strtok(NULL, ","))
+            {
+                long value = strtol(port, NULL, 10);
+                if (value <= 0 || value > 65535 || options->port_count == RECEIVER_MAX_LISTENERS)
+                {
+                    fprintf(stderr, "Invalid port %s\n", port);
+                    return false;
+                }
+                options->ports[options->port_count++] = (uint16_t)value;
+            }
+            break;
+        case 't':
+            options->threads_per_port = atoi(optarg);
+            break;
+        case 'o':
+            options->output = optarg;
+            break;
+        case 'f':
+            if (strcasecmp(optarg, "CAPTURE") != 0 && strcasecmp(optarg, "CSV") != 0)
+            {
+                fprintf(stderr, "Format must be CSV or CAPTURE\n");
+                return false;
+            }
+            options->capture_format = strcasecmp(optarg, "CAPTURE") == 0;
+            break;
+        case 'b':
+            options->batch = atoi(optarg);
+            break;
+        case 'r':
+            options->ring_bytes = (uint32_t)atoi(optarg) << 20;
+            break;
+        case 'P':
+            options->pin_threads = true;
+            break;
+        case 'q':
+            options->quiet = true;
+            break;
+        default:
+            receiver_print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (options->port_count == 0)
+    {
+        options->ports[options->port_count++] = RECEIVER_DEFAULT_PORT;
+    }
+    if (options->threads_per_port < 1 || options->port_count * options->threads_per_port > RECEIVER_MAX_LISTENERS)
+    {
+        fprintf(stderr, "Between 1 and %d listeners in total\n", RECEIVER_MAX_LISTENERS);
+        return false;
+    }
+    if (options->batch < 1 || options->batch > RECEIVER_MAX_BATCH)
+    {
+        fprintf(stderr, "Batch must be 1-%d datagrams\n", RECEIVER_MAX_BATCH);
+        return false;
+    }
+    if (options->ring_bytes < (2u << 20) || options->ring_bytes > (1u << 30))
+    {
+        fprintf(stderr, "Ring must be 2-1024 MiB\n");
+        return false;
+    }
+    return true;
+}
+
+static void receiver_print_status(int64_t interval_ns, uint64_t *last_datagrams, uint64_t *last_rows,
+                                  uint64_t *last_bytes, bool final)
+{
+    uint64_t datagrams = 0, ring_drops = 0, rows = 0, features = 0, malformed = 0, discarded = 0;
+    uint64_t written = 0, ring_used = 0, ring_capacity = 0;
+    int64_t alloc_fail = 0, queue_drops = 0, device_ring_drops = 0, decimated = 0, send_fail = 0;
+    bool has_telemetry = false;
+    char stream_status[1024] = {0};
+    size_t stream_length = 0;
+
+    for (int index = 0; index < g_receiver_listener_count; index++)
+    {
+        receiver_listener_t *listener = &g_receiver_listeners[index];
+        datagrams += atomic_load_explicit(&listener->datagrams, memory_order_relaxed);
+        ring_drops += atomic_load_explicit(&listener->ring_drops, memory_order_relaxed);
+        ring_used += spsc_ring_used(&listener->ring);
+        ring_capacity += listener->ring.capacity;
+
+        pthread_mutex_lock(&listener->snapshot_lock);
+        receiver_snapshot_t *snapshot = &listener->snapshot;
+        rows += snapshot->frame_rows;
+        features += snapshot->feature_rows;
+        malformed += snapshot->malformed + snapshot->unsupported;
+        discarded += snapshot->discarded;
+        written += snapshot->bytes_written;
+        alloc_fail += snapshot->alloc_fail;
+        queue_drops += snapshot->queue_drops;
+        device_ring_drops += snapshot->ring_drops;
+        decimated += snapshot->decimated;
+        send_fail += snapshot->send_fail;
+        has_telemetry = has_telemetry || snapshot->has_telemetry;
+        if (snapshot->stream_status[0] && stream_length < sizeof(stream_status) - 1)
+        {
+            stream_length += snprintf(stream_status + stream_length, sizeof(stream_status) - stream_length, "%s%s",
+                                      stream_length ? " | " : "", snapshot->stream_status);
+        }
+        pthread_mutex_unlock(&listener->snapshot_lock);
+    }
+
+    if (final)
+    {
+        printf("\nReceived %llu datagrams, wrote %llu frames and %llu feature records (%.1f MB)\n",
+               (unsigned long long)datagrams, (unsigned long long)rows, (unsigned long long)features, written / 1e6);
+        printf("Ring drops %llu, malformed %llu, deltas without reference %llu\n", (unsigned long long)ring_drops,
+               (unsigned long long)malformed, (unsigned long long)discarded);
+        if (stream_status[0])
+        {
+            printf("%s\n", stream_status);
+        }
+        return;
+    }
+
+    double seconds = interval_ns / 1e9;
+    printf("\rStatus: %llu datagrams | PPS: %.0f | Frames/s: %.0f | Write: %.1f MB/s | Ring: %.0f%%",
+           (unsigned long long)datagrams, (datagrams - *last_datagrams) / seconds,
+           (rows + features - *last_rows) / seconds, (written - *last_bytes) / seconds / 1e6,
+           ring_capacity ? 100.0 * ring_used / ring_capacity : 0.0);
+    if (ring_drops)
+    {
+        printf(" drops %llu", (unsigned long long)ring_drops);
+    }
+    if (malformed)
+    {
+        printf(" | Malformed: %llu", (unsigned long long)malformed);
+    }
+    if (stream_status[0])
+    {
+        printf(" | %s", stream_status);
+    }
+    if (discarded)
+    {
+        printf(" | Deltas without reference: %llu", (unsigned long long)discarded);
+    }
+    if (has_telemetry)
+    {
+        printf(" | AP drops: alloc %lld queue %lld ring %lld decimated %lld send %lld", (long long)alloc_fail,
+               (long long)queue_drops, (long long)device_ring_drops, (long long)decimated, (long long)send_fail);
+    }
+    printf("    ");
+    fflush(stdout);
+
+    *last_datagrams = datagrams;
+    *last_rows = rows + features;
+    *last_bytes = written;
+}
+
+int main(int argc, char **argv)
+{
+    receiver_options_t options;
+    if (!receiver_parse_options(argc, argv, &options))
+    {
+        return 2;
+    }
+
+    char default_output[PATH_MAX];
+    if (!options.output)
+    {
+        char file_time[32];
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+        strftime(file_time, sizeof(file_time), "%Y%m%d_%H%M%S", &local);
+        mkdir(RECEIVER_DEFAULT_DIRECTORY, 0755);
+        snprintf(default_output, sizeof(default_output), "%s/csi_data_%s.csv", RECEIVER_DEFAULT_DIRECTORY,
+                 file_time);
+        options.output = default_output;
+    }
+
+    g_receiver_listener_count = options.port_count * options.threads_per_port;
+    g_receiver_listeners = calloc(g_receiver_listener_count, sizeof(receiver_listener_t));
+    if (!g_receiver_listeners)
+    {
+        return 1;
+    }
+
+    struct sigaction action = {.sa_handler = receiver_signal_handler};
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int index = 0; index < g_receiver_listener_count; index++)
+    {
+        receiver_listener_t *listener = &g_receiver_listeners[index];
+        int thread = index % options.threads_per_port;
+        listener->port = options.ports[index / options.threads_per_port];
+        listener->batch = options.batch;
+        listener->receive_cpu = options.pin_threads ? (int)((2 * index) % cpu_count) : -1;
+        listener->write_cpu = options.pin_threads ? (int)((2 * index + 1) % cpu_count) : -1;
+        pthread_mutex_init(&listener->snapshot_lock, NULL);
+
+        char suffix[32] = "";
+        if (g_receiver_listener_count > 1)
+        {
+            if (options.threads_per_port > 1)
+            {
+                snprintf(suffix, sizeof(suffix), "_%u_%d", listener->port, thread);
+            }
+            else
+            {
+                snprintf(suffix, sizeof(suffix), "_%u", listener->port);
+            }
+        }
+        listener->capture_format = options.capture_format;
+        bool paths_fit = receiver_output_path(listener->frames_path, sizeof(listener->frames_path), options.output,
+                                              suffix, options.capture_format ? ".csic" : NULL);
+        strncat(suffix, "_features", sizeof(suffix) - strlen(suffix) - 1);
+        paths_fit = paths_fit && receiver_output_path(listener->features_path, sizeof(listener->features_path),
+                                                      options.output, suffix, NULL);
+        if (!paths_fit)
+        {
+            fprintf(stderr, "Output path %s is too long\n", options.output);
+            return 1;
+        }
+
+        if (options.capture_format && access(listener->frames_path, F_OK) == 0)
+        {
+            // Capture files are not appended to like the CSV files
+            fprintf(stderr, "%s exists, choose another output\n", listener->frames_path);
+            return 1;
+        }
+
+        listener->socket = receiver_open_socket(listener->port, options.threads_per_port > 1);
+        esp_err_t frames_opened =
+            options.capture_format ? capture_writer_open(&listener->capture, listener->frames_path)
+                                   : output_writer_open(&listener->frames, listener->frames_path, CSV_FRAME_HEADER);
+        if (listener->socket < 0 || spsc_ring_init(&listener->ring, options.ring_bytes) != ESP_OK ||
+            frames_opened != ESP_OK ||
+            output_writer_open(&listener->features, listener->features_path, CSV_FEATURES_HEADER) != ESP_OK)
+        {
+            return 1;
+        }
+        record_decoder_init(&listener->decoder, options.capture_format ? NULL : &listener->frames,
+                            options.capture_format ? &listener->capture : NULL, &listener->features);
+        printf("Listening on UDP port %u, writing %s\n", listener->port, listener->frames_path);
+    }
+
+    for (int index = 0; index < g_receiver_listener_count; index++)
+    {
+        receiver_listener_t *listener = &g_receiver_listeners[index];
+        if (pthread_create(&listener->write_thread, NULL, receiver_write_thread, listener) != 0 ||
+            pthread_create(&listener->receive_thread, NULL, receiver_receive_thread, listener) != 0)
+        {
+            fprintf(stderr, "Cannot start the threads for port %u\n", listener->port);
+            return 1;
+        }
+    }
+    printf("Press Ctrl+C to stop collection\n");
+
+    uint64_t last_datagrams = 0, last_rows = 0, last_bytes = 0;
+    int64_t last_status_ns = receiver_clock_ns(CLOCK_MONOTONIC);
+    while (!g_receiver_stop)
+    {
+        struct timespec tick = {.tv_nsec = 100000000};
+        nanosleep(&tick, NULL);
+
+        int64_t now_ns = receiver_clock_ns(CLOCK_MONOTONIC);
+        if (now_ns - last_status_ns >= 1000000000)
+        {
+            if (!options.quiet)
+            {
+                receiver_print_status(now_ns - last_status_ns, &last_datagrams, &last_rows, &last_bytes, false);
+            }
+            last_status_ns = now_ns;
+        }
+    }
+
+    // Receive threads stop within one poll timeout, writers drain their rings first
+    for (int index = 0; index < g_receiver_listener_count; index++)
+    {
+        pthread_join(g_receiver_listeners[index].receive_thread, NULL);
+        pthread_join(g_receiver_listeners[index].write_thread, NULL);
+    }
+    receiver_print_status(0, &last_datagrams, &last_rows, &last_bytes, true);
+
+    for (int index = 0; index < g_receiver_listener_count; index++)
+    {
+        receiver_listener_t *listener = &g_receiver_listeners[index];
+        if (listener->capture_format)
+        {
+            if (capture_writer_close(&listener->capture) != ESP_OK)
+            {
+                fprintf(stderr, "%s was not closed cleanly, readers fall back to scanning it\n",
+                        listener->frames_path);
+            }
+        }
+        else
+        {
+            output_writer_close(&listener->frames);
+        }
+        output_writer_close(&listener->features);
+        record_decoder_deinit(&listener->decoder);
+        close(listener->socket);
+        free(listener->ring.buffer);
+    }
+    free(g_receiver_listeners);
+    return 0;
+}
@@ -0,0 +1,616 @@
+#ifndef CSV_FRAME_H
+#define CSV_FRAME_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "capture_format.h"
+#include "output_writer.h"
+
+// A CSI frame between the wire, CSV rows and capture records. Frames are
+// formatted as the rows csi_data_collector.py writes and parsed back from
+// them, in both CSV layouts: the current one with stream and capture layout
+// columns, and the legacy one without (e.g. csi_data/csi_data_20250608_171407.csv).
+
+#define CSV_FRAME_MAX_VALUES 2048 // Payload values of one frame, a full capture is 612
+#define CSV_FRAME_FIELDS 25       // Columns before CSI_DATA
+#define CSV_FRAME_TRAILING 9      // Stream and capture layout columns after CSI_DATA
+#define CSV_FRAME_STREAM_COLUMNS 5
+#define CSV_FRAME_MAX_ROW(value_count) ((size_t)(value_count) * 16 + 512)
+
+#define CSV_FRAME_HEADER                                                                                    \
+    "type,role,mac,rssi,rate,sig_mode,mcs,bandwidth,smoothing,not_sounding,aggregation,stbc,fec_coding,"    \
+    "sgi,noise_floor,ampdu_cnt,channel,secondary_channel,local_timestamp,ant,sig_len,rx_state,"             \
+    "real_time_set,real_timestamp,len,CSI_DATA,frame_sequence,alloc_drops,queue_drops,decimated,"           \
+    "ring_drops,capture_profile,lltf_subcarriers,htltf_subcarriers,stbc_htltf_subcarriers,pc_timestamp\r\n"
+#define CSV_FRAME_LEGACY_HEADER                                                                             \
+    "type,role,mac,rssi,rate,sig_mode,mcs,bandwidth,smoothing,not_sounding,aggregation,stbc,fec_coding,"    \
+    "sgi,noise_floor,ampdu_cnt,channel,secondary_channel,local_timestamp,ant,sig_len,rx_state,"             \
+    "real_time_set,real_timestamp,len,CSI_DATA,pc_timestamp\r\n"
+
+static const char *const g_capture_profile_names[] = {"LLTF", "HTLTF", "HTLTF_STBC", "FULL"};
+#define CSV_FRAME_PROFILE_COUNT (sizeof(g_capture_profile_names) / sizeof(g_capture_profile_names[0]))
+
+typedef struct
+{
+    capture_chunk_key_t key; // What the frame shares with the other records of its chunk
+    capture_record_t record;
+    const void *values; // key.value_count values of key.value_type
+} csv_frame_t;
+
+typedef struct
+{
+    const char *text;
+    size_t length;
+} csv_span_t;
+
+// The columns of one frame row. trailing_count is 0, 5 (stream only) or 9.
+typedef struct
+{
+    csv_span_t fields[CSV_FRAME_FIELDS];
+    csv_span_t values;
+    csv_span_t trailing[CSV_FRAME_TRAILING];
+    int trailing_count;
+} csv_row_t;
+
+// Local wall clock of the last second formatted, for pc_timestamp
+typedef struct
+{
+    time_t second;
+    char prefix[24];
+} csv_clock_t;
+
+static inline void csv_clock_init(csv_clock_t *clock)
+{
+    clock->second = (time_t)-1;
+    clock->prefix[0] = '\0';
+}
+
+// "YYYY-mm-dd HH:MM:SS.mmm" local time, like the collector's pc_timestamp
+static char *csv_put_local_time(char *out, csv_clock_t *clock, int64_t time_us)
+{
+    int64_t second = time_us / 1000000;
+    int64_t microseconds = time_us % 1000000;
+    if (microseconds < 0)
+    {
+        second--;
+        microseconds += 1000000;
+    }
+
+    if ((time_t)second != clock->second)
+    {
+        time_t local_second = (time_t)second;
+        struct tm local;
+        localtime_r(&local_second, &local);
+        strftime(clock->prefix, sizeof(clock->prefix), "%Y-%m-%d %H:%M:%S", &local);
+        clock->second = local_second;
+    }
+
+    uint32_t milliseconds = (uint32_t)(microseconds / 1000);
+    out = output_put_string(out, clock->prefix);
+    *out++ = '.';
+    *out++ = (char)('0' + milliseconds / 100);
+    *out++ = (char)('0' + milliseconds / 10 % 10);
+    *out++ = (char)('0' + milliseconds % 10);
+    return out;
+}
+
+static char *csv_end_row(char *out, csv_clock_t *clock, int64_t arrival_us)
+{
+    out = csv_put_local_time(out, clock, arrival_us);
+    *out++ = '\r';
+    *out++ = '\n';
+    return out;
+}
+
+static char *csv_put_mac(char *out, const uint8_t mac[6])
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (int index = 0; index < 6; index++)
+    {
+        if (index)
+        {
+            *out++ = ':';
+        }
+        *out++ = hex[mac[index] >> 4];
+        *out++ = hex[mac[index] & 0x0F];
+    }
+    return out;
+}
+
+// Seconds and microseconds, rounded down like divmod()
+static char *csv_put_wall_time(char *out, int64_t timestamp_us)
+{
+    int64_t seconds = timestamp_us / 1000000;
+    int64_t microseconds = timestamp_us % 1000000;
+    if (microseconds < 0)
+    {
+        seconds--;
+        microseconds += 1000000;
+    }
+    out = output_put_int(out, seconds);
+    *out++ = '.';
+    for (int digit = 5; digit >= 0; digit--)
+    {
+        out[digit] = (char)('0' + microseconds % 10);
+        microseconds /= 10;
+    }
+    return out + 6;
+}
+
+static inline char *csv_put_flag(char *out, bool set)
+{
+    *out++ = set ? '1' : '0';
+    *out++ = ',';
+    return out;
+}
+
+static inline char *csv_put_column(char *out, int64_t value)
+{
+    out = output_put_int(out, value);
+    *out++ = ',';
+    return out;
+}
+
+static inline char *csv_put_name(char *out, const char name[CAPTURE_NAME_LENGTH])
+{
+    return output_put_bytes(out, name, strnlen(name, CAPTURE_NAME_LENGTH));
+}
+
+// Value index of a frame as the collector prints it
+static inline char *csv_put_value(char *out, uint8_t value_type, const void *values, uint16_t index)
+{
+    switch (value_type)
+    {
+    case CAPTURE_VALUE_INT8:
+        return output_put_int(out, ((const int8_t *)values)[index]);
+    case CAPTURE_VALUE_UINT16_Q8:
+    {
+        uint16_t value;
+        memcpy(&value, (const uint8_t *)values + index * 2, sizeof(value));
+        return output_put_fixed(out, value / 256.0, 4);
+    }
+    case CAPTURE_VALUE_INT16_Q15:
+    {
+        int16_t value;
+        memcpy(&value, (const uint8_t *)values + index * 2, sizeof(value));
+        return output_put_fixed(out, value * 3.141592653589793 / 32768.0, 4);
+    }
+    case CAPTURE_VALUE_INT16_PHASE_SANITIZED:
+    {
+        int16_t value;
+        memcpy(&value, (const uint8_t *)values + index * 2, sizeof(value));
+        return output_put_fixed(out, value * 3.141592653589793 / 1024.0, 4);
+    }
+    default:
+    {
+        float value;
+        memcpy(&value, (const uint8_t *)values + index * 4, sizeof(value));
+        return output_put_fixed(out, value, 4);
+    }
+    }
+}
+
+// A frame row up to and including the comma before pc_timestamp. Without
+// trailing_columns the row has the legacy layout; otherwise columns the
+// frame's source did not have are left blank.
+char *csv_put_frame_row(char *out, const csv_frame_t *frame, bool trailing_columns)
+{
+    const capture_chunk_key_t *key = &frame->key;
+    const capture_record_t *record = &frame->record;
+    const csi_wire_rx_ctrl_t *rx = &record->rx_ctrl;
+
+    out = csv_put_name(out, key->type);
+    *out++ = ',';
+    out = csv_put_name(out, key->role);
+    *out++ = ',';
+    out = csv_put_mac(out, record->mac);
+    *out++ = ',';
+    out = csv_put_column(out, rx->rssi);
+    out = csv_put_column(out, rx->rate);
+    out = csv_put_column(out, rx->sig_mode);
+    out = csv_put_column(out, rx->mcs);
+    out = csv_put_column(out, rx->cwb);
+    out = csv_put_flag(out, rx->rx_flags & CSI_WIRE_RX_SMOOTHING);
+    out = csv_put_flag(out, rx->rx_flags & CSI_WIRE_RX_NOT_SOUNDING);
+    out = csv_put_flag(out, rx->rx_flags & CSI_WIRE_RX_AGGREGATION);
+    out = csv_put_column(out, rx->stbc);
+    out = csv_put_flag(out, rx->rx_flags & CSI_WIRE_RX_FEC_CODING);
+    out = csv_put_flag(out, rx->rx_flags & CSI_WIRE_RX_SGI);
+    out = csv_put_column(out, rx->noise_floor);
+    out = csv_put_column(out, rx->ampdu_cnt);
+    out = csv_put_column(out, rx->channel);
+    out = csv_put_column(out, rx->secondary_channel);
+    out = csv_put_column(out, rx->local_timestamp);
+    out = csv_put_column(out, rx->ant);
+    out = csv_put_column(out, rx->sig_len);
+    out = csv_put_column(out, rx->rx_state);
+    out = csv_put_flag(out, record->flags & CAPTURE_RECORD_FLAG_TIME_SYNCED);
+    out = csv_put_wall_time(out, record->timestamp_us);
+    *out++ = ',';
+    out = csv_put_column(out, record->csi_length);
+
+    for (uint16_t index = 0; index < key->value_count; index++)
+    {
+        if (index)
+        {
+            *out++ = ' ';
+        }
+        out = csv_put_value(out, key->value_type, frame->values, index);
+    }
+    *out++ = ',';
+
+    if (!trailing_columns)
+    {
+        return out;
+    }
+    if (key->flags & CAPTURE_KEY_FLAG_STREAM_COLUMNS)
+    {
+        out = csv_put_column(out, record->stream.frame_sequence);
+        out = csv_put_column(out, record->stream.alloc_drops);
+        out = csv_put_column(out, record->stream.queue_drops);
+        out = csv_put_column(out, record->stream.decimated);
+        out = csv_put_column(out, record->stream.ring_drops);
+    }
+    else
+    {
+        out = output_put_string(out, ",,,,,");
+    }
+    if (key->flags & CAPTURE_KEY_FLAG_LAYOUT_COLUMNS)
+    {
+        if (key->layout.capture_profile < CSV_FRAME_PROFILE_COUNT)
+        {
+            out = output_put_string(out, g_capture_profile_names[key->layout.capture_profile]);
+        }
+        else
+        {
+            out = output_put_uint(out, key->layout.capture_profile);
+        }
+        *out++ = ',';
+        out = csv_put_column(out, key->layout.lltf_pairs);
+        out = csv_put_column(out, key->layout.htltf_pairs);
+        out = csv_put_column(out, key->layout.stbc_htltf_pairs);
+    }
+    else
+    {
+        out = output_put_string(out, ",,,,");
+    }
+    return out;
+}
+
+// Parsing, all spans are bounded and need not be NUL terminated
+
+static bool csv_parse_int(csv_span_t span, int64_t *value)
+{
+    const char *text = span.text;
+    const char *end = text + span.length;
+    bool negative = text < end && *text == '-';
+    text += negative || (text < end && *text == '+');
+    if (text == end)
+    {
+        return false;
+    }
+
+    int64_t result = 0;
+    for (; text < end; text++)
+    {
+        if (*text < '0' || *text > '9')
+        {
+            return false;
+        }
+        result = result * 10 + (*text - '0');
+    }
+    *value = negative ? -result : result;
+    return true;
+}
+
+// Decimal number as printed by the encoders; exact for up to 15 digits
+static bool csv_parse_decimal(const char *text, const char *end, double *value)
+{
+    bool negative = text < end && *text == '-';
+    text += negative;
+
+    int64_t digits = 0;
+    int64_t scale = 1;
+    bool any = false, fraction = false;
+    for (; text < end; text++)
+    {
+        if (*text == '.' && !fraction)
+        {
+            fraction = true;
+            continue;
+        }
+        if (*text < '0' || *text > '9' || scale > 100000000000000)
+        {
+            return false;
+        }
+        digits = digits * 10 + (*text - '0');
+        scale *= fraction ? 10 : 1;
+        any = true;
+    }
+    if (!any)
+    {
+        return false;
+    }
+    *value = (negative ? -(double)digits : (double)digits) / (double)scale;
+    return true;
+}
+
+// "<seconds>.<microseconds>" into microseconds
+static bool csv_parse_wall_time(csv_span_t span, int64_t *timestamp_us)
+{
+    const char *dot = memchr(span.text, '.', span.length);
+    int64_t seconds, microseconds = 0;
+    if (!dot)
+    {
+        return csv_parse_int(span, &seconds) && (*timestamp_us = seconds * 1000000, true);
+    }
+
+    csv_span_t whole = {span.text, (size_t)(dot - span.text)};
+    if (!csv_parse_int(whole, &seconds))
+    {
+        return false;
+    }
+    const char *fraction = dot + 1;
+    const char *end = span.text + span.length;
+    int digits = 0;
+    for (; fraction < end; fraction++, digits++)
+    {
+        if (*fraction < '0' || *fraction > '9')
+        {
+            return false;
+        }
+        if (digits < 6)
+        {
+            microseconds = microseconds * 10 + (*fraction - '0');
+        }
+    }
+    for (; digits < 6; digits++)
+    {
+        microseconds *= 10;
+    }
+    *timestamp_us = seconds * 1000000 + (span.text[0] == '-' ? -microseconds : microseconds);
+    return true;
+}
+
+// pc_timestamp back into microseconds, local time
+bool csv_parse_local_time(csv_span_t span, int64_t *time_us)
+{
+    char text[32];
+    if (span.length < 19 || span.length >= sizeof(text))
+    {
+        return false;
+    }
+    memcpy(text, span.text, span.length);
+    text[span.length] = '\0';
+
+    struct tm local = {0};
+    char *rest = strptime(text, "%Y-%m-%d %H:%M:%S", &local);
+    if (!rest)
+    {
+        return false;
+    }
+    local.tm_isdst = -1;
+    int64_t milliseconds = 0;
+    if (*rest == '.')
+    {
+        milliseconds = strtol(rest + 1, NULL, 10);
+    }
+    *time_us = (int64_t)mktime(&local) * 1000000 + milliseconds * 1000;
+    return true;
+}
+
+static bool csv_parse_mac(csv_span_t span, uint8_t mac[6])
+{
+    if (span.length != 17)
+    {
+        return false;
+    }
+    for (int index = 0; index < 6; index++)
+    {
+        int value = 0;
+        for (int digit = 0; digit < 2; digit++)
+        {
+            char character = span.text[index * 3 + digit];
+            int nibble = character >= '0' && character <= '9'   ? character - '0'
+                         : character >= 'A' && character <= 'F' ? character - 'A' + 10
+                         : character >= 'a' && character <= 'f' ? character - 'a' + 10
+                                                                : -1;
+            if (nibble < 0)
+            {
+                return false;
+            }
+            value = value * 16 + nibble;
+        }
+        mac[index] = (uint8_t)value;
+    }
+    return true;
+}
+
+static void csv_copy_name(char name[CAPTURE_NAME_LENGTH], csv_span_t span)
+{
+    size_t length = span.length < CAPTURE_NAME_LENGTH ? span.length : CAPTURE_NAME_LENGTH;
+    memset(name, 0, CAPTURE_NAME_LENGTH);
+    memcpy(name, span.text, length);
+}
+
+// Space separated values: INT8 if they are all integers in range, FLOAT32
+// otherwise. value_storage has room for CSV_FRAME_MAX_VALUES floats.
+static bool csv_parse_values(csv_span_t span, capture_chunk_key_t *key, void *value_storage)
+{
+    float *floats = value_storage;
+    bool integers = true;
+    uint16_t count = 0;
+    const char *text = span.text;
+    const char *end = span.text + span.length;
+
+    while (text < end)
+    {
+        while (text < end && *text == ' ')
+        {
+            text++;
+        }
+        const char *token = text;
+        while (text < end && *text != ' ')
+        {
+            text++;
+        }
+        if (token == text)
+        {
+            break;
+        }
+
+        double value;
+        if (count == CSV_FRAME_MAX_VALUES || !csv_parse_decimal(token, text, &value))
+        {
+            return false;
+        }
+        integers = integers && memchr(token, '.', text - token) == NULL && value >= -128 && value <= 127;
+        floats[count++] = (float)value;
+    }
+
+    key->value_count = count;
+    key->value_type = integers ? CAPTURE_VALUE_INT8 : CAPTURE_VALUE_FLOAT32;
+    if (integers)
+    {
+        // In place, the int8 copy never overtakes the floats still to convert
+        int8_t *bytes = value_storage;
+        for (uint16_t index = 0; index < count; index++)
+        {
+            bytes[index] = (int8_t)floats[index];
+        }
+    }
+    return true;
+}
+
+// A parsed frame row into a frame whose values live in value_storage
+bool csv_row_to_frame(const csv_row_t *row, csv_frame_t *frame, void *value_storage)
+{
+    static const uint8_t flag_bits[] = {CSI_WIRE_RX_SMOOTHING, CSI_WIRE_RX_NOT_SOUNDING, CSI_WIRE_RX_AGGREGATION, 0,
+                                        CSI_WIRE_RX_FEC_CODING, CSI_WIRE_RX_SGI};
+    int64_t numbers[CSV_FRAME_FIELDS] = {0};
+    memset(frame, 0, sizeof(*frame));
+
+    // Columns 3-22 and 24 are integers, 23 is real_timestamp
+    for (int column = 3; column < CSV_FRAME_FIELDS; column++)
+    {
+        if (column != 23 && !csv_parse_int(row->fields[column], &numbers[column]))
+        {
+            return false;
+        }
+    }
+
+    capture_chunk_key_t *key = &frame->key;
+    capture_record_t *record = &frame->record;
+    csi_wire_rx_ctrl_t *rx = &record->rx_ctrl;
+    int64_t timestamp_us;
+    if (!csv_parse_mac(row->fields[2], record->mac) || !csv_parse_wall_time(row->fields[23], &timestamp_us) ||
+        !csv_parse_values(row->values, key, value_storage))
+    {
+        return false;
+    }
+    record->timestamp_us = timestamp_us;
+    csv_copy_name(key->type, row->fields[0]);
+    csv_copy_name(key->role, row->fields[1]);
+
+    rx->rssi = (int8_t)numbers[3];
+    rx->rate = (uint8_t)numbers[4];
+    rx->sig_mode = (uint8_t)numbers[5];
+    rx->mcs = (uint8_t)numbers[6];
+    rx->cwb = (uint8_t)numbers[7];
+    for (int flag = 0; flag < 6; flag++)
+    {
+        rx->rx_flags |= numbers[8 + flag] ? flag_bits[flag] : 0;
+    }
+    rx->stbc = (uint8_t)numbers[11];
+    rx->noise_floor = (int8_t)numbers[14];
+    rx->ampdu_cnt = (uint8_t)numbers[15];
+    rx->channel = (uint8_t)numbers[16];
+    rx->secondary_channel = (uint8_t)numbers[17];
+    rx->local_timestamp = (uint32_t)numbers[18];
+    rx->ant = (uint8_t)numbers[19];
+    rx->sig_len = (uint16_t)numbers[20];
+    rx->rx_state = (uint8_t)numbers[21];
+    record->flags = numbers[22] ? CAPTURE_RECORD_FLAG_TIME_SYNCED : 0;
+    record->csi_length = (uint16_t)numbers[24];
+
+    if (row->trailing_count >= CSV_FRAME_STREAM_COLUMNS)
+    {
+        int64_t stream[CSV_FRAME_STREAM_COLUMNS];
+        bool parsed = true;
+        for (int column = 0; column < CSV_FRAME_STREAM_COLUMNS; column++)
+        {
+            parsed = parsed && csv_parse_int(row->trailing[column], &stream[column]);
+        }
+        if (parsed)
+        {
+            key->flags |= CAPTURE_KEY_FLAG_STREAM_COLUMNS;
+            record->stream.frame_sequence = (uint32_t)stream[0];
+            record->stream.alloc_drops = (uint16_t)stream[1];
+            record->stream.queue_drops = (uint16_t)stream[2];
+            record->stream.decimated = (uint16_t)stream[3];
+            record->stream.ring_drops = (uint16_t)stream[4];
+        }
+    }
+    if (row->trailing_count == CSV_FRAME_TRAILING)
+    {
+        int64_t pairs[3];
+        csv_span_t profile = row->trailing[5];
+        int64_t profile_number;
+        bool parsed = true;
+        for (int column = 0; column < 3; column++)
+        {
+            parsed = parsed && csv_parse_int(row->trailing[6 + column], &pairs[column]);
+        }
+        if (parsed)
+        {
+            key->layout.capture_profile = 0xFF;
+            for (uint8_t name = 0; name < CSV_FRAME_PROFILE_COUNT; name++)
+            {
+                if (strlen(g_capture_profile_names[name]) == profile.length &&
+                    memcmp(g_capture_profile_names[name], profile.text, profile.length) == 0)
+                {
+                    key->layout.capture_profile = name;
+                }
+            }
+            if (key->layout.capture_profile == 0xFF && csv_parse_int(profile, &profile_number))
+            {
+                key->layout.capture_profile = (uint8_t)profile_number;
+            }
+            key->flags |= CAPTURE_KEY_FLAG_LAYOUT_COLUMNS;
+            key->layout.lltf_pairs = (uint16_t)pairs[0];
+            key->layout.htltf_pairs = (uint16_t)pairs[1];
+            key->layout.stbc_htltf_pairs = (uint16_t)pairs[2];
+        }
+    }
+
+    key->record_size = capture_record_size(key->value_type, key->value_count);
+    frame->values = value_storage;
+    return true;
+}
+
+// Split comma separated columns of a CSV line (no quoting, the encoders never
+// need it) into at most capacity spans; returns the column count
+static int csv_split(const char *text, const char *end, csv_span_t *columns, int capacity)
+{
+    int count = 0;
+    while (count < capacity)
+    {
+        const char *comma = memchr(text, ',', end - text);
+        const char *column_end = comma ? comma : end;
+        columns[count].text = text;
+        columns[count].length = (size_t)(column_end - text);
+        count++;
+        if (!comma)
+        {
+            break;
+        }
+        text = comma + 1;
+    }
+    return count;
+}
+
+#endif // CSV_FRAME_H
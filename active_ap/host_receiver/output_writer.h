@@ -0,0 +1,204 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_err.h"
+
+// Buffered CSV output. Rows are formatted straight into a large buffer that
+// goes to the file with one write() once it is full, or when the writer
+// thread runs idle, instead of one flush per row. Rows end in "\r\n" like
+// the rows Python's csv module writes, so files from both receivers match.
+
+#define OUTPUT_WRITER_BUFFER_SIZE (1 << 20)
+
+typedef struct
+{
+    int fd;
+    char *buffer;
+    size_t used;
+    uint64_t bytes_written;
+    uint32_t write_errors;
+} output_writer_t;
+
+// Append to path, writing header_line first if the file is new or empty
+esp_err_t output_writer_open(output_writer_t *writer, const char *path, const char *header_line)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (writer->fd < 0)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    writer->buffer = malloc(OUTPUT_WRITER_BUFFER_SIZE);
+    if (!writer->buffer)
+    {
+        close(writer->fd);
+        writer->fd = -1;
+        return ESP_ERR_NO_MEM;
+    }
+
+    struct stat file_status;
+    if (header_line && fstat(writer->fd, &file_status) == 0 && file_status.st_size == 0)
+    {
+        size_t length = strlen(header_line);
+        memcpy(writer->buffer, header_line, length);
+        writer->used = length;
+    }
+    return ESP_OK;
+}
+
+// Replace path with a file holding only header_line
+esp_err_t output_writer_create(output_writer_t *writer, const char *path, const char *header_line)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return output_writer_open(writer, path, header_line);
+}
+
+esp_err_t output_writer_flush(output_writer_t *writer)
+{
+    size_t offset = 0;
+    while (offset < writer->used)
+    {
+        ssize_t written = write(writer->fd, writer->buffer + offset, writer->used - offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            writer->write_errors++;
+            writer->used = 0;
+            return ESP_FAIL;
+        }
+        offset += (size_t)written;
+    }
+    writer->bytes_written += writer->used;
+    writer->used = 0;
+    return ESP_OK;
+}
+
+// Room for a row of up to max_length bytes at the end of the buffer
+char *output_writer_reserve(output_writer_t *writer, size_t max_length)
+{
+    if (max_length > OUTPUT_WRITER_BUFFER_SIZE)
+    {
+        return NULL;
+    }
+    if (writer->used + max_length > OUTPUT_WRITER_BUFFER_SIZE)
+    {
+        output_writer_flush(writer);
+    }
+    return writer->buffer + writer->used;
+}
+
+// Keep the row written into the reserved space, end to the first unused byte
+void output_writer_commit(output_writer_t *writer, const char *end)
+{
+    writer->used = (size_t)(end - writer->buffer);
+}
+
+void output_writer_close(output_writer_t *writer)
+{
+    if (writer->fd >= 0)
+    {
+        output_writer_flush(writer);
+        close(writer->fd);
+    }
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->fd = -1;
+}
+
+// Row formatting, the caller reserved enough room
+
+static inline char *output_put_bytes(char *out, const char *data, size_t length)
+{
+    memcpy(out, data, length);
+    return out + length;
+}
+
+static inline char *output_put_string(char *out, const char *text)
+{
+    return output_put_bytes(out, text, strlen(text));
+}
+
+static inline char *output_put_uint(char *out, uint64_t value)
+{
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while (count)
+    {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+static inline char *output_put_int(char *out, int64_t value)
+{
+    if (value < 0)
+    {
+        *out++ = '-';
+        return output_put_uint(out, (uint64_t)0 - (uint64_t)value);
+    }
+    return output_put_uint(out, (uint64_t)value);
+}
+
+// value with a fixed number of decimals (at most 6), rounded like printf()
+static inline char *output_put_fixed(char *out, double value, int decimals)
+{
+    static const double scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    double scaled = value * scales[decimals];
+    double whole = floor(fabs(scaled));
+    double fraction = fabs(scaled) - whole;
+
+    // Near a tie the product may have rounded the wrong way; let printf decide
+    if (!isfinite(scaled) || fabs(fraction - 0.5) < 1e-6 || fabs(scaled) > 1e15)
+    {
+        return out + sprintf(out, "%.*f", decimals, value);
+    }
+
+    uint64_t units = (uint64_t)whole + (fraction > 0.5 ? 1 : 0);
+    if (signbit(scaled))
+    {
+        // printf keeps the sign of values that round to zero, and of -0.0
+        *out++ = '-';
+    }
+
+    uint64_t divisor = (uint64_t)scales[decimals];
+    out = output_put_uint(out, units / divisor);
+    if (decimals)
+    {
+        uint64_t rest = units % divisor;
+        *out++ = '.';
+        for (int digit = decimals - 1; digit >= 0; digit--)
+        {
+            out[digit] = (char)('0' + rest % 10);
+            rest /= 10;
+        }
+        out += decimals;
+    }
+    return out;
+}
+
+#endif // OUTPUT_WRITER_H
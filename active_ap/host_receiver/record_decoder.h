@@ -0,0 +1,848 @@
+#ifndef RECORD_DECODER_H
+#define RECORD_DECODER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include "csi_wire_format.h"
+#include "output_writer.h"
+#include "capture_writer.h"
+#include "csv_frame.h"
+#include "stream_monitor.h"
+
+// Turns the datagrams the AP sends into the CSV rows csi_data_collector.py
+// writes: the same columns for text and binary records, feature records to
+// a file of their own, CSI_STATS telemetry kept for the status line. With a
+// capture writer, frames go to a capture file (capture_writer.h) instead. A
+// datagram may hold a batch of records (see frame_batcher.h); binary
+// records are delimited by record_length, text records by their newline.
+//
+// Compressed binary payloads (csi_compression.h) are decoded against the
+// station's previous record. References are per decoder, which is fine as
+// long as one AP's stream goes to one decoder: connected UDP sockets keep
+// the source port, and SO_REUSEPORT hashes by it.
+
+#define RECORD_DECODER_MAX_VALUES CSV_FRAME_MAX_VALUES
+#define RECORD_DECODER_MAX_REFERENCES 256 // Stations with compressed streams, power of two
+#define RECORD_DECODER_MAX_SOURCES 16     // APs whose telemetry is kept
+
+// Header up to value_count; versions 3 and 4 append the stream and layout blocks
+#define RECORD_DECODER_BASE_HEADER_SIZE offsetof(csi_wire_record_header_t, stream)
+
+#define CSV_FEATURES_HEADER                                                                                 \
+    "type,role,mac,rssi_mean,real_timestamp,frames,window,energy,motion_score,subcarrier_stats,"           \
+    "frame_sequence,alloc_drops,queue_drops,decimated,ring_drops,capture_profile,lltf_subcarriers,"         \
+    "htltf_subcarriers,stbc_htltf_subcarriers,pc_timestamp\r\n"
+
+#define TELEMETRY_PREFIX "CSI_STATS,"
+
+// Positions in the CSI_STATS line, see pipeline_stats.h
+typedef enum
+{
+    TELEMETRY_UPTIME_US,
+    TELEMETRY_SEEN,
+    TELEMETRY_FILTERED,
+    TELEMETRY_ALLOC_FAIL,
+    TELEMETRY_QUEUE_DROPS,
+    TELEMETRY_QUEUE_HWM,
+    TELEMETRY_ENCODED,
+    TELEMETRY_RING_DROPS,
+    TELEMETRY_CYCLES_MIN,
+    TELEMETRY_CYCLES_AVG,
+    TELEMETRY_CYCLES_MAX,
+    TELEMETRY_DATAGRAMS,
+    TELEMETRY_SEND_FAIL,
+    TELEMETRY_BYTES_SENT,
+    TELEMETRY_DECIMATED,
+    TELEMETRY_FIELD_COUNT = 29 // Including the traffic generator, replay and time sync fields
+} telemetry_field_t;
+
+typedef struct
+{
+    bool used;
+    uint8_t mac[6];
+    uint8_t sequence;
+    uint8_t payload_type;
+    uint16_t value_count;
+    int32_t *values; // RECORD_DECODER_MAX_VALUES, allocated with the first keyframe
+} record_reference_t;
+
+typedef struct
+{
+    uint32_t source_ip;
+    int64_t values[TELEMETRY_FIELD_COUNT];
+} record_telemetry_t;
+
+typedef struct
+{
+    output_writer_t *frames;
+    capture_writer_t *capture; // Takes the frames instead of the frames CSV if set
+    output_writer_t *features;
+    stream_monitor_t monitor;
+
+    record_reference_t references[RECORD_DECODER_MAX_REFERENCES];
+    record_telemetry_t telemetry[RECORD_DECODER_MAX_SOURCES];
+    uint32_t telemetry_count;
+
+    csv_clock_t clock; // For pc_timestamp
+
+    uint64_t frame_rows;
+    uint64_t feature_rows;
+    uint64_t malformed;   // Truncated or inconsistent records
+    uint64_t unsupported; // Unknown version or payload type
+    uint64_t discarded;   // Deltas without reference
+} record_decoder_t;
+
+// Frames to the frames CSV, or to capture if it is not NULL
+void record_decoder_init(record_decoder_t *decoder, output_writer_t *frames, capture_writer_t *capture,
+                         output_writer_t *features)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->frames = frames;
+    decoder->capture = capture;
+    decoder->features = features;
+    csv_clock_init(&decoder->clock);
+}
+
+void record_decoder_deinit(record_decoder_t *decoder)
+{
+    for (int index = 0; index < RECORD_DECODER_MAX_REFERENCES; index++)
+    {
+        free(decoder->references[index].values);
+        decoder->references[index].values = NULL;
+    }
+}
+
+static char *record_decoder_end_row(record_decoder_t *decoder, char *out, int64_t arrival_ns)
+{
+    return csv_end_row(out, &decoder->clock, arrival_ns / 1000);
+}
+
+static inline bool record_is_space(char character)
+{
+    return character == ' ' || character == '\t' || character == '\r' || character == '\n' ||
+           character == '\v' || character == '\f';
+}
+
+static void record_trim(const char **text, const char **end)
+{
+    while (*text < *end && record_is_space(**text))
+    {
+        (*text)++;
+    }
+    while (*end > *text && record_is_space((*end)[-1]))
+    {
+        (*end)--;
+    }
+}
+
+// A telemetry field summed over the APs, 0 before the first CSI_STATS line
+int64_t record_decoder_telemetry_sum(const record_decoder_t *decoder, telemetry_field_t field)
+{
+    int64_t sum = 0;
+    for (uint32_t source = 0; source < decoder->telemetry_count; source++)
+    {
+        sum += decoder->telemetry[source].values[field];
+    }
+    return sum;
+}
+
+static void record_decoder_telemetry(record_decoder_t *decoder, const char *text, const char *end,
+                                     uint32_t source_ip)
+{
+    record_telemetry_t *telemetry = NULL;
+    for (uint32_t source = 0; source < decoder->telemetry_count; source++)
+    {
+        if (decoder->telemetry[source].source_ip == source_ip)
+        {
+            telemetry = &decoder->telemetry[source];
+        }
+    }
+    if (!telemetry)
+    {
+        if (decoder->telemetry_count == RECORD_DECODER_MAX_SOURCES)
+        {
+            return;
+        }
+        telemetry = &decoder->telemetry[decoder->telemetry_count++];
+        telemetry->source_ip = source_ip;
+    }
+
+    // Task stack entries (name=free) follow the numeric fields and are not kept
+    text += strlen(TELEMETRY_PREFIX);
+    for (int field = 0; field < TELEMETRY_FIELD_COUNT && text < end; field++)
+    {
+        bool negative = *text == '-';
+        int64_t value = 0;
+        for (text += negative; text < end && *text >= '0' && *text <= '9'; text++)
+        {
+            value = value * 10 + (*text - '0');
+        }
+        telemetry->values[field] = negative ? -value : value;
+
+        const char *comma = memchr(text, ',', end - text);
+        text = comma ? comma + 1 : end;
+    }
+}
+
+// The stream counter and capture layout columns after a text record's
+// closing bracket, commas around them dropped; returns how many there are
+static int record_text_tail(const char *text, const char *end, const char **tail_start, const char **tail_end)
+{
+    // Everything after the last bracket, the whole line if there is none
+    const char *tail = end;
+    while (tail > text && tail[-1] != ']')
+    {
+        tail--;
+    }
+    while (tail < end && *tail == ',')
+    {
+        tail++;
+    }
+    const char *last = end;
+    while (last > tail && last[-1] == ',')
+    {
+        last--;
+    }
+
+    int columns = 1;
+    for (const char *scan = tail; scan < last; scan++)
+    {
+        columns += *scan == ',';
+    }
+    *tail_start = tail;
+    *tail_end = last;
+    return columns;
+}
+
+// The 9 trailing columns of a row; blank for firmware without them. The
+// stream columns are numbers if the collector could track them.
+static char *record_put_text_trailing(char *out, const char *text, const char *end, uint32_t *stream_values,
+                                      bool *has_stream)
+{
+    const char *tail, *tail_end;
+    int columns = record_text_tail(text, end, &tail, &tail_end);
+    *has_stream = false;
+    if (columns != CSV_FRAME_STREAM_COLUMNS && columns != CSV_FRAME_TRAILING)
+    {
+        return output_put_string(out, ",,,,,,,,,");
+    }
+
+    csv_span_t stream[CSV_FRAME_STREAM_COLUMNS];
+    csv_split(tail, tail_end, stream, CSV_FRAME_STREAM_COLUMNS);
+    *has_stream = true;
+    for (int column = 0; column < CSV_FRAME_STREAM_COLUMNS; column++)
+    {
+        int64_t value;
+        *has_stream = *has_stream && csv_parse_int(stream[column], &value);
+        stream_values[column] = *has_stream ? (uint32_t)value : 0;
+    }
+
+    *out++ = ',';
+    out = output_put_bytes(out, tail, tail_end - tail);
+    if (columns == CSV_FRAME_STREAM_COLUMNS)
+    {
+        out = output_put_string(out, ",,,,");
+    }
+    return out;
+}
+
+// CSI_FEATURES,<role>,<mac>,<rssi_mean>,<timestamp>,<frames>,<window>,<energy>,<motion>,[<mean>:<stddev> ...],<stream>
+static void record_decoder_feature_text(record_decoder_t *decoder, const char *text, const char *end,
+                                        int64_t arrival_ns)
+{
+    const char *bracket = memchr(text, '[', end - text);
+    const char *head_end = bracket ? bracket : end;
+    while (head_end > text && head_end[-1] == ',')
+    {
+        head_end--;
+    }
+
+    // The first 9 fields of the head
+    const char *field_end = text;
+    int fields = 0;
+    while (fields < 9 && field_end <= head_end)
+    {
+        const char *comma = memchr(field_end, ',', head_end - field_end);
+        fields++;
+        field_end = comma ? comma + 1 : head_end + 1;
+    }
+    if (fields < 9)
+    {
+        decoder->malformed++;
+        return;
+    }
+
+    char *out = output_writer_reserve(decoder->features, (size_t)(end - text) + 256);
+    if (!out)
+    {
+        decoder->malformed++;
+        return;
+    }
+    out = output_put_bytes(out, text, field_end - 1 - text);
+    *out++ = ',';
+
+    if (bracket)
+    {
+        const char *stats = bracket + 1;
+        const char *stats_end = memchr(stats, ']', end - stats);
+        stats_end = stats_end ? stats_end : end;
+        record_trim(&stats, &stats_end);
+        out = output_put_bytes(out, stats, stats_end - stats);
+    }
+
+    uint32_t stream_values[5];
+    bool has_stream;
+    out = record_put_text_trailing(out, text, end, stream_values, &has_stream);
+    *out++ = ',';
+    output_writer_commit(decoder->features, record_decoder_end_row(decoder, out, arrival_ns));
+    decoder->feature_rows++;
+}
+
+// A decoded frame to the frames CSV or the capture file
+static void record_decoder_frame(record_decoder_t *decoder, csv_frame_t *frame, int64_t arrival_ns)
+{
+    frame->record.arrival_us = arrival_ns / 1000;
+    if (decoder->capture)
+    {
+        if (capture_writer_append(decoder->capture, frame) != ESP_OK)
+        {
+            decoder->malformed++;
+            return;
+        }
+    }
+    else
+    {
+        char *out = output_writer_reserve(decoder->frames, CSV_FRAME_MAX_ROW(frame->key.value_count));
+        if (!out)
+        {
+            decoder->malformed++;
+            return;
+        }
+        out = csv_put_frame_row(out, frame, true);
+        output_writer_commit(decoder->frames, record_decoder_end_row(decoder, out, arrival_ns));
+    }
+    decoder->frame_rows++;
+
+    if (frame->key.flags & CAPTURE_KEY_FLAG_STREAM_COLUMNS)
+    {
+        const csi_wire_stream_t *stream = &frame->record.stream;
+        uint16_t counters[STREAM_MONITOR_COUNTERS] = {stream->alloc_drops, stream->queue_drops, stream->decimated,
+                                                      stream->ring_drops};
+        stream_monitor_update(&decoder->monitor, frame->record.mac, stream->frame_sequence, counters,
+                              frame->record.rx_ctrl.local_timestamp, arrival_ns / 1e9);
+    }
+}
+
+// A text record parsed into a frame for the capture file
+static void record_decoder_text_frame(record_decoder_t *decoder, const char *text, const char *end,
+                                      const char *const *field_starts, int fields, int64_t arrival_ns)
+{
+    csv_row_t row;
+    memset(&row, 0, sizeof(row));
+    for (int field = 0; field < CSV_FRAME_FIELDS; field++)
+    {
+        const char *field_end = field + 1 < fields ? field_starts[field + 1] - 1 : end;
+        row.fields[field].text = field_starts[field];
+        row.fields[field].length = (size_t)(field_end - field_starts[field]);
+    }
+
+    const char *open = memchr(text, '[', end - text);
+    const char *close = memchr(text, ']', end - text);
+    if (open && close && close > open)
+    {
+        const char *values = open + 1;
+        const char *values_end = close;
+        record_trim(&values, &values_end);
+        row.values.text = values;
+        row.values.length = (size_t)(values_end - values);
+    }
+
+    const char *tail, *tail_end;
+    int columns = record_text_tail(text, end, &tail, &tail_end);
+    if (columns == CSV_FRAME_STREAM_COLUMNS || columns == CSV_FRAME_TRAILING)
+    {
+        row.trailing_count = csv_split(tail, tail_end, row.trailing, CSV_FRAME_TRAILING);
+    }
+
+    float values[CSV_FRAME_MAX_VALUES];
+    csv_frame_t frame;
+    if (!csv_row_to_frame(&row, &frame, values))
+    {
+        decoder->malformed++;
+        return;
+    }
+    record_decoder_frame(decoder, &frame, arrival_ns);
+}
+
+// CSI_DATA,<role>,<mac>,<rx_ctrl fields>,<real_time_set>,<timestamp>,<len>,[<values>],<stream>,<layout>
+static void record_decoder_text(record_decoder_t *decoder, const char *text, const char *end, int64_t arrival_ns)
+{
+    record_trim(&text, &end);
+    if (end - text >= 13 && memcmp(text, "CSI_FEATURES,", 13) == 0)
+    {
+        record_decoder_feature_text(decoder, text, end, arrival_ns);
+        return;
+    }
+
+    // Field boundaries of the first 25 fields, then whether there are more
+    const char *field_starts[CSV_FRAME_FIELDS + 1];
+    int fields = 0;
+    const char *field = text;
+    while (fields < CSV_FRAME_FIELDS + 1)
+    {
+        field_starts[fields++] = field;
+        const char *comma = memchr(field, ',', end - field);
+        if (!comma)
+        {
+            break;
+        }
+        field = comma + 1;
+    }
+    if (fields < CSV_FRAME_FIELDS)
+    {
+        // The Python collector warns below 20 fields and writes nothing below 25
+        decoder->malformed++;
+        return;
+    }
+    if (decoder->capture)
+    {
+        record_decoder_text_frame(decoder, text, end, field_starts, fields, arrival_ns);
+        return;
+    }
+
+    char *out = output_writer_reserve(decoder->frames, (size_t)(end - text) + 256);
+    if (!out)
+    {
+        decoder->malformed++;
+        return;
+    }
+    const char *fields_end = fields == CSV_FRAME_FIELDS + 1 ? field_starts[CSV_FRAME_FIELDS] : end + 1;
+    out = output_put_bytes(out, text, fields_end - 1 - text);
+    *out++ = ',';
+
+    const char *open = memchr(text, '[', end - text);
+    const char *close = memchr(text, ']', end - text);
+    if (open && close && close > open)
+    {
+        const char *values = open + 1;
+        const char *values_end = close;
+        record_trim(&values, &values_end);
+        out = output_put_bytes(out, values, values_end - values);
+    }
+
+    uint32_t stream_values[5];
+    bool has_stream;
+    out = record_put_text_trailing(out, text, end, stream_values, &has_stream);
+    *out++ = ',';
+    output_writer_commit(decoder->frames, record_decoder_end_row(decoder, out, arrival_ns));
+    decoder->frame_rows++;
+
+    csv_span_t mac_span = {field_starts[2], (size_t)(field_starts[3] - 1 - field_starts[2])};
+    csv_span_t local_timestamp = {field_starts[18], (size_t)(field_starts[19] - 1 - field_starts[18])};
+    uint8_t mac[6];
+    int64_t device_time;
+    if (has_stream && csv_parse_mac(mac_span, mac) && csv_parse_int(local_timestamp, &device_time))
+    {
+        uint16_t counters[STREAM_MONITOR_COUNTERS];
+        for (int counter = 0; counter < STREAM_MONITOR_COUNTERS; counter++)
+        {
+            counters[counter] = (uint16_t)stream_values[counter + 1];
+        }
+        stream_monitor_update(&decoder->monitor, mac, stream_values[0], counters, (uint32_t)device_time,
+                              arrival_ns / 1e9);
+    }
+}
+
+static record_reference_t *record_decoder_reference(record_decoder_t *decoder, const uint8_t mac[6])
+{
+    uint32_t hash = 2166136261u;
+    for (int index = 0; index < 6; index++)
+    {
+        hash = (hash ^ mac[index]) * 16777619u;
+    }
+
+    for (uint32_t probe = 0; probe < RECORD_DECODER_MAX_REFERENCES; probe++)
+    {
+        record_reference_t *reference = &decoder->references[(hash + probe) & (RECORD_DECODER_MAX_REFERENCES - 1)];
+        if (!reference->used || memcmp(reference->mac, mac, 6) == 0)
+        {
+            return reference;
+        }
+    }
+    return NULL;
+}
+
+// Undo the delta + zigzag varint coding of csi_compression.h into values.
+// False if the record is malformed or (counted) a delta without reference.
+static bool record_decoder_decompress(record_decoder_t *decoder, const csi_wire_record_header_t *header,
+                                      const uint8_t *payload, const uint8_t *payload_end, int32_t *values)
+{
+    uint16_t count = header->value_count;
+    int bits = header->payload_type == CSI_WIRE_PAYLOAD_RAW_IQ ? 8 : 16;
+    bool is_signed = header->payload_type != CSI_WIRE_PAYLOAD_AMPLITUDE_Q8;
+    uint32_t value_mask = (1u << bits) - 1;
+
+    for (uint16_t index = 0; index < count; index++)
+    {
+        uint32_t result = 0;
+        int shift = 0;
+        while (true)
+        {
+            if (payload >= payload_end || shift > 28)
+            {
+                decoder->malformed++;
+                return false;
+            }
+            uint8_t byte = *payload++;
+            result |= (uint32_t)(byte & 0x7F) << shift;
+            if (byte < 0x80)
+            {
+                break;
+            }
+            shift += 7;
+        }
+        values[index] = (int32_t)(result >> 1) ^ -(int32_t)(result & 1);
+    }
+
+    record_reference_t *reference = record_decoder_reference(decoder, header->mac);
+    if (header->flags & CSI_WIRE_FLAG_DELTA)
+    {
+        if (!reference || !reference->used || reference->sequence != (uint8_t)(header->delta_sequence - 1) ||
+            reference->payload_type != header->payload_type || reference->value_count != count)
+        {
+            if (reference)
+            {
+                // Wait for the next keyframe
+                reference->payload_type = 0;
+            }
+            decoder->discarded++;
+            return false;
+        }
+    }
+
+    int32_t previous = 0;
+    for (uint16_t index = 0; index < count; index++)
+    {
+        int32_t prediction = (header->flags & CSI_WIRE_FLAG_DELTA) ? reference->values[index] : previous;
+        uint32_t value = (uint32_t)(prediction + values[index]) & value_mask;
+        values[index] = is_signed && value >= (1u << (bits - 1)) ? (int32_t)value - (int32_t)(1u << bits)
+                                                                   : (int32_t)value;
+        previous = values[index];
+    }
+
+    if (reference)
+    {
+        if (!reference->values)
+        {
+            reference->values = malloc(RECORD_DECODER_MAX_VALUES * sizeof(int32_t));
+        }
+        if (reference->values)
+        {
+            reference->used = true;
+            memcpy(reference->mac, header->mac, 6);
+            reference->sequence = header->delta_sequence;
+            reference->payload_type = header->payload_type;
+            reference->value_count = count;
+            memcpy(reference->values, values, count * sizeof(int32_t));
+        }
+    }
+    return true;
+}
+
+static inline uint16_t record_read_u16(const uint8_t *data)
+{
+    return (uint16_t)(data[0] | data[1] << 8);
+}
+
+// The values of a binary frame record, stored the way the AP sent them
+static void record_decoder_binary_frame(record_decoder_t *decoder, const csi_wire_record_header_t *header,
+                                        const int32_t *values, int64_t arrival_ns)
+{
+    union
+    {
+        int8_t iq[RECORD_DECODER_MAX_VALUES];
+        uint16_t amplitudes[RECORD_DECODER_MAX_VALUES];
+        int16_t phases[RECORD_DECODER_MAX_VALUES];
+    } storage;
+    csv_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+
+    capture_chunk_key_t *key = &frame.key;
+    memcpy(key->type, "CSI_Data", sizeof("CSI_Data"));
+    memcpy(key->role, "AP", sizeof("AP"));
+    key->payload_type = header->payload_type;
+    key->flags = (header->version >= 3 ? CAPTURE_KEY_FLAG_STREAM_COLUMNS : 0) |
+                 (header->version >= 4 ? CAPTURE_KEY_FLAG_LAYOUT_COLUMNS : 0);
+    key->value_count = header->value_count;
+    if (header->version >= 4)
+    {
+        key->layout = header->layout;
+    }
+
+    for (uint16_t index = 0; index < header->value_count; index++)
+    {
+        if (header->payload_type == CSI_WIRE_PAYLOAD_RAW_IQ)
+        {
+            storage.iq[index] = (int8_t)values[index];
+        }
+        else if (header->payload_type == CSI_WIRE_PAYLOAD_AMPLITUDE_Q8)
+        {
+            storage.amplitudes[index] = (uint16_t)values[index];
+        }
+        else
+        {
+            storage.phases[index] = (int16_t)values[index];
+        }
+    }
+    key->value_type = header->payload_type == CSI_WIRE_PAYLOAD_RAW_IQ            ? CAPTURE_VALUE_INT8
+                      : header->payload_type == CSI_WIRE_PAYLOAD_AMPLITUDE_Q8     ? CAPTURE_VALUE_UINT16_Q8
+                      : header->payload_type == CSI_WIRE_PAYLOAD_PHASE_SANITIZED ? CAPTURE_VALUE_INT16_PHASE_SANITIZED
+                                                                                  : CAPTURE_VALUE_INT16_Q15;
+    key->record_size = capture_record_size(key->value_type, key->value_count);
+
+    capture_record_t *record = &frame.record;
+    record->timestamp_us = header->timestamp_us;
+    memcpy(record->mac, header->mac, 6);
+    record->flags = (header->flags & CSI_WIRE_FLAG_TIME_SYNCED) ? CAPTURE_RECORD_FLAG_TIME_SYNCED : 0;
+    record->rx_ctrl = header->rx_ctrl;
+    record->csi_length = header->csi_length;
+    if (header->version >= 3)
+    {
+        record->stream = header->stream;
+    }
+    frame.values = &storage;
+    record_decoder_frame(decoder, &frame, arrival_ns);
+}
+
+static void record_decoder_binary(record_decoder_t *decoder, const uint8_t *data, size_t length, int64_t arrival_ns)
+{
+    csi_wire_record_header_t header;
+    memset(&header, 0, sizeof(header));
+    if (length < RECORD_DECODER_BASE_HEADER_SIZE)
+    {
+        decoder->malformed++;
+        return;
+    }
+    memcpy(&header, data, RECORD_DECODER_BASE_HEADER_SIZE);
+
+    if (header.version < 1 || header.version > CSI_WIRE_VERSION)
+    {
+        decoder->unsupported++;
+        return;
+    }
+    if (header.record_length > length || header.record_length < RECORD_DECODER_BASE_HEADER_SIZE)
+    {
+        decoder->malformed++;
+        return;
+    }
+
+    const uint8_t *end = data + header.record_length;
+    const uint8_t *payload = data + RECORD_DECODER_BASE_HEADER_SIZE;
+    bool has_stream = header.version >= 3;
+    if (has_stream)
+    {
+        if (end - payload < (ptrdiff_t)sizeof(csi_wire_stream_t))
+        {
+            decoder->malformed++;
+            return;
+        }
+        memcpy(&header.stream, payload, sizeof(csi_wire_stream_t));
+        payload += sizeof(csi_wire_stream_t);
+    }
+    if (header.version >= 4)
+    {
+        if (end - payload < (ptrdiff_t)sizeof(csi_wire_layout_t))
+        {
+            decoder->malformed++;
+            return;
+        }
+        memcpy(&header.layout, payload, sizeof(csi_wire_layout_t));
+        payload += sizeof(csi_wire_layout_t);
+    }
+
+    bool features = header.payload_type == CSI_WIRE_PAYLOAD_FEATURES;
+    if (!features && header.payload_type != CSI_WIRE_PAYLOAD_RAW_IQ &&
+        header.payload_type != CSI_WIRE_PAYLOAD_AMPLITUDE_Q8 && header.payload_type != CSI_WIRE_PAYLOAD_PHASE_Q15 &&
+        header.payload_type != CSI_WIRE_PAYLOAD_PHASE_SANITIZED)
+    {
+        decoder->unsupported++;
+        return;
+    }
+    if (header.value_count > RECORD_DECODER_MAX_VALUES)
+    {
+        decoder->malformed++;
+        return;
+    }
+
+    int32_t values[RECORD_DECODER_MAX_VALUES];
+    uint16_t count = header.value_count;
+    if (features)
+    {
+        if (end - payload < (ptrdiff_t)(sizeof(csi_wire_features_t) + count * sizeof(csi_wire_subcarrier_stats_t)))
+        {
+            decoder->malformed++;
+            return;
+        }
+    }
+    else if (header.flags & CSI_WIRE_FLAG_COMPRESSED)
+    {
+        if (!record_decoder_decompress(decoder, &header, payload, end, values))
+        {
+            return;
+        }
+    }
+    else
+    {
+        size_t value_size = header.payload_type == CSI_WIRE_PAYLOAD_RAW_IQ ? 1 : 2;
+        if (end - payload < (ptrdiff_t)(count * value_size))
+        {
+            decoder->malformed++;
+            return;
+        }
+        for (uint16_t index = 0; index < count; index++)
+        {
+            if (value_size == 1)
+            {
+                values[index] = (int8_t)payload[index];
+            }
+            else
+            {
+                uint16_t value = record_read_u16(payload + index * 2);
+                values[index] = header.payload_type == CSI_WIRE_PAYLOAD_AMPLITUDE_Q8 ? value : (int16_t)value;
+            }
+        }
+    }
+
+    if (!features)
+    {
+        record_decoder_binary_frame(decoder, &header, values, arrival_ns);
+        return;
+    }
+
+    char *out = output_writer_reserve(decoder->features, CSV_FRAME_MAX_ROW(count));
+    if (!out)
+    {
+        decoder->malformed++;
+        return;
+    }
+
+    csi_wire_features_t summary;
+    memcpy(&summary, payload, sizeof(summary));
+    const uint8_t *stats = payload + sizeof(summary);
+
+    out = output_put_string(out, "CSI_FEATURES,AP,");
+    out = csv_put_mac(out, header.mac);
+    *out++ = ',';
+    out = csv_put_column(out, summary.rssi_mean);
+    out = csv_put_wall_time(out, header.timestamp_us);
+    *out++ = ',';
+    out = csv_put_column(out, summary.frame_count);
+    out = csv_put_column(out, summary.window_frames);
+    out = output_put_fixed(out, summary.energy, 2);
+    *out++ = ',';
+    out = output_put_fixed(out, summary.motion_score, 5);
+    *out++ = ',';
+    for (uint16_t index = 0; index < count; index++)
+    {
+        if (index)
+        {
+            *out++ = ' ';
+        }
+        out = output_put_fixed(out, record_read_u16(stats + index * 4) / 256.0, 2);
+        *out++ = ':';
+        out = output_put_fixed(out, record_read_u16(stats + index * 4 + 2) / 256.0, 2);
+    }
+    *out++ = ',';
+
+    if (has_stream)
+    {
+        out = csv_put_column(out, header.stream.frame_sequence);
+        out = csv_put_column(out, header.stream.alloc_drops);
+        out = csv_put_column(out, header.stream.queue_drops);
+        out = csv_put_column(out, header.stream.decimated);
+        out = csv_put_column(out, header.stream.ring_drops);
+    }
+    else
+    {
+        out = output_put_string(out, ",,,,,");
+    }
+    if (header.version >= 4)
+    {
+        if (header.layout.capture_profile < CSV_FRAME_PROFILE_COUNT)
+        {
+            out = output_put_string(out, g_capture_profile_names[header.layout.capture_profile]);
+        }
+        else
+        {
+            out = output_put_uint(out, header.layout.capture_profile);
+        }
+        *out++ = ',';
+        out = csv_put_column(out, header.layout.lltf_pairs);
+        out = csv_put_column(out, header.layout.htltf_pairs);
+        out = csv_put_column(out, header.layout.stbc_htltf_pairs);
+    }
+    else
+    {
+        out = output_put_string(out, ",,,,");
+    }
+    output_writer_commit(decoder->features, record_decoder_end_row(decoder, out, arrival_ns));
+    decoder->feature_rows++;
+}
+
+static inline bool record_is_binary(const uint8_t *data, size_t length)
+{
+    return length >= 2 && record_read_u16(data) == CSI_WIRE_MAGIC;
+}
+
+// Every record of one datagram, arrival_ns on the realtime clock
+void record_decoder_datagram(record_decoder_t *decoder, const uint8_t *data, size_t length, uint32_t source_ip,
+                             int64_t arrival_ns)
+{
+    size_t offset = 0;
+    while (offset < length)
+    {
+        const uint8_t *record = data + offset;
+        size_t remaining = length - offset;
+
+        if (record_is_binary(record, remaining))
+        {
+            uint16_t record_length = remaining >= 6 ? record_read_u16(record + 4) : 0;
+            if (remaining < RECORD_DECODER_BASE_HEADER_SIZE || record_length < RECORD_DECODER_BASE_HEADER_SIZE)
+            {
+                // The rest of the datagram, which cannot be a whole record
+                record_decoder_binary(decoder, record, remaining, arrival_ns);
+                return;
+            }
+            record_decoder_binary(decoder, record, record_length < remaining ? record_length : remaining,
+                                  arrival_ns);
+            offset += record_length;
+            continue;
+        }
+
+        const uint8_t *newline = memchr(record, '\n', remaining);
+        size_t line_length = newline ? (size_t)(newline - record) + 1 : remaining;
+        const char *text = (const char *)record;
+        const char *text_end = text + line_length;
+        offset += line_length;
+
+        record_trim(&text, &text_end);
+        if (text == text_end)
+        {
+            continue;
+        }
+        if ((size_t)(text_end - text) > strlen(TELEMETRY_PREFIX) &&
+            memcmp(text, TELEMETRY_PREFIX, strlen(TELEMETRY_PREFIX)) == 0)
+        {
+            record_decoder_telemetry(decoder, text, text_end, source_ip);
+            continue;
+        }
+        record_decoder_text(decoder, text, text_end, arrival_ns);
+    }
+}
+
+#endif // RECORD_DECODER_H
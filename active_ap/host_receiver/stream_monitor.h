@@ -0,0 +1,207 @@
+#ifndef STREAM_MONITOR_H
+#define STREAM_MONITOR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+// Loss, reorder and jitter of each station's frame sequence, the same
+// accounting as StreamMonitor in csi_data_collector.py (see
+// _components/csi_streams.h for the counters). One monitor per writer
+// thread; stations are kept in a small open-addressing table by MAC.
+
+#define STREAM_MONITOR_MAX_STATIONS 256 // Power of two
+#define STREAM_MONITOR_REORDER_RESET_WINDOW 4096 // A sequence this far behind means the AP restarted
+#define STREAM_MONITOR_COUNTERS 4
+
+typedef struct
+{
+    bool used;
+    uint8_t mac[6];
+    uint32_t first_sequence;
+    uint32_t max_sequence;
+    uint16_t counters[STREAM_MONITOR_COUNTERS];
+    uint64_t received;
+    uint64_t missing;      // Sequence numbers not (yet) seen
+    uint64_t device_drops; // Of those, dropped on the AP by one of its stages
+    uint64_t reordered;
+    uint64_t duplicates;
+    double jitter_s;
+    double transit_s;
+} stream_station_t;
+
+typedef struct
+{
+    stream_station_t stations[STREAM_MONITOR_MAX_STATIONS];
+    uint32_t station_count;
+    uint32_t untracked; // Records of stations beyond the table
+} stream_monitor_t;
+
+static stream_station_t *stream_monitor_find(stream_monitor_t *monitor, const uint8_t mac[6])
+{
+    uint32_t hash = 2166136261u;
+    for (int index = 0; index < 6; index++)
+    {
+        hash = (hash ^ mac[index]) * 16777619u;
+    }
+
+    for (uint32_t probe = 0; probe < STREAM_MONITOR_MAX_STATIONS; probe++)
+    {
+        stream_station_t *station = &monitor->stations[(hash + probe) & (STREAM_MONITOR_MAX_STATIONS - 1)];
+        if (!station->used || memcmp(station->mac, mac, 6) == 0)
+        {
+            return station;
+        }
+    }
+    return NULL;
+}
+
+static void stream_station_reset(stream_station_t *station, const uint8_t mac[6], uint32_t sequence,
+                                 const uint16_t *counters, uint32_t device_time_us, double arrival_s)
+{
+    memset(station, 0, sizeof(*station));
+    station->used = true;
+    memcpy(station->mac, mac, 6);
+    station->first_sequence = sequence;
+    station->max_sequence = sequence;
+    memcpy(station->counters, counters, sizeof(station->counters));
+    station->received = 1;
+    station->transit_s = arrival_s - device_time_us / 1e6;
+}
+
+// One frame record: its sequence number, the alloc/queue/decimated/ring drop
+// counters and the radio timestamp
+void stream_monitor_update(stream_monitor_t *monitor, const uint8_t mac[6], uint32_t sequence,
+                           const uint16_t *counters, uint32_t device_time_us, double arrival_s)
+{
+    if (sequence == 0)
+    {
+        return; // Untracked station or a record without stream columns
+    }
+
+    stream_station_t *station = stream_monitor_find(monitor, mac);
+    if (!station)
+    {
+        monitor->untracked++;
+        return;
+    }
+    if (!station->used)
+    {
+        monitor->station_count++;
+        stream_station_reset(station, mac, sequence, counters, device_time_us, arrival_s);
+        return;
+    }
+    if ((uint64_t)sequence + STREAM_MONITOR_REORDER_RESET_WINDOW < station->max_sequence)
+    {
+        stream_station_reset(station, mac, sequence, counters, device_time_us, arrival_s);
+        return;
+    }
+
+    station->received++;
+    if (sequence == station->max_sequence)
+    {
+        station->duplicates++;
+        return;
+    }
+    if (sequence < station->max_sequence)
+    {
+        station->reordered++;
+        if (station->missing)
+        {
+            station->missing--;
+        }
+        return;
+    }
+
+    station->missing += sequence - station->max_sequence - 1;
+    station->max_sequence = sequence;
+    // Counters wrap at 16 bits on the wire
+    for (int counter = 0; counter < STREAM_MONITOR_COUNTERS; counter++)
+    {
+        station->device_drops += (uint16_t)(counters[counter] - station->counters[counter]);
+        station->counters[counter] = counters[counter];
+    }
+
+    // RFC 3550 interarrival jitter; the radio timestamp wraps every 2^32 us
+    double transit_s = arrival_s - device_time_us / 1e6;
+    double difference = transit_s - station->transit_s;
+    difference -= nearbyint(difference / 4294.967296) * 4294.967296;
+    station->transit_s = transit_s;
+    station->jitter_s += (fabs(difference) - station->jitter_s) / 16;
+}
+
+static inline uint64_t stream_station_expected(const stream_station_t *station)
+{
+    return (uint64_t)station->max_sequence - station->first_sequence + 1;
+}
+
+static inline uint64_t stream_station_network_loss(const stream_station_t *station)
+{
+    // Device counters are stamped when a record is encoded, so they can run a little ahead
+    return station->missing > station->device_drops ? station->missing - station->device_drops : 0;
+}
+
+// Status segment for the stations losing the most, at most limit of them
+int stream_monitor_status(const stream_monitor_t *monitor, char *output, size_t capacity, int limit)
+{
+    const stream_station_t *shown[8];
+    int shown_count = 0;
+    if (limit > 8)
+    {
+        limit = 8;
+    }
+
+    for (int index = 0; index < STREAM_MONITOR_MAX_STATIONS; index++)
+    {
+        const stream_station_t *station = &monitor->stations[index];
+        if (!station->used)
+        {
+            continue;
+        }
+
+        // Insertion into the short list, most missing first
+        int position;
+        if (shown_count < limit)
+        {
+            position = shown_count++;
+        }
+        else if (limit > 0 && station->missing > shown[limit - 1]->missing)
+        {
+            position = limit - 1;
+        }
+        else
+        {
+            continue;
+        }
+        while (position > 0 && shown[position - 1]->missing < station->missing)
+        {
+            shown[position] = shown[position - 1];
+            position--;
+        }
+        shown[position] = station;
+    }
+
+    int offset = 0;
+    for (int index = 0; index < shown_count && offset < (int)capacity; index++)
+    {
+        const stream_station_t *station = shown[index];
+        offset += snprintf(output + offset, capacity - offset,
+                           "%s%02X:%02X:%02X loss %.1f%% (AP %llu net %llu) reorder %llu jitter %.1fms",
+                           index ? " | " : "", station->mac[3], station->mac[4], station->mac[5],
+                           100.0 * station->missing / stream_station_expected(station),
+                           (unsigned long long)station->device_drops,
+                           (unsigned long long)stream_station_network_loss(station),
+                           (unsigned long long)station->reordered, station->jitter_s * 1000);
+    }
+    if ((int)monitor->station_count > shown_count && offset < (int)capacity)
+    {
+        offset += snprintf(output + offset, capacity - offset, " | +%d stations",
+                           (int)monitor->station_count - shown_count);
+    }
+    return offset < (int)capacity ? offset : (int)capacity - 1;
+}
+
+#endif // STREAM_MONITOR_H
@@ -13,48 +13,110 @@
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "mdns.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
 
 // Include our redesigned components
-#include "../../_components/storage_manager.h"
-#include "../../_components/csi_handler.h"
-#include "../../_components/timestamp_manager.h"
-#include "../../_components/command_processor.h"
+#include "storage_manager.h"
+#include "csi_handler.h"
+#include "timestamp_manager.h"
+#include "command_processor.h"
+#include "frame_batcher.h"
+#include "pipeline_stats.h"
+#include "csi_sink.h"
+#include "csi_pipeline.h"
+#include "udp_subscribers.h"
+#include "runtime_settings.h"
+#include "csi_commands.h"
+#include "control_channel.h"
+#include "csi_replay.h"
+#include "time_sync.h"
+#include "csi_burst.h"
+#if CONFIG_SEND_CSI_TO_SD
+#include "sd_capture.h"
+#endif
+#if CONFIG_CSI_BENCHMARK_AT_BOOT
+#include "csi_bench.h"
+#endif
 
 // Network and device configuration constants
 #define WIFI_ACCESS_POINT_SSID      "ESP32-AP"
 #define WIFI_ACCESS_POINT_PASSWORD  "esp32-ap"
 #define WIFI_CHANNEL_NUMBER         6
 #define MAX_STATION_CONNECTIONS     10
-#define CSI_DATA_QUEUE_SIZE         64
 #define HOST_COMMUNICATION_PORT     9999
+#define CONTROL_CHANNEL_PORT        (HOST_COMMUNICATION_PORT + 1)
 #define DEVICE_HOSTNAME_PREFIX      "ESP32_CSI_Collector"
 
 // Application configuration
-#define CSI_PROCESSING_TASK_PRIORITY    5
-#define CSI_PROCESSING_STACK_SIZE       8192
 #define UDP_PAYLOAD_BUFFER_SIZE         4096
 #define MDNS_SERVICE_NAME              "csi-collector"
 #define MDNS_PROTOCOL                  "_udp"
+#define BROADCAST_ADDRESS              "192.168.4.255"
+
+#ifdef CONFIG_CSI_WIRE_FORMAT_BINARY
+#define CSI_UDP_SINK_FORMAT             CSI_WIRE_FORMAT_BINARY
+#else
+#define CSI_UDP_SINK_FORMAT             CSI_WIRE_FORMAT_TEXT
+#endif
+
+#ifdef CONFIG_CSI_SERIAL_SINK_BINARY
+#define CSI_SERIAL_SINK_FORMAT          CSI_WIRE_FORMAT_BINARY
+#else
+#define CSI_SERIAL_SINK_FORMAT          CSI_WIRE_FORMAT_TEXT
+#endif
+
+#ifdef CONFIG_SEND_CSI_TO_SERIAL
+#define CSI_SERIAL_SINK_ENABLED         true
+#else
+#define CSI_SERIAL_SINK_ENABLED         false
+#endif
+
+#if CONFIG_CSI_SUBCARRIER_MASK_HT20
+#define CSI_DEFAULT_SUBCARRIER_MASK     CSI_SUBCARRIER_MASK_HT20
+#elif CONFIG_CSI_SUBCARRIER_MASK_HT40
+#define CSI_DEFAULT_SUBCARRIER_MASK     CSI_SUBCARRIER_MASK_HT40
+#else
+#define CSI_DEFAULT_SUBCARRIER_MASK     CSI_SUBCARRIER_MASK_ALL
+#endif
+
+#ifdef CONFIG_CSI_COMPRESSION
+#define CSI_COMPRESSION_DEFAULT         true
+#else
+#define CSI_COMPRESSION_DEFAULT         false
+#endif
+
+#ifdef CONFIG_CSI_PHASE_SANITIZE
+#define CSI_PHASE_SANITIZE_DEFAULT      true
+#else
+#define CSI_PHASE_SANITIZE_DEFAULT      false
+#endif
 
 static const char *APPLICATION_TAG = "CSI_Collector_AP";
 
 // Structure to manage application state
 typedef struct {
-    xQueueHandle csi_data_queue;
     char* target_host_address;
-    int udp_socket_descriptor;
     bool network_ready;
-    uint32_t processed_packets;
-    char discovered_host_ip[16];
-    bool host_discovered;
 } application_state_t;
 
 static application_state_t app_state = {0};
 
-// Known research device MAC addresses for filtering
+// Stations that have an address from the AP's DHCP server, owned by the event handler
+typedef struct {
+    bool in_use;
+    uint8_t mac[6];
+    uint32_t address;
+} connected_station_t;
+
+static connected_station_t connected_stations[MAX_STATION_CONNECTIONS];
+
+// UDP sink state, owned by the UDP sink task
+static int64_t udp_next_telemetry_us;
+
+// Default research device MAC addresses, used until the allowlist is edited with CSI_ALLOW
 static const char authorized_devices[][20] = {
     "a0:b7:65:5a:08:a5",  // Research ESP32 Device A
     "24:0a:c4:c9:25:d8",  // Research ESP32 Device B  
@@ -62,77 +124,100 @@ static const char authorized_devices[][20] = {
 static const uint8_t NUM_AUTHORIZED_DEVICES = sizeof(authorized_devices) / sizeof(authorized_devices[0]);
 
 // Task function declarations
-static void csi_data_processing_task(void *parameters);
 static void network_event_handler(void* arg, esp_event_base_t event_base, 
                                  int32_t event_id, void* event_data);
-static void mdns_discovery_task(void *parameters);
+static void mdns_advertise_task(void *parameters);
 static esp_err_t setup_mdns_service(void);
-static esp_err_t discover_host_computer(void);
-
-// Enhanced MAC address validation function
-bool is_authorized_research_device(uint8_t device_mac[6]) {
-    char mac_address_string[20];
-    snprintf(mac_address_string, sizeof(mac_address_string), 
-             "%02x:%02x:%02x:%02x:%02x:%02x", 
-             device_mac[0], device_mac[1], device_mac[2], 
-             device_mac[3], device_mac[4], device_mac[5]);
-    
-    // Check against authorized device list
-    for (int device_index = 0; device_index < NUM_AUTHORIZED_DEVICES; device_index++) {
-        if (strcmp(mac_address_string, authorized_devices[device_index]) == 0) {
-            ESP_LOGI(APPLICATION_TAG, "Authorized device detected: %s", mac_address_string);
-            return true;
+
+// MAC address validation against the allowlist, or a load test station (hot path, no logging)
+bool is_authorized_research_device(const uint8_t device_mac[6]) {
+    return mac_allowlist_contains(device_mac) || csi_replay_station(device_mac);
+}
+
+// Load the persisted allowlist, seeding it with the built-in research devices on first boot
+static void load_authorized_devices(void) {
+    esp_err_t result = mac_allowlist_load();
+    
+    if (result != ESP_OK) {
+        for (int device_index = 0; device_index < NUM_AUTHORIZED_DEVICES; device_index++) {
+            uint8_t device_mac[6];
+            if (parse_mac_address(authorized_devices[device_index], device_mac)) {
+                mac_allowlist_add(device_mac);
+            }
+        }
+        
+        if (result == ESP_ERR_NVS_NOT_FOUND) {
+            mac_allowlist_save();
         }
     }
     
-    ESP_LOGD(APPLICATION_TAG, "Unauthorized device filtered: %s", mac_address_string);
-    return false;
+    ESP_LOGI(APPLICATION_TAG, "Authorized devices: %u", mac_allowlist_count());
 }
 
-// CSI callback that implements filtering
+// CSI callback: only copies allowlisted frames into the shared pipeline
 void research_csi_data_callback(void *context, wifi_csi_info_t *csi_info) {
-    if (!csi_info || !csi_info->buf) {
-        ESP_LOGW(APPLICATION_TAG, "Invalid CSI data received");
-        return;
+    csi_pipeline_capture(csi_info);
+}
+
+static connected_station_t *find_connected_station(const uint8_t mac[6]) {
+    for (int index = 0; index < MAX_STATION_CONNECTIONS; index++) {
+        if (connected_stations[index].in_use && memcmp(connected_stations[index].mac, mac, 6) == 0) {
+            return &connected_stations[index];
+        }
     }
-    
-    // Apply MAC address filtering for given devices only
-    if (!is_authorized_research_device(csi_info->mac)) {
-        return; 
+    return NULL;
+}
+
+// A station got an address: anything that is not a research device is taken
+// to be a host and receives the stream right away, without waiting for mDNS
+static void handle_station_address(const uint8_t mac[6], uint32_t address) {
+    connected_station_t *station = find_connected_station(mac);
+    for (int index = 0; !station && index < MAX_STATION_CONNECTIONS; index++) {
+        if (!connected_stations[index].in_use) {
+            station = &connected_stations[index];
+        }
     }
-    
-    // Create a copy of CSI data for queue processing
-    wifi_csi_info_t *csi_copy = malloc(sizeof(wifi_csi_info_t));
-    if (!csi_copy) {
-        ESP_LOGE(APPLICATION_TAG, "Failed to allocate memory for CSI data");
+    if (!station) {
         return;
     }
     
-    // Deep copy the CSI information
-    memcpy(csi_copy, csi_info, sizeof(wifi_csi_info_t));
+    station->in_use = true;
+    memcpy(station->mac, mac, 6);
+    station->address = address;
     
-    // Allocate and copy the buffer data
-    csi_copy->buf = malloc(csi_info->len);
-    if (!csi_copy->buf) {
-        free(csi_copy);
-        ESP_LOGE(APPLICATION_TAG, "Failed to allocate memory for CSI buffer");
+    // Research devices get echo requests at the stimulus rate, hosts are left alone
+    csi_stimulus_add_station(mac, address);
+    
+#if CONFIG_CSI_AUTO_SUBSCRIBE_HOSTS
+    if (!is_authorized_research_device(mac)) {
+        udp_subscription_t subscription = {.address = address, .port = HOST_COMMUNICATION_PORT};
+        udp_subscribers_add(&subscription);
+    }
+#endif
+}
+
+// A station left: stop streaming to whatever it subscribed
+static void handle_station_departure(const uint8_t mac[6]) {
+    connected_station_t *station = find_connected_station(mac);
+    if (!station) {
         return;
     }
-    memcpy(csi_copy->buf, csi_info->buf, csi_info->len);
     
-    // Queue the data for processing (non-blocking)
-    if (xQueueSend(app_state.csi_data_queue, &csi_copy, 0) != pdTRUE) {
-        // Queue is full, free the allocated memory
-        free(csi_copy->buf);
-        free(csi_copy);
-        ESP_LOGW(APPLICATION_TAG, "CSI data queue overflow - dropping packet");
-    }
+    udp_subscribers_remove(station->address, 0);
+    csi_stimulus_remove_station(mac);
+    station->in_use = false;
 }
 
 // Network event handler for WiFi and IP events
 static void network_event_handler(void* arg, esp_event_base_t event_base,
                                  int32_t event_id, void* event_data) {
-    if (event_base == WIFI_EVENT) {
+    if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        ip_event_ap_staipassigned_t* event = (ip_event_ap_staipassigned_t*) event_data;
+        ESP_LOGI(APPLICATION_TAG, "Station " IPSTR " assigned - MAC: %02x:%02x:%02x:%02x:%02x:%02x",
+                 IP2STR(&event->ip), event->mac[0], event->mac[1], event->mac[2],
+                 event->mac[3], event->mac[4], event->mac[5]);
+        handle_station_address(event->mac, event->ip.addr);
+    } else if (event_base == WIFI_EVENT) {
         switch (event_id) {
             case WIFI_EVENT_AP_START:
                 ESP_LOGI(APPLICATION_TAG, "Access Point started successfully");
@@ -157,6 +242,7 @@ static void network_event_handler(void* arg, esp_event_base_t event_base,
                 ESP_LOGI(APPLICATION_TAG, "Station disconnected - MAC: %02x:%02x:%02x:%02x:%02x:%02x",
                          event->mac[0], event->mac[1], event->mac[2],
                          event->mac[3], event->mac[4], event->mac[5]);
+                handle_station_departure(event->mac);
                 break;
             }
             
@@ -199,6 +285,8 @@ static esp_err_t configure_wifi_access_point(void) {
     // Register event handler for network events
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
                                               &network_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED,
+                                              &network_event_handler, NULL));
     
     // Configure Access Point settings
     wifi_config_t ap_config = {
@@ -206,7 +294,7 @@ static esp_err_t configure_wifi_access_point(void) {
             .ssid = WIFI_ACCESS_POINT_SSID,
             .ssid_len = strlen(WIFI_ACCESS_POINT_SSID),
             .password = WIFI_ACCESS_POINT_PASSWORD,
-            .channel = WIFI_CHANNEL_NUMBER,
+            .channel = g_runtime_settings.wifi_channel,
             .max_connection = MAX_STATION_CONNECTIONS,
             .authmode = WIFI_AUTH_WPA2_PSK,
             .beacon_interval = 100,
@@ -219,7 +307,7 @@ static esp_err_t configure_wifi_access_point(void) {
     ESP_ERROR_CHECK(esp_wifi_start());
     
     ESP_LOGI(APPLICATION_TAG, "WiFi AP configured: SSID=%s, Channel=%d", 
-             WIFI_ACCESS_POINT_SSID, WIFI_CHANNEL_NUMBER);
+             WIFI_ACCESS_POINT_SSID, g_runtime_settings.wifi_channel);
     
     return ESP_OK;
 }
@@ -267,193 +355,207 @@ static esp_err_t setup_mdns_service(void) {
     return ESP_OK;
 }
 
-// Discover host computer using mDNS
-static esp_err_t discover_host_computer(void) {
-    ESP_LOGI(APPLICATION_TAG, "Searching for host computer via mDNS...");
-    
-    // Query for research host computers
-    mdns_result_t *results = NULL;
-    esp_err_t result = mdns_query_ptr("_ssh", "_tcp", 3000, 20, &results);
-    
-    if (result != ESP_OK) {
-        ESP_LOGW(APPLICATION_TAG, "mDNS query failed, using broadcast discovery");
-        return ESP_FAIL;
-    }
-    
-    // Process mDNS results
-    mdns_result_t *current = results;
-    while (current) {
-        if (current->addr && current->hostname) {
-            ESP_LOGI(APPLICATION_TAG, "Found host: %s at %s", 
-                     current->hostname, inet_ntoa(current->addr->addr.u_addr.ip4));
-            
-            // Store the first discovered host
-            if (!app_state.host_discovered) {
-                strcpy(app_state.discovered_host_ip, inet_ntoa(current->addr->addr.u_addr.ip4));
-                app_state.host_discovered = true;
-                ESP_LOGI(APPLICATION_TAG, "Selected host: %s", app_state.discovered_host_ip);
-            }
-        }
-        current = current->next;
-    }
-    
-    // Free mDNS results
-    mdns_query_results_free(results);
-    
-    if (!app_state.host_discovered) {
-        ESP_LOGW(APPLICATION_TAG, "No host computer discovered via mDNS");
-        // Fallback to broadcast or default gateway
-        strcpy(app_state.discovered_host_ip, "192.168.4.255"); // Broadcast address
-        app_state.host_discovered = true;
-        ESP_LOGI(APPLICATION_TAG, "Using broadcast address: %s", app_state.discovered_host_ip);
-    }
-    
-    return ESP_OK;
-}
-
-// mDNS discovery task
-static void mdns_discovery_task(void *parameters) {
-    ESP_LOGI(APPLICATION_TAG, "mDNS discovery task started");
-    
+// mDNS advertisement task: publishes the collector service so hosts can find the AP
+static void mdns_advertise_task(void *parameters) {
     // Wait for network to be ready
     while (!app_state.network_ready) {
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
-    // Setup mDNS service
     if (setup_mdns_service() != ESP_OK) {
         ESP_LOGE(APPLICATION_TAG, "Failed to setup mDNS service");
-        vTaskDelete(NULL);
-        return;
+    }
+    vTaskDelete(NULL);
+}
+
+// CSI_HELLO [port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY] - sent by a host to the
+// control port to subscribe itself; repeating it only updates the filters
+static bool handle_hello_command(const char *arguments) {
+    struct sockaddr_in sender;
+    if (!control_channel_request_sender(&sender)) {
+        printf("CSI_HELLO is only accepted on the control port\n");
+        return false;
     }
     
-    // Periodic host discovery
-    while (true) {
-        if (!app_state.host_discovered) {
-            discover_host_computer();
-        }
-        
-        // Re-discover every 30 seconds if no host found
-        vTaskDelay(pdMS_TO_TICKS(30000));
+    unsigned int port = HOST_COMMUNICATION_PORT;
+    char mac_text[20] = {0};
+    char payload_text[12] = {0};
+    sscanf(arguments, "%u %19s %11s", &port, mac_text, payload_text);
+    
+    udp_subscription_t subscription = {.address = sender.sin_addr.s_addr};
+    if (port == 0 || port > 65535 || !udp_subscriber_parse_filters(mac_text, payload_text, &subscription)) {
+        printf("Usage: CSI_HELLO [port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY]\n");
+        return false;
     }
+    subscription.port = (uint16_t)port;
+    
+    esp_err_t result = udp_subscribers_add(&subscription);
+    printf("%s\n", result == ESP_OK ? "Subscribed" : esp_err_to_name(result));
+    return result == ESP_OK;
 }
 
-// Initialize UDP socket for data transmission
-static int initialize_udp_socket(void) {
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        ESP_LOGE(APPLICATION_TAG, "Failed to create UDP socket: %s", strerror(errno));
-        return -1;
+// CSI_BYE [port] - the sender stops receiving the stream (all its ports if omitted)
+static bool handle_bye_command(const char *arguments) {
+    struct sockaddr_in sender;
+    if (!control_channel_request_sender(&sender)) {
+        printf("CSI_BYE is only accepted on the control port\n");
+        return false;
     }
     
-    // Enable broadcast for the socket
-    int broadcast_enable = 1;
-    if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable)) < 0) {
-        ESP_LOGW(APPLICATION_TAG, "Failed to enable broadcast: %s", strerror(errno));
+    unsigned int port = 0;
+    sscanf(arguments, "%u", &port);
+    esp_err_t result = udp_subscribers_remove(sender.sin_addr.s_addr, (uint16_t)port);
+    printf("%s\n", result == ESP_OK ? "Unsubscribed" : esp_err_to_name(result));
+    return result == ESP_OK;
+}
+
+// Format a CSI frame as a text CSV line, returns its length or 0 if it does not fit
+static size_t format_csi_text_record(const csi_frame_slot_t *frame, int64_t timestamp_us,
+                                     char *output_buffer, size_t buffer_size) {
+    const wifi_csi_info_t *csi_data = &frame->info;
+    
+    char mac_string[20] = {0};
+    format_mac_address((uint8_t *)csi_data->mac, mac_string);
+    
+    // Format the frame timestamp
+    char timestamp[TIMESTAMP_STRING_LENGTH];
+    format_timestamp_microseconds(timestamp_us, timestamp, sizeof(timestamp));
+    
+    // Build the formatted CSI data string
+    int offset = snprintf(output_buffer, buffer_size,
+                         "CSI_Data,AP,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%s,%d,[",
+                         mac_string,
+                         csi_data->rx_ctrl.rssi, csi_data->rx_ctrl.rate, csi_data->rx_ctrl.sig_mode,
+                         csi_data->rx_ctrl.mcs, csi_data->rx_ctrl.cwb, csi_data->rx_ctrl.smoothing,
+                         csi_data->rx_ctrl.not_sounding, csi_data->rx_ctrl.aggregation, csi_data->rx_ctrl.stbc,
+                         csi_data->rx_ctrl.fec_coding, csi_data->rx_ctrl.sgi, csi_data->rx_ctrl.noise_floor,
+                         csi_data->rx_ctrl.ampdu_cnt, csi_data->rx_ctrl.channel, csi_data->rx_ctrl.secondary_channel,
+                         csi_data->rx_ctrl.timestamp, csi_data->rx_ctrl.ant, csi_data->rx_ctrl.sig_len,
+                         csi_data->rx_ctrl.rx_state, (int)is_time_synchronized(),
+                         timestamp, csi_data->len);
+    
+    // Only the subcarriers selected by the mask
+    int8_t selected_iq[CSI_MAX_ENCODED_SUBCARRIERS * 2];
+    float amplitudes[CSI_MAX_ENCODED_SUBCARRIERS];
+    uint16_t kept[CSI_LTF_COUNT];
+    int pair_count = csi_capture_gather(csi_data, (csi_capture_profile_t)frame->capture_profile,
+                                        CSI_MAX_ENCODED_SUBCARRIERS, selected_iq, kept);
+    csi_compute_amplitudes(selected_iq, pair_count, amplitudes);
+    
+    for (int i = 0; i < pair_count && offset > 0 && offset < (int)buffer_size; i++) {
+        offset += snprintf(output_buffer + offset, buffer_size - offset, "%.4f ", amplitudes[i]);
     }
     
-    ESP_LOGI(APPLICATION_TAG, "UDP socket initialized successfully");
-    return sock;
+    // Close the data array, then the stream counters and the capture layout
+    return finish_csi_text_record(frame, kept, output_buffer, offset, buffer_size);
 }
 
-// Send CSI data via UDP
-static esp_err_t transmit_csi_data(wifi_csi_info_t *csi_data, const char *formatted_data) {
-    if (!app_state.host_discovered || app_state.udp_socket_descriptor < 0) {
-        return ESP_FAIL;
+// Text encoder of the amplitude mode; the other modes use the shared CSI_DATA layout
+static size_t encode_ap_text_record(const csi_frame_slot_t *frame, int64_t timestamp_us,
+                                     uint8_t *output, size_t capacity) {
+    return format_csi_text_record(frame, timestamp_us, (char *)output, capacity);
+}
+
+// UDP sink: batches records per subscriber and sends the periodic telemetry
+static esp_err_t udp_sink_write(csi_sink_t *sink, const uint8_t *record, size_t record_length) {
+    return udp_subscribers_append(record, record_length);
+}
+
+static int64_t udp_sink_idle(csi_sink_t *sink) {
+    // Pick up subscriber changes between records, never in the middle of a batch walk
+    udp_subscribers_apply_changes();
+    
+    // Send batches whose deadline passed, then sleep until new records or the next deadline
+    int64_t wait_us = udp_subscribers_poll();
+    
+    // Low-rate pipeline telemetry datagram
+    if (CONFIG_CSI_TELEMETRY_INTERVAL_MS > 0) {
+        int64_t until_telemetry_us = udp_next_telemetry_us - esp_timer_get_time();
+        if (until_telemetry_us <= 0) {
+            char telemetry[512];
+            size_t telemetry_length = pipeline_stats_format_telemetry(telemetry, sizeof(telemetry));
+            if (telemetry_length > 0) {
+                udp_subscribers_send_all(telemetry, telemetry_length);
+            }
+            udp_next_telemetry_us = esp_timer_get_time() + CONFIG_CSI_TELEMETRY_INTERVAL_MS * 1000LL;
+            until_telemetry_us = CONFIG_CSI_TELEMETRY_INTERVAL_MS * 1000LL;
+        }
+        if (wait_us < 0 || until_telemetry_us < wait_us) {
+            wait_us = until_telemetry_us;
+        }
     }
     
-    struct sockaddr_in dest_addr = {0};
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(HOST_COMMUNICATION_PORT);
-    dest_addr.sin_addr.s_addr = inet_addr(app_state.discovered_host_ip);
-    
-    int bytes_sent = sendto(app_state.udp_socket_descriptor, formatted_data, 
-                           strlen(formatted_data), 0, 
-                           (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    return wait_us;
+}
+
+// CSI_CHANNEL <1-13> - moves the AP, connected stations have to reassociate
+static bool handle_channel_command(const char *arguments) {
+    int channel = 0;
+    if (sscanf(arguments, "%d", &channel) != 1) {
+        printf("WiFi channel: %u\n", g_runtime_settings.wifi_channel);
+        return true;
+    }
+    if (channel < 1 || channel > 13) {
+        printf("Usage: CSI_CHANNEL <1-13>\n");
+        return false;
+    }
     
-    if (bytes_sent < 0) {
-        ESP_LOGE(APPLICATION_TAG, "UDP transmission failed: %s", strerror(errno));
-        return ESP_FAIL;
+    wifi_config_t ap_config;
+    esp_err_t result = esp_wifi_get_config(WIFI_IF_AP, &ap_config);
+    if (result == ESP_OK) {
+        ap_config.ap.channel = (uint8_t)channel;
+        result = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+    }
+    if (result != ESP_OK) {
+        printf("Channel change failed: %s\n", esp_err_to_name(result));
+        return false;
     }
     
-    app_state.processed_packets++;
-    return ESP_OK;
+    g_runtime_settings.wifi_channel = (uint8_t)channel;
+    printf("WiFi channel: %d\n", channel);
+    return csi_commands_save("WiFi channel");
 }
 
-// CSI data processing task
-static void csi_data_processing_task(void *parameters) {
-    ESP_LOGI(APPLICATION_TAG, "CSI data processing task started");
+// Register the output sinks with their build-time defaults
+static esp_err_t setup_csi_sinks(void) {
+    override_csi_encoder(CSI_MODE_AMPLITUDE, CSI_WIRE_FORMAT_TEXT, encode_ap_text_record);
+    select_csi_encoders();
     
-    wifi_csi_info_t *csi_data = NULL;
-    char *output_buffer = malloc(UDP_PAYLOAD_BUFFER_SIZE);
+    udp_next_telemetry_us = esp_timer_get_time() + CONFIG_CSI_TELEMETRY_INTERVAL_MS * 1000LL;
     
-    if (!output_buffer) {
-        ESP_LOGE(APPLICATION_TAG, "Failed to allocate output buffer");
-        vTaskDelete(NULL);
-        return;
+    esp_err_t result = csi_sink_register(CSI_SINK_UDP, udp_sink_write, udp_sink_idle, NULL,
+                               CSI_UDP_SINK_FORMAT, true, CONFIG_CSI_ENCODED_RING_SIZE,
+                               CONFIG_CSI_TRANSMIT_TASK_PRIORITY, CONFIG_CSI_TRANSMIT_TASK_STACK_SIZE,
+                               CSI_TASK_CORE(CONFIG_CSI_TRANSMIT_TASK_CORE));
+    if (result != ESP_OK) {
+        return result;
     }
     
-    while (true) {
-        // Wait for CSI data from queue
-        if (xQueueReceive(app_state.csi_data_queue, &csi_data, portMAX_DELAY) == pdTRUE) {
-            if (!csi_data) {
-                continue;
-            }
-            
-            // Format CSI data for transmission
-            memset(output_buffer, 0, UDP_PAYLOAD_BUFFER_SIZE);
-            
-            // Create formatted output using the enhanced CSI callback logic
-            char mac_string[20] = {0};
-            snprintf(mac_string, sizeof(mac_string), "%02X:%02X:%02X:%02X:%02X:%02X",
-                     csi_data->mac[0], csi_data->mac[1], csi_data->mac[2],
-                     csi_data->mac[3], csi_data->mac[4], csi_data->mac[5]);
-            
-            // Get current timestamp
-            char *timestamp = get_formatted_timestamp();
-            
-            // Build the formatted CSI data string
-            int offset = snprintf(output_buffer, UDP_PAYLOAD_BUFFER_SIZE,
-                                 "CSI_Data,AP,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%s,%d,[",
-                                 mac_string,
-                                 csi_data->rx_ctrl.rssi, csi_data->rx_ctrl.rate, csi_data->rx_ctrl.sig_mode,
-                                 csi_data->rx_ctrl.mcs, csi_data->rx_ctrl.cwb, csi_data->rx_ctrl.smoothing,
-                                 csi_data->rx_ctrl.not_sounding, csi_data->rx_ctrl.aggregation, csi_data->rx_ctrl.stbc,
-                                 csi_data->rx_ctrl.fec_coding, csi_data->rx_ctrl.sgi, csi_data->rx_ctrl.noise_floor,
-                                 csi_data->rx_ctrl.ampdu_cnt, csi_data->rx_ctrl.channel, csi_data->rx_ctrl.secondary_channel,
-                                 csi_data->rx_ctrl.timestamp, csi_data->rx_ctrl.ant, csi_data->rx_ctrl.sig_len,
-                                 csi_data->rx_ctrl.rx_state, (int)is_time_synchronized(),
-                                 timestamp ? timestamp : "0.0", csi_data->len);
-            
-            int8_t *data_ptr = csi_data->buf;
-            for (int i = 0; i < 64 && (i * 2 + 1) < csi_data->len && offset < (UDP_PAYLOAD_BUFFER_SIZE - 50); i++) {
-                double real_part = data_ptr[i * 2];
-                double imag_part = data_ptr[i * 2 + 1];
-                double amplitude = sqrt(real_part * real_part + imag_part * imag_part);
-                offset += snprintf(output_buffer + offset, UDP_PAYLOAD_BUFFER_SIZE - offset, "%.4f ", amplitude);
-            }
-            
-            // Close the data array
-            snprintf(output_buffer + offset, UDP_PAYLOAD_BUFFER_SIZE - offset, "]\n");
-            
-            // Transmit the formatted data
-            transmit_csi_data(csi_data, output_buffer);
-            
-            // Print to console as well
-            printf("%s", output_buffer);
-            
-            // Free allocated memory
-            if (timestamp) {
-                free(timestamp);
-            }
-            free(csi_data->buf);
-            free(csi_data);
-            csi_data = NULL;
-        }
+    result = csi_pipeline_register_serial_sink(CSI_SERIAL_SINK_FORMAT, CSI_SERIAL_SINK_ENABLED);
+    if (result != ESP_OK) {
+        return result;
     }
     
-    free(output_buffer);
-    vTaskDelete(NULL);
+#if CONFIG_SEND_CSI_TO_SD
+    // Untethered capture to the SD card; without a card the other sinks carry on
+    if (sd_capture_register_sink(true, CONFIG_CSI_SLOW_SINK_TASK_PRIORITY, CONFIG_CSI_SLOW_SINK_TASK_STACK_SIZE,
+                                 CSI_TASK_CORE(CONFIG_CSI_TRANSMIT_TASK_CORE)) == ESP_OK) {
+        register_csi_command("CSI_SD", "ROTATE | STATUS", sd_capture_command);
+    }
+#endif
+    
+    register_csi_command("CSI_SINK", "<UDP|SERIAL|SD> <ON|OFF> [TEXT|BINARY] | NONE | LIST", csi_sink_command);
+    register_csi_command("CSI_SUBSCRIBE", "ADD <ip>[:port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY] | DEL <ip>[:port] | LIST",
+                         udp_subscribers_command);
+    register_csi_command("CSI_HELLO", "[port] [mac|ANY] [RAW|AMPLITUDE|PHASE|FEATURES|ANY] (control port)", handle_hello_command);
+    register_csi_command("CSI_BYE", "[port] (control port)", handle_bye_command);
+    register_csi_command("CSI_STREAMS", "", csi_streams_command);
+    register_csi_command("CSI_WEIGHT", "[<mac> <1-16|DEFAULT>]", csi_scheduler_command);
+    register_csi_command("CSI_REPLAY", "[START <rate_hz|MAX> [stations] [seconds] | STOP | GENERATE <shape> [frames] | CLEAR]",
+                         csi_replay_command);
+    register_csi_command("CSI_TIMESYNC", "[SERVER [<ip>:]<port> | INTERVAL <s> | OFF]", time_sync_command);
+    register_csi_command("CSI_BURST", "[START [ms] | ARM [pre_ms] | TRIGGER [ms] | STOP | ABORT]", csi_burst_command);
+    return ESP_OK;
 }
 
 void app_main(void) {
@@ -471,16 +573,61 @@ void app_main(void) {
     reset_time_sync_status();
     ESP_LOGI(APPLICATION_TAG, "Timestamp manager initialized");
     
+    // Runtime settings: build defaults, replaced by the values saved over the command interfaces
+    g_runtime_settings.csi_mode = CSI_MODE_AMPLITUDE;
+    g_runtime_settings.overload_policy = CSI_OVERLOAD_DEFAULT_POLICY;
+    g_runtime_settings.wifi_channel = WIFI_CHANNEL_NUMBER;
+    g_runtime_settings.queue_depth = CONFIG_CSI_DATA_QUEUE_DEPTH;
+    g_runtime_settings.batch_max_bytes = CONFIG_CSI_UDP_BATCH_MAX_BYTES;
+    g_runtime_settings.batch_deadline_ms = CONFIG_CSI_UDP_BATCH_DEADLINE_MS;
+    g_runtime_settings.subcarrier_mask_preset = CSI_DEFAULT_SUBCARRIER_MASK;
+    g_runtime_settings.compression = CSI_COMPRESSION_DEFAULT;
+    g_runtime_settings.feature_interval_ms = CONFIG_CSI_FEATURE_INTERVAL_MS;
+    g_runtime_settings.capture_profile = CONFIG_CSI_CAPTURE_PROFILE_DEFAULT;
+    g_runtime_settings.stimulus_rate_hz = CONFIG_CSI_STIMULUS_RATE_HZ;
+    g_runtime_settings.phase_sanitize = CSI_PHASE_SANITIZE_DEFAULT;
+    if (runtime_settings_load() == ESP_OK) {
+        ESP_LOGI(APPLICATION_TAG, "Restored saved runtime settings");
+    }
+    
     // Initialize command processor
     initialize_command_processor(true);
+    register_csi_runtime_commands();
+    register_csi_command("CSI_CHANNEL", "[1-13]", handle_channel_command);
+    
+    // Restore the station allowlist and the scheduling weights
+    load_authorized_devices();
+    csi_scheduler_load_weights();
+    
+#if CONFIG_CSI_BENCHMARK_AT_BOOT
+    // Cost per frame on this chip, measured before the pipeline and WiFi run
+    csi_bench_run(CONFIG_CSI_BENCHMARK_FRAMES);
+    
+#endif
+    // Capture pipeline: preallocated frame slots, queue and encoder task, filtered by the allowlist
+    csi_pipeline_config_t pipeline_config = CSI_PIPELINE_DEFAULT_CONFIG();
+    pipeline_config.filter = is_authorized_research_device;
+    pipeline_config.queue_depth = g_runtime_settings.queue_depth;
+    pipeline_config.overload_policy = (csi_overload_policy_t)g_runtime_settings.overload_policy;
+    if (csi_pipeline_start(&pipeline_config) != ESP_OK) {
+        ESP_LOGE(APPLICATION_TAG, "Failed to start CSI pipeline");
+        return;
+    }
+    
+    // Subscriber table first, station events may subscribe hosts as soon as the AP is up
+    if (udp_subscribers_init(g_runtime_settings.batch_max_bytes, g_runtime_settings.batch_deadline_ms) != ESP_OK) {
+        ESP_LOGE(APPLICATION_TAG, "Failed to create UDP subscriber table");
+        return;
+    }
     
-    // Create CSI data queue
-    app_state.csi_data_queue = xQueueCreate(CSI_DATA_QUEUE_SIZE, sizeof(wifi_csi_info_t*));
-    if (!app_state.csi_data_queue) {
-        ESP_LOGE(APPLICATION_TAG, "Failed to create CSI data queue");
+    if (csi_stimulus_init() != ESP_OK) {
+        ESP_LOGE(APPLICATION_TAG, "Failed to create stimulus target queue");
         return;
     }
     
+    // Until a host is known the stream goes to the subnet broadcast
+    udp_subscribers_set_fallback(inet_addr(BROADCAST_ADDRESS), HOST_COMMUNICATION_PORT);
+    
     // Configure WiFi Access Point
     esp_err_t wifi_result = configure_wifi_access_point();
     if (wifi_result != ESP_OK) {
@@ -488,32 +635,69 @@ void app_main(void) {
         return;
     }
     
-    // Initialize UDP socket
-    app_state.udp_socket_descriptor = initialize_udp_socket();
-    if (app_state.udp_socket_descriptor < 0) {
-        ESP_LOGE(APPLICATION_TAG, "UDP socket initialization failed");
-        return;
-    }
-    
     // Initialize CSI collection with callback
-    esp_err_t csi_result = initialize_csi_collection("collector", CSI_MODE_AMPLITUDE, 
+    esp_err_t csi_result = initialize_csi_collection("collector", (csi_processing_mode_t)g_runtime_settings.csi_mode,
                                                      research_csi_data_callback);
     if (csi_result != ESP_OK) {
         ESP_LOGE(APPLICATION_TAG, "CSI initialization failed: %s", esp_err_to_name(csi_result));
         return;
     }
     
-    // Create processing tasks
-    xTaskCreate(csi_data_processing_task, "csi_processor", 
-                CSI_PROCESSING_STACK_SIZE, NULL, CSI_PROCESSING_TASK_PRIORITY, NULL);
+    // Capture and encoder options saved with the runtime settings
+    esp_err_t profile_result = csi_capture_profile_apply((csi_capture_profile_t)g_runtime_settings.capture_profile);
+    if (profile_result != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Capture profile %u not applied: %s", g_runtime_settings.capture_profile,
+                 esp_err_to_name(profile_result));
+    }
+    uint32_t subcarrier_bits[CSI_SUBCARRIER_MASK_WORDS];
+    memcpy(subcarrier_bits, g_runtime_settings.subcarrier_mask, sizeof(subcarrier_bits));
+    csi_subcarrier_mask_set((csi_subcarrier_mask_preset_t)g_runtime_settings.subcarrier_mask_preset, subcarrier_bits);
+    csi_features_set_interval(g_runtime_settings.feature_interval_ms);
+    csi_compression_set_enabled(g_runtime_settings.compression);
+    csi_phase_set_sanitize(g_runtime_settings.phase_sanitize);
+    
+    // Output sinks, each with its own ring and task
+    if (setup_csi_sinks() != ESP_OK) {
+        ESP_LOGE(APPLICATION_TAG, "Failed to set up CSI output sinks");
+        return;
+    }
+    
+    // Traffic generator, idle until a rate is set and an allowlisted station has an address
+    csi_stimulus_set_rate(g_runtime_settings.stimulus_rate_hz);
+    if (csi_stimulus_start(CONFIG_CSI_STIMULUS_TASK_PRIORITY, 4096, CSI_TASK_CORE(CONFIG_CSI_TRANSMIT_TASK_CORE)) != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Traffic generator unavailable");
+    }
+    
+    // Load test source, idle until CSI_REPLAY START; it runs where the WiFi driver calls back
+    if (csi_replay_init(research_csi_data_callback, CONFIG_CSI_REPLAY_TASK_PRIORITY, 4096, CSI_REPLAY_DEFAULT_CORE) != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Load test replay unavailable");
+    }
     
-    xTaskCreate(mdns_discovery_task, "mdns_discovery", 
+    // Burst recorder, idle until CSI_BURST START or ARM; the ring is allocated then
+    if (csi_burst_start_task(CONFIG_CSI_BURST_TASK_PRIORITY, 4096, tskNO_AFFINITY) != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Burst capture unavailable");
+    }
+    
+    xTaskCreate(mdns_advertise_task, "mdns_advertise", 
                 4096, NULL, 3, NULL);
     
+    // Same commands as the console, over UDP
+    if (control_channel_start(CONTROL_CHANNEL_PORT, 3, 4096) != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Control channel unavailable, console commands only");
+    }
+    
+    // Clock discipline against the collector's time server, idle until CSI_TIMESYNC SERVER
+    if (time_sync_start(4, 4096) != ESP_OK) {
+        ESP_LOGW(APPLICATION_TAG, "Time sync unavailable, SYNC_TIME over serial only");
+    }
+    
+    pipeline_stats_register_task("main", xTaskGetCurrentTaskHandle());
+    
     // Start command monitoring in main task
     ESP_LOGI(APPLICATION_TAG, "System initialization complete");
     ESP_LOGI(APPLICATION_TAG, "Access Point SSID: %s", WIFI_ACCESS_POINT_SSID);
     ESP_LOGI(APPLICATION_TAG, "Data transmission port: %d", HOST_COMMUNICATION_PORT);
+    ESP_LOGI(APPLICATION_TAG, "Control port: %d", CONTROL_CHANNEL_PORT);
     
     // Main command processing loop
     start_command_monitoring_loop();